@@ -0,0 +1,779 @@
+/*
+    Synthetic graph benchmark.
+
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ */
+
+/* Starts a private jackd on the dummy driver, adds N synthetic clients
+ * with M ports each, wires them into a chain, a fan-in, a fan-out or a
+ * random DAG, and reports what the engine costs: the per-phase cycle
+ * profile kept by the server (see jack_cycle_profile_t), the wakeup
+ * and process times each client sees (see jack_trace_slot_t), and
+ * xruns.  With -M it instead looks for the largest number of clients
+ * whose graph still fits the period.  Server options such as -r, where
+ * real-time scheduling is not available, go in -J.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <jack/jack.h>
+
+#include "internal.h"
+
+#define BENCH_MAX_PORTS 64
+#define BENCH_MAX_ARGS 64
+#define BENCH_POLL_USECS 20000          /* well inside one trace ring */
+
+typedef enum {
+	TopologyChain,
+	TopologyFanIn,
+	TopologyFanOut,
+	TopologyDAG
+} bench_topology_t;
+
+typedef struct {
+	jack_client_t *client;
+	jack_port_t *in[BENCH_MAX_PORTS];
+	jack_port_t *out[BENCH_MAX_PORTS];
+	int fed;                        /* has an upstream client */
+	int feeds;                      /* has a downstream client */
+	int slot;                       /* trace slot, or -1 */
+	uint32_t cursor;
+	jack_trace_entry_t *entries;
+	int n_entries;
+} bench_client_t;
+
+typedef struct {
+	unsigned long cycles;
+	unsigned long xruns;
+	unsigned long late;
+	uint32_t overhead_p99;          /* driver read, write, post-process */
+	uint32_t process_p99;
+} bench_result_t;
+
+static const char *server_name = "graphbench";
+static const char *jackd_path = JACK_LOCATION "/jackd";
+static char *jackd_options = NULL;
+static bench_topology_t topology = TopologyChain;
+static int n_clients = 8;
+static int n_ports = 2;
+static jack_time_t dsp_usecs = 0;
+static jack_nframes_t period = 256;
+static jack_nframes_t rate = 48000;
+static int seconds = 10;
+static int dag_percent = 30;
+static unsigned int seed = 1;
+static int find_max = 0;
+
+static pid_t server_pid = -1;
+static jack_client_t *monitor = NULL;
+static volatile unsigned long xruns = 0;
+static volatile sig_atomic_t interrupted = 0;
+
+static void
+usage (void)
+{
+	fprintf (stderr,
+		 "usage: jack_graph_bench [options]\n"
+		 "  -n clients      synthetic clients (default 8; the upper bound with -M)\n"
+		 "  -m ports        input and output ports per client (default 2)\n"
+		 "  -t topology     chain, fanin, fanout or dag (default chain)\n"
+		 "  -e percent      edge probability of the random DAG (default 30)\n"
+		 "  -S seed         seed of the random DAG (default 1)\n"
+		 "  -c usecs        DSP cost of each client per cycle (default 0)\n"
+		 "  -p frames       period size (default 256)\n"
+		 "  -r rate         sample rate (default 48000)\n"
+		 "  -s seconds      how long to measure (default 10)\n"
+		 "  -M              find the most clients that fit the period\n"
+		 "  -j path         jackd to run (default %s)\n"
+		 "  -J options      extra jackd options, before -d dummy\n"
+		 "  -N name         server name (default %s)\n",
+		 jackd_path, server_name);
+}
+
+static void
+start_server (void)
+{
+	char *argv[BENCH_MAX_ARGS];
+	char period_arg[32], rate_arg[32];
+	char *opt;
+	int argc = 0;
+
+	snprintf (period_arg, sizeof(period_arg), "%u", period);
+	snprintf (rate_arg, sizeof(rate_arg), "%u", rate);
+
+	argv[argc++] = (char*)jackd_path;
+	argv[argc++] = "-n";
+	argv[argc++] = (char*)server_name;
+	if (jackd_options) {
+		for (opt = strtok (jackd_options, " \t"); opt && argc < BENCH_MAX_ARGS - 8;
+		     opt = strtok (NULL, " \t")) {
+			argv[argc++] = opt;
+		}
+	}
+	argv[argc++] = "-d";
+	argv[argc++] = "dummy";
+	argv[argc++] = "-p";
+	argv[argc++] = period_arg;
+	argv[argc++] = "-r";
+	argv[argc++] = rate_arg;
+	argv[argc] = NULL;
+
+	if ((server_pid = fork ()) < 0) {
+		fprintf (stderr, "cannot fork jackd (%s)\n", strerror (errno));
+		exit (1);
+	}
+
+	if (server_pid == 0) {
+		execv (jackd_path, argv);
+		fprintf (stderr, "cannot run %s (%s)\n", jackd_path, strerror (errno));
+		_exit (1);
+	}
+}
+
+static void
+stop_server (void)
+{
+	if (monitor) {
+		jack_client_close (monitor);
+		monitor = NULL;
+	}
+	if (server_pid > 0) {
+		kill (server_pid, SIGTERM);
+		waitpid (server_pid, NULL, 0);
+		server_pid = -1;
+	}
+}
+
+/* main() stops the server once the trial sees this */
+static void
+signal_handler (int sig)
+{
+	interrupted = 1;
+}
+
+static jack_client_t *
+open_client (const char *name)
+{
+	jack_status_t status;
+
+	return jack_client_open (name, JackNoStartServer | JackServerName,
+				 &status, server_name);
+}
+
+static int
+xrun_callback (void *arg)
+{
+	xruns++;
+	return 0;
+}
+
+static void
+connect_monitor (void)
+{
+	int tries;
+
+	/* give the server a few seconds to come up */
+	for (tries = 0; tries < 50 && !interrupted; tries++) {
+		if ((monitor = open_client ("graphbench")) != NULL) {
+			break;
+		}
+		if (waitpid (server_pid, NULL, WNOHANG) == server_pid) {
+			server_pid = -1;
+			break;
+		}
+		usleep (100000);
+	}
+
+	if (monitor == NULL) {
+		fprintf (stderr, "cannot connect to %s\n", server_name);
+		stop_server ();
+		exit (1);
+	}
+
+	jack_set_xrun_callback (monitor, xrun_callback, NULL);
+
+	if (jack_activate (monitor)) {
+		fprintf (stderr, "cannot activate the monitor client\n");
+		stop_server ();
+		exit (1);
+	}
+}
+
+/* the work each synthetic client does: a gain on every port, then as
+   much busy time as it was asked to spend */
+static int
+bench_process (jack_nframes_t nframes, void *arg)
+{
+	bench_client_t *bc = (bench_client_t*)arg;
+	jack_default_audio_sample_t *in, *out;
+	jack_time_t until;
+	jack_nframes_t i;
+	int k;
+
+	for (k = 0; k < n_ports; k++) {
+		in = (jack_default_audio_sample_t*)
+		     jack_port_get_buffer (bc->in[k], nframes);
+		out = (jack_default_audio_sample_t*)
+		      jack_port_get_buffer (bc->out[k], nframes);
+		for (i = 0; i < nframes; i++) {
+			out[i] = in[i] * 0.5f;
+		}
+	}
+
+	if (dsp_usecs) {
+		until = jack_get_time () + dsp_usecs;
+		while (jack_get_time () < until) ;
+	}
+
+	return 0;
+}
+
+static int
+start_client (bench_client_t *bc, int index)
+{
+	char name[JACK_CLIENT_NAME_SIZE];
+	int k;
+
+	memset (bc, 0, sizeof(bench_client_t));
+	bc->slot = -1;
+
+	snprintf (name, sizeof(name), "bench-%d", index);
+	if ((bc->client = open_client (name)) == NULL) {
+		fprintf (stderr, "cannot open client %s\n", name);
+		return -1;
+	}
+
+	for (k = 0; k < n_ports; k++) {
+		snprintf (name, sizeof(name), "in_%d", k + 1);
+		bc->in[k] = jack_port_register (bc->client, name,
+						JACK_DEFAULT_AUDIO_TYPE,
+						JackPortIsInput, 0);
+		snprintf (name, sizeof(name), "out_%d", k + 1);
+		bc->out[k] = jack_port_register (bc->client, name,
+						 JACK_DEFAULT_AUDIO_TYPE,
+						 JackPortIsOutput, 0);
+		if (bc->in[k] == NULL || bc->out[k] == NULL) {
+			fprintf (stderr, "cannot register ports of %s\n",
+				 jack_get_client_name (bc->client));
+			return -1;
+		}
+	}
+
+	jack_set_process_callback (bc->client, bench_process, bc);
+
+	if (jack_activate (bc->client)) {
+		fprintf (stderr, "cannot activate %s\n",
+			 jack_get_client_name (bc->client));
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+add_op (jack_connection_op_t *ops, unsigned int *n, const char *src,
+	const char *dst)
+{
+	ops[*n].source_port = strdup (src);
+	ops[*n].destination_port = strdup (dst);
+	ops[*n].connect = 1;
+	(*n)++;
+}
+
+static void
+add_edge (bench_client_t *clients, jack_connection_op_t *ops,
+	  unsigned int *n, int from, int to)
+{
+	int k;
+
+	for (k = 0; k < n_ports; k++) {
+		add_op (ops, n, jack_port_name (clients[from].out[k]),
+			jack_port_name (clients[to].in[k]));
+	}
+	clients[from].feeds = 1;
+	clients[to].fed = 1;
+}
+
+/* Wire the clients into the topology, feeding the sources from the
+ * capture ports and mixing the sinks down to the playback ports, and
+ * apply it all in one batch.
+ */
+static int
+connect_graph (bench_client_t *clients, int n)
+{
+	const char **capture, **playback;
+	jack_connection_op_t *ops;
+	unsigned int n_ops = 0, max_ops, i;
+	int from, to, k, n_capture = 0, n_playback = 0, failed, ret = 0;
+
+	capture = jack_get_ports (monitor, NULL, NULL,
+				  JackPortIsPhysical | JackPortIsOutput);
+	playback = jack_get_ports (monitor, NULL, NULL,
+				   JackPortIsPhysical | JackPortIsInput);
+	while (capture && capture[n_capture]) {
+		n_capture++;
+	}
+	while (playback && playback[n_playback]) {
+		n_playback++;
+	}
+
+	max_ops = (unsigned int)(n * n + 2 * n) * n_ports;
+	if ((ops = (jack_connection_op_t*)
+		   calloc (max_ops, sizeof(jack_connection_op_t))) == NULL) {
+		fprintf (stderr, "cannot allocate %u connections\n", max_ops);
+		jack_free (capture);
+		jack_free (playback);
+		return -1;
+	}
+
+	switch (topology) {
+	case TopologyChain:
+		for (from = 0; from + 1 < n; from++) {
+			add_edge (clients, ops, &n_ops, from, from + 1);
+		}
+		break;
+	case TopologyFanIn:
+		for (from = 0; from + 1 < n; from++) {
+			add_edge (clients, ops, &n_ops, from, n - 1);
+		}
+		break;
+	case TopologyFanOut:
+		for (to = 1; to < n; to++) {
+			add_edge (clients, ops, &n_ops, 0, to);
+		}
+		break;
+	case TopologyDAG:
+		srandom (seed);
+		for (to = 1; to < n; to++) {
+			/* everything but the first client has at least
+			   one input, so the graph is connected */
+			add_edge (clients, ops, &n_ops, random () % to, to);
+			for (from = 0; from < to; from++) {
+				if (random () % 100 < dag_percent) {
+					add_edge (clients, ops, &n_ops, from, to);
+				}
+			}
+		}
+		break;
+	}
+
+	for (i = 0; i < (unsigned int)n; i++) {
+		for (k = 0; k < n_ports; k++) {
+			if (!clients[i].fed && n_capture) {
+				add_op (ops, &n_ops, capture[k % n_capture],
+					jack_port_name (clients[i].in[k]));
+			}
+			if (!clients[i].feeds && n_playback) {
+				add_op (ops, &n_ops,
+					jack_port_name (clients[i].out[k]),
+					playback[k % n_playback]);
+			}
+		}
+	}
+
+	/* the DAG may repeat an edge, which the batch does not count
+	   as a failure */
+	if ((failed = jack_connect_batch (monitor, ops, n_ops, NULL)) != 0) {
+		fprintf (stderr, "cannot connect the graph (%d failed)\n",
+			 failed);
+		ret = -1;
+	}
+
+	for (i = 0; i < n_ops; i++) {
+		free ((char*)ops[i].source_port);
+		free ((char*)ops[i].destination_port);
+	}
+	free (ops);
+	jack_free (capture);
+	jack_free (playback);
+
+	return ret;
+}
+
+static void
+read_traces (bench_client_t *clients, int n, int max_entries)
+{
+	bench_client_t *bc;
+	int i, got;
+
+	for (i = 0; i < n; i++) {
+		bc = &clients[i];
+		if (bc->slot < 0) {
+			/* the server may not have traced it yet */
+			bc->slot = jack_trace_slot_by_name
+					   (monitor, jack_get_client_name (bc->client));
+		}
+		if (bc->slot < 0 || bc->entries == NULL) {
+			continue;
+		}
+		got = jack_trace_read (monitor, bc->slot, &bc->cursor,
+				       bc->entries + bc->n_entries,
+				       max_entries - bc->n_entries);
+		if (got > 0) {
+			bc->n_entries += got;
+		}
+	}
+}
+
+static void
+report_profile (const jack_cycle_profile_t *profile,
+		const jack_cycle_profile_t *total)
+{
+	const jack_profile_histogram_t *hist;
+	int phase;
+
+	printf ("%-14s %10s %8s %8s %8s %8s\n", "phase", "cycles",
+		"mean", "p50", "p99", "max");
+
+	for (phase = 0; phase < JackProfilePhases; phase++) {
+		hist = &profile->phase[phase];
+		printf ("%-14s %10u %8.1f %8u %8u %8u\n",
+			jack_profile_phase_name ((jack_profile_phase_t)phase),
+			hist->count,
+			hist->count ? (double)hist->total_usecs / hist->count : 0.0,
+			jack_profile_percentile (hist, 50.0f),
+			jack_profile_percentile (hist, 99.0f),
+			total->phase[phase].max_usecs);
+	}
+}
+
+static void
+report_traces (bench_client_t *clients, int n, bench_result_t *result)
+{
+	jack_trace_entry_t *all;
+	int i, j, total = 0;
+
+	for (i = 0; i < n; i++) {
+		total += clients[i].n_entries;
+	}
+
+	if (total == 0) {
+		printf ("no client traces\n");
+		return;
+	}
+
+	if ((all = (jack_trace_entry_t*)
+		   malloc (total * sizeof(jack_trace_entry_t))) == NULL) {
+		fprintf (stderr, "cannot allocate %d trace entries\n", total);
+		return;
+	}
+	for (i = 0, total = 0; i < n; i++) {
+		for (j = 0; j < clients[i].n_entries; j++) {
+			if (clients[i].entries[j].flags & JackTraceLate) {
+				result->late++;
+			}
+			all[total++] = clients[i].entries[j];
+		}
+	}
+
+	printf ("%-14s %10s %8s %8s %8s\n", "clients", "entries",
+		"p50", "p99", "p99.9");
+	printf ("%-14s %10d %8u %8u %8u\n", "wakeup", total,
+		jack_trace_percentile (all, total, JackTraceWakeup, 50.0f),
+		jack_trace_percentile (all, total, JackTraceWakeup, 99.0f),
+		jack_trace_percentile (all, total, JackTraceWakeup, 99.9f));
+	printf ("%-14s %10d %8u %8u %8u\n", "process", total,
+		jack_trace_percentile (all, total, JackTraceProcess, 50.0f),
+		jack_trace_percentile (all, total, JackTraceProcess, 99.0f),
+		jack_trace_percentile (all, total, JackTraceProcess, 99.9f));
+	printf ("%-14s %10d %8u %8u %8u\n", "finish", total,
+		jack_trace_percentile (all, total, JackTraceFinish, 50.0f),
+		jack_trace_percentile (all, total, JackTraceFinish, 99.0f),
+		jack_trace_percentile (all, total, JackTraceFinish, 99.9f));
+
+	free (all);
+}
+
+/* Run `n' clients for the measuring time and report what happened. */
+static int
+run_trial (int n, bench_result_t *result, int verbose)
+{
+	bench_client_t *clients;
+	jack_cycle_profile_t then, now, total;
+	jack_time_t end;
+	int max_entries, i, ret = -1;
+
+	memset (result, 0, sizeof(bench_result_t));
+
+	if ((clients = (bench_client_t*)
+		       calloc (n, sizeof(bench_client_t))) == NULL) {
+		fprintf (stderr, "cannot allocate %d clients\n", n);
+		return -1;
+	}
+	max_entries = seconds * (rate / period + 1) + JACK_TRACE_RING;
+
+	for (i = 0; i < n; i++) {
+		if (start_client (&clients[i], i)) {
+			n = i + (clients[i].client != NULL);
+			goto out;
+		}
+	}
+
+	if (connect_graph (clients, n)) {
+		goto out;
+	}
+
+	/* let the graph settle before counting anything */
+	sleep (1);
+
+	for (i = 0; i < n; i++) {
+		clients[i].entries = (jack_trace_entry_t*)
+				     malloc (max_entries * sizeof(jack_trace_entry_t));
+	}
+	/* skip what the rings hold from before */
+	read_traces (clients, n, max_entries);
+	for (i = 0; i < n; i++) {
+		clients[i].n_entries = 0;
+	}
+
+	if (jack_profile_read (monitor, &then)) {
+		memset (&then, 0, sizeof(then));
+	}
+	xruns = 0;
+
+	end = jack_get_time () + (jack_time_t)seconds * 1000000;
+	while (jack_get_time () < end) {
+		if (interrupted) {
+			goto out;
+		}
+		usleep (BENCH_POLL_USECS);
+		read_traces (clients, n, max_entries);
+	}
+
+	result->xruns = xruns;
+	if (jack_profile_read (monitor, &now)) {
+		fprintf (stderr, "cannot read the cycle profile\n");
+		goto out;
+	}
+	total = now;
+	jack_profile_since (&now, &then);
+	result->cycles = now.phase[JackProfileProcess].count;
+	result->process_p99 =
+		jack_profile_percentile (&now.phase[JackProfileProcess], 99.0f);
+	result->overhead_p99 =
+		jack_profile_percentile (&now.phase[JackProfileRead], 99.0f)
+		+ jack_profile_percentile (&now.phase[JackProfileWrite], 99.0f)
+		+ jack_profile_percentile (&now.phase[JackProfilePostProcess], 99.0f);
+
+	if (verbose) {
+		report_profile (&now, &total);
+		printf ("\n");
+	}
+	report_traces (clients, n, result);
+	if (verbose) {
+		printf ("\n");
+	}
+	ret = 0;
+
+out:
+	for (i = 0; i < n; i++) {
+		if (clients[i].client) {
+			jack_client_close (clients[i].client);
+		}
+		free (clients[i].entries);
+	}
+	free (clients);
+
+	return ret;
+}
+
+/* the whole cycle, client graph included, has to fit the period */
+static int
+trial_fits (const bench_result_t *result)
+{
+	jack_time_t period_usecs = (jack_time_t)period * 1000000 / rate;
+
+	return result->xruns == 0 && result->late == 0
+	       && result->process_p99 + result->overhead_p99 <= period_usecs;
+}
+
+static void
+report_trial (int n, const bench_result_t *result)
+{
+	printf ("%4d clients: %lu cycles, %lu xruns, %lu late, "
+		"graph p99 %u usecs, server overhead p99 %u usecs: %s\n\n",
+		n, result->cycles, result->xruns, result->late,
+		result->process_p99, result->overhead_p99,
+		trial_fits (result) ? "fits" : "does not fit");
+}
+
+static int
+find_max_clients (void)
+{
+	bench_result_t result;
+	int good = 0, bad = n_clients + 1, n;
+
+	/* double until it no longer fits, then bisect */
+	for (n = 1; n <= n_clients; n *= 2) {
+		if (run_trial (n, &result, 0)) {
+			return -1;
+		}
+		report_trial (n, &result);
+		if (!trial_fits (&result)) {
+			bad = n;
+			break;
+		}
+		good = n;
+	}
+
+	if (bad > n_clients && good < n_clients) {
+		/* the bound itself was skipped over by doubling */
+		n = n_clients;
+		if (run_trial (n, &result, 0)) {
+			return -1;
+		}
+		report_trial (n, &result);
+		if (trial_fits (&result)) {
+			good = n;
+		} else {
+			bad = n;
+		}
+	}
+
+	while (bad - good > 1) {
+		n = (good + bad) / 2;
+		if (run_trial (n, &result, 0)) {
+			return -1;
+		}
+		report_trial (n, &result);
+		if (trial_fits (&result)) {
+			good = n;
+		} else {
+			bad = n;
+		}
+	}
+
+	return good;
+}
+
+static const char *topology_names[] = { "chain", "fanin", "fanout", "dag" };
+
+int
+main (int argc, char *argv[])
+{
+	bench_result_t result;
+	int c, i, max, ret = 0;
+
+	while ((c = getopt (argc, argv, "n:m:t:e:S:c:p:r:s:Mj:J:N:h")) != -1) {
+		switch (c) {
+		case 'n':
+			n_clients = atoi (optarg);
+			break;
+		case 'm':
+			n_ports = atoi (optarg);
+			break;
+		case 't':
+			for (i = 0; i < 4; i++) {
+				if (strcmp (optarg, topology_names[i]) == 0) {
+					break;
+				}
+			}
+			if (i == 4) {
+				fprintf (stderr, "unknown topology %s\n", optarg);
+				usage ();
+				return 1;
+			}
+			topology = (bench_topology_t)i;
+			break;
+		case 'e':
+			dag_percent = atoi (optarg);
+			break;
+		case 'S':
+			seed = strtoul (optarg, NULL, 0);
+			break;
+		case 'c':
+			dsp_usecs = strtoul (optarg, NULL, 0);
+			break;
+		case 'p':
+			period = strtoul (optarg, NULL, 0);
+			break;
+		case 'r':
+			rate = strtoul (optarg, NULL, 0);
+			break;
+		case 's':
+			seconds = atoi (optarg);
+			break;
+		case 'M':
+			find_max = 1;
+			break;
+		case 'j':
+			jackd_path = optarg;
+			break;
+		case 'J':
+			jackd_options = optarg;
+			break;
+		case 'N':
+			server_name = optarg;
+			break;
+		default:
+			usage ();
+			return 1;
+		}
+	}
+
+	if (n_clients < 1 || n_ports < 1 || n_ports > BENCH_MAX_PORTS
+	    || period == 0 || rate == 0 || seconds < 1) {
+		usage ();
+		return 1;
+	}
+
+	if (n_clients > JACK_TRACE_SLOTS) {
+		fprintf (stderr, "note: the server traces %d clients at most\n",
+			 JACK_TRACE_SLOTS);
+	}
+
+	signal (SIGINT, signal_handler);
+	signal (SIGTERM, signal_handler);
+
+	start_server ();
+	connect_monitor ();
+
+	printf ("%s, %d ports per client, %u usecs DSP, %u frames at %u Hz "
+		"(%u usecs)\n\n", topology_names[topology], n_ports,
+		(unsigned int)dsp_usecs, period, rate,
+		(unsigned int)((jack_time_t)period * 1000000 / rate));
+
+	if (find_max) {
+		if ((max = find_max_clients ()) < 0) {
+			ret = 1;
+		} else {
+			printf ("most clients that fit the period: %d\n", max);
+		}
+	} else {
+		if (run_trial (n_clients, &result, 1)) {
+			ret = 1;
+		} else {
+			report_trial (n_clients, &result);
+		}
+	}
+
+	stop_server ();
+
+	return ret;
+}
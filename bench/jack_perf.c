@@ -0,0 +1,181 @@
+/*
+    Cycle profile tool.
+
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ */
+
+/* Reads the per-phase cycle profile of a running server (see
+ * <jack/profile.h>) at a fixed interval and prints, for the cycles of
+ * each interval, how long every phase of the server's own work took:
+ * the driver wakeup jitter, the driver read, the client graph, the
+ * driver write and the post-processing.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <jack/jack.h>
+
+#include "profile.h"
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void
+show_usage (void)
+{
+	fprintf (stderr,
+		 "usage: jack_perf [options]\n"
+		 "  -s, --server name     connect to the server called name\n"
+		 "  -i, --interval secs   report every secs seconds (default 1)\n"
+		 "  -c, --count n         stop after n reports (default 0, never)\n"
+		 "  -a, --all             report everything since the server started\n"
+		 "                        and exit\n"
+		 "  -h, --help            show this message\n");
+}
+
+static void
+signal_handler (int sig)
+{
+	interrupted = 1;
+}
+
+static void
+report (const jack_cycle_profile_t *profile)
+{
+	const jack_profile_histogram_t *hist;
+	int phase;
+
+	printf ("%-14s %9s %8s %8s %8s %8s %8s\n", "usecs", "cycles",
+		"mean", "p50", "p99", "p99.9", "max");
+
+	for (phase = 0; phase < JackProfilePhases; phase++) {
+		hist = &profile->phase[phase];
+		printf ("%-14s %9u %8u %8u %8u %8u %8u\n",
+			jack_profile_phase_name ((jack_profile_phase_t)phase),
+			hist->count,
+			hist->count ?
+			(uint32_t)(hist->total_usecs / hist->count) : 0,
+			jack_profile_percentile (hist, 50.0f),
+			jack_profile_percentile (hist, 99.0f),
+			jack_profile_percentile (hist, 99.9f),
+			hist->max_usecs);
+	}
+
+	printf ("\n");
+	fflush (stdout);
+}
+
+int
+main (int argc, char *argv[])
+{
+	jack_options_t options = JackNoStartServer;
+	jack_status_t status;
+	jack_client_t *client;
+	jack_cycle_profile_t then, now, next;
+	const char *server_name = NULL;
+	int interval = 1, count = 0, all = 0, reports = 0;
+	int c, ret = 0;
+
+	const char *short_options = "s:i:c:ah";
+	struct option long_options[] = {
+		{ "server", 1, 0, 's' },
+		{ "interval", 1, 0, 'i' },
+		{ "count", 1, 0, 'c' },
+		{ "all", 0, 0, 'a' },
+		{ "help", 0, 0, 'h' },
+		{ 0, 0, 0, 0 }
+	};
+
+	while ((c = getopt_long (argc, argv, short_options, long_options,
+				 NULL)) != -1) {
+		switch (c) {
+		case 's':
+			server_name = optarg;
+			options |= JackServerName;
+			break;
+		case 'i':
+			interval = atoi (optarg);
+			break;
+		case 'c':
+			count = atoi (optarg);
+			break;
+		case 'a':
+			all = 1;
+			break;
+		default:
+			show_usage ();
+			return 1;
+		}
+	}
+
+	if (interval < 1 || count < 0) {
+		show_usage ();
+		return 1;
+	}
+
+	if ((client = jack_client_open ("jack_perf", options, &status,
+					server_name)) == NULL) {
+		fprintf (stderr, "cannot connect to the JACK server\n");
+		return 1;
+	}
+
+	if (jack_profile_read (client, &then)) {
+		fprintf (stderr, "cannot read the cycle profile\n");
+		jack_client_close (client);
+		return 1;
+	}
+
+	if (all) {
+		report (&then);
+		jack_client_close (client);
+		return 0;
+	}
+
+	signal (SIGINT, signal_handler);
+	signal (SIGTERM, signal_handler);
+
+	/* the longest times are kept from the start of the server */
+	printf ("every %d s, max since the server started\n\n", interval);
+
+	while (!interrupted && (count == 0 || reports < count)) {
+		sleep (interval);
+		if (interrupted) {
+			break;
+		}
+		if (jack_profile_read (client, &now)) {
+			fprintf (stderr, "cannot read the cycle profile\n");
+			ret = 1;
+			break;
+		}
+		memcpy (&next, &now, sizeof(now));
+		jack_profile_since (&now, &then);
+		report (&now);
+		memcpy (&then, &next, sizeof(next));
+		reports++;
+	}
+
+	jack_client_close (client);
+
+	return ret;
+}
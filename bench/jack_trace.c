@@ -0,0 +1,411 @@
+/*
+    Cycle timing trace tool.
+
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ */
+
+/* Reads the per-client cycle timing trace of a running server (see
+ * <jack/trace.h>) for a while, optionally printing every entry as it
+ * arrives, and then prints the wakeup, process and finish percentiles
+ * of each client, and a histogram of one of them if asked to.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <jack/jack.h>
+#include "trace.h"
+
+#define TRACE_POLL_USECS 20000          /* well inside one trace ring */
+
+typedef struct {
+	int in_use;
+	char *name;
+	uint32_t cursor;
+	jack_trace_entry_t *entries;
+	int n_entries;
+	int max_entries;
+	unsigned long late;
+	unsigned long unfinished;
+} trace_client_t;
+
+static trace_client_t clients[JACK_TRACE_SLOTS];
+static trace_client_t *gone = NULL;     /* slots handed to a new client */
+static int n_gone = 0;
+static jack_client_t *client;
+static const char *only_client = NULL;
+static int follow = 0;
+static volatile sig_atomic_t interrupted = 0;
+
+static const char *field_names[] = { "wakeup", "process", "finish" };
+
+static void
+show_usage (void)
+{
+	fprintf (stderr,
+		 "usage: jack_trace [options]\n"
+		 "  -s, --server name    connect to the server called name\n"
+		 "  -c, --client name    only trace the client called name\n"
+		 "  -l, --list           list the traced clients and exit\n"
+		 "  -t, --time seconds   how long to read the trace (default 10,\n"
+		 "                       0 until interrupted)\n"
+		 "  -f, --follow         print every entry as it is read\n"
+		 "  -b, --bucket usecs   also print a histogram with buckets this wide\n"
+		 "  -n, --buckets count  number of histogram buckets (default 20)\n"
+		 "  -F, --field name     wakeup, process or finish: what the\n"
+		 "                       histogram counts (default process)\n"
+		 "  -h, --help           show this message\n");
+}
+
+static void
+signal_handler (int sig)
+{
+	interrupted = 1;
+}
+
+static void
+list_clients (void)
+{
+	char *name = (char*)malloc (jack_client_name_size ());
+	int slot;
+
+	if (name == NULL) {
+		return;
+	}
+
+	for (slot = 0; slot < JACK_TRACE_SLOTS; slot++) {
+		if (jack_trace_slot_name (client, slot, name) == 0) {
+			printf ("%2d %s\n", slot, name);
+		}
+	}
+
+	free (name);
+}
+
+/* Look at what `slot' holds now.  Returns non-zero if it is to be
+ * read.  A slot that is handed to another client starts afresh.
+ */
+static int
+update_slot (int slot, char *name)
+{
+	trace_client_t *tc = &clients[slot];
+
+	if (jack_trace_slot_name (client, slot, name)
+	    || (only_client && strcmp (name, only_client) != 0)) {
+		return 0;
+	}
+
+	if (tc->in_use && strcmp (tc->name, name) == 0) {
+		return 1;
+	}
+
+	if (tc->in_use) {
+		/* keep what the old client left for the report */
+		trace_client_t *more;
+
+		if ((more = (trace_client_t*)
+			    realloc (gone, (n_gone + 1) * sizeof(trace_client_t)))) {
+			gone = more;
+			gone[n_gone++] = *tc;
+		} else {
+			free (tc->name);
+			free (tc->entries);
+		}
+	}
+
+	memset (tc, 0, sizeof(trace_client_t));
+	if ((tc->name = strdup (name)) == NULL) {
+		return 0;
+	}
+	tc->in_use = 1;
+
+	return 1;
+}
+
+static int
+store_entry (trace_client_t *tc, const jack_trace_entry_t *entry)
+{
+	jack_trace_entry_t *entries;
+	int max;
+
+	if (tc->n_entries == tc->max_entries) {
+		max = tc->max_entries ? 2 * tc->max_entries : 4 * JACK_TRACE_RING;
+		if ((entries = (jack_trace_entry_t*)
+			       realloc (tc->entries,
+					max * sizeof(jack_trace_entry_t))) == NULL) {
+			fprintf (stderr, "out of memory for the trace of %s\n",
+				 tc->name);
+			return -1;
+		}
+		tc->entries = entries;
+		tc->max_entries = max;
+	}
+
+	tc->entries[tc->n_entries++] = *entry;
+
+	if (entry->flags & JackTraceLate) {
+		tc->late++;
+	}
+	if (entry->flags & JackTraceUnfinished) {
+		tc->unfinished++;
+	}
+
+	return 0;
+}
+
+/* Read whatever every traced client has added since the last time.
+ * With `skip' set, only move the cursors past it.
+ */
+static int
+read_traces (char *name, int skip)
+{
+	jack_trace_entry_t ring[JACK_TRACE_RING];
+	trace_client_t *tc;
+	int slot, got, i;
+
+	for (slot = 0; slot < JACK_TRACE_SLOTS; slot++) {
+
+		if (!update_slot (slot, name)) {
+			continue;
+		}
+
+		tc = &clients[slot];
+
+		if ((got = jack_trace_read (client, slot, &tc->cursor, ring,
+					    JACK_TRACE_RING)) <= 0 || skip) {
+			continue;
+		}
+
+		for (i = 0; i < got; i++) {
+			if (follow) {
+				printf ("%-32s %10u %8u %8u %8u%s%s\n",
+					tc->name, ring[i].cycle,
+					ring[i].wakeup_usecs,
+					ring[i].process_usecs,
+					ring[i].finish_usecs,
+					ring[i].flags & JackTraceLate ?
+					" late" : "",
+					ring[i].flags & JackTraceUnfinished ?
+					" unfinished" : "");
+			}
+			if (store_entry (tc, &ring[i])) {
+				return -1;
+			}
+		}
+	}
+
+	if (follow) {
+		fflush (stdout);
+	}
+
+	return 0;
+}
+
+static void
+report_client (const trace_client_t *tc, jack_trace_field_t hist_field,
+	       uint32_t bucket_usecs, int nbuckets)
+{
+	uint32_t *buckets;
+	int f, b;
+
+	printf ("%s: %d cycles, %lu late, %lu unfinished\n",
+		tc->name, tc->n_entries, tc->late, tc->unfinished);
+
+	if (tc->n_entries == 0) {
+		return;
+	}
+
+	printf ("  %-10s %8s %8s %8s %8s\n", "", "p50", "p99", "p99.9", "max");
+	for (f = JackTraceWakeup; f <= JackTraceFinish; f++) {
+		printf ("  %-10s %8u %8u %8u %8u\n", field_names[f],
+			jack_trace_percentile (tc->entries, tc->n_entries,
+					       (jack_trace_field_t)f, 50.0f),
+			jack_trace_percentile (tc->entries, tc->n_entries,
+					       (jack_trace_field_t)f, 99.0f),
+			jack_trace_percentile (tc->entries, tc->n_entries,
+					       (jack_trace_field_t)f, 99.9f),
+			jack_trace_percentile (tc->entries, tc->n_entries,
+					       (jack_trace_field_t)f, 100.0f));
+	}
+
+	if (bucket_usecs == 0
+	    || (buckets = (uint32_t*)malloc (nbuckets * sizeof(uint32_t))) == NULL) {
+		return;
+	}
+
+	jack_trace_histogram (tc->entries, tc->n_entries, hist_field,
+			      bucket_usecs, buckets, nbuckets);
+
+	printf ("  %s usecs:\n", field_names[hist_field]);
+	for (b = 0; b < nbuckets; b++) {
+		if (b == nbuckets - 1) {
+			printf ("  %6u -        %8u\n", b * bucket_usecs,
+				buckets[b]);
+		} else {
+			printf ("  %6u - %6u %8u\n", b * bucket_usecs,
+				(b + 1) * bucket_usecs - 1, buckets[b]);
+		}
+	}
+
+	free (buckets);
+}
+
+int
+main (int argc, char *argv[])
+{
+	jack_options_t options = JackNoStartServer;
+	jack_status_t status;
+	jack_trace_field_t hist_field = JackTraceProcess;
+	jack_time_t end;
+	const char *server_name = NULL;
+	uint32_t bucket_usecs = 0;
+	int seconds = 10, nbuckets = 20, list = 0;
+	int c, i, ret = 0;
+	char *name;
+
+	const char *short_options = "s:c:lt:fb:n:F:h";
+	struct option long_options[] = {
+		{ "server", 1, 0, 's' },
+		{ "client", 1, 0, 'c' },
+		{ "list", 0, 0, 'l' },
+		{ "time", 1, 0, 't' },
+		{ "follow", 0, 0, 'f' },
+		{ "bucket", 1, 0, 'b' },
+		{ "buckets", 1, 0, 'n' },
+		{ "field", 1, 0, 'F' },
+		{ "help", 0, 0, 'h' },
+		{ 0, 0, 0, 0 }
+	};
+
+	while ((c = getopt_long (argc, argv, short_options, long_options,
+				 NULL)) != -1) {
+		switch (c) {
+		case 's':
+			server_name = optarg;
+			options |= JackServerName;
+			break;
+		case 'c':
+			only_client = optarg;
+			break;
+		case 'l':
+			list = 1;
+			break;
+		case 't':
+			seconds = atoi (optarg);
+			break;
+		case 'f':
+			follow = 1;
+			break;
+		case 'b':
+			bucket_usecs = strtoul (optarg, NULL, 0);
+			break;
+		case 'n':
+			nbuckets = atoi (optarg);
+			break;
+		case 'F':
+			for (i = JackTraceWakeup; i <= JackTraceFinish; i++) {
+				if (strcmp (optarg, field_names[i]) == 0) {
+					break;
+				}
+			}
+			if (i > JackTraceFinish) {
+				fprintf (stderr, "unknown field %s\n", optarg);
+				show_usage ();
+				return 1;
+			}
+			hist_field = (jack_trace_field_t)i;
+			break;
+		default:
+			show_usage ();
+			return 1;
+		}
+	}
+
+	if (seconds < 0 || nbuckets < 1) {
+		show_usage ();
+		return 1;
+	}
+
+	if ((client = jack_client_open ("jack_trace", options, &status,
+					server_name)) == NULL) {
+		fprintf (stderr, "cannot connect to the JACK server\n");
+		return 1;
+	}
+
+	if (list) {
+		list_clients ();
+		jack_client_close (client);
+		return 0;
+	}
+
+	if ((name = (char*)malloc (jack_client_name_size ())) == NULL) {
+		jack_client_close (client);
+		return 1;
+	}
+
+	signal (SIGINT, signal_handler);
+	signal (SIGTERM, signal_handler);
+
+	/* only what happens from now on */
+	read_traces (name, 1);
+
+	if (follow) {
+		printf ("%-32s %10s %8s %8s %8s\n", "client", "cycle",
+			"wakeup", "process", "finish");
+	}
+
+	end = jack_get_time () + (jack_time_t)seconds * 1000000;
+	while (!interrupted && (seconds == 0 || jack_get_time () < end)) {
+		usleep (TRACE_POLL_USECS);
+		if (read_traces (name, 0)) {
+			ret = 1;
+			break;
+		}
+	}
+
+	if (follow) {
+		printf ("\n");
+	}
+
+	for (i = 0; i < n_gone; i++) {
+		report_client (&gone[i], hist_field, bucket_usecs, nbuckets);
+		free (gone[i].name);
+		free (gone[i].entries);
+	}
+	free (gone);
+
+	for (i = 0; i < JACK_TRACE_SLOTS; i++) {
+		if (clients[i].in_use) {
+			report_client (&clients[i], hist_field, bucket_usecs,
+				       nbuckets);
+			free (clients[i].name);
+			free (clients[i].entries);
+		}
+	}
+
+	free (name);
+	jack_client_close (client);
+
+	return ret;
+}
@@ -0,0 +1,229 @@
+/*
+    netjack packet cache benchmark.
+
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ */
+
+/* Feeds the netjack packet cache the way the net driver does, without
+ * a socket: every period the fragments of one packet arrive, some
+ * periods ahead of the one being played and out of order, and the
+ * driver then asks for the next available packet and the fill level,
+ * retrieves the expected packet and releases it.  The time per period
+ * is reported for several cache depths.  The frame count starts just
+ * below 2^32, so every run also goes through its wrap; a packet that
+ * cannot be retrieved, or comes back with the wrong frame count, fails
+ * the run.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "netjack_packet.h"
+
+#define NJB_MTU 1500
+
+static const int default_depths[] = { 16, 64, 256 };
+
+static int periods = 200000;
+static int fragments = 8;
+
+static void
+show_usage (void)
+{
+	fprintf (stderr,
+		 "usage: netjack_cache_bench [options]\n"
+		 "  -d, --depth packets      cache depth (default 16, 64 and 256)\n"
+		 "  -f, --fragments n        fragments per packet (default 8)\n"
+		 "  -n, --periods n          periods per run (default 200000)\n"
+		 "  -h, --help               show this message\n");
+}
+
+static double
+now_nsecs (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Build the fragments of the packet for `framecnt' in `frags'. */
+static void
+make_packet (char *frags, jack_nframes_t framecnt)
+{
+	jacknet_packet_header *pkthdr;
+	int i;
+
+	for (i = 0; i < fragments; i++) {
+		pkthdr = (jacknet_packet_header*)(frags + i * NJB_MTU);
+		pkthdr->framecnt = htonl (framecnt);
+		pkthdr->fragment_nr = htonl (i);
+	}
+}
+
+/* Deliver the fragments of the packet for `framecnt', last first. */
+static void
+deliver (packet_cache *pcache, char *frags, jack_nframes_t framecnt)
+{
+	cache_packet *cpack;
+	int i;
+
+	make_packet (frags, framecnt);
+
+	if ((cpack = packet_cache_get_packet (pcache, framecnt)) == NULL) {
+		return;
+	}
+
+	for (i = fragments - 1; i >= 0; i--) {
+		cache_packet_add_fragment (cpack, frags + i * NJB_MTU, NJB_MTU);
+	}
+}
+
+static int
+run (int depth)
+{
+	int pkt_size = sizeof(jacknet_packet_header)
+		       + fragments * (NJB_MTU - sizeof(jacknet_packet_header));
+	int ahead = depth / 2, failed = 0, t;
+	jack_nframes_t start = 0xffffffff - periods / 2;
+	jack_nframes_t expected, avail;
+	jacknet_packet_header *pkthdr;
+	packet_cache *pcache;
+	char *frags, *buf;
+	double begin, elapsed;
+	float fill = 0.0f;
+
+	if ((pcache = packet_cache_new (depth, pkt_size, NJB_MTU)) == NULL) {
+		return -1;
+	}
+
+	if ((frags = (char*)calloc (fragments, NJB_MTU)) == NULL) {
+		packet_cache_free (pcache);
+		return -1;
+	}
+
+	/* the packets already on their way when playback starts */
+	for (t = 0; t < ahead; t++) {
+		deliver (pcache, frags, start + t);
+	}
+
+	begin = now_nsecs ();
+
+	for (t = 0; t < periods; t++) {
+
+		expected = start + t;
+
+		/* jitter: every other pair of packets arrives swapped */
+		if (t & 1) {
+			deliver (pcache, frags, expected + ahead);
+			deliver (pcache, frags, expected + ahead - 1);
+		}
+
+		if (!packet_cache_get_next_available_framecnt (pcache, expected,
+							       &avail)
+		    || avail != expected) {
+			failed++;
+			continue;
+		}
+
+		fill += packet_cache_get_fill (pcache, expected);
+
+		if (packet_cache_retreive_packet_pointer (pcache, expected, &buf,
+							  pkt_size, NULL)
+		    != pkt_size) {
+			failed++;
+			continue;
+		}
+
+		pkthdr = (jacknet_packet_header*)buf;
+		if (ntohl (pkthdr->framecnt) != expected) {
+			failed++;
+		}
+
+		packet_cache_release_packet (pcache, expected);
+	}
+
+	elapsed = now_nsecs () - begin;
+
+	printf ("%6d %8d %10.1f %8.1f %8d\n", depth, fragments,
+		elapsed / periods, fill / periods, failed);
+
+	free (frags);
+	packet_cache_free (pcache);
+
+	return failed;
+}
+
+int
+main (int argc, char *argv[])
+{
+	int depth = 0, c, i, failed = 0;
+
+	const char *short_options = "d:f:n:h";
+	struct option long_options[] = {
+		{ "depth", 1, 0, 'd' },
+		{ "fragments", 1, 0, 'f' },
+		{ "periods", 1, 0, 'n' },
+		{ "help", 0, 0, 'h' },
+		{ 0, 0, 0, 0 }
+	};
+
+	while ((c = getopt_long (argc, argv, short_options, long_options,
+				 NULL)) != -1) {
+		switch (c) {
+		case 'd':
+			depth = atoi (optarg);
+			break;
+		case 'f':
+			fragments = atoi (optarg);
+			break;
+		case 'n':
+			periods = atoi (optarg);
+			break;
+		default:
+			show_usage ();
+			return 1;
+		}
+	}
+
+	if (depth < 0 || (depth > 0 && depth < 4) || fragments < 1
+	    || periods < 1) {
+		show_usage ();
+		return 1;
+	}
+
+	printf ("%6s %8s %10s %8s %8s\n", "depth", "frags", "ns/period",
+		"fill %", "failed");
+
+	if (depth) {
+		failed = run (depth);
+	} else {
+		for (i = 0; i < (int)(sizeof(default_depths) / sizeof(default_depths[0])); i++) {
+			failed |= run (default_depths[i]);
+		}
+	}
+
+	return failed ? 1 : 0;
+}
@@ -23,8 +23,9 @@ void jack_init_time ()
 {
 	/* nothing to do on a generic system - we use the system clock */
 }
-void jack_set_clock_source (jack_timer_type_t clocksrc)
+int jack_set_clock_source (jack_timer_type_t clocksrc)
 {
 	/* only one clock source on a generic system */
+	return (clocksrc == JACK_TIMER_SYSTEM_CLOCK) ? 0 : -1;
 }
 
@@ -22,6 +22,8 @@
 #include <config.h>
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
 
 jack_time_t (*_jack_get_microseconds)(void) = 0;
 
@@ -112,6 +114,170 @@ jack_get_microseconds_from_hpet (void)
 
 #endif /* HPET_SUPPORT */
 
+#if defined(__gnu_linux__) && defined(__x86_64__)
+#define TSC_SUPPORT
+#define TSC_CALIBRATION_NSECS           50000000        /* 50 msecs */
+#define TSC_SAMPLE_TRIES                8
+#endif
+
+#ifdef TSC_SUPPORT
+
+static inline uint64_t
+jack_read_tsc (void)
+{
+	uint32_t lo, hi;
+
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t)hi << 32) | lo;
+}
+
+/* Only a TSC that ticks at the same rate whatever the CPU frequency
+ * (constant_tsc) and keeps ticking in deep C-states (nonstop_tsc) can
+ * be used as a clock.
+ */
+static int
+jack_tsc_invariant (void)
+{
+	FILE *cpuinfo;
+	char *line = NULL;
+	size_t len = 0;
+	int constant = 0, nonstop = 0;
+
+	if ((cpuinfo = fopen ("/proc/cpuinfo", "r")) == NULL) {
+		return 0;
+	}
+
+	while (getline (&line, &len, cpuinfo) > 0) {
+		if (strncmp (line, "flags", 5) == 0) {
+			constant = (strstr (line, " constant_tsc") != NULL);
+			nonstop = (strstr (line, " nonstop_tsc") != NULL);
+			break;
+		}
+	}
+
+	free (line);
+	fclose (cpuinfo);
+
+	return constant && nonstop;
+}
+
+/* Read the TSC and CLOCK_MONOTONIC together, as closely as we can */
+static void
+jack_tsc_sample (uint64_t *tsc, uint64_t *nsecs)
+{
+	struct timespec ts;
+	uint64_t before, after, best = UINT64_MAX;
+	int i;
+
+	for (i = 0; i < TSC_SAMPLE_TRIES; i++) {
+		before = jack_read_tsc ();
+		clock_gettime (CLOCK_MONOTONIC, &ts);
+		after = jack_read_tsc ();
+
+		if (after - before < best) {
+			best = after - before;
+			*tsc = before + best / 2;
+			*nsecs = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+		}
+	}
+}
+
+static int
+jack_tsc_calibrate (jack_tsc_calibration_t *cal)
+{
+	struct timespec delay = { 0, TSC_CALIBRATION_NSECS };
+	uint64_t tsc0, tsc1, nsecs0, nsecs1;
+	unsigned __int128 mult;
+	uint32_t shift;
+
+	jack_tsc_sample (&tsc0, &nsecs0);
+	while (nanosleep (&delay, &delay) && errno == EINTR) ;
+	jack_tsc_sample (&tsc1, &nsecs1);
+
+	if (tsc1 <= tsc0 || nsecs1 <= nsecs0) {
+		return -1;
+	}
+
+	/* the most precise multiplier that fits in 32 bits */
+	for (shift = 63; shift > 0; shift--) {
+		mult = ((unsigned __int128)(nsecs1 - nsecs0) << shift)
+		       / ((unsigned __int128)(tsc1 - tsc0) * 1000);
+		if (mult <= UINT32_MAX) {
+			break;
+		}
+	}
+
+	if (mult == 0) {
+		return -1;
+	}
+
+	cal->tsc_base = tsc1;
+	cal->usecs_base = nsecs1 / 1000;
+	cal->mult = (uint32_t)mult;
+	cal->shift = shift;
+
+	return 0;
+}
+
+static int
+jack_tsc_init ()
+{
+	if (jack_tsc_calibration.mult) {
+		/* a client, given the server's calibration */
+		return 0;
+	}
+
+	if (!jack_tsc_invariant ()) {
+		jack_error ("This CPU has no constant, nonstop TSC.\n"
+			    "Please choose a different clock source.");
+		return -1;
+	}
+
+	if (jack_tsc_calibrate (&jack_tsc_calibration)) {
+		jack_error ("cannot calibrate the TSC");
+		return -1;
+	}
+
+	return 0;
+}
+
+static jack_time_t
+jack_get_microseconds_from_tsc (void)
+{
+	const jack_tsc_calibration_t *cal = &jack_tsc_calibration;
+	int64_t delta = (int64_t)(jack_read_tsc () - cal->tsc_base);
+
+	/* a CPU may lag the one that calibrated a little */
+	if (unlikely (delta < 0)) {
+		return cal->usecs_base -
+		       (jack_time_t)(((unsigned __int128)(-delta) * cal->mult)
+				     >> cal->shift);
+	}
+
+	return cal->usecs_base +
+	       (jack_time_t)(((unsigned __int128)delta * cal->mult)
+			     >> cal->shift);
+}
+
+#else
+
+static int
+jack_tsc_init ()
+{
+	jack_error ("This version of JACK or this computer does not have TSC support.\n"
+		    "Please choose a different clock source.");
+	return -1;
+}
+
+static jack_time_t
+jack_get_microseconds_from_tsc (void)
+{
+	/* never called */
+	return 0;
+}
+
+#endif /* TSC_SUPPORT */
+
 
 void
 jack_init_time ()
@@ -119,22 +285,33 @@ jack_init_time ()
 	/* nothing to do on a generic system - we use the system clock */
 }
 
-void
+/* Returns -1 if the system clock is used instead of `clocksrc' */
+int
 jack_set_clock_source (jack_timer_type_t clocksrc)
 {
 	switch (clocksrc) {
 	case JACK_TIMER_HPET:
 		if (jack_hpet_init () == 0) {
 			_jack_get_microseconds = jack_get_microseconds_from_hpet;
-		} else {
-			_jack_get_microseconds = jack_get_microseconds_from_system;
+			return 0;
 		}
-		break;
+		_jack_get_microseconds = jack_get_microseconds_from_system;
+		return -1;
+
+	case JACK_TIMER_TSC:
+		if (jack_tsc_init () == 0) {
+			_jack_get_microseconds = jack_get_microseconds_from_tsc;
+			return 0;
+		}
+		_jack_get_microseconds = jack_get_microseconds_from_system;
+		return -1;
 
 	case JACK_TIMER_SYSTEM_CLOCK:
 	default:
 		_jack_get_microseconds = jack_get_microseconds_from_system;
 		break;
 	}
+
+	return 0;
 }
 
@@ -34,9 +34,10 @@ jack_init_time ()
 	__jack_time_ratio = ((float)info.numer / info.denom) / 1000;
 }
 
-void jack_set_clock_source (jack_timer_type_t clocksrc)
+int jack_set_clock_source (jack_timer_type_t clocksrc)
 {
 	/* only one clock source for os x */
+	return (clocksrc == JACK_TIMER_SYSTEM_CLOCK) ? 0 : -1;
 }
 
 jack_time_t
@@ -247,9 +247,27 @@ alsa_driver_hw_specific (alsa_driver_t *driver, int hw_monitoring,
 	return 0;
 }
 
+/* Use the SIMD sample converters where memops has them and the CPU
+ * can run them.  They are bit-exact with the scalar ones (see
+ * memops.h), so this changes nothing but speed.
+ */
+#ifdef MEMOPS_HAVE_SSE2
+#define MEMOPS_FN(name) (sse2 ? name ## _sse2 : name)
+#else
+#define MEMOPS_FN(name) name
+#endif
+
 static void
 alsa_driver_setup_io_function_pointers (alsa_driver_t *driver)
 {
+#ifdef MEMOPS_HAVE_SSE2
+	int sse2 = memops_have_sse2 ();
+
+	if (sse2) {
+		jack_info ("using SSE2 sample converters");
+	}
+#endif
+
 	if (driver->playback_handle) {
 		if (SND_PCM_FORMAT_FLOAT_LE == driver->playback_sample_format) {
 			driver->write_via_copy = sample_move_dS_floatLE;
@@ -260,15 +278,15 @@ alsa_driver_setup_io_function_pointers (alsa_driver_t *driver)
 				case Rectangular:
 					jack_info ("Rectangular dithering at 16 bits");
 					driver->write_via_copy = driver->quirk_bswap ?
-								 sample_move_dither_rect_d16_sSs :
-								 sample_move_dither_rect_d16_sS;
+								 MEMOPS_FN (sample_move_dither_rect_d16_sSs) :
+								 MEMOPS_FN (sample_move_dither_rect_d16_sS);
 					break;
 
 				case Triangular:
 					jack_info ("Triangular dithering at 16 bits");
 					driver->write_via_copy = driver->quirk_bswap ?
-								 sample_move_dither_tri_d16_sSs :
-								 sample_move_dither_tri_d16_sS;
+								 MEMOPS_FN (sample_move_dither_tri_d16_sSs) :
+								 MEMOPS_FN (sample_move_dither_tri_d16_sS);
 					break;
 
 				case Shaped:
@@ -280,23 +298,23 @@ alsa_driver_setup_io_function_pointers (alsa_driver_t *driver)
 
 				default:
 					driver->write_via_copy = driver->quirk_bswap ?
-								 sample_move_d16_sSs :
-								 sample_move_d16_sS;
+								 MEMOPS_FN (sample_move_d16_sSs) :
+								 MEMOPS_FN (sample_move_d16_sS);
 					break;
 				}
 				break;
 
 			case 3: /* NO DITHER */
 				driver->write_via_copy = driver->quirk_bswap ?
-							 sample_move_d24_sSs :
-							 sample_move_d24_sS;
+							 MEMOPS_FN (sample_move_d24_sSs) :
+							 MEMOPS_FN (sample_move_d24_sS);
 
 				break;
 
 			case 4: /* NO DITHER */
 				driver->write_via_copy = driver->quirk_bswap ?
-							 sample_move_d32u24_sSs :
-							 sample_move_d32u24_sS;
+							 MEMOPS_FN (sample_move_d32u24_sSs) :
+							 MEMOPS_FN (sample_move_d32u24_sS);
 				break;
 
 			default:
@@ -314,18 +332,18 @@ alsa_driver_setup_io_function_pointers (alsa_driver_t *driver)
 			switch (driver->capture_sample_bytes) {
 			case 2:
 				driver->read_via_copy = driver->quirk_bswap ?
-							sample_move_dS_s16s :
-							sample_move_dS_s16;
+							MEMOPS_FN (sample_move_dS_s16s) :
+							MEMOPS_FN (sample_move_dS_s16);
 				break;
 			case 3:
 				driver->read_via_copy = driver->quirk_bswap ?
-							sample_move_dS_s24s :
-							sample_move_dS_s24;
+							MEMOPS_FN (sample_move_dS_s24s) :
+							MEMOPS_FN (sample_move_dS_s24);
 				break;
 			case 4:
 				driver->read_via_copy = driver->quirk_bswap ?
-							sample_move_dS_s32u24s :
-							sample_move_dS_s32u24;
+							MEMOPS_FN (sample_move_dS_s32u24s) :
+							MEMOPS_FN (sample_move_dS_s32u24);
 				break;
 			}
 		}
@@ -1572,6 +1590,24 @@ alsa_driver_bufsize (alsa_driver_t* driver, jack_nframes_t nframes)
 					     driver->frame_rate);
 }
 
+/* Is every sample in `buf' +0.0?  Idle digital inputs deliver whole
+ * periods of them.
+ */
+static int
+alsa_driver_capture_silent (const jack_default_audio_sample_t *buf,
+			    jack_nframes_t nframes)
+{
+	const uint32_t *word = (const uint32_t*)buf;
+	uint32_t bits = 0;
+	jack_nframes_t n;
+
+	for (n = 0; n < nframes; n++) {
+		bits |= word[n];
+	}
+
+	return bits == 0;
+}
+
 static int
 alsa_driver_read (alsa_driver_t *driver, jack_nframes_t nframes)
 {
@@ -1638,6 +1674,20 @@ alsa_driver_read (alsa_driver_t *driver, jack_nframes_t nframes)
 		nread += contiguous;
 	}
 
+	/* let the clients reading them skip silent channels */
+	for (node = driver->capture_ports; node; node = jack_slist_next (node)) {
+
+		port = (jack_port_t*)node->data;
+
+		if (!jack_port_connected (port)) {
+			continue;
+		}
+		buf = jack_port_get_buffer (port, orig_nframes);
+		if (alsa_driver_capture_silent (buf, orig_nframes)) {
+			jack_port_mark_silent (port, orig_nframes);
+		}
+	}
+
 	return 0;
 }
 
@@ -1710,6 +1760,19 @@ alsa_driver_write (alsa_driver_t* driver, jack_nframes_t nframes)
 			if (!jack_port_connected (port)) {
 				continue;
 			}
+			if (jack_port_is_silent (port)) {
+				/* leave the channel to
+				   alsa_driver_silence_untouched_channels(),
+				   which stops writing to it once the whole
+				   hardware buffer is silent */
+				if (mon_node) {
+					jack_port_mark_silent (
+						(jack_port_t*)mon_node->data,
+						orig_nframes);
+					mon_node = jack_slist_next (mon_node);
+				}
+				continue;
+			}
 			buf = jack_port_get_buffer (port, orig_nframes);
 			alsa_driver_write_to_channel (driver, chn,
 						      buf + nwritten, contiguous);
@@ -593,6 +593,318 @@ void sample_move_dS_s16 (jack_default_audio_sample_t *dst, char *src, unsigned l
 	}
 }
 
+#ifdef MEMOPS_HAVE_SSE2
+
+/* SSE2 versions of the converters above, four samples at a time.
+
+   These are bit-exact with the scalar versions: the range checks use
+   the same (inclusive) limits, cvtps2dq rounds in the current mode
+   just as lrintf does, and every float operation is done in the same
+   order.  Only the low 16 or 24 bits of the rounded value are ever
+   stored, so even NaN gives the same result.  The dither noise is
+   taken from the same fast_rand() sequence, so a buffer converted
+   partly here and partly by the scalar tail gets the same noise too.
+ */
+
+#include <emmintrin.h>
+
+/* everything using SSE2 is built for it, whatever the rest of the
+   file is built for */
+#define MEMOPS_SSE2 __attribute__ ((target ("sse2")))
+
+int
+memops_have_sse2 (void)
+{
+	__builtin_cpu_init ();
+	return __builtin_cpu_supports ("sse2");
+}
+
+static inline MEMOPS_SSE2 __m128i
+sse2_select (__m128 mask, __m128i a, __m128i b)
+{
+	__m128i m = _mm_castps_si128 (mask);
+
+	return _mm_or_si128 (_mm_and_si128 (m, a), _mm_andnot_si128 (m, b));
+}
+
+/* round `v' (already scaled), or clip it to imin/imax if it is
+   outside fmin..fmax */
+static inline MEMOPS_SSE2 __m128i
+sse2_clip_round (__m128 s, __m128 v, float fmin, float fmax,
+		 int32_t imin, int32_t imax)
+{
+	__m128i z = _mm_cvtps_epi32 (v);
+
+	z = sse2_select (_mm_cmple_ps (s, _mm_set1_ps (fmin)),
+			 _mm_set1_epi32 (imin), z);
+	return sse2_select (_mm_cmpge_ps (s, _mm_set1_ps (fmax)),
+			    _mm_set1_epi32 (imax), z);
+}
+
+/* float_16 () */
+static inline MEMOPS_SSE2 __m128i
+sse2_float_16 (__m128 s)
+{
+	return sse2_clip_round (s, _mm_mul_ps (s, _mm_set1_ps (SAMPLE_16BIT_SCALING)),
+				NORMALIZED_FLOAT_MIN, NORMALIZED_FLOAT_MAX,
+				SAMPLE_16BIT_MIN, SAMPLE_16BIT_MAX);
+}
+
+/* float_16_scaled () */
+static inline MEMOPS_SSE2 __m128i
+sse2_float_16_scaled (__m128 v)
+{
+	return sse2_clip_round (v, v, SAMPLE_16BIT_MIN_F, SAMPLE_16BIT_MAX_F,
+				SAMPLE_16BIT_MIN, SAMPLE_16BIT_MAX);
+}
+
+/* float_24 () */
+static inline MEMOPS_SSE2 __m128i
+sse2_float_24 (__m128 s)
+{
+	return sse2_clip_round (s, _mm_mul_ps (s, _mm_set1_ps (SAMPLE_24BIT_SCALING)),
+				NORMALIZED_FLOAT_MIN, NORMALIZED_FLOAT_MAX,
+				SAMPLE_24BIT_MIN, SAMPLE_24BIT_MAX);
+}
+
+/* float_24u32 () */
+static inline MEMOPS_SSE2 __m128i
+sse2_float_24u32 (__m128 s)
+{
+	return _mm_slli_epi32 (sse2_float_24 (s), 8);
+}
+
+/* unsigned to float: each 16 bit half converts exactly, so the sum is
+   rounded only once, just like a scalar (float) cast */
+static inline MEMOPS_SSE2 __m128
+sse2_u32_to_float (__m128i x)
+{
+	__m128 hi = _mm_cvtepi32_ps (_mm_srli_epi32 (x, 16));
+	__m128 lo = _mm_cvtepi32_ps (_mm_and_si128 (x, _mm_set1_epi32 (0xffff)));
+
+	return _mm_add_ps (_mm_mul_ps (hi, _mm_set1_ps (65536.0f)), lo);
+}
+
+/* (*src * SAMPLE_16BIT_SCALING) + fast_rand () / (float)UINT_MAX - 0.5f */
+static inline MEMOPS_SSE2 __m128
+sse2_dither_rect_16 (__m128 s)
+{
+	uint32_t r[4];
+	__m128 noise;
+	int j;
+
+	for (j = 0; j < 4; j++)
+		r[j] = fast_rand ();
+
+	noise = _mm_div_ps (sse2_u32_to_float (_mm_loadu_si128 ((__m128i*)r)),
+			    _mm_set1_ps ((float)UINT_MAX));
+	return _mm_sub_ps (_mm_add_ps (_mm_mul_ps (s, _mm_set1_ps (SAMPLE_16BIT_SCALING)),
+				       noise),
+			   _mm_set1_ps (0.5f));
+}
+
+/* (*src * SAMPLE_16BIT_SCALING) + ((float)fast_rand () + (float)fast_rand ()) / (float)UINT_MAX - 1.0f */
+static inline MEMOPS_SSE2 __m128
+sse2_dither_tri_16 (__m128 s)
+{
+	uint32_t r1[4], r2[4];
+	__m128 noise;
+	int j;
+
+	for (j = 0; j < 4; j++) {
+		r1[j] = fast_rand ();
+		r2[j] = fast_rand ();
+	}
+
+	noise = _mm_add_ps (sse2_u32_to_float (_mm_loadu_si128 ((__m128i*)r1)),
+			    sse2_u32_to_float (_mm_loadu_si128 ((__m128i*)r2)));
+	noise = _mm_div_ps (noise, _mm_set1_ps ((float)UINT_MAX));
+	return _mm_sub_ps (_mm_add_ps (_mm_mul_ps (s, _mm_set1_ps (SAMPLE_16BIT_SCALING)),
+				       noise),
+			   _mm_set1_ps (1.0f));
+}
+
+static inline MEMOPS_SSE2 void
+sse2_store_d32u24 (char *dst, __m128i v, unsigned long dst_skip)
+{
+	int32_t z[4];
+	int j;
+
+	if (dst_skip == 4) {
+		_mm_storeu_si128 ((__m128i*)dst, v);
+		return;
+	}
+
+	_mm_storeu_si128 ((__m128i*)z, v);
+	for (j = 0; j < 4; j++) {
+		*((int32_t*)dst) = z[j];
+		dst += dst_skip;
+	}
+}
+
+static inline MEMOPS_SSE2 void
+sse2_store_d32u24s (char *dst, __m128i v, unsigned long dst_skip)
+{
+	int32_t z[4];
+	int j;
+
+	_mm_storeu_si128 ((__m128i*)z, v);
+	for (j = 0; j < 4; j++) {
+		dst[0] = (char)(z[j] >> 24);
+		dst[1] = (char)(z[j] >> 16);
+		dst[2] = (char)(z[j] >> 8);
+		dst[3] = (char)(z[j]);
+		dst += dst_skip;
+	}
+}
+
+static inline MEMOPS_SSE2 void
+sse2_store_d24 (char *dst, __m128i v, unsigned long dst_skip)
+{
+	int32_t z[4];
+	int j;
+
+	_mm_storeu_si128 ((__m128i*)z, v);
+	for (j = 0; j < 4; j++) {
+		memcpy (dst, &z[j], 3);
+		dst += dst_skip;
+	}
+}
+
+static inline MEMOPS_SSE2 void
+sse2_store_d24s (char *dst, __m128i v, unsigned long dst_skip)
+{
+	int32_t z[4];
+	int j;
+
+	_mm_storeu_si128 ((__m128i*)z, v);
+	for (j = 0; j < 4; j++) {
+		dst[0] = (char)(z[j] >> 16);
+		dst[1] = (char)(z[j] >> 8);
+		dst[2] = (char)(z[j]);
+		dst += dst_skip;
+	}
+}
+
+static inline MEMOPS_SSE2 void
+sse2_store_d16 (char *dst, __m128i v, unsigned long dst_skip)
+{
+	int32_t z[4];
+	int j;
+
+	if (dst_skip == 2) {
+		/* sign extend the low halves first, so that packing
+		   truncates exactly like the scalar (int16_t) store */
+		v = _mm_srai_epi32 (_mm_slli_epi32 (v, 16), 16);
+		_mm_storel_epi64 ((__m128i*)dst, _mm_packs_epi32 (v, v));
+		return;
+	}
+
+	_mm_storeu_si128 ((__m128i*)z, v);
+	for (j = 0; j < 4; j++) {
+		*((int16_t*)dst) = (int16_t)z[j];
+		dst += dst_skip;
+	}
+}
+
+static inline MEMOPS_SSE2 void
+sse2_store_d16s (char *dst, __m128i v, unsigned long dst_skip)
+{
+	int32_t z[4];
+	int16_t tmp;
+	int j;
+
+	_mm_storeu_si128 ((__m128i*)z, v);
+	for (j = 0; j < 4; j++) {
+		tmp = (int16_t)z[j];
+		dst[0] = (char)(tmp >> 8);
+		dst[1] = (char)(tmp);
+		dst += dst_skip;
+	}
+}
+
+/* Each of these converts as many whole groups of four as it can and
+   leaves the rest to the scalar version. */
+#define SSE2_MOVE_D(name, convert, store)				\
+	MEMOPS_SSE2 void name ## _sse2 (char *dst, jack_default_audio_sample_t *src, \
+			    unsigned long nsamples, unsigned long dst_skip, \
+			    dither_state_t *state)			\
+	{								\
+		while (nsamples >= 4) {					\
+			store (dst, convert (_mm_loadu_ps (src)), dst_skip); \
+			dst += 4 * dst_skip;				\
+			src += 4;					\
+			nsamples -= 4;					\
+		}							\
+		name (dst, src, nsamples, dst_skip, state);		\
+	}
+
+#define sse2_rect_16(s) sse2_float_16_scaled (sse2_dither_rect_16 (s))
+#define sse2_tri_16(s) sse2_float_16_scaled (sse2_dither_tri_16 (s))
+
+SSE2_MOVE_D (sample_move_d32u24_sSs, sse2_float_24u32, sse2_store_d32u24s)
+SSE2_MOVE_D (sample_move_d32u24_sS, sse2_float_24u32, sse2_store_d32u24)
+SSE2_MOVE_D (sample_move_d24_sSs, sse2_float_24, sse2_store_d24s)
+SSE2_MOVE_D (sample_move_d24_sS, sse2_float_24, sse2_store_d24)
+SSE2_MOVE_D (sample_move_d16_sSs, sse2_float_16, sse2_store_d16s)
+SSE2_MOVE_D (sample_move_d16_sS, sse2_float_16, sse2_store_d16)
+SSE2_MOVE_D (sample_move_dither_rect_d16_sSs, sse2_rect_16, sse2_store_d16s)
+SSE2_MOVE_D (sample_move_dither_rect_d16_sS, sse2_rect_16, sse2_store_d16)
+SSE2_MOVE_D (sample_move_dither_tri_d16_sSs, sse2_tri_16, sse2_store_d16s)
+SSE2_MOVE_D (sample_move_dither_tri_d16_sS, sse2_tri_16, sse2_store_d16)
+
+/* the integer samples are gathered four at a time by the scalar code
+   and only converted and scaled here */
+static inline MEMOPS_SSE2 void
+sse2_scale_store (jack_default_audio_sample_t *dst, const int32_t *x, float scaling)
+{
+	_mm_storeu_ps (dst, _mm_div_ps (_mm_cvtepi32_ps (_mm_loadu_si128 ((__m128i*)x)),
+					_mm_set1_ps (scaling)));
+}
+
+#define SSE2_MOVE_S(name, gather, scaling)				\
+	MEMOPS_SSE2 void name ## _sse2 (jack_default_audio_sample_t *dst, char *src, \
+			    unsigned long nsamples, unsigned long src_skip) \
+	{								\
+		int32_t x[4];						\
+		int j;							\
+									\
+		while (nsamples >= 4) {					\
+			for (j = 0; j < 4; j++) {			\
+				gather (x[j], src);			\
+				src += src_skip;			\
+			}						\
+			sse2_scale_store (dst, x, scaling);		\
+			dst += 4;					\
+			nsamples -= 4;					\
+		}							\
+		name (dst, src, nsamples, src_skip);			\
+	}
+
+#define gather_s32u24s(x, src) \
+	(x) = ((unsigned char)(src)[0] << 24 | (unsigned char)(src)[1] << 16 | \
+	       (unsigned char)(src)[2] << 8 | (unsigned char)(src)[3]) >> 8
+#define gather_s32u24(x, src) \
+	(x) = *((int32_t*)(src)) >> 8
+#define gather_s24s(x, src) \
+	(x) = ((unsigned char)(src)[0] << 24 | (unsigned char)(src)[1] << 16 | \
+	       (unsigned char)(src)[2] << 8) >> 8
+#define gather_s24(x, src) \
+	memcpy ((char*)&(x) + 1, (src), 3); (x) >>= 8
+#define gather_s16s(x, src) \
+	(x) = (short)((unsigned char)(src)[0] << 8 | (unsigned char)(src)[1])
+#define gather_s16(x, src) \
+	(x) = *((short*)(src))
+
+SSE2_MOVE_S (sample_move_dS_s32u24s, gather_s32u24s, SAMPLE_24BIT_SCALING)
+SSE2_MOVE_S (sample_move_dS_s32u24, gather_s32u24, SAMPLE_24BIT_SCALING)
+SSE2_MOVE_S (sample_move_dS_s24s, gather_s24s, SAMPLE_24BIT_SCALING)
+SSE2_MOVE_S (sample_move_dS_s24, gather_s24, SAMPLE_24BIT_SCALING)
+SSE2_MOVE_S (sample_move_dS_s16s, gather_s16s, SAMPLE_16BIT_SCALING)
+SSE2_MOVE_S (sample_move_dS_s16, gather_s16, SAMPLE_16BIT_SCALING)
+
+#endif /* MEMOPS_HAVE_SSE2 */
+
 void memset_interleave (char *dst, char val, unsigned long bytes,
 			unsigned long unit_bytes,
 			unsigned long skip_bytes)
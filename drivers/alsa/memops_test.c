@@ -0,0 +1,344 @@
+/*
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ */
+
+/* Checks that the SSE2 sample converters in memops.c give exactly the
+ * same bytes as the scalar ones, for random samples, samples on and
+ * around the clipping and rounding boundaries, NaN and infinity, at
+ * several strides.  The dithering converters draw their noise from a
+ * static generator, so the scalar reference runs in a forked child
+ * that starts from the same generator state as the parent.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <float.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "memops.h"
+
+#ifdef MEMOPS_HAVE_SSE2
+
+/* not a multiple of four, so the scalar tail runs as well */
+#define NSAMPLES 1027
+#define MAX_SAMPLE_BYTES 4
+#define MAX_STRIDE (5 * MAX_SAMPLE_BYTES)
+#define BUFFER_BYTES (NSAMPLES * MAX_STRIDE)
+
+typedef void (*move_d_t)(char *, jack_default_audio_sample_t *,
+			 unsigned long, unsigned long, dither_state_t *);
+typedef void (*move_s_t)(jack_default_audio_sample_t *, char *,
+			 unsigned long, unsigned long);
+
+typedef struct {
+	const char *name;
+	move_d_t scalar;
+	move_d_t sse2;
+	unsigned long sample_bytes;
+} move_d_test_t;
+
+typedef struct {
+	const char *name;
+	move_s_t scalar;
+	move_s_t sse2;
+	unsigned long sample_bytes;
+} move_s_test_t;
+
+#define MOVE_D(name, bytes) { #name, name, name ## _sse2, bytes }
+#define MOVE_S(name, bytes) { #name, name, name ## _sse2, bytes }
+
+static const move_d_test_t move_d_tests[] = {
+	MOVE_D (sample_move_d32u24_sSs, 4),
+	MOVE_D (sample_move_d32u24_sS, 4),
+	MOVE_D (sample_move_d24_sSs, 3),
+	MOVE_D (sample_move_d24_sS, 3),
+	MOVE_D (sample_move_d16_sSs, 2),
+	MOVE_D (sample_move_d16_sS, 2),
+	MOVE_D (sample_move_dither_rect_d16_sSs, 2),
+	MOVE_D (sample_move_dither_rect_d16_sS, 2),
+	MOVE_D (sample_move_dither_tri_d16_sSs, 2),
+	MOVE_D (sample_move_dither_tri_d16_sS, 2),
+};
+
+static const move_s_test_t move_s_tests[] = {
+	MOVE_S (sample_move_dS_s32u24s, 4),
+	MOVE_S (sample_move_dS_s32u24, 4),
+	MOVE_S (sample_move_dS_s24s, 3),
+	MOVE_S (sample_move_dS_s24, 3),
+	MOVE_S (sample_move_dS_s16s, 2),
+	MOVE_S (sample_move_dS_s16, 2),
+};
+
+/* in units of the sample size: packed, and two interleaved layouts */
+static const unsigned long strides[] = { 1, 2, 5 };
+
+#define N_ELEMENTS(a) (sizeof(a) / sizeof((a)[0]))
+
+static float floats[NSAMPLES];
+static char ints[BUFFER_BYTES];
+
+static float
+random_float (float range)
+{
+	return ((float)random () / RAND_MAX * 2.0f - 1.0f) * range;
+}
+
+/* Floats on and next to every limit and rounding boundary the
+ * converters have, then random ones, some of them out of range.
+ */
+static void
+fill_floats (void)
+{
+	static const float scales[] = { 32767.0f, 8388607.0f };
+	static const float specials[] = {
+		0.0f, -0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 2.0f, -2.0f,
+		FLT_MIN, -FLT_MIN, FLT_MAX, -FLT_MAX, 1e-45f, -1e-45f,
+		INFINITY, -INFINITY, NAN, -NAN
+	};
+	unsigned long n = 0, i, k;
+	float v;
+
+	for (i = 0; i < N_ELEMENTS(specials); i++) {
+		floats[n++] = specials[i];
+	}
+
+	for (i = 0; i < N_ELEMENTS(scales); i++) {
+		for (k = 0; k < 8; k++) {
+			/* the clipping limits and the halfway points
+			   between the smallest and largest steps */
+			v = (k & 1 ? -1.0f : 1.0f);
+			switch (k / 2) {
+			case 0:
+				break;
+			case 1:
+				v = nextafterf (v, 0.0f);
+				break;
+			case 2:
+				v = nextafterf (v, 2.0f * v);
+				break;
+			case 3:
+				v *= 0.5f / scales[i];
+				break;
+			}
+			floats[n++] = v;
+		}
+		for (k = 0; k < 16; k++) {
+			floats[n++] = ((float)(random () % 65536) + 0.5f)
+				      / scales[i] * (k & 1 ? -1.0f : 1.0f);
+		}
+	}
+
+	while (n < NSAMPLES) {
+		floats[n] = random_float (n % 4 ? 1.0f : 1.5f);
+		n++;
+	}
+}
+
+/* Integer samples: first mixtures of the extreme byte patterns, which
+ * give all bits clear or set and the extremes of each sign at every
+ * sample size, then random bytes.
+ */
+static void
+fill_ints (void)
+{
+	static const unsigned char patterns[] = { 0x00, 0xff, 0x7f, 0x80, 0x01, 0xfe };
+	unsigned long i;
+
+	for (i = 0; i < BUFFER_BYTES; i++) {
+		if (i / MAX_STRIDE < N_ELEMENTS(patterns) * N_ELEMENTS(patterns)) {
+			/* the first byte of a sample picks one pattern,
+			   the rest another */
+			unsigned long s = i / MAX_STRIDE;
+			ints[i] = (i % MAX_SAMPLE_BYTES == 0) ?
+				  patterns[s / N_ELEMENTS(patterns)] :
+				  patterns[s % N_ELEMENTS(patterns)];
+		} else {
+			ints[i] = random ();
+		}
+	}
+}
+
+static void *
+shared_buffer (size_t bytes)
+{
+	void *buf = mmap (NULL, bytes, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if (buf == MAP_FAILED) {
+		perror ("mmap");
+		exit (1);
+	}
+	return buf;
+}
+
+/* Run the scalar converter in a child, which shares the state of the
+ * dither noise generator with us as it was at the fork.
+ */
+static void
+run_scalar (void (*run)(const void *, unsigned long, void *),
+	    const void *test, unsigned long stride, void *out)
+{
+	pid_t pid;
+	int status;
+
+	if ((pid = fork ()) < 0) {
+		perror ("fork");
+		exit (1);
+	}
+
+	if (pid == 0) {
+		run (test, stride, out);
+		_exit (0);
+	}
+
+	if (waitpid (pid, &status, 0) != pid || !WIFEXITED (status)
+	    || WEXITSTATUS (status) != 0) {
+		fprintf (stderr, "scalar converter failed\n");
+		exit (1);
+	}
+}
+
+static void
+run_d_scalar (const void *arg, unsigned long stride, void *out)
+{
+	const move_d_test_t *test = (const move_d_test_t*)arg;
+	dither_state_t state;
+	float src[NSAMPLES];
+
+	memset (&state, 0, sizeof(state));
+	memcpy (src, floats, sizeof(src));
+	test->scalar ((char*)out, src, NSAMPLES, stride, &state);
+}
+
+static void
+run_s_scalar (const void *arg, unsigned long stride, void *out)
+{
+	const move_s_test_t *test = (const move_s_test_t*)arg;
+
+	test->scalar ((jack_default_audio_sample_t*)out, ints, NSAMPLES, stride);
+}
+
+static int
+check_d (const move_d_test_t *test, unsigned long stride, char *expected)
+{
+	char got[BUFFER_BYTES];
+	dither_state_t state;
+	float src[NSAMPLES];
+	unsigned long i;
+
+	memset (expected, 0x55, BUFFER_BYTES);
+	run_scalar (run_d_scalar, test, stride, expected);
+
+	memset (got, 0x55, BUFFER_BYTES);
+	memset (&state, 0, sizeof(state));
+	memcpy (src, floats, sizeof(src));
+	test->sse2 (got, src, NSAMPLES, stride, &state);
+
+	for (i = 0; i < BUFFER_BYTES; i++) {
+		if (got[i] != expected[i]) {
+			fprintf (stderr, "%s, stride %lu: byte %lu differs\n",
+				 test->name, stride, i);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int
+check_s (const move_s_test_t *test, unsigned long stride, float *expected)
+{
+	float got[NSAMPLES];
+	unsigned long i;
+
+	memset (expected, 0, NSAMPLES * sizeof(float));
+	run_scalar (run_s_scalar, test, stride, expected);
+
+	memset (got, 0, sizeof(got));
+	test->sse2 (got, ints, NSAMPLES, stride);
+
+	for (i = 0; i < NSAMPLES; i++) {
+		if (memcmp (&got[i], &expected[i], sizeof(float))) {
+			fprintf (stderr, "%s, stride %lu: sample %lu "
+				 "gives %g instead of %g\n",
+				 test->name, stride, i, got[i], expected[i]);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+	char *expected = (char*)shared_buffer (BUFFER_BYTES);
+	unsigned long i, j, stride;
+	int failed = 0, checked = 0;
+
+#ifndef __SSE2_MATH__
+	/* the scalar converters do their float math on the x87 here,
+	   so there is nothing bit-exact to check against */
+	printf ("scalar float math is not SSE in this build\n");
+	return 77;      /* skipped */
+#endif
+
+	if (!memops_have_sse2 ()) {
+		printf ("no SSE2 on this CPU\n");
+		return 77;      /* skipped */
+	}
+
+	srandom (1);
+	fill_floats ();
+	fill_ints ();
+
+	for (i = 0; i < N_ELEMENTS(move_d_tests); i++) {
+		for (j = 0; j < N_ELEMENTS(strides); j++) {
+			stride = strides[j] * move_d_tests[i].sample_bytes;
+			failed += check_d (&move_d_tests[i], stride, expected);
+			checked++;
+		}
+	}
+
+	for (i = 0; i < N_ELEMENTS(move_s_tests); i++) {
+		for (j = 0; j < N_ELEMENTS(strides); j++) {
+			stride = strides[j] * move_s_tests[i].sample_bytes;
+			failed += check_s (&move_s_tests[i], stride,
+					   (float*)expected);
+			checked++;
+		}
+	}
+
+	printf ("%d of %d conversions differ\n", failed, checked);
+
+	return failed ? 1 : 0;
+}
+
+#else /* MEMOPS_HAVE_SSE2 */
+
+int
+main (int argc, char *argv[])
+{
+	printf ("no SSE2 converters in this build\n");
+	return 77;      /* skipped */
+}
+
+#endif /* MEMOPS_HAVE_SSE2 */
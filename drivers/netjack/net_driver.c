@@ -411,7 +411,7 @@ driver_get_descriptor ()
 
 	desc = calloc (1, sizeof(jack_driver_desc_t));
 	strcpy (desc->name, "net");
-	desc->nparams = 18;
+	desc->nparams = 19;
 
 	params = calloc (desc->nparams, sizeof(jack_driver_param_desc_t));
 
@@ -569,6 +569,17 @@ driver_get_descriptor ()
 	strcpy (params[i].short_desc,
 		"Always wait until deadline");
 	strcpy (params[i].long_desc, params[i].short_desc);
+
+	i++;
+	strcpy (params[i].name, "offload");
+	params[i].character  = 'G';
+	params[i].type       = JackDriverParamUInt;
+	params[i].value.ui   = 0U;
+	strcpy (params[i].short_desc,
+		"Use UDP segmentation and receive offload");
+	strcpy (params[i].long_desc,
+		"Let the kernel split outgoing packets into fragments and "
+		"merge incoming ones (UDP GSO/GRO, Linux 5.0 or later)");
 	desc->params = params;
 
 	return desc;
@@ -689,6 +700,9 @@ driver_initialize (jack_client_t *client, const JSList * params)
 		case 'D':
 			always_deadline = param->value.ui;
 			break;
+		case 'G':
+			netjack_set_offload (param->value.ui);
+			break;
 		}
 	}
 
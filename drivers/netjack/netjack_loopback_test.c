@@ -0,0 +1,248 @@
+/*
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ */
+
+/* Runs two netjack endpoints over the loopback interface, each with its
+ * own socket and packet cache, the way a master and a slave exchange
+ * periods: every period each side sends a packet of 64 channels of 256
+ * float samples to the other, fragmented to the MTU, and waits for the
+ * other's packet to arrive complete.  Every byte of every payload is
+ * checked.  It runs once with the batched send and receive, and once
+ * with segmentation offload asked for, which falls back to the batched
+ * path where the kernel does not offer it.  The frame count starts
+ * just below 2^32, so the wrap is crossed as well.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "netjack_packet.h"
+
+#define TEST_MTU      1400
+#define TEST_CHANNELS 64
+#define TEST_FRAMES   256
+#define TEST_PERIODS  200
+#define TEST_CACHE    16
+#define TEST_TIMEOUT  500000            /* usecs to wait for one packet */
+
+#define TEST_PKT_SIZE (sizeof(jacknet_packet_header) \
+		       + TEST_CHANNELS * TEST_FRAMES * sizeof(float))
+
+typedef struct {
+	const char *name;
+	int sockfd;
+	struct sockaddr_in address;
+	packet_cache *pcache;
+	char *tx_buf;
+} endpoint_t;
+
+static jack_time_t
+get_microseconds (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (jack_time_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* The payload byte at `offset' of the packet `from' sends for
+ * `framecnt'.
+ */
+static char
+payload_byte (int from, jack_nframes_t framecnt, int offset)
+{
+	return (char)(framecnt * 31 + offset * 7 + from * 101 + (offset >> 8));
+}
+
+static int
+endpoint_open (endpoint_t *ep, const char *name)
+{
+	socklen_t len = sizeof(ep->address);
+	int rcvbuf = 4 * TEST_PKT_SIZE;
+
+	memset (ep, 0, sizeof(endpoint_t));
+	ep->name = name;
+
+	if ((ep->sockfd = socket (AF_INET, SOCK_DGRAM, 0)) < 0) {
+		fprintf (stderr, "%s: socket: %s\n", name, strerror (errno));
+		return -1;
+	}
+
+	setsockopt (ep->sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	ep->address.sin_family = AF_INET;
+	ep->address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+	ep->address.sin_port = 0;
+
+	if (bind (ep->sockfd, (struct sockaddr*)&ep->address, len) < 0
+	    || getsockname (ep->sockfd, (struct sockaddr*)&ep->address, &len) < 0) {
+		fprintf (stderr, "%s: bind: %s\n", name, strerror (errno));
+		close (ep->sockfd);
+		return -1;
+	}
+
+	if ((ep->pcache = packet_cache_new (TEST_CACHE, TEST_PKT_SIZE,
+					    TEST_MTU)) == NULL
+	    || (ep->tx_buf = (char*)malloc (TEST_PKT_SIZE)) == NULL) {
+		fprintf (stderr, "%s: out of memory\n", name);
+		packet_cache_free (ep->pcache);
+		close (ep->sockfd);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+endpoint_close (endpoint_t *ep)
+{
+	packet_cache_free (ep->pcache);
+	free (ep->tx_buf);
+	close (ep->sockfd);
+}
+
+static void
+endpoint_send (endpoint_t *from, int from_nr, endpoint_t *to,
+	       jack_nframes_t framecnt)
+{
+	jacknet_packet_header *pkthdr = (jacknet_packet_header*)from->tx_buf;
+	char *payload = from->tx_buf + sizeof(jacknet_packet_header);
+	int i;
+
+	memset (pkthdr, 0, sizeof(jacknet_packet_header));
+	pkthdr->framecnt = framecnt;
+	pkthdr->period_size = TEST_FRAMES;
+	pkthdr->mtu = TEST_MTU;
+	packet_header_hton (pkthdr);
+
+	for (i = 0; i < (int)(TEST_PKT_SIZE - sizeof(jacknet_packet_header)); i++) {
+		payload[i] = payload_byte (from_nr, framecnt, i);
+	}
+
+	netjack_sendto (from->sockfd, from->tx_buf, TEST_PKT_SIZE, 0,
+			(struct sockaddr*)&to->address, sizeof(to->address),
+			TEST_MTU);
+}
+
+/* Wait for the packet `from_nr' sent for `framecnt' and check it. */
+static int
+endpoint_receive (endpoint_t *ep, int from_nr, jack_nframes_t framecnt)
+{
+	jack_time_t deadline = get_microseconds () + TEST_TIMEOUT;
+	jacknet_packet_header *pkthdr;
+	char *buf, *payload;
+	int i;
+
+	while (packet_cache_retreive_packet_pointer (ep->pcache, framecnt, &buf,
+						     TEST_PKT_SIZE, NULL) < 0) {
+		if (!netjack_poll_deadline (ep->sockfd, deadline,
+					    get_microseconds)) {
+			fprintf (stderr, "%s: packet %u did not arrive\n",
+				 ep->name, framecnt);
+			return -1;
+		}
+		packet_cache_drain_socket (ep->pcache, ep->sockfd,
+					   get_microseconds);
+	}
+
+	pkthdr = (jacknet_packet_header*)buf;
+	if (ntohl (pkthdr->framecnt) != framecnt
+	    || ntohl (pkthdr->period_size) != TEST_FRAMES) {
+		fprintf (stderr, "%s: packet %u has a bad header\n",
+			 ep->name, framecnt);
+		return -1;
+	}
+
+	payload = buf + sizeof(jacknet_packet_header);
+	for (i = 0; i < (int)(TEST_PKT_SIZE - sizeof(jacknet_packet_header)); i++) {
+		if (payload[i] != payload_byte (from_nr, framecnt, i)) {
+			fprintf (stderr, "%s: packet %u differs at byte %d\n",
+				 ep->name, framecnt, i);
+			return -1;
+		}
+	}
+
+	packet_cache_release_packet (ep->pcache, framecnt);
+
+	return 0;
+}
+
+static int
+run (int offload)
+{
+	endpoint_t master, slave;
+	jack_nframes_t framecnt = 0xffffffff - TEST_PERIODS / 2;
+	int period, failed = 0;
+
+	netjack_set_offload (offload);
+
+	if (endpoint_open (&master, "master")) {
+		return -1;
+	}
+	if (endpoint_open (&slave, "slave")) {
+		endpoint_close (&master);
+		return -1;
+	}
+
+	for (period = 0; period < TEST_PERIODS; period++, framecnt++) {
+		endpoint_send (&master, 0, &slave, framecnt);
+		if (endpoint_receive (&slave, 0, framecnt)) {
+			failed = 1;
+			break;
+		}
+		endpoint_send (&slave, 1, &master, framecnt);
+		if (endpoint_receive (&master, 1, framecnt)) {
+			failed = 1;
+			break;
+		}
+	}
+
+	printf ("%s: %d of %d periods exchanged\n",
+		offload ? "with offload" : "without offload", period,
+		TEST_PERIODS);
+
+	endpoint_close (&slave);
+	endpoint_close (&master);
+
+	return failed;
+}
+
+int
+main (int argc, char *argv[])
+{
+	int ret;
+
+	if ((ret = run (0)) < 0) {
+		return 77;      /* skipped: no loopback sockets here */
+	}
+	if (ret == 0) {
+		ret = run (1);
+	}
+
+	return ret ? 1 : 0;
+}
@@ -32,7 +32,7 @@
 #define _DARWIN_C_SOURCE
 #endif
 
-#if HAVE_PPOLL
+#if HAVE_PPOLL || HAVE_SENDMMSG || HAVE_RECVMMSG
 #define _GNU_SOURCE
 #endif
 
@@ -56,10 +56,16 @@
 #include <malloc.h>
 #else
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <poll.h>
 #endif
 
+#ifndef SOL_UDP
+#define SOL_UDP IPPROTO_UDP
+#endif
+
 #include <errno.h>
 #include <signal.h>
 
@@ -82,6 +88,24 @@
 
 int fraggo = 0;
 
+// Datagrams per recvmmsg() call, and their number and size when
+// generic receive offload hands us several MTUs in one.
+#define NETJACK_RX_BATCH 32
+#define NETJACK_RX_GRO_BATCH 8
+#define NETJACK_RX_GRO_SIZE 65536
+
+// Largest UDP payload, and most segments in one offloaded send.
+#define NETJACK_UDP_MAX 65507
+#define NETJACK_GSO_MAX_SEGMENTS 64
+
+static int netjack_offload = 0;
+
+void
+netjack_set_offload (int onoff)
+{
+	netjack_offload = onoff;
+}
+
 void
 packet_header_hton (jacknet_packet_header *pkthdr)
 {
@@ -153,7 +177,7 @@ packet_cache
 *packet_cache_new (int num_packets, int pkt_size, int mtu)
 {
 	int fragment_payload_size = mtu - sizeof(jacknet_packet_header);
-	int i, fragment_number;
+	int i, fragment_number, num_slots;
 
 	if ( pkt_size == sizeof(jacknet_packet_header) ) {
 		fragment_number = 1;
@@ -167,20 +191,31 @@ packet_cache
 		return NULL;
 	}
 
+	for (num_slots = 1; num_slots < num_packets; num_slots <<= 1)
+		;
+
 	pcache->size = num_packets;
-	pcache->packets = malloc (sizeof(cache_packet) * num_packets);
+	pcache->packets = malloc (sizeof(cache_packet) * num_slots);
+	pcache->mask = num_slots - 1;
+	pcache->newest_framecnt = 0;
+	pcache->newest_framecnt_valid = 0;
 	pcache->master_address_valid = 0;
 	pcache->last_framecnt_retreived = 0;
 	pcache->last_framecnt_retreived_valid = 0;
+	pcache->rx_buffers = NULL;
+	pcache->rx_count = 0;
+	pcache->rx_size = 0;
+	pcache->rx_gro = 0;
 
 	if (pcache->packets == NULL) {
 		jack_error ("could not allocate packet cache (2)");
 		return NULL;
 	}
 
-	for (i = 0; i < num_packets; i++) {
+	for (i = 0; i < num_slots; i++) {
 		pcache->packets[i].valid = 0;
 		pcache->packets[i].num_fragments = fragment_number;
+		pcache->packets[i].fragments_received = 0;
 		pcache->packets[i].packet_size = pkt_size;
 		pcache->packets[i].mtu = mtu;
 		pcache->packets[i].framecnt = 0;
@@ -205,79 +240,63 @@ packet_cache_free (packet_cache *pcache)
 		return;
 	}
 
-	for (i = 0; i < pcache->size; i++) {
+	for (i = 0; i <= (int)pcache->mask; i++) {
 		free (pcache->packets[i].fragment_array);
 		free (pcache->packets[i].packet_buf);
 	}
 
 	free (pcache->packets);
+	free (pcache->rx_buffers);
 	free (pcache);
 }
 
-cache_packet
-*packet_cache_get_packet (packet_cache *pcache, jack_nframes_t framecnt)
+// Distance from framecnt b forward to a, negative when a is older.
+// Frame counts wrap, so only the difference means anything.
+static inline int32_t
+framecnt_offset (jack_nframes_t a, jack_nframes_t b)
 {
-	int i;
-	cache_packet *retval;
-
-	for (i = 0; i < pcache->size; i++)
-		if (pcache->packets[i].valid && (pcache->packets[i].framecnt == framecnt)) {
-			return &(pcache->packets[i]);
-		}
+	return (int32_t)(a - b);
+}
 
-	// The Packet is not in the packet cache.
-	// find a free packet.
+static cache_packet *
+packet_cache_lookup (packet_cache *pcache, jack_nframes_t framecnt)
+{
+	cache_packet *cpack = &(pcache->packets[framecnt & pcache->mask]);
 
-	retval = packet_cache_get_free_packet (pcache);
-	if (retval != NULL) {
-		cache_packet_set_framecnt (retval, framecnt);
-		return retval;
+	if (cpack->valid && (cpack->framecnt == framecnt)) {
+		return cpack;
 	}
 
-	// No Free Packet available
-	// Get The Oldest packet and reset it.
-
-	retval = packet_cache_get_oldest_packet (pcache);
-	//printf( "Dropping %d from Cache :S\n", retval->framecnt );
-	cache_packet_reset (retval);
-	cache_packet_set_framecnt (retval, framecnt);
-
-	return retval;
+	return NULL;
 }
 
-// TODO: fix wrapping case... need to pass
-//       current expected frame here.
-//
-//       or just save framecount into packet_cache.
-
+// Returns the packet for framecnt, taking over its slot from an older
+// packet if need be.  Returns NULL when a newer packet holds the slot,
+// then framecnt is too late to be of any use.
 cache_packet
-*packet_cache_get_oldest_packet (packet_cache *pcache)
+*packet_cache_get_packet (packet_cache *pcache, jack_nframes_t framecnt)
 {
-	jack_nframes_t minimal_frame = JACK_MAX_FRAMES;
-	cache_packet *retval = &(pcache->packets[0]);
-	int i;
+	cache_packet *cpack = &(pcache->packets[framecnt & pcache->mask]);
 
-	for (i = 0; i < pcache->size; i++) {
-		if (pcache->packets[i].valid && (pcache->packets[i].framecnt < minimal_frame)) {
-			minimal_frame = pcache->packets[i].framecnt;
-			retval = &(pcache->packets[i]);
+	if (cpack->valid) {
+		if (cpack->framecnt == framecnt) {
+			return cpack;
 		}
+		if (framecnt_offset (cpack->framecnt, framecnt) > 0) {
+			return NULL;
+		}
+		//printf( "Dropping %d from Cache :S\n", cpack->framecnt );
 	}
 
-	return retval;
-}
-
-cache_packet
-*packet_cache_get_free_packet (packet_cache *pcache)
-{
-	int i;
+	cache_packet_set_framecnt (cpack, framecnt);
 
-	for (i = 0; i < pcache->size; i++)
-		if (pcache->packets[i].valid == 0) {
-			return &(pcache->packets[i]);
-		}
+	if (!pcache->newest_framecnt_valid
+	    || (framecnt_offset (framecnt, pcache->newest_framecnt) > 0)) {
+		pcache->newest_framecnt = framecnt;
+		pcache->newest_framecnt_valid = 1;
+	}
 
-	return NULL;
+	return cpack;
 }
 
 void
@@ -286,6 +305,7 @@ cache_packet_reset (cache_packet *pack)
 	int i;
 
 	pack->valid = 0;
+	pack->fragments_received = 0;
 
 	// XXX: i dont think this is necessary here...
 	//      fragement array is cleared in _set_framecnt()
@@ -300,6 +320,7 @@ cache_packet_set_framecnt (cache_packet *pack, jack_nframes_t framecnt)
 	int i;
 
 	pack->framecnt = framecnt;
+	pack->fragments_received = 0;
 
 	for (i = 0; i < pack->num_fragments; i++)
 		pack->fragment_array[i] = 0;
@@ -326,7 +347,10 @@ cache_packet_add_fragment (cache_packet *pack, char *packet_buf, int rcv_len)
 
 	if (fragment_nr == 0) {
 		memcpy (pack->packet_buf, packet_buf, rcv_len);
-		pack->fragment_array[0] = 1;
+		if (!pack->fragment_array[0]) {
+			pack->fragment_array[0] = 1;
+			pack->fragments_received += 1;
+		}
 
 		return;
 	}
@@ -334,7 +358,10 @@ cache_packet_add_fragment (cache_packet *pack, char *packet_buf, int rcv_len)
 	if ((fragment_nr < pack->num_fragments) && (fragment_nr > 0)) {
 		if ((fragment_nr * fragment_payload_size + rcv_len - sizeof(jacknet_packet_header)) <= (pack->packet_size - sizeof(jacknet_packet_header))) {
 			memcpy (packet_bufX + fragment_nr * fragment_payload_size, dataX, rcv_len - sizeof(jacknet_packet_header));
-			pack->fragment_array[fragment_nr] = 1;
+			if (!pack->fragment_array[fragment_nr]) {
+				pack->fragment_array[fragment_nr] = 1;
+				pack->fragments_received += 1;
+			}
 		} else {
 			jack_error ("too long packet received...");
 		}
@@ -344,14 +371,7 @@ cache_packet_add_fragment (cache_packet *pack, char *packet_buf, int rcv_len)
 int
 cache_packet_is_complete (cache_packet *pack)
 {
-	int i;
-
-	for (i = 0; i < pack->num_fragments; i++)
-		if (pack->fragment_array[i] == 0) {
-			return 0;
-		}
-
-	return 1;
+	return pack->fragments_received == pack->num_fragments;
 }
 
 #ifndef WIN32
@@ -514,14 +534,157 @@ netjack_poll_deadline (int sockfd, jack_time_t deadline, jack_time_t (*get_micro
 // This now reads all a socket has into the cache.
 // replacing netjack_recv functions.
 
+// Take one received datagram into the cache.
+static void
+packet_cache_receive ( packet_cache *pcache, char *rx_packet, int rcv_len,
+		       struct sockaddr_in *sender_address, size_t senderlen,
+		       jack_time_t (*get_microseconds)(void) )
+{
+	jacknet_packet_header *pkthdr = (jacknet_packet_header*)rx_packet;
+	jack_nframes_t framecnt;
+	cache_packet *cpack;
+
+	if (rcv_len < (int)sizeof(jacknet_packet_header)) {
+		return;
+	}
+
+	if (pcache->master_address_valid) {
+		// Verify its from our master.
+		if (memcmp (sender_address, &(pcache->master_address), senderlen) != 0) {
+			return;
+		}
+	} else {
+		// Setup this one as master
+		//printf( "setup master...\n" );
+		memcpy ( &(pcache->master_address), sender_address, senderlen );
+		pcache->master_address_valid = 1;
+	}
+
+	framecnt = ntohl (pkthdr->framecnt);
+	if ( pcache->last_framecnt_retreived_valid
+	     && (framecnt_offset (framecnt, pcache->last_framecnt_retreived) <= 0) ) {
+		return;
+	}
+
+	cpack = packet_cache_get_packet (pcache, framecnt);
+	if (cpack == NULL) {
+		return;
+	}
+	cache_packet_add_fragment (cpack, rx_packet, rcv_len);
+	cpack->recv_timestamp = get_microseconds ();
+}
+
+#if HAVE_RECVMMSG && !defined(WIN32)
+
+// Allocate the receive batch, turning on GRO first if asked to, since
+// it needs bigger buffers.
+static int
+packet_cache_setup_rx ( packet_cache *pcache, int sockfd )
+{
+	pcache->rx_gro = 0;
+	pcache->rx_count = NETJACK_RX_BATCH;
+	pcache->rx_size = pcache->mtu;
+
+#ifdef UDP_GRO
+	if (netjack_offload) {
+		int on = 1;
+		if (setsockopt (sockfd, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0) {
+			pcache->rx_gro = 1;
+			pcache->rx_count = NETJACK_RX_GRO_BATCH;
+			pcache->rx_size = NETJACK_RX_GRO_SIZE;
+		} else {
+			jack_error ("netjack: UDP receive offload not available (%s)",
+				    strerror (errno));
+		}
+	}
+#endif
+
+	pcache->rx_buffers = malloc ((size_t)pcache->rx_count * pcache->rx_size);
+	if (pcache->rx_buffers == NULL) {
+		jack_error ("could not allocate packet receive buffers");
+		return -1;
+	}
+
+	return 0;
+}
+
+// The segment size of a datagram coalesced by GRO, or its whole length.
+static int
+netjack_gro_segment_size ( struct msghdr *msg, int len )
+{
+#ifdef UDP_GRO
+	struct cmsghdr *cmsg;
+
+	for (cmsg = CMSG_FIRSTHDR (msg); cmsg; cmsg = CMSG_NXTHDR (msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+			int seg;
+			memcpy (&seg, CMSG_DATA (cmsg), sizeof(seg));
+			if (seg > 0) {
+				return seg;
+			}
+		}
+	}
+#endif
+	return len;
+}
+
+void
+packet_cache_drain_socket ( packet_cache *pcache, int sockfd, jack_time_t (*get_microseconds)(void) )
+{
+	struct mmsghdr msgs[NETJACK_RX_BATCH];
+	struct iovec iovs[NETJACK_RX_BATCH];
+	struct sockaddr_in senders[NETJACK_RX_BATCH];
+	char control[NETJACK_RX_BATCH][CMSG_SPACE (sizeof(int))];
+	int i, n, len, seg, off;
+
+	if (pcache->rx_buffers == NULL && packet_cache_setup_rx (pcache, sockfd)) {
+		return;
+	}
+
+	while (1) {
+		for (i = 0; i < pcache->rx_count; i++) {
+			iovs[i].iov_base = pcache->rx_buffers + (size_t)i * pcache->rx_size;
+			iovs[i].iov_len = pcache->rx_size;
+			memset (&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+			msgs[i].msg_hdr.msg_name = &senders[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			if (pcache->rx_gro) {
+				msgs[i].msg_hdr.msg_control = control[i];
+				msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+			}
+		}
+
+		n = recvmmsg (sockfd, msgs, pcache->rx_count, MSG_DONTWAIT, NULL);
+		if (n <= 0) {
+			return;
+		}
+
+		for (i = 0; i < n; i++) {
+			len = msgs[i].msg_len;
+			seg = pcache->rx_gro ? netjack_gro_segment_size (&msgs[i].msg_hdr, len) : len;
+			for (off = 0; off < len; off += seg) {
+				packet_cache_receive (pcache, (char*)iovs[i].iov_base + off,
+						      len - off < seg ? len - off : seg,
+						      &senders[i], msgs[i].msg_hdr.msg_namelen,
+						      get_microseconds);
+			}
+		}
+
+		if (n < pcache->rx_count) {
+			return;
+		}
+	}
+}
+
+#else
+
 void
 packet_cache_drain_socket ( packet_cache *pcache, int sockfd, jack_time_t (*get_microseconds)(void) )
 {
 	char *rx_packet = alloca (pcache->mtu);
-	jacknet_packet_header *pkthdr = (jacknet_packet_header*)rx_packet;
 	int rcv_len;
-	jack_nframes_t framecnt;
-	cache_packet *cpack;
 	struct sockaddr_in sender_address;
 
 #ifdef WIN32
@@ -543,62 +706,33 @@ packet_cache_drain_socket ( packet_cache *pcache, int sockfd, jack_time_t (*get_
 			return;
 		}
 
-		if (pcache->master_address_valid) {
-			// Verify its from our master.
-			if (memcmp (&sender_address, &(pcache->master_address), senderlen) != 0) {
-				continue;
-			}
-		} else {
-			// Setup this one as master
-			//printf( "setup master...\n" );
-			memcpy ( &(pcache->master_address), &sender_address, senderlen );
-			pcache->master_address_valid = 1;
-		}
-
-		framecnt = ntohl (pkthdr->framecnt);
-		if ( pcache->last_framecnt_retreived_valid && (framecnt <= pcache->last_framecnt_retreived )) {
-			continue;
-		}
-
-		cpack = packet_cache_get_packet (pcache, framecnt);
-		cache_packet_add_fragment (cpack, rx_packet, rcv_len);
-		cpack->recv_timestamp = get_microseconds ();
+		packet_cache_receive (pcache, rx_packet, rcv_len,
+				      &sender_address, senderlen, get_microseconds);
 	}
 }
 
+#endif /* HAVE_RECVMMSG */
+
+// A new master starts its own frame count, forget the old one's packets.
 void
 packet_cache_reset_master_address ( packet_cache *pcache )
 {
+	jack_nframes_t i;
+
 	pcache->master_address_valid = 0;
 	pcache->last_framecnt_retreived = 0;
 	pcache->last_framecnt_retreived_valid = 0;
-}
-
-void
-packet_cache_clear_old_packets (packet_cache *pcache, jack_nframes_t framecnt )
-{
-	int i;
 
-	for (i = 0; i < pcache->size; i++) {
-		if (pcache->packets[i].valid && (pcache->packets[i].framecnt < framecnt)) {
-			cache_packet_reset (&(pcache->packets[i]));
-		}
+	for (i = 0; i <= pcache->mask; i++) {
+		cache_packet_reset (&(pcache->packets[i]));
 	}
+	pcache->newest_framecnt_valid = 0;
 }
 
 int
 packet_cache_retreive_packet_pointer ( packet_cache *pcache, jack_nframes_t framecnt, char **packet_buf, int pkt_size, jack_time_t *timestamp )
 {
-	int i;
-	cache_packet *cpack = NULL;
-
-
-	for (i = 0; i < pcache->size; i++) {
-		if (pcache->packets[i].valid && (pcache->packets[i].framecnt == framecnt)) {
-			cpack = &(pcache->packets[i]);
-			break;
-		}
-	}
+	cache_packet *cpack = packet_cache_lookup (pcache, framecnt);
 
 	if ( cpack == NULL ) {
 		//printf( "retreive packet: %d....not found\n", framecnt );
@@ -621,19 +755,12 @@ packet_cache_retreive_packet_pointer ( packet_cache *pcache, jack_nframes_t fram
 	return pkt_size;
 }
 
+// Older packets need no clearing, the receive path refuses anything up
+// to the last retrieved framecnt and newer packets take over their slots.
 int
 packet_cache_release_packet ( packet_cache *pcache, jack_nframes_t framecnt )
 {
-	int i;
-	cache_packet *cpack = NULL;
-
-
-	for (i = 0; i < pcache->size; i++) {
-		if (pcache->packets[i].valid && (pcache->packets[i].framecnt == framecnt)) {
-			cpack = &(pcache->packets[i]);
-			break;
-		}
-	}
+	cache_packet *cpack = packet_cache_lookup (pcache, framecnt);
 
 	if ( cpack == NULL ) {
 		//printf( "retreive packet: %d....not found\n", framecnt );
@@ -645,22 +772,20 @@ packet_cache_release_packet ( packet_cache *pcache, jack_nframes_t framecnt )
 	}
 
 	cache_packet_reset (cpack);
-	packet_cache_clear_old_packets ( pcache, framecnt );
 
 	return 0;
 }
+
 float
 packet_cache_get_fill ( packet_cache *pcache, jack_nframes_t expected_framecnt )
 {
 	int num_packets_before_us = 0;
-	int i;
+	jack_nframes_t i;
 
-	for (i = 0; i < pcache->size; i++) {
-		cache_packet *cpack = &(pcache->packets[i]);
-		if (cpack->valid && cache_packet_is_complete ( cpack )) {
-			if ( cpack->framecnt >= expected_framecnt ) {
-				num_packets_before_us += 1;
-			}
+	for (i = 0; i <= pcache->mask; i++) {
+		cache_packet *cpack = packet_cache_lookup (pcache, expected_framecnt + i);
+		if (cpack && cache_packet_is_complete ( cpack )) {
+			num_packets_before_us += 1;
 		}
 	}
 
@@ -668,84 +793,104 @@ packet_cache_get_fill ( packet_cache *pcache, jack_nframes_t expected_framecnt )
 }
 
 // Returns 0 when no valid packet is inside the cache.
+//
+// Every frame from expected_framecnt up to the newest has its own slot
+// while they span no more than the ring, so they are looked up in order.
+// Once the expected frame fell out of the ring, search it all.
 int
 packet_cache_get_next_available_framecnt ( packet_cache *pcache, jack_nframes_t expected_framecnt, jack_nframes_t *framecnt )
 {
-	int i;
-	jack_nframes_t best_offset = JACK_MAX_FRAMES / 2 - 1;
-	int retval = 0;
+	jack_nframes_t i, next;
+	int32_t ahead, best_offset = -1;
 
-	for (i = 0; i < pcache->size; i++) {
-		cache_packet *cpack = &(pcache->packets[i]);
-		//printf( "p%d: valid=%d, frame %d\n", i, cpack->valid, cpack->framecnt );
+	if ( !pcache->newest_framecnt_valid ) {
+		return 0;
+	}
 
-		if (!cpack->valid || !cache_packet_is_complete ( cpack )) {
-			//printf( "invalid\n" );
-			continue;
-		}
+	ahead = framecnt_offset (pcache->newest_framecnt, expected_framecnt);
+	if ( ahead < 0 ) {
+		return 0;
+	}
 
-		if ( cpack->framecnt < expected_framecnt ) {
-			continue;
+	if ( ahead <= (int32_t)pcache->mask ) {
+		for (next = expected_framecnt; next != pcache->newest_framecnt + 1; next++) {
+			cache_packet *cpack = packet_cache_lookup (pcache, next);
+
+			if (cpack && cache_packet_is_complete ( cpack )) {
+				if ( framecnt ) {
+					*framecnt = next;
+				}
+				return 1;
+			}
 		}
+		return 0;
+	}
 
-		if ( (cpack->framecnt - expected_framecnt) > best_offset ) {
+	for (i = 0; i <= pcache->mask; i++) {
+		cache_packet *cpack = &(pcache->packets[i]);
+		int32_t offset;
+
+		if (!cpack->valid || !cache_packet_is_complete ( cpack )) {
 			continue;
 		}
 
-		best_offset = cpack->framecnt - expected_framecnt;
-		retval = 1;
-
-		if ( best_offset == 0 ) {
-			break;
+		offset = framecnt_offset (cpack->framecnt, expected_framecnt);
+		if ( offset >= 0 && (best_offset < 0 || offset < best_offset) ) {
+			best_offset = offset;
 		}
 	}
-	if ( retval && framecnt ) {
+	if ( best_offset < 0 ) {
+		return 0;
+	}
+	if ( framecnt ) {
 		*framecnt = expected_framecnt + best_offset;
 	}
 
-	return retval;
+	return 1;
 }
 
 int
 packet_cache_get_highest_available_framecnt ( packet_cache *pcache, jack_nframes_t *framecnt )
 {
-	int i;
-	jack_nframes_t best_value = 0;
-	int retval = 0;
+	jack_nframes_t i;
+	int32_t best_offset = -1;
 
-	for (i = 0; i < pcache->size; i++) {
+	if ( !pcache->newest_framecnt_valid ) {
+		return 0;
+	}
+
+	for (i = 0; i <= pcache->mask; i++) {
 		cache_packet *cpack = &(pcache->packets[i]);
-		//printf( "p%d: valid=%d, frame %d\n", i, cpack->valid, cpack->framecnt );
+		int32_t offset;
 
 		if (!cpack->valid || !cache_packet_is_complete ( cpack )) {
-			//printf( "invalid\n" );
 			continue;
 		}
 
-		if (cpack->framecnt < best_value) {
-			continue;
+		offset = framecnt_offset (pcache->newest_framecnt, cpack->framecnt);
+		if ( offset >= 0 && (best_offset < 0 || offset < best_offset) ) {
+			best_offset = offset;
 		}
-
-		best_value = cpack->framecnt;
-		retval = 1;
-
 	}
-	if ( retval && framecnt ) {
-		*framecnt = best_value;
+	if ( best_offset < 0 ) {
+		return 0;
+	}
+	if ( framecnt ) {
+		*framecnt = pcache->newest_framecnt - best_offset;
 	}
 
-	return retval;
+	return 1;
 }
 
 // Returns 0 when no valid packet is inside the cache.
 int
 packet_cache_find_latency ( packet_cache *pcache, jack_nframes_t expected_framecnt, jack_nframes_t *framecnt )
 {
-	int i;
+	jack_nframes_t i;
 	jack_nframes_t best_offset = 0;
 	int retval = 0;
 
-	for (i = 0; i < pcache->size; i++) {
+	for (i = 0; i <= pcache->mask; i++) {
 		cache_packet *cpack = &(pcache->packets[i]);
 		//printf( "p%d: valid=%d, frame %d\n", i, cpack->valid, cpack->framecnt );
 
@@ -772,6 +917,125 @@ packet_cache_find_latency ( packet_cache *pcache, jack_nframes_t expected_framec
 	return retval;
 }
 // fragmented packet IO
+#if HAVE_SENDMMSG && !defined(WIN32)
+
+// Send fragments [first, first + count) as one datagram that the kernel
+// splits every mtu bytes (UDP_SEGMENT).  Returns -1 if it can't.
+static int
+netjack_send_gso (int sockfd, struct iovec *iov, int count, int flags,
+		  struct sockaddr *addr, int addr_size, int mtu)
+{
+#ifdef UDP_SEGMENT
+	char control[CMSG_SPACE (sizeof(uint16_t))];
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	uint16_t gso_size = mtu;
+
+	memset (&msg, 0, sizeof(msg));
+	msg.msg_name = addr;
+	msg.msg_namelen = addr_size;
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2 * count;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	cmsg = CMSG_FIRSTHDR (&msg);
+	cmsg->cmsg_level = SOL_UDP;
+	cmsg->cmsg_type = UDP_SEGMENT;
+	cmsg->cmsg_len = CMSG_LEN (sizeof(uint16_t));
+	memcpy (CMSG_DATA (cmsg), &gso_size, sizeof(gso_size));
+
+	if (sendmsg (sockfd, &msg, flags) >= 0) {
+		return 0;
+	}
+
+	jack_error ("netjack: UDP segmentation offload not available (%s)",
+		    strerror (errno));
+	netjack_offload = 0;
+#endif
+	return -1;
+}
+
+void
+netjack_sendto (int sockfd, char *packet_buf, int pkt_size, int flags, struct sockaddr *addr, int addr_size, int mtu)
+{
+	jacknet_packet_header *pkthdr = (jacknet_packet_header*)packet_buf;
+	int header_size = sizeof(jacknet_packet_header);
+	int fragment_payload_size = mtu - header_size;
+	int frag_cnt, i, n, sent;
+	jacknet_packet_header *headers;
+	struct iovec *iov;
+	struct mmsghdr *msgs;
+
+	if (pkt_size <= mtu) {
+		int err;
+		pkthdr->fragment_nr = htonl (0);
+		err = sendto (sockfd, packet_buf, pkt_size, flags, addr, addr_size);
+		if ( err < 0 ) {
+			//printf( "error in send\n" );
+			perror ( "send" );
+		}
+		return;
+	}
+
+	// Each fragment is its own copy of the header followed by a
+	// slice of the payload, which is sent from where it is.
+	frag_cnt = (pkt_size - header_size + fragment_payload_size - 1) / fragment_payload_size;
+	headers = alloca (frag_cnt * sizeof(jacknet_packet_header));
+	iov = alloca (2 * frag_cnt * sizeof(struct iovec));
+	msgs = alloca (frag_cnt * sizeof(struct mmsghdr));
+
+	for (i = 0; i < frag_cnt; i++) {
+		int offset = header_size + i * fragment_payload_size;
+
+		headers[i] = *pkthdr;
+		headers[i].fragment_nr = htonl (i);
+		iov[2 * i].iov_base = &headers[i];
+		iov[2 * i].iov_len = header_size;
+		iov[2 * i + 1].iov_base = packet_buf + offset;
+		iov[2 * i + 1].iov_len = (pkt_size - offset < fragment_payload_size)
+					 ? pkt_size - offset : fragment_payload_size;
+	}
+
+	if (netjack_offload) {
+		n = NETJACK_UDP_MAX / mtu;
+		if (n > NETJACK_GSO_MAX_SEGMENTS) {
+			n = NETJACK_GSO_MAX_SEGMENTS;
+		}
+		for (i = 0; n > 1 && i < frag_cnt; i += n) {
+			if (netjack_send_gso (sockfd, &iov[2 * i],
+					      (frag_cnt - i < n) ? frag_cnt - i : n,
+					      flags, addr, addr_size, mtu)) {
+				break;
+			}
+		}
+		if (i >= frag_cnt) {
+			return;
+		}
+	} else {
+		i = 0;
+	}
+
+	for (n = i; n < frag_cnt; n++) {
+		memset (&msgs[n].msg_hdr, 0, sizeof(msgs[n].msg_hdr));
+		msgs[n].msg_hdr.msg_name = addr;
+		msgs[n].msg_hdr.msg_namelen = addr_size;
+		msgs[n].msg_hdr.msg_iov = &iov[2 * n];
+		msgs[n].msg_hdr.msg_iovlen = 2;
+	}
+
+	while (i < frag_cnt) {
+		sent = sendmmsg (sockfd, &msgs[i], frag_cnt - i, flags);
+		if (sent <= 0) {
+			perror ( "send" );
+			return;
+		}
+		i += sent;
+	}
+}
+
+#else
+
 void
 netjack_sendto (int sockfd, char *packet_buf, int pkt_size, int flags, struct sockaddr *addr, int addr_size, int mtu)
 {
@@ -823,6 +1087,7 @@ netjack_sendto (int sockfd, char *packet_buf, int pkt_size, int flags, struct so
 	}
 }
 
+#endif /* HAVE_SENDMMSG */
 
 void
 decode_midi_buffer (uint32_t *buffer_uint32, unsigned int buffer_size_uint32, jack_default_audio_sample_t* buf)
@@ -82,6 +82,7 @@ typedef struct _cache_packet cache_packet;
 struct _cache_packet {
 	int valid;
 	int num_fragments;
+	int fragments_received;
 	int packet_size;
 	int mtu;
 	jack_time_t recv_timestamp;
@@ -92,14 +93,25 @@ struct _cache_packet {
 
 typedef struct _packet_cache packet_cache;
 
+// The packets form a ring indexed by framecnt & mask.  The ring has a
+// power of two slots, so the index stays continuous when framecnt wraps.
 struct _packet_cache {
 	int size;
 	cache_packet *packets;
+	jack_nframes_t mask;
+	jack_nframes_t newest_framecnt;
+	int newest_framecnt_valid;
 	int mtu;
 	struct sockaddr_in master_address;
 	int master_address_valid;
 	jack_nframes_t last_framecnt_retreived;
 	int last_framecnt_retreived_valid;
+
+	// receive batch for recvmmsg(), set up on first use.
+	char *rx_buffers;
+	int rx_count;
+	int rx_size;
+	int rx_gro;
 };
 
 // fragment cache function prototypes
@@ -108,8 +120,6 @@ packet_cache *packet_cache_new(int num_packets, int pkt_size, int mtu);
 void          packet_cache_free(packet_cache *pkt_cache);
 
 cache_packet *packet_cache_get_packet(packet_cache *pkt_cache, jack_nframes_t framecnt);
-cache_packet *packet_cache_get_oldest_packet(packet_cache *pkt_cache);
-cache_packet *packet_cache_get_free_packet(packet_cache *pkt_cache);
 
 void    cache_packet_reset(cache_packet *pack);
 void    cache_packet_set_framecnt(cache_packet *pack, jack_nframes_t framecnt);
@@ -130,6 +140,10 @@ int netjack_poll_deadline (int sockfd, jack_time_t deadline, jack_time_t (*get_m
 
 void netjack_sendto(int sockfd, char *packet_buf, int pkt_size, int flags, struct sockaddr *addr, int addr_size, int mtu);
 
+// Use UDP segmentation offload for sending and generic receive
+// offload for receiving, where the kernel supports them.
+void netjack_set_offload(int onoff);
+
 
 int get_sample_size(int bitdepth);
 void packet_header_hton(jacknet_packet_header *pkthdr);
@@ -31,6 +31,31 @@ static inline int exchange_and_add(volatile _Atomic_word* obj, int value)
     return atomic_fetch_add_explicit(obj, value, memory_order_relaxed);
 }
 
+static inline int exchange_and_add_acq_rel(volatile _Atomic_word* obj, int value)
+{
+    return atomic_fetch_add_explicit(obj, value, memory_order_acq_rel);
+}
+
+static inline int exchange_and_add_seq_cst(volatile _Atomic_word* obj, int value)
+{
+    return atomic_fetch_add_explicit(obj, value, memory_order_seq_cst);
+}
+
+static inline void acquire_fence(void)
+{
+    atomic_thread_fence(memory_order_acquire);
+}
+
+static inline void release_fence(void)
+{
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void full_fence(void)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
 #else
 
 typedef int _Atomic_word;
@@ -40,6 +65,31 @@ static inline int exchange_and_add(volatile _Atomic_word* obj, int value)
     return __atomic_fetch_add(obj, value, __ATOMIC_RELAXED);
 }
 
+static inline int exchange_and_add_acq_rel(volatile _Atomic_word* obj, int value)
+{
+    return __atomic_fetch_add(obj, value, __ATOMIC_ACQ_REL);
+}
+
+static inline int exchange_and_add_seq_cst(volatile _Atomic_word* obj, int value)
+{
+    return __atomic_fetch_add(obj, value, __ATOMIC_SEQ_CST);
+}
+
+static inline void acquire_fence(void)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+static inline void release_fence(void)
+{
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void full_fence(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
 #endif
 
 #endif /* __jack_atomicity_h__ */
@@ -0,0 +1,132 @@
+/*
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+ */
+
+#ifndef __jack_channel_h__
+#define __jack_channel_h__
+
+/* Shared memory request channel rings (see jack_channel_ring_t).
+ *
+ * Each ring has exactly one producer and one consumer.  A message is a
+ * jack_channel_msg_t followed by its payload, padded to a multiple of
+ * eight bytes, and may wrap around the end of the ring.  The producer
+ * publishes a message by advancing `head' after a release fence; the
+ * consumer frees its space by advancing `tail' the same way.  The
+ * server treats a ring whose indices make no sense as empty: it lives
+ * in memory that the client can scribble on.
+ */
+
+#include <string.h>
+
+#define jack_channel_space(size) \
+	((sizeof(jack_channel_msg_t) + (size) + 7) & ~7)
+
+static inline void
+jack_channel_copy_in (jack_channel_ring_t *ring, uint32_t pos,
+		      const void *src, uint32_t len)
+{
+	uint32_t off = pos & (JACK_CHANNEL_RING_SIZE - 1);
+	uint32_t first = JACK_CHANNEL_RING_SIZE - off;
+
+	if (first > len) {
+		first = len;
+	}
+	memcpy (ring->data + off, src, first);
+	memcpy (ring->data, (const char*)src + first, len - first);
+}
+
+static inline void
+jack_channel_copy_out (jack_channel_ring_t *ring, uint32_t pos,
+		       void *dst, uint32_t len)
+{
+	uint32_t off = pos & (JACK_CHANNEL_RING_SIZE - 1);
+	uint32_t first = JACK_CHANNEL_RING_SIZE - off;
+
+	if (first > len) {
+		first = len;
+	}
+	memcpy (dst, ring->data + off, first);
+	memcpy ((char*)dst + first, ring->data, len - first);
+}
+
+/* Append a message.  Returns -1 if there is no room for it. */
+static inline int
+jack_channel_put (jack_channel_ring_t *ring, const jack_channel_msg_t *msg,
+		  const void *payload)
+{
+	uint32_t head = ring->head;
+	uint32_t used = head - ring->tail;
+
+	if (msg->size > JACK_CHANNEL_MAX_PAYLOAD
+	    || used > JACK_CHANNEL_RING_SIZE
+	    || JACK_CHANNEL_RING_SIZE - used < jack_channel_space (msg->size)) {
+		return -1;
+	}
+
+	/* the consumer is done with the space we are about to reuse */
+	acquire_fence ();
+
+	jack_channel_copy_in (ring, head, msg, sizeof(*msg));
+	jack_channel_copy_in (ring, head + sizeof(*msg), payload, msg->size);
+
+	release_fence ();
+	ring->head = head + jack_channel_space (msg->size);
+
+	return 0;
+}
+
+/* Take the oldest message, copying at most `max' bytes of its payload.
+ * Returns 0 if the ring is empty (or broken, in which case it is
+ * emptied), 1 otherwise.
+ */
+static inline int
+jack_channel_get (jack_channel_ring_t *ring, jack_channel_msg_t *msg,
+		  void *payload, uint32_t max)
+{
+	uint32_t tail = ring->tail;
+	uint32_t used = ring->head - tail;
+
+	if (used == 0) {
+		return 0;
+	}
+
+	acquire_fence ();
+
+	if (used > JACK_CHANNEL_RING_SIZE || used < sizeof(*msg)) {
+		ring->tail = ring->head;
+		return 0;
+	}
+
+	jack_channel_copy_out (ring, tail, msg, sizeof(*msg));
+
+	if (msg->size > JACK_CHANNEL_MAX_PAYLOAD
+	    || used < jack_channel_space (msg->size)) {
+		ring->tail = ring->head;
+		return 0;
+	}
+
+	jack_channel_copy_out (ring, tail + sizeof(*msg), payload,
+			       msg->size < max ? msg->size : max);
+
+	release_fence ();
+	ring->tail = tail + jack_channel_space (msg->size);
+
+	return 1;
+}
+
+#endif /* __jack_channel_h__ */
@@ -35,6 +35,8 @@ struct _jack_port_internal;
 typedef struct {
 	jack_shm_info_t* shm_info;
 	jack_shmsize_t offset;
+	uint32_t index;                 /* in the port type's buffers */
+	volatile uint32_t next;         /* free list link, index + 1 */
 } jack_port_buffer_info_t;
 
 /* The engine keeps an array of these in its local memory. */
@@ -42,15 +44,52 @@ typedef struct _jack_port_internal {
 	struct _jack_port_shared *shared;
 	JSList                   *connections;
 	jack_port_buffer_info_t  *buffer_info;
+	uint32_t                  name_hash[3]; /* keys in the name index */
+	int                       n_name_hash;
 } jack_port_internal_t;
 
 /* The engine's internal port type structure. */
 typedef struct _jack_port_buffer_list {
-	pthread_mutex_t lock;                   /* only lock within server */
-	JSList                  *freelist;      /* list of free buffers */
-	jack_port_buffer_info_t *info;          /* jack_buffer_info_t array */
+	pthread_mutex_t lock;                   /* taken to add segments */
+	volatile uint64_t freelist;             /* tag << 32 | index + 1 of
+						   the first free buffer */
+	uint32_t segment_buffers;               /* buffers per segment */
+	volatile uint32_t n_segments;
+	jack_port_buffer_info_t *info[JACK_PORT_MAX_SEGMENTS];
 } jack_port_buffer_list_t;
 
+/* A client's part in the cycle, as of the last time the graph was
+ * rechained.
+ */
+typedef struct _jack_cycle_step {
+	struct _jack_client_internal *client;
+	int internal;
+	int start_fd;                   /* starts the client's subgraph */
+	int start_slot;
+	int wait_fd;                    /* its subgraph is done */
+	int wait_slot;
+	int parallel_node;
+	int parallel_indegree;
+	unsigned long execution_order;
+} jack_cycle_step_t;
+
+/* Everything the engine thread needs to run a cycle, so that it never
+ * has to look at the graph itself.  The server thread builds a new
+ * plan into the spare one of engine->cycle_plans and publishes it by
+ * switching engine->cycle_plan (see jack_engine_publish_cycle_plan()).
+ */
+typedef struct _jack_cycle_plan {
+	jack_cycle_step_t *steps;       /* all clients, in sort order */
+	unsigned int n_steps;
+	unsigned int max_steps;
+	int parallel;                   /* run as jack_rechain_graph_parallel() */
+	unsigned int parallel_nodes;
+	unsigned int parallel_sinks;
+	int parallel_wait_fd;
+	int parallel_wait_slot;
+	int futex;
+} jack_cycle_plan_t;
+
 typedef struct _jack_reserved_name {
 	jack_uuid_t uuid;
 	char name[JACK_CLIENT_NAME_SIZE];
@@ -86,6 +125,9 @@ struct _jack_engine {
 	pthread_rwlock_t client_lock;
 	pthread_mutex_t port_lock;
 	pthread_mutex_t problem_lock; /* must hold write lock on client_lock */
+	pthread_mutex_t event_lock;   /* client event buffers and replies */
+	int event_batch;              /* server thread is batching events */
+	int defer_replies;            /* event replies are collected later */
 	int process_errors;
 	int period_msecs;
 
@@ -101,11 +143,17 @@ struct _jack_engine {
 	   indexed by the port type_id
 	 */
 	jack_port_buffer_list_t port_buffers[JACK_MAX_PORT_TYPES];
-	jack_shm_info_t port_segment[JACK_MAX_PORT_TYPES];
+	jack_shm_info_t port_segment[JACK_MAX_PORT_TYPES][JACK_PORT_MAX_SEGMENTS];
 
 	unsigned int port_max;
 	pthread_t server_thread;
 
+	/* answers queries from the clients' shared memory request
+	   channels (see jack_channel_ring_t) */
+	pthread_t channel_thread;
+	int channel_running;
+	volatile int channel_stop;
+
 	int fds[2];
 	int cleanup_fifo[2];
 	size_t pfd_size;
@@ -131,6 +179,37 @@ struct _jack_engine {
 	char temporary;
 	int reordered;
 	int feedbackcount;
+	unsigned int sort_mark;         /* visit stamp for graph searches */
+
+	/* parallel graph execution */
+	int parallel_graph;             /* enabled by server option */
+	int parallel_active;            /* current graph uses the plan */
+	unsigned int parallel_nodes;    /* external clients in the plan */
+	unsigned int parallel_sinks;    /* plan clients with no downstream */
+	int parallel_wait_fd;           /* written by the last sink client */
+	int parallel_wait_slot;
+
+	/* futex wakeups */
+	int futex_available;            /* supported by the kernel */
+	int futex_active;               /* used by the current graph */
+	volatile int futex_failed;      /* a wait failed, use FIFOs */
+
+	/* cycles run from the published cycle plan while the graph is
+	   write locked, unless the writer stopped them (see
+	   jack_lock_graph_edit()) */
+	jack_cycle_plan_t cycle_plans[2];
+	jack_cycle_plan_t * volatile cycle_plan;
+	volatile int plan_quiesced;     /* no cycles without the lock */
+	volatile int plan_cycle;        /* one is running */
+	volatile unsigned int plan_cycles; /* count of them */
+	pthread_mutex_t plan_lock;      /* a writer waits for plan_cycle */
+	pthread_cond_t plan_done;       /* to clear, with plan_waiting set */
+	volatile int plan_waiting;
+	int chain_changed;              /* connections changed the chain */
+
+	/* port buffer segment placement */
+	int hugepages;                  /* enabled by server option */
+	int numa_node;                  /* of the audio interface, or -1 */
 	int removing_clients;
 	pid_t wait_pid;
 	int nozombies;
@@ -158,6 +237,8 @@ struct _jack_engine {
 	int rolling_interval;
 	float max_usecs;
 	float spare_usecs;
+	uint32_t trace_cycle;           /* cycles recorded in the timing trace */
+	int32_t profile_jitter;         /* this wakeup's, in usecs, or -1 */
 
 	int first_wakeup;
 
@@ -183,6 +264,7 @@ jack_engine_t  *jack_engine_new(int real_time, int real_time_priority,
 				unsigned int port_max,
 				pid_t waitpid, jack_nframes_t frame_time_offset, int nozombies,
 				int timeout_count_threshold,
+				int parallel_graph, int hugepages,
 				JSList *drivers);
 void            jack_engine_delete(jack_engine_t *);
 int             jack_run(jack_engine_t *engine);
@@ -200,6 +282,14 @@ void            jack_engine_reset_rolling_usecs(jack_engine_t *engine);
 int             internal_client_request(void* ptr, jack_request_t *request);
 int             jack_get_fifo_fd(jack_engine_t *engine,
 				 unsigned int which_fifo);
+int             jack_trace_slot_alloc(jack_engine_t *engine,
+				      jack_client_internal_t *client);
+void            jack_trace_slot_free(jack_engine_t *engine,
+				     jack_client_internal_t *client);
+void            jack_engine_quiesce(jack_engine_t *engine);
+int             jack_engine_reserve_cycle_plan(jack_engine_t *engine,
+					       unsigned int n);
+int             jack_engine_publish_cycle_plan(jack_engine_t *engine);
 
 extern jack_timer_type_t clock_source;
 
@@ -207,7 +297,12 @@ extern jack_client_internal_t *
 jack_client_internal_by_id(jack_engine_t *engine, jack_uuid_t id);
 
 #define jack_rdlock_graph(e) { DEBUG ("acquiring graph read lock"); if (pthread_rwlock_rdlock (&e->client_lock)) { abort (); } }
-#define jack_lock_graph(e) { DEBUG ("acquiring graph write lock"); if (pthread_rwlock_wrlock (&e->client_lock)) { abort (); } }
+#define jack_lock_graph(e) { DEBUG ("acquiring graph write lock"); if (pthread_rwlock_wrlock (&e->client_lock)) { abort (); } jack_engine_quiesce (e); }
+/* For edits that leave the published cycle plan valid: the engine
+   keeps running cycles from it while the lock is held.  Anything that
+   changes the chain or frees clients calls jack_engine_quiesce()
+   first. */
+#define jack_lock_graph_edit(e) { DEBUG ("acquiring graph write lock for edit"); if (pthread_rwlock_wrlock (&e->client_lock)) { abort (); } e->plan_quiesced = 0; }
 #define jack_try_rdlock_graph(e) pthread_rwlock_tryrdlock (&e->client_lock)
 #define jack_unlock_graph(e) { DEBUG ("release graph lock"); if (pthread_rwlock_unlock (&e->client_lock)) { abort (); } }
 
@@ -0,0 +1,165 @@
+/*
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+ */
+
+#ifndef __jack_futex_h__
+#define __jack_futex_h__
+
+/* Futex based wakeups for the process graph.
+ *
+ * A jack_wakeup_t lives in the engine control block, one per
+ * inter-client FIFO number.  Whoever would have written a byte to FIFO
+ * n instead calls jack_wakeup_signal() on slot n, and whoever would
+ * have polled FIFO n calls jack_wakeup_wait_timeout().  A wakeup that
+ * is already pending costs no system call, and neither does signalling
+ * a slot that nobody is sleeping on.
+ */
+
+#ifdef HAVE_LINUX_FUTEX
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static inline long
+jack_futex (volatile _Atomic_word *addr, int op, int val,
+	    const struct timespec *timeout)
+{
+	return syscall (SYS_futex, (int*)addr, op, val, timeout, NULL, 0);
+}
+
+/* Returns non-zero if the running kernel supports futexes. */
+static inline int
+jack_futex_available (void)
+{
+	_Atomic_word word = 0;
+
+	return jack_futex (&word, FUTEX_WAKE, 1, NULL) >= 0 || errno != ENOSYS;
+}
+
+/* Wake whoever is sleeping on `w', without posting a process wakeup.
+ * The fence keeps the load of `waiters' from being satisfied before
+ * the new sequence number is visible, which weakly ordered machines
+ * would otherwise allow even after a sequentially consistent add: the
+ * waiter could then miss both the new number and our wake.
+ */
+static inline void
+jack_wakeup_kick (jack_wakeup_t *w)
+{
+	exchange_and_add_seq_cst (&w->seq, 1);
+	full_fence ();
+
+	if (w->waiters) {
+		jack_futex (&w->seq, FUTEX_WAKE, 1, NULL);
+	}
+}
+
+/* Post one process wakeup on `w'. */
+static inline void
+jack_wakeup_signal (jack_wakeup_t *w)
+{
+	exchange_and_add_seq_cst (&w->pending, 1);
+	jack_wakeup_kick (w);
+}
+
+/* Take one pending wakeup, if there is one.  There is only ever a
+ * single thread consuming wakeups from a given slot.
+ */
+static inline int
+jack_wakeup_consume (jack_wakeup_t *w)
+{
+	if (w->pending > 0) {
+		exchange_and_add_acq_rel (&w->pending, -1);
+		return 1;
+	}
+	return 0;
+}
+
+/* Sleep until `w' is kicked or signalled, as long as its sequence
+ * number is still `seq', for at most `usecs' microseconds.  Returns
+ * -1 if `w' cannot be waited on at all (EINVAL: it is misplaced), in
+ * which case the caller has to go back to the FIFOs or the socket
+ * rather than spin on it; otherwise 0.
+ */
+static inline int
+jack_wakeup_wait (jack_wakeup_t *w, int seq, jack_time_t usecs)
+{
+	struct timespec ts;
+	int ret = 0;
+
+	ts.tv_sec = usecs / 1000000;
+	ts.tv_nsec = (usecs % 1000000) * 1000;
+
+	exchange_and_add_seq_cst (&w->waiters, 1);
+	if (jack_futex (&w->seq, FUTEX_WAIT, seq, &ts) < 0 && errno == EINVAL) {
+		jack_error ("cannot wait on futex at %p (%s)",
+			    &w->seq, strerror (errno));
+		ret = -1;
+	}
+	exchange_and_add_seq_cst (&w->waiters, -1);
+
+	return ret;
+}
+
+/* Returns zero if `w' can be waited on.  A wait on a sequence number
+ * other than the current one returns at once.
+ */
+static inline int
+jack_wakeup_usable (jack_wakeup_t *w)
+{
+	struct timespec ts = { 0, 0 };
+
+	return (jack_futex (&w->seq, FUTEX_WAIT, w->seq + 1, &ts) < 0
+		&& errno == EINVAL) ? -1 : 0;
+}
+
+/* Wait for and consume one process wakeup on `w'.  Returns zero if
+ * none arrived within `usecs' microseconds, and -1 if `w' cannot be
+ * waited on (see jack_wakeup_wait()).
+ */
+static inline int
+jack_wakeup_wait_timeout (jack_wakeup_t *w, jack_time_t usecs)
+{
+	jack_time_t now = jack_get_microseconds ();
+	jack_time_t deadline = now + usecs;
+	int seq;
+
+	while (1) {
+		seq = w->seq;
+
+		if (jack_wakeup_consume (w)) {
+			return 1;
+		}
+
+		if (now >= deadline) {
+			return 0;
+		}
+
+		if (jack_wakeup_wait (w, seq, deadline - now)) {
+			return -1;
+		}
+		now = jack_get_microseconds ();
+	}
+}
+
+#endif /* HAVE_LINUX_FUTEX */
+
+#endif /* __jack_futex_h__ */
@@ -27,6 +27,7 @@
 #define __jack_internal_h__
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <limits.h>
 #include <dlfcn.h>
@@ -47,16 +48,34 @@ extern void jack_info(const char *fmt, ...);
 #include <jack/metadata.h>
 
 #include "port.h"
+#include "trace.h"
+#include "profile.h"
+#include "silence.h"
 
 extern jack_thread_creator_t jack_thread_creator;
 
 typedef enum {
 	JACK_TIMER_SYSTEM_CLOCK,
 	JACK_TIMER_HPET,
+	JACK_TIMER_TSC,
 } jack_timer_type_t;
 
+/* Converts TSC readings to microseconds:
+ * usecs_base + ((tsc - tsc_base) * mult >> shift).  The server
+ * calibrates it and hands it to clients in the control segment, so
+ * that every process reads the same clock.
+ */
+typedef struct {
+	uint64_t tsc_base;
+	jack_time_t usecs_base;
+	uint32_t mult;
+	uint32_t shift;
+} POST_PACKED_STRUCTURE jack_tsc_calibration_t;
+
+extern jack_tsc_calibration_t jack_tsc_calibration;
+
 void        jack_init_time();
-void jack_set_clock_source (jack_timer_type_t);
+int jack_set_clock_source (jack_timer_type_t);
 const char* jack_clock_source_name (jack_timer_type_t);
 
 #include <sysdeps/time.h>
@@ -151,6 +170,156 @@ typedef struct {
 
 } POST_PACKED_STRUCTURE jack_frame_timer_t;
 
+/* Upper bound on the number of external clients that can take part in
+ * parallel graph execution.  Larger graphs fall back to the serial
+ * FIFO chain.
+ */
+#define JACK_PARALLEL_MAX_CLIENTS 128
+
+/* Futex words and words used with the atomic operations must be
+ * naturally aligned: the kernel refuses to wait on an unaligned futex,
+ * and unaligned atomics are split locks on x86 and fault elsewhere.
+ * The shared memory structures are packed, so such members are aligned
+ * explicitly and their placement is checked at compile time.
+ */
+#define JACK_SHM_ALIGNED __attribute__((__aligned__(8)))
+
+#define JACK_ASSERT_ALIGNED(type, member, n) \
+	_Static_assert (offsetof (type, member) % (n) == 0, \
+			#type "." #member " is not " #n " byte aligned")
+
+/* Futex wakeup slot, one per inter-client FIFO number (see futex.h).
+ * Graphs that need more slots than this use the FIFOs.
+ */
+#define JACK_WAKEUP_SLOTS (JACK_PARALLEL_MAX_CLIENTS + 1)
+
+typedef struct {
+	volatile _Atomic_word seq;      /* futex word, bumped by every wakeup */
+	volatile _Atomic_word pending;  /* process wakeups not yet consumed */
+	volatile _Atomic_word waiters;  /* threads sleeping on seq */
+} JACK_SHM_ALIGNED jack_wakeup_t;
+
+/* Shared memory request channel.  Each external client's control
+ * segment holds two single-producer byte rings: the client writes
+ * requests into one and the server's channel thread writes replies
+ * into the other (see channel.h).  Only read-only queries travel this
+ * way; everything else still goes through the request socket.
+ */
+#define JACK_CHANNEL_RING_SIZE 8192             /* a power of two */
+
+typedef struct {
+	uint32_t id;                    /* chosen by the client, echoed */
+	uint32_t type;                  /* RequestType, 0 = use the socket */
+	uint32_t size;                  /* payload bytes that follow */
+	int32_t status;
+} POST_PACKED_STRUCTURE jack_channel_msg_t;
+
+/* largest payload of a single message */
+#define JACK_CHANNEL_MAX_PAYLOAD \
+	(JACK_CHANNEL_RING_SIZE / 2 - sizeof(jack_channel_msg_t))
+
+typedef struct {
+	volatile uint32_t head JACK_SHM_ALIGNED; /* w: producer */
+	volatile uint32_t tail;         /* w: consumer */
+	jack_wakeup_t doorbell JACK_SHM_ALIGNED; /* kicked after each message */
+	char data[JACK_CHANNEL_RING_SIZE];
+} POST_PACKED_STRUCTURE jack_channel_ring_t;
+
+JACK_ASSERT_ALIGNED (jack_channel_ring_t, tail, 4);
+JACK_ASSERT_ALIGNED (jack_channel_ring_t, doorbell, 8);
+
+/* Port name index entry.  The index is an open-addressed hash table
+ * that follows the ports[] array in the engine control segment; each
+ * port has one entry for its name and one for each alias.  Only the
+ * engine writes it, under port_hash_seq; clients read it without
+ * locking and check every hit against the port itself.
+ */
+typedef struct {
+	uint32_t hash;
+	jack_port_id_t id;              /* JACK_PORT_HASH_EMPTY if unused */
+} POST_PACKED_STRUCTURE jack_port_hash_entry_t;
+
+#define JACK_PORT_HASH_EMPTY ((jack_port_id_t)-1)
+
+#define jack_port_hash_table(control) \
+	((jack_port_hash_entry_t*)&(control)->ports[(control)->port_max])
+
+/* Per-client cycle timing trace (see trace.h).  The engine keeps the
+ * rings in the control segment, after the port name index.  The server
+ * appends one entry per client at the end of every cycle; readers copy
+ * entries without locking, and use `head' to discard any that were
+ * overwritten while they were copying.
+ */
+typedef struct {
+	volatile int32_t in_use;
+	jack_uuid_t client_id;
+	char client_name[JACK_CLIENT_NAME_SIZE];
+	volatile uint32_t head;         /* entries ever written */
+	jack_trace_entry_t ring[JACK_TRACE_RING];
+} POST_PACKED_STRUCTURE jack_trace_slot_t;
+
+#define jack_trace_slots(control) \
+	((jack_trace_slot_t*)(jack_port_hash_table(control) + (control)->port_hash_size))
+
+/* MIDI overflow arena.  A MIDI buffer that fills up during a cycle
+ * is moved here, into a block of twice its size, and its header in the
+ * port segment then points at the copy (see libjack/midiport.c).  The
+ * arena sits in the control segment after the trace slots, so every
+ * client has it mapped already.  Blocks are handed out with an atomic
+ * add and all of them are freed at the start of the next cycle, when
+ * the engine resets `used'; a moved buffer records the cycle it moved
+ * in, so a stale one is never followed.
+ */
+#define JACK_MIDI_OVERFLOW_BUFFERS 64           /* default MIDI buffers */
+#define JACK_MIDI_OVERFLOW_MIN (256 * 1024)
+
+typedef struct {
+	volatile uint32_t used;         /* bytes handed out this cycle */
+	uint32_t size;                  /* bytes in data[] */
+	char data[0] JACK_SHM_ALIGNED;
+} POST_PACKED_STRUCTURE jack_midi_overflow_t;
+
+JACK_ASSERT_ALIGNED (jack_midi_overflow_t, data, 8);
+
+/* The areas before the arena have odd sizes, so its start is rounded
+ * up to the next 8 bytes; the segment has room for that.
+ */
+#define JACK_MIDI_OVERFLOW_PAD 7
+
+#define jack_midi_overflow_arena(control) \
+	((jack_midi_overflow_t*) \
+	 (((uintptr_t)(jack_trace_slots(control) + JACK_TRACE_SLOTS) \
+	   + JACK_MIDI_OVERFLOW_PAD) & ~(uintptr_t)JACK_MIDI_OVERFLOW_PAD))
+
+/* Per-phase cycle profile (see profile.h).  The server counts each
+ * phase into the histogram bucket given by jack_profile_bucket().
+ */
+static inline uint32_t
+jack_profile_bucket (uint32_t usecs)
+{
+	uint32_t e;
+
+	if (usecs < 4) {
+		return usecs;
+	}
+
+	e = 31 - __builtin_clz (usecs);
+	if (e > 16) {
+		return JACK_PROFILE_BUCKETS - 1;
+	}
+	return 4 * (e - 1) + ((usecs >> (e - 2)) & 3);
+}
+
+/* the shortest time counted in `bucket' */
+static inline uint32_t
+jack_profile_bucket_usecs (uint32_t bucket)
+{
+	if (bucket < 4) {
+		return bucket;
+	}
+	return (4 + (bucket & 3)) << (bucket / 4 - 1);
+}
+
 /* JACK engine shared memory data structure. */
 typedef struct {
 
@@ -172,6 +341,7 @@ typedef struct {
 	jack_frame_timer_t frame_timer;
 	int32_t internal;
 	jack_timer_type_t clock_source;
+	jack_tsc_calibration_t tsc_calibration; /* if clock_source is the TSC */
 	pid_t engine_pid;
 	jack_nframes_t buffer_size;
 	int8_t real_time;
@@ -185,12 +355,47 @@ typedef struct {
 	float max_delayed_usecs;
 	uint32_t port_max;
 	int32_t engine_ok;
+
+	/* bumped at the start of every process cycle, never 0 */
+	volatile uint32_t cycle_count;
+	uint32_t midi_overflow_size;            /* see jack_midi_overflow_t */
+
+	/* where the server's time goes (see jack_cycle_profile_t) */
+	jack_cycle_profile_t profile;
+
+	/* parallel graph execution: one activation counter per client
+	   in the execution plan (indexed by FIFO number), plus one for
+	   the server itself, which is woken when the last sink client
+	   finishes.
+	 */
+	volatile _Atomic_word activation[JACK_PARALLEL_MAX_CLIENTS + 1] JACK_SHM_ALIGNED;
+
+	/* futex wakeups, used instead of the FIFOs when the kernel
+	   supports them.
+	 */
+	jack_wakeup_t wakeup[JACK_WAKEUP_SLOTS] JACK_SHM_ALIGNED;
+
+	/* kicked by clients after writing to their request channel */
+	jack_wakeup_t channel_doorbell JACK_SHM_ALIGNED;
+
+	/* port name index (see jack_port_hash_entry_t).  port_hash_seq
+	   is odd during updates; it is also the port generation.
+	 */
+	uint32_t port_hash_size;                /* a power of two */
+	volatile _Atomic_word port_hash_seq JACK_SHM_ALIGNED;
+
 	jack_port_type_id_t n_port_types;
 	jack_port_type_info_t port_types[JACK_MAX_PORT_TYPES];
 	jack_port_shared_t ports[0];
 
 } POST_PACKED_STRUCTURE jack_control_t;
 
+JACK_ASSERT_ALIGNED (jack_control_t, seq_number, 4);
+JACK_ASSERT_ALIGNED (jack_control_t, activation, 8);
+JACK_ASSERT_ALIGNED (jack_control_t, wakeup, 8);
+JACK_ASSERT_ALIGNED (jack_control_t, channel_doorbell, 8);
+JACK_ASSERT_ALIGNED (jack_control_t, port_hash_seq, 4);
+
 typedef enum  {
 	BufferSizeChange,
 	SampleRateChange,
@@ -272,6 +477,31 @@ typedef volatile struct {
 	volatile uint64_t finished_at;
 	volatile int32_t last_status;        /* w: client, r: engine and client */
 
+	/* parallel graph execution. when set, the client wakes every
+	   client listed in downstream[] whose activation counter drops
+	   to zero instead of the next client in the serial chain.
+	 */
+	volatile int8_t parallel_graph;         /* w: engine r: engine and client */
+	volatile uint32_t n_downstream;         /* w: engine r: engine and client */
+	volatile uint32_t downstream[JACK_PARALLEL_MAX_CLIENTS];
+
+	/* futex wakeups. wakeup_futex tells the client to use the
+	   wakeup slots instead of the FIFOs for the current graph;
+	   wakeup_slot is the slot it is sleeping on (-1 if none), and
+	   event_pending is set by the server after writing an event to
+	   a client that sleeps on a futex.
+	 */
+	volatile int8_t wakeup_futex;           /* w: engine r: client */
+	volatile int8_t event_pending;          /* w: engine and client r: client */
+	volatile int32_t wakeup_slot;           /* w: client r: engine */
+
+	/* shared memory request channel (see jack_channel_ring_t),
+	   usable when request_channel is set.
+	 */
+	volatile int8_t request_channel;        /* w: engine r: client */
+	jack_channel_ring_t request_ring JACK_SHM_ALIGNED; /* w: client r: engine */
+	jack_channel_ring_t reply_ring JACK_SHM_ALIGNED;   /* w: engine r: client */
+
 	/* indicators for whether callbacks have been set for this client.
 	   We do not include ptrs to the callbacks here (or their arguments)
 	   so that we can avoid 32/64 bit pointer size mismatches between
@@ -299,6 +529,9 @@ typedef volatile struct {
 
 } POST_PACKED_STRUCTURE jack_client_control_t;
 
+JACK_ASSERT_ALIGNED (jack_client_control_t, request_ring, 8);
+JACK_ASSERT_ALIGNED (jack_client_control_t, reply_ring, 8);
+
 typedef struct {
 
 	uint32_t protocol_v;            /* protocol version, must go first */
@@ -383,7 +616,9 @@ typedef enum {
 	SessionReply = 31,
 	SessionHasCallback = 32,
 	PropertyChangeNotify = 33,
-	PortNameChanged = 34
+	PortNameChanged = 34,
+	ReindexPort = 35,
+	ConnectPortsBatch = 36
 } RequestType;
 
 struct _jack_request {
@@ -443,6 +678,12 @@ struct _jack_request {
 			size_t keylen;
 			const char* key; /* not delivered inline to server, see oop_client_deliver_request() */
 		} POST_PACKED_STRUCTURE property;
+		struct {
+			uint32_t count;
+			uint32_t nbytes;
+			const char* ops;        /* not delivered inline to server, see oop_client_deliver_request() */
+			int8_t* results;        /* returned after the reply, one per op */
+		} POST_PACKED_STRUCTURE connect_batch;
 		jack_uuid_t client_id;
 		jack_nframes_t nframes;
 		jack_time_t timeout;
@@ -452,6 +693,9 @@ struct _jack_request {
 	int32_t status;
 } POST_PACKED_STRUCTURE;
 
+/* events sent to a client in one write, at most */
+#define JACK_EVENT_BUFFER_SIZE 16384
+
 /* Per-client structure allocated in the server's address space.
  * It's here because its not part of the engine structure.
  */
@@ -464,19 +708,32 @@ typedef struct _jack_client_internal {
 	int event_fd;
 	int subgraph_start_fd;
 	int subgraph_wait_fd;
+	int subgraph_start_slot;        /* futex wakeup slots, when in use */
+	int subgraph_wait_slot;
 	JSList    *ports;       /* protected by engine->client_lock */
 	JSList    *truefeeds;   /* protected by engine->client_lock */
 	JSList    *sortfeeds;   /* protected by engine->client_lock */
 	int fedcount;
 	int tfedcount;
+	long sort_order;        /* position in the sorted client list, or -1 */
+	unsigned int sort_mark; /* see engine->sort_mark */
 	jack_shm_info_t control_shm;
 	unsigned long execution_order;
 	struct  _jack_client_internal *next_client;     /* not a linked list! */
+	int parallel_node;      /* part of the parallel execution plan */
+	int parallel_indegree;  /* number of upstream clients in the plan */
+	int trace_slot;         /* timing trace slot, or -1 */
 	dlhandle handle;
 	int (*initialize)(jack_client_t*, const char*); /* int. clients only */
 	void (*finish)(void *);                         /* internal clients only */
 	int error;
 
+	/* events queued for, or awaiting a reply from, an external
+	   client (protected by engine->event_lock) */
+	char event_buf[JACK_EVENT_BUFFER_SIZE];
+	size_t event_buf_len;
+	int event_replies_pending;
+
 	int session_reply_pending;
 
 #ifdef JACK_USE_MACH_THREADS
@@ -540,6 +797,36 @@ extern jack_port_t *jack_port_by_id_int(const jack_client_t *client,
 extern jack_port_t *jack_port_by_name_int(jack_client_t *client,
                                           const char *port_name, int* free);
 extern int jack_port_name_equals(jack_port_shared_t* port, const char* target);
+extern uint32_t jack_port_name_hash(const char *name);
+extern jack_port_id_t jack_port_hash_lookup(jack_control_t *control,
+					    const char *name);
+
+/* take a consistent copy of the profile in the control segment */
+extern int jack_profile_copy(const jack_cycle_profile_t *shared,
+			     jack_cycle_profile_t *profile);
+
+/* bulk connection changes, applied by the server under one graph
+ * lock and followed by a single graph sort
+ */
+typedef struct {
+	const char *source_port;
+	const char *destination_port;
+	int connect;                    /* 0 to disconnect */
+} jack_connection_op_t;
+
+/* largest ConnectPortsBatch payload the server will accept */
+#define JACK_CONNECT_BATCH_MAX_BYTES (1024 * 1024)
+
+extern int jack_connect_batch(jack_client_t *client,
+			      const jack_connection_op_t *ops,
+			      unsigned int count, int *results);
+
+/* MIDI overflow arena of the server this process is connected to,
+ * and the per-port limit on how far a MIDI buffer may grow into it.
+ */
+extern void jack_midi_set_overflow_arena(jack_control_t *control);
+extern void jack_midi_release_overflow_arena(jack_control_t *control);
+extern void jack_midi_buffer_set_limit(void *port_buffer, size_t bytes);
 
 /** Get the size (in bytes) of the data structure used to store
  *  MIDI events internally.
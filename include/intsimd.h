@@ -24,32 +24,58 @@
 #if (defined(__i386__) || defined(__x86_64__))
 #define ARCH_X86
 #endif  /* __i386__ || __x86_64__ */
+#ifdef __aarch64__
+#define ARCH_AARCH64
+#endif  /* __aarch64__ */
 #endif  /* USE_DYNSIMD */
 
 #ifdef ARCH_X86
 #define ARCH_X86_SSE(x)         ((x) & 0xff)
 #define ARCH_X86_HAVE_SSE2(x)   (ARCH_X86_SSE (x) >= 2)
-#define ARCH_X86_3DNOW(x)       ((x) >> 8)
+#define ARCH_X86_3DNOW(x)       (((x) >> 8) & 0xff)
 #define ARCH_X86_HAVE_3DNOW(x)  (ARCH_X86_3DNOW (x))
+#define ARCH_X86_AVX(x)         (((x) >> 16) & 0xff)
+#define ARCH_X86_HAVE_AVX2(x)   (ARCH_X86_AVX (x) >= 1)
+#define ARCH_X86_HAVE_AVX512(x) (ARCH_X86_AVX (x) >= 2)
 
 typedef float v2sf __attribute__((vector_size (8)));
 typedef float v4sf __attribute__((vector_size (16)));
+typedef float v8sf __attribute__((vector_size (32)));
+typedef float v16sf __attribute__((vector_size (64)));
 typedef v2sf * pv2sf;
 typedef v4sf * pv4sf;
 
+/* unaligned variants, for buffers that are only float aligned */
+typedef float v4sf_u __attribute__((vector_size (16), aligned (4)));
+typedef float v8sf_u __attribute__((vector_size (32), aligned (4)));
+typedef float v16sf_u __attribute__((vector_size (64), aligned (4)));
+
 extern int cpu_type;
 
 int have_3dnow(void);
 int have_sse(void);
-void x86_3dnow_copyf(float *, const float *, int);
-void x86_3dnow_add2f(float *, const float *, int);
-void x86_sse_copyf(float *, const float *, int);
-void x86_sse_add2f(float *, const float *, int);
+int have_avx(void);
 void x86_sse_f2i(int *, const float *, int, float);
 void x86_sse_i2f(float *, const int *, int, float);
+void x86_sse_mixnf(float *, const float * const *, int, int);
+void x86_avx2_mixnf(float *, const float * const *, int, int);
+void x86_avx512_mixnf(float *, const float * const *, int, int);
 
 #endif /* ARCH_X86 */
 
+#ifdef ARCH_AARCH64
+#define ARCH_AARCH64_HAVE_NEON(x) ((x) & 0x1)
+
+typedef float v4sf __attribute__((vector_size (16)));
+typedef float v4sf_u __attribute__((vector_size (16), aligned (4)));
+
+extern int cpu_type;
+
+int have_neon(void);
+void neon_mixnf(float *, const float * const *, int, int);
+
+#endif /* ARCH_AARCH64 */
+
 void jack_port_set_funcs(void);
 
 #endif /* __jack_intsimd_h__ */
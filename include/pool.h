@@ -21,8 +21,41 @@
 #define __jack_pool_h__
 
 #include <sys/types.h>
-
+#include <stdint.h>
+
+/* size classes run from 64 bytes to 64 kilobytes */
+#define JACK_POOL_CLASSES 11
+
+typedef struct {
+	size_t block_size;
+	uint32_t blocks;                /* preallocated blocks */
+	uint32_t in_use;
+	uint32_t high_water;            /* most blocks ever in use at once */
+	uint32_t failures;              /* jack_pool_alloc_rt() found none free */
+} jack_pool_class_stats_t;
+
+typedef struct {
+	jack_pool_class_stats_t classes[JACK_POOL_CLASSES];
+	uint32_t heap_allocs;           /* requests the pool could not serve */
+	uint32_t locked_bytes;
+} jack_pool_stats_t;
+
+/* Takes a block from the pool, growing it or falling back to the heap
+   if necessary.  Not real-time safe. */
 void * jack_pool_alloc(size_t bytes);
+
+/* Takes a block from the pool without locking or calling the system
+   allocator.  Returns NULL if there is no block of that size left. */
+void * jack_pool_alloc_rt(size_t bytes);
+
+/* Returns memory from either of the above.  Real-time safe for pool
+   blocks. */
 void   jack_pool_release(void *);
 
+/* Makes sure at least `count' free blocks of `bytes' are available,
+   locked into memory.  Not real-time safe. */
+int    jack_pool_reserve(size_t bytes, unsigned int count);
+
+void   jack_pool_get_stats(jack_pool_stats_t *stats);
+
 #endif /* __jack_pool_h__ */
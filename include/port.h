@@ -43,6 +43,11 @@
 #define JACK_AUDIO_PORT_TYPE 0
 #define JACK_MIDI_PORT_TYPE 1
 
+/* Port buffer segments per port type, at most.  Each uses a slot in
+ * the shm registry, which has room for MAX_SHM_ID segments in all.
+ */
+#define JACK_PORT_MAX_SEGMENTS 16
+
 /* these should probably go somewhere else, but not in <jack/types.h> */
 #define JACK_CLIENT_NAME_SIZE 33
 
@@ -85,9 +90,15 @@ typedef struct _jack_port_type_info {
 	/* ignored unless buffer_scale_factor is < 0. see above */
 	jack_shmsize_t buffer_size;
 
-	jack_shm_registry_index_t shm_registry_index;
+	/* the buffers live in up to JACK_PORT_MAX_SEGMENTS segments of
+	   segment_size bytes each, appended as ports are added.  A
+	   port's offset counts from the start of the first segment.
+	 */
+	jack_shm_registry_index_t shm_registry_index[JACK_PORT_MAX_SEGMENTS];
+	volatile uint32_t n_segments;
+	jack_shmsize_t segment_size;
 
-	jack_shmsize_t zero_buffer_offset;
+	jack_shmsize_t zero_buffer_offset;      /* in the first segment */
 
 } POST_PACKED_STRUCTURE jack_port_type_info_t;
 
@@ -110,6 +121,10 @@ typedef struct _jack_port_shared {
 	volatile jack_latency_range_t capture_latency;
 	volatile uint8_t monitor_requests;
 
+	/* the buffer is all silence in the cycle whose cycle_count
+	   matches (see jack_port_mark_silent()) */
+	volatile uint32_t silent_cycle;
+
 	char has_mixdown;               /* port has a mixdown function */
 	char in_use;
 	char unused;                    /* legacy locked field */
@@ -120,9 +135,8 @@ typedef struct _jack_port_functions {
 
 	/* Function to initialize port buffer. Cannot be NULL.
 	 * NOTE: This must take a buffer rather than jack_port_t as it is called
-	 * in jack_engine_place_buffers() before any port creation.
-	 * A better solution is to make jack_engine_place_buffers to be type-specific,
-	 * but this works.
+	 * in jack_port_segment_create() for every buffer of a new segment,
+	 * before any port uses it.
 	 */
 	void (*buffer_init)(void *buffer, size_t size, jack_nframes_t);
 
@@ -146,12 +160,15 @@ jack_get_port_functions(jack_port_type_id_t ptid);
 
 /* Allocated by the client in local memory. */
 struct _jack_port {
-	void                    **client_segment_base;
+	jack_shm_info_t          *client_segments;  /* of this port's type */
+	struct _jack_client      *client;       /* client that created this */
 	void                     *mix_buffer;
 	jack_port_type_info_t    *type_info;    /* shared memory type info */
 	struct _jack_port_shared *shared;       /* corresponding shm struct */
 	struct _jack_port        *tied;         /* locally tied source port */
 	jack_port_functions_t fptr;
+	char zeroed;                    /* buffer untouched since cleared */
+	unsigned long buffer_request;   /* given to jack_port_register() */
 	pthread_mutex_t connection_lock;
 	JSList                   *connections;
 };
@@ -160,11 +177,15 @@ struct _jack_port {
  *  non-optimized code.  jack_output_port_buffer() only handles output
  *  ports.  jack_port_buffer() works for both input and output ports.
  */
+#define jack_port_segment_base(p) \
+	((char*)(p)->client_segments[(p)->shared->offset \
+				     / (p)->type_info->segment_size].attached_at)
+#define jack_output_port_buffer(p) \
+	((void*)(jack_port_segment_base (p) \
+		 + (p)->shared->offset % (p)->type_info->segment_size))
 #define jack_port_buffer(p) \
 	((void*)((p)->mix_buffer ? (p)->mix_buffer : \
-		 *(p)->client_segment_base + (p)->shared->offset))
-#define jack_output_port_buffer(p) \
-	((void*)(*(p)->client_segment_base + (p)->shared->offset))
+		 jack_output_port_buffer (p)))
 
 /* not for use by JACK applications */
 size_t jack_port_type_buffer_size(jack_port_type_info_t* port_type_info, jack_nframes_t nframes);
@@ -0,0 +1,117 @@
+/*
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+ */
+
+#ifndef __jack_profile_h__
+#define __jack_profile_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <jack/types.h>
+#include <jack/weakmacros.h>
+
+/**
+ * @defgroup ProfileFunctions Reading the server's cycle profile
+ *
+ * Every real-time cycle the server times each phase of its own work
+ * and counts the result into a fixed histogram per phase.  The counts
+ * only ever grow; take two copies some time apart and use
+ * jack_profile_since() to look at the cycles in between.  The
+ * buckets are log-linear: exact below 4 usecs, then four per power of
+ * two, so the last one starts at 114688 usecs and counts everything
+ * longer.
+ *
+ * @{
+ */
+
+#define JACK_PROFILE_BUCKETS 64
+
+typedef enum {
+	JackProfileWakeup,              /* driver wakeup vs. the DLL's prediction */
+	JackProfileRead,                /* jack_drivers_read() */
+	JackProfileProcess,             /* running the client graph */
+	JackProfileWrite,               /* jack_drivers_write() */
+	JackProfilePostProcess,         /* transport, cpu load, client checks */
+	JackProfilePhases
+} jack_profile_phase_t;
+
+typedef struct {
+	uint32_t count;
+	uint32_t max_usecs;
+	uint64_t total_usecs;
+	uint32_t buckets[JACK_PROFILE_BUCKETS];
+} POST_PACKED_STRUCTURE jack_profile_histogram_t;
+
+typedef struct {
+	volatile uint32_t guard1;       /* bumped before an update ... */
+	jack_profile_histogram_t phase[JackProfilePhases];
+	volatile uint32_t guard2;       /* ... and after it */
+} POST_PACKED_STRUCTURE jack_cycle_profile_t;
+
+/**
+ * Copy the cycle profile of the server @a client is connected to.
+ *
+ * @return 0 on success, -1 if the server kept updating it while it
+ * was being copied.
+ */
+int jack_profile_read (jack_client_t *client,
+		       jack_cycle_profile_t *profile) JACK_OPTIONAL_WEAK_EXPORT;
+
+/**
+ * Turn @a now into the profile of the cycles since @a then was read.
+ * The longest times are left as they are in @a now, as the server
+ * only keeps the longest ever.
+ */
+void jack_profile_since (jack_cycle_profile_t *now,
+			 const jack_cycle_profile_t *then) JACK_OPTIONAL_WEAK_EXPORT;
+
+/**
+ * @return the given @a percentile (0 to 100) of one phase's times, to
+ * the precision of the histogram: the shortest time counted in the
+ * bucket it falls in.
+ */
+uint32_t jack_profile_percentile (const jack_profile_histogram_t *hist,
+				  float percentile) JACK_OPTIONAL_WEAK_EXPORT;
+
+/**
+ * @return a short description of @a phase.
+ */
+const char *jack_profile_phase_name (jack_profile_phase_t phase) JACK_OPTIONAL_WEAK_EXPORT;
+
+struct jackctl_server;
+
+/**
+ * Copy the cycle profile of a server started through the control
+ * API.  @a server is a jackctl_server_t (see <jack/control.h>).
+ *
+ * @return false if the server is not running or kept updating the
+ * profile while it was being copied.
+ */
+bool jackctl_server_get_profile (struct jackctl_server *server,
+				 jack_cycle_profile_t *profile) JACK_OPTIONAL_WEAK_EXPORT;
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __jack_profile_h__ */
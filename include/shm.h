@@ -108,4 +108,10 @@ extern void jack_destroy_shm(jack_shm_info_t*);
 extern int  jack_attach_shm(jack_shm_info_t*);
 extern int  jack_resize_shm(jack_shm_info_t*, jack_shmsize_t size);
 
+/* for large segments: put them on huge pages if asked to and able to,
+   and prefer the memory of one NUMA node (server only) */
+extern int  jack_shmalloc_large(jack_shmsize_t size, jack_shm_info_t* result,
+				int hugepages);
+extern int  jack_shm_bind_node(jack_shm_info_t*, int node);
+
 #endif /* __jack_shm_h__ */
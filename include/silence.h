@@ -0,0 +1,66 @@
+/*
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+ */
+
+#ifndef __jack_silence_h__
+#define __jack_silence_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <jack/types.h>
+#include <jack/weakmacros.h>
+
+/**
+ * @defgroup SilenceFunctions Marking silent port buffers
+ *
+ * A client whose output is silent for a cycle can say so instead of
+ * writing zeros.  Clients reading the port then skip it: an input with
+ * one audible connection gets that port's buffer directly, one with
+ * none gets a shared buffer of zeros, and silent sources are left out
+ * of mixes.  Drivers can stop writing channels fed only by silence.
+ *
+ * @{
+ */
+
+/**
+ * Mark the buffer of @a port, an output port owned by the calling
+ * client, silent for the current cycle.  The buffer holds zeros
+ * afterwards; it is only cleared if it was handed out by
+ * jack_port_get_buffer() since it was last cleared.  Calling
+ * jack_port_get_buffer() on the port again in the same cycle
+ * unmarks it.  This should only be called from the process callback.
+ */
+void jack_port_mark_silent (jack_port_t *port,
+			    jack_nframes_t nframes) JACK_OPTIONAL_WEAK_EXPORT;
+
+/**
+ * @return non-zero if @a port holds only silence this cycle: for an
+ * output port, if it was marked silent; for an input port, if every
+ * port connected to it was.
+ */
+int jack_port_is_silent (jack_port_t *port) JACK_OPTIONAL_WEAK_EXPORT;
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __jack_silence_h__ */
@@ -0,0 +1,115 @@
+/*
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2.1 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+ */
+
+#ifndef __jack_trace_h__
+#define __jack_trace_h__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <jack/types.h>
+#include <jack/weakmacros.h>
+
+/**
+ * @defgroup TraceFunctions Reading the cycle timing trace
+ *
+ * The server keeps a ring of recent cycle timings for each of up to
+ * JACK_TRACE_SLOTS clients.  At the end of every cycle it appends one
+ * jack_trace_entry_t per client: how long the client took to wake up
+ * once it was triggered, how long its process() ran, and when it
+ * finished relative to the start of the cycle.  Any client of the
+ * server can read the rings; reading never holds up the server.
+ *
+ * @{
+ */
+
+#define JACK_TRACE_SLOTS 64
+#define JACK_TRACE_RING  128            /* entries per client, a power of two */
+
+#define JackTraceLate       0x1         /* finished after the period deadline */
+#define JackTraceUnfinished 0x2         /* still running when the cycle ended */
+
+typedef struct {
+	uint32_t cycle;                 /* engine cycle number */
+	uint32_t flags;
+	uint32_t wakeup_usecs;          /* from being triggered to running */
+	uint32_t process_usecs;         /* from running to finishing */
+	uint32_t finish_usecs;          /* from the start of the cycle to finishing */
+} POST_PACKED_STRUCTURE jack_trace_entry_t;
+
+typedef enum {
+	JackTraceWakeup,
+	JackTraceProcess,
+	JackTraceFinish
+} jack_trace_field_t;
+
+/**
+ * @return the trace slot of the client called @a client_name, or -1
+ * if the server does not trace it (yet).
+ */
+int jack_trace_slot_by_name (jack_client_t *client,
+			     const char *client_name) JACK_OPTIONAL_WEAK_EXPORT;
+
+/**
+ * Copy the name of the client traced in @a slot to @a client_name,
+ * which must have room for jack_client_name_size() characters.
+ *
+ * @return 0 on success, -1 if the slot is not in use.
+ */
+int jack_trace_slot_name (jack_client_t *client, int slot,
+			  char *client_name) JACK_OPTIONAL_WEAK_EXPORT;
+
+/**
+ * Copy up to @a max of the entries written to @a slot since
+ * @a *cursor, oldest first, and advance @a *cursor past them.  Start
+ * with a cursor of zero.  Entries the server overwrote before they
+ * could be copied are skipped, so a reader has to come back at least
+ * every JACK_TRACE_RING cycles to see them all.
+ *
+ * @return the number of entries copied, or -1 if the slot is not in
+ * use.
+ */
+int jack_trace_read (jack_client_t *client, int slot, uint32_t *cursor,
+		     jack_trace_entry_t *entries, int max) JACK_OPTIONAL_WEAK_EXPORT;
+
+/**
+ * @return the given @a percentile (0 to 100) of one timing over @a n
+ * entries, ignoring cycles the client did not finish.
+ */
+uint32_t jack_trace_percentile (const jack_trace_entry_t *entries, int n,
+				jack_trace_field_t field,
+				float percentile) JACK_OPTIONAL_WEAK_EXPORT;
+
+/**
+ * Count one timing over @a n entries into @a nbuckets buckets of
+ * @a bucket_usecs each.  The last bucket also counts everything
+ * longer.
+ */
+void jack_trace_histogram (const jack_trace_entry_t *entries, int n,
+			   jack_trace_field_t field, uint32_t bucket_usecs,
+			   uint32_t *buckets, int nbuckets) JACK_OPTIONAL_WEAK_EXPORT;
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __jack_trace_h__ */
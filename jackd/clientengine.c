@@ -66,6 +66,8 @@ jack_client_disconnect_ports (jack_engine_t *engine,
 	jack_slist_free (client->sortfeeds);
 	client->truefeeds = 0;
 	client->sortfeeds = 0;
+	client->fedcount = 0;
+	client->tfedcount = 0;
 	client->ports = 0;
 }
 
@@ -230,6 +232,10 @@ jack_remove_client (jack_engine_t *engine, jack_client_internal_t *client)
 
 	VERBOSE (engine, "after: client list contains %d", jack_slist_length (engine->clients));
 
+	/* the cycle plan must not point at it any more; the plan
+	   only shrinks, so this cannot fail */
+	jack_engine_publish_cycle_plan (engine);
+
 	jack_client_delete (engine, client);
 
 	if (engine->temporary) {
@@ -268,7 +274,8 @@ jack_remove_client (jack_engine_t *engine, jack_client_internal_t *client)
 int
 jack_check_clients (jack_engine_t* engine, int with_timeout_check)
 {
-	/* CALLER MUST HOLD graph read lock */
+	/* CALLER MUST HOLD graph read lock, or run a cycle from the
+	   published plan */
 
 	JSList* node;
 	jack_client_internal_t* client;
@@ -578,10 +585,16 @@ jack_setup_client_control (jack_engine_t *engine, int fd, ClientType type, const
 	client->truefeeds = 0;
 	client->sortfeeds = 0;
 	client->execution_order = UINT_MAX;
+	client->sort_order = -1;
+	client->sort_mark = 0;
 	client->next_client = NULL;
+	client->parallel_node = FALSE;
+	client->parallel_indegree = 0;
 	client->handle = NULL;
 	client->finish = NULL;
 	client->error = 0;
+	client->event_buf_len = 0;
+	client->event_replies_pending = 0;
 	client->private_client = NULL;
 
 	if (type != ClientExternal) {
@@ -615,6 +628,8 @@ jack_setup_client_control (jack_engine_t *engine, int fd, ClientType type, const
 	client->control->active = 0;
 	client->control->dead = FALSE;
 	client->control->timed_out = 0;
+	client->control->parallel_graph = FALSE;
+	client->control->n_downstream = 0;
 
 	if (jack_uuid_empty (uuid)) {
 		client->control->uuid = jack_client_uuid_generate ();
@@ -625,6 +640,18 @@ jack_setup_client_control (jack_engine_t *engine, int fd, ClientType type, const
 	strcpy ((char*)client->control->name, name);
 	client->subgraph_start_fd = -1;
 	client->subgraph_wait_fd = -1;
+	client->subgraph_start_slot = -1;
+	client->subgraph_wait_slot = -1;
+	client->control->wakeup_futex = FALSE;
+	client->control->event_pending = FALSE;
+	client->control->wakeup_slot = -1;
+	memset ((void*)&client->control->request_ring, 0,
+		sizeof(client->control->request_ring));
+	memset ((void*)&client->control->reply_ring, 0,
+		sizeof(client->control->reply_ring));
+	client->control->request_channel =
+		(type == ClientExternal && engine->channel_running
+		 && !engine->channel_stop);
 
 	client->session_reply_pending = FALSE;
 
@@ -665,6 +692,8 @@ jack_setup_client_control (jack_engine_t *engine, int fd, ClientType type, const
 #endif
 	jack_transport_client_new (client);
 
+	client->trace_slot = jack_trace_slot_alloc (engine, client);
+
 #ifdef JACK_USE_MACH_THREADS
 	/* specific resources for server/client real-time thread
 	 * communication */
@@ -684,7 +713,7 @@ jack_ensure_uuid_unique (jack_engine_t *engine, jack_uuid_t uuid)
 		return;
 	}
 
-	jack_lock_graph (engine);
+	jack_lock_graph_edit (engine);
 	for (node = engine->clients; node; node = jack_slist_next (node)) {
 		jack_client_internal_t *client = (jack_client_internal_t*)node->data;
 		if (jack_uuid_compare (client->control->uuid, uuid) == 0) {
@@ -703,6 +732,7 @@ setup_client (jack_engine_t *engine, ClientType type, char *name,
 {
 	/* called with the request_lock */
 	jack_client_internal_t *client;
+	JSList *node;
 	char bufx[64];
 
 	/* validate client name, generate a unique one if appropriate */
@@ -712,6 +742,18 @@ setup_client (jack_engine_t *engine, ClientType type, char *name,
 
 	jack_ensure_uuid_unique (engine, uuid);
 
+	/* the cycle plans need room for one more client; clients are
+	   only added under the request_lock, so it is still there when
+	   the client is */
+	jack_lock_graph_edit (engine);
+	if (jack_engine_reserve_cycle_plan
+		    (engine, jack_slist_length (engine->clients) + 1)) {
+		jack_unlock_graph (engine);
+		*status |= (JackFailure | JackInitFailure);
+		return NULL;
+	}
+	jack_unlock_graph (engine);
+
 	/* create a client struct for this name */
 	if ((client = jack_setup_client_control (engine, client_fd,
 						 type, name, uuid)) == NULL) {
@@ -758,9 +800,13 @@ setup_client (jack_engine_t *engine, ClientType type, char *name,
 		client->private_client->deliver_arg = engine;
 	}
 
-	/* add new client to the clients list */
-	jack_lock_graph (engine);
-	engine->clients = jack_slist_prepend (engine->clients, client);
+	/* add new client to the clients list.  Cycles run from the
+	   cycle plan may walk the list meanwhile (post-processing), so
+	   the new head is only published once it is complete. */
+	jack_lock_graph_edit (engine);
+	node = jack_slist_prepend (engine->clients, client);
+	release_fence ();
+	engine->clients = node;
 	jack_engine_reset_rolling_usecs (engine);
 
 	if (jack_client_is_internal (client)) {
@@ -1108,6 +1154,8 @@ jack_client_delete (jack_engine_t *engine, jack_client_internal_t *client)
 	 */
 	jack_property_change_notify (engine, PropertyDeleted, uuid, NULL);
 
+	jack_trace_slot_free (engine, client);
+
 	if (jack_client_is_internal (client)) {
 
 		free (client->private_client);
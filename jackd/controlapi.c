@@ -116,6 +116,14 @@ struct jackctl_server {
 	/* int, timeout thres... */
 	union jackctl_parameter_value timothres;
 	union jackctl_parameter_value default_timothres;
+
+	/* bool, run independent clients concurrently */
+	union jackctl_parameter_value parallel_graph;
+	union jackctl_parameter_value default_parallel_graph;
+
+	/* bool, put port buffers on huge pages near the audio interface */
+	union jackctl_parameter_value hugepages;
+	union jackctl_parameter_value default_hugepages;
 };
 
 struct jackctl_driver {
@@ -956,7 +964,7 @@ jackctl_server_t * jackctl_server_create (
 		    &server_ptr->parameters,
 		    'c',
 		    "clock-source",
-		    "Clocksource type : c(ycle) | h(pet) | s(ystem).",
+		    "Clocksource type : c(ycle) | h(pet) | s(ystem) | t(sc).",
 		    "",
 		    JackParamUInt,
 		    &server_ptr->clock_source,
@@ -1049,6 +1057,34 @@ jackctl_server_t * jackctl_server_create (
 		goto fail_free_parameters;
 	}
 
+	value.b = false;
+	if (jackctl_add_parameter (
+		    &server_ptr->parameters,
+		    'G',
+		    "parallel-graph",
+		    "run independent clients concurrently",
+		    "",
+		    JackParamBool,
+		    &server_ptr->parallel_graph,
+		    &server_ptr->default_parallel_graph,
+		    value, NULL) == NULL) {
+		goto fail_free_parameters;
+	}
+
+	value.b = false;
+	if (jackctl_add_parameter (
+		    &server_ptr->parameters,
+		    'H',
+		    "hugepages",
+		    "put port buffers on huge pages, near the audio interface",
+		    "",
+		    JackParamBool,
+		    &server_ptr->hugepages,
+		    &server_ptr->default_hugepages,
+		    value, NULL) == NULL) {
+		goto fail_free_parameters;
+	}
+
 	//TODO: need
 	//JackServerGlobals::on_device_acquire = on_device_acquire;
 	//JackServerGlobals::on_device_release = on_device_release;
@@ -1112,6 +1148,17 @@ const JSList * jackctl_server_get_parameters (jackctl_server_t *server_ptr)
 	return server_ptr->parameters;
 }
 
+bool jackctl_server_get_profile (jackctl_server_t *server_ptr,
+				 jack_cycle_profile_t *profile)
+{
+	if (server_ptr->engine == NULL) {
+		return false;
+	}
+
+	return jack_profile_copy (&server_ptr->engine->control->profile,
+				  profile) == 0;
+}
+
 bool
 jackctl_server_start (
 	jackctl_server_t *server_ptr,
@@ -1154,7 +1201,9 @@ jackctl_server_start (
 						   server_ptr->do_mlock.b, server_ptr->do_unlock.b, server_ptr->name.str,
 						   server_ptr->temporary.b, server_ptr->verbose.b, server_ptr->client_timeout.i,
 						   server_ptr->port_max.i, getpid (), frame_time_offset,
-						   server_ptr->nozombies.b, server_ptr->timothres.ui, drivers)) == 0) {
+						   server_ptr->nozombies.b, server_ptr->timothres.ui,
+						   server_ptr->parallel_graph.b,
+						   server_ptr->hugepages.b, drivers)) == 0) {
 		jack_error ("cannot create engine");
 		goto fail_unregister;
 	}
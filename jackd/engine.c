@@ -44,6 +44,8 @@
 #include <jack/metadata.h>
 
 #include "internal.h"
+#include "futex.h"
+#include "channel.h"
 #include "engine.h"
 #include "messagebuffer.h"
 #include "driver.h"
@@ -67,6 +69,9 @@
 
 #include "libjack/local.h"
 
+/* cycles run per graph lock while freewheeling */
+#define JACK_FREEWHEEL_BATCH 8
+
 typedef struct {
 
 	jack_port_internal_t *source;
@@ -97,10 +102,14 @@ static int  jack_port_do_connect(jack_engine_t *engine,
 static int  jack_port_do_disconnect(jack_engine_t *engine,
 				    const char *source_port,
 				    const char *destination_port);
+static int  jack_port_do_connect_batch(jack_engine_t *engine,
+				       const char *ops, uint32_t nbytes,
+				       uint32_t count, int8_t *results);
 static int  jack_port_do_disconnect_all(jack_engine_t *engine,
 					jack_port_id_t);
 static int  jack_port_do_unregister(jack_engine_t *engine, jack_request_t *);
 static int  jack_port_do_register(jack_engine_t *engine, jack_request_t *, int);
+static int  jack_port_do_reindex(jack_engine_t *engine, jack_request_t *);
 static int  jack_do_get_port_connections(jack_engine_t *engine,
 					 jack_request_t *req, int reply_fd);
 static int  jack_port_disconnect_internal(jack_engine_t *engine,
@@ -112,6 +121,10 @@ static int  jack_send_connection_notification(jack_engine_t *,
 					      jack_port_id_t, int);
 static void jack_deliver_event_to_all(jack_engine_t *engine,
 				      jack_event_t *event);
+static void jack_deliver_event_to_clients(jack_engine_t *engine,
+					  jack_client_internal_t **clients,
+					  int n, const jack_event_t *event);
+static void jack_flush_event_batch(jack_engine_t *engine);
 static void jack_notify_all_port_interested_clients(jack_engine_t *engine,
 						    jack_uuid_t exclude_src_id,
 						    jack_uuid_t exclude_dst_id,
@@ -123,14 +136,15 @@ static int  jack_run_cycle(jack_engine_t *engine, jack_nframes_t nframes,
 			   float delayed_usecs);
 static int   jack_run_one_cycle(jack_engine_t *engine, jack_nframes_t nframes,
 				float delayed_usecs);
+static void jack_run_freewheel_cycles(jack_engine_t *engine,
+				      jack_nframes_t nframes, int cycles);
 static void jack_engine_delay(jack_engine_t *engine,
 			      float delayed_usecs);
 static void jack_engine_driver_exit(jack_engine_t* engine);
 static int  jack_start_freewheeling(jack_engine_t* engine, jack_uuid_t);
-static int jack_client_feeds_transitive(jack_client_internal_t *source,
+static int jack_client_feeds_transitive(jack_engine_t *engine,
+					jack_client_internal_t *source,
 					jack_client_internal_t *dest);
-static int jack_client_sort(jack_client_internal_t *a,
-			    jack_client_internal_t *b);
 static void jack_check_acyclic(jack_engine_t* engine);
 static void jack_compute_all_port_total_latencies(jack_engine_t *engine);
 static void jack_compute_port_total_latency(jack_engine_t *engine, jack_port_shared_t*);
@@ -352,144 +366,166 @@ make_sockets (const char *server_name, int fd[2])
 	return 0;
 }
 
-void
-jack_engine_place_port_buffers (jack_engine_t* engine,
-				jack_port_type_id_t ptid,
-				jack_shmsize_t one_buffer,
-				jack_shmsize_t size,
-				unsigned long nports,
-				jack_nframes_t nframes)
-{
-	jack_shmsize_t offset;          /* shared memory offset */
-	jack_port_buffer_info_t *bi;
-	jack_port_buffer_list_t* pti = &engine->port_buffers[ptid];
-	jack_port_functions_t *pfuncs = jack_get_port_functions (ptid);
-
-	pthread_mutex_lock (&pti->lock);
-	offset = 0;
-
-	if (pti->info) {
+/* Find the NUMA node of the first sound device interrupt, which is
+ * where the audio interface's DMA buffers live.  Returns -1 if there
+ * is no such interrupt or the system is not NUMA.
+ */
+static int
+jack_sound_numa_node (void)
+{
+	FILE *f;
+	char line[1024], path[64];
+	int irq, node = -1;
 
-		/* Buffer info array already allocated for this port
-		 * type.  This must be a resize operation, so
-		 * recompute the buffer offsets, but leave the free
-		 * list alone.
-		 */
-		int i;
+	if ((f = fopen ("/proc/interrupts", "r")) == NULL) {
+		return -1;
+	}
 
-		bi = pti->info;
-		while (offset < size) {
-			bi->offset = offset;
-			offset += one_buffer;
-			++bi;
-		}
+	irq = -1;
 
-		/* update any existing output port offsets */
-		for (i = 0; i < engine->port_max; i++) {
-			jack_port_shared_t *port = &engine->control->ports[i];
-			if (port->in_use &&
-			    (port->flags & JackPortIsOutput) &&
-			    port->ptype_id == ptid) {
-				bi = engine->internal_ports[i].buffer_info;
-				if (bi) {
-					port->offset = bi->offset;
-				}
-			}
+	while (fgets (line, sizeof(line), f)) {
+		if (strstr (line, "snd") && sscanf (line, " %d:", &irq) == 1) {
+			break;
 		}
+		irq = -1;
+	}
 
-	} else {
-		jack_port_type_info_t* port_type = &engine->control->port_types[ptid];
+	fclose (f);
 
-		/* Allocate an array of buffer info structures for all
-		 * the buffers in the segment.  Chain them to the free
-		 * list in memory address order, offset zero must come
-		 * first.
-		 */
-		bi = pti->info = (jack_port_buffer_info_t*)
-				 malloc (nports * sizeof(jack_port_buffer_info_t));
+	if (irq < 0) {
+		return -1;
+	}
 
-		while (offset < size) {
-			bi->offset = offset;
-			pti->freelist = jack_slist_append (pti->freelist, bi);
-			offset += one_buffer;
-			++bi;
-		}
+	snprintf (path, sizeof(path), "/proc/irq/%d/node", irq);
 
-		/* Allocate the first buffer of the port segment
-		 * for an empy buffer area.
-		 * NOTE: audio buffer is zeroed in its buffer_init function.
-		 */
-		bi = (jack_port_buffer_info_t*)pti->freelist->data;
-		pti->freelist = jack_slist_remove_link (pti->freelist,
-							pti->freelist);
-		port_type->zero_buffer_offset = bi->offset;
-		if (ptid == JACK_AUDIO_PORT_TYPE) {
-			engine->silent_buffer = bi;
+	if ((f = fopen (path, "r")) != NULL) {
+		if (fscanf (f, "%d", &node) != 1) {
+			node = -1;
 		}
+		fclose (f);
 	}
-	/* initialize buffers */
-	{
-		int i;
-		jack_shm_info_t *shm_info = &engine->port_segment[ptid];
-		char* shm_segment = (char*)jack_shm_addr (shm_info);
 
-		bi = pti->info;
-		for (i = 0; i < nports; ++i, ++bi)
-			pfuncs->buffer_init (shm_segment + bi->offset, one_buffer, nframes);
-	}
+	return node;
+}
 
-	pthread_mutex_unlock (&pti->lock);
+/* Port buffers.
+ *
+ * The buffers of each port type live in up to JACK_PORT_MAX_SEGMENTS
+ * shm segments of segment_buffers buffers each.  The engine starts out
+ * with one segment and appends another whenever it runs out of free
+ * buffers.  Existing buffers never move, so adding ports interrupts
+ * nobody: a client maps a new segment the first time it meets a port
+ * whose buffer lives there (see jack_port_new()).  Only a change of
+ * buffer size rebuilds every segment and makes clients re-attach.
+ *
+ * Free buffers sit on a lock-free LIFO whose head packs a buffer
+ * index with a tag that is bumped on every update, as in
+ * libjack/pool.c.
+ */
+
+/* buffers per segment, at least */
+#define JACK_PORT_SEGMENT_MIN_BUFFERS 64
+
+static inline jack_port_buffer_info_t *
+jack_port_buffer_at (jack_port_buffer_list_t *pti, uint32_t index)
+{
+	return &pti->info[index / pti->segment_buffers]
+	       [index % pti->segment_buffers];
+}
+
+static void
+jack_port_buffer_push (jack_port_buffer_list_t *pti,
+		       jack_port_buffer_info_t *bi)
+{
+	uint64_t head, next;
+
+	head = __atomic_load_n (&pti->freelist, __ATOMIC_ACQUIRE);
+	do {
+		__atomic_store_n (&bi->next, (uint32_t)head, __ATOMIC_RELAXED);
+		next = (((head >> 32) + 1) << 32) | (bi->index + 1);
+	} while (!__atomic_compare_exchange_n (&pti->freelist, &head, next, 1,
+					       __ATOMIC_RELEASE,
+					       __ATOMIC_ACQUIRE));
 }
 
+static jack_port_buffer_info_t *
+jack_port_buffer_pop (jack_port_buffer_list_t *pti)
+{
+	jack_port_buffer_info_t *bi;
+	uint64_t head, next;
+
+	head = __atomic_load_n (&pti->freelist, __ATOMIC_ACQUIRE);
+	do {
+		if ((uint32_t)head == 0) {
+			return NULL;
+		}
+		/* buffer info is never freed while the engine runs,
+		   so reading a stale link is harmless: the tag makes
+		   the swap below fail */
+		bi = jack_port_buffer_at (pti, (uint32_t)head - 1);
+		next = (((head >> 32) + 1) << 32)
+		       | __atomic_load_n (&bi->next, __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n (&pti->freelist, &head, next, 1,
+					       __ATOMIC_ACQUIRE,
+					       __ATOMIC_ACQUIRE));
+
+	return bi;
+}
 
+/* Create, attach and initialize segment `seg' of port type `ptid',
+ * replacing whatever was there.  Caller holds the buffer list lock.
+ */
 static int
-jack_resize_port_segment (jack_engine_t *engine,
-			  jack_port_type_id_t ptid,
-			  unsigned long nports)
+jack_port_segment_create (jack_engine_t *engine, jack_port_type_id_t ptid,
+			  uint32_t seg)
 {
-	jack_event_t event;
-	jack_shmsize_t one_buffer;      /* size of one buffer */
-	jack_shmsize_t size;            /* segment size */
 	jack_port_type_info_t* port_type = &engine->control->port_types[ptid];
-	jack_shm_info_t* shm_info = &engine->port_segment[ptid];
-
-	one_buffer = jack_port_type_buffer_size (port_type, engine->control->buffer_size);
-	VERBOSE (engine, "resizing port buffer segment for type %d, one buffer = %u bytes", ptid, one_buffer);
+	jack_port_functions_t *pfuncs = jack_get_port_functions (ptid);
+	jack_shm_info_t* shm_info = &engine->port_segment[ptid][seg];
+	jack_shmsize_t size = port_type->segment_size;
+	jack_shmsize_t one_buffer;
+	char *addr;
+	uint32_t i;
 
-	size = nports * one_buffer;
+	one_buffer = size / engine->port_buffers[ptid].segment_buffers;
 
-	if (shm_info->attached_at == 0) {
+	if (shm_info->attached_at != 0) {
+		/* there is no way to resize a segment in place */
+		jack_release_shm (shm_info);
+		jack_destroy_shm (shm_info);
+	}
 
-		if (jack_shmalloc (size, shm_info)) {
-			jack_error ("cannot create new port segment of %d"
-				    " bytes (%s)",
-				    size,
-				    strerror (errno));
-			return -1;
-		}
+	if (jack_shmalloc_large (size, shm_info, engine->hugepages)) {
+		jack_error ("cannot create new port segment of %d"
+			    " bytes (%s)",
+			    size,
+			    strerror (errno));
+		shm_info->attached_at = 0;
+		return -1;
+	}
 
-		if (jack_attach_shm (shm_info)) {
-			jack_error ("cannot attach to new port segment "
-				    "(%s)", strerror (errno));
-			return -1;
-		}
+	if (jack_attach_shm (shm_info)) {
+		jack_error ("cannot attach to new port segment "
+			    "(%s)", strerror (errno));
+		jack_destroy_shm (shm_info);
+		shm_info->attached_at = 0;
+		return -1;
+	}
 
-		engine->control->port_types[ptid].shm_registry_index =
-			shm_info->index;
+	/* before the buffers are initialized, so that their pages
+	   are first touched on the right node */
+	if (engine->numa_node >= 0) {
+		jack_shm_bind_node (shm_info, engine->numa_node);
+	}
 
-	} else {
+	addr = (char*)jack_shm_addr (shm_info);
 
-		/* resize existing buffer segment */
-		if (jack_resize_shm (shm_info, size)) {
-			jack_error ("cannot resize port segment to %d bytes,"
-				    " (%s)", size,
-				    strerror (errno));
-			return -1;
-		}
+	/* NOTE: audio buffer is zeroed in its buffer_init function. */
+	for (i = 0; i < engine->port_buffers[ptid].segment_buffers; ++i) {
+		pfuncs->buffer_init (addr + i * one_buffer, one_buffer,
+				     engine->control->buffer_size);
 	}
 
-	jack_engine_place_port_buffers (engine, ptid, one_buffer, size, nports, engine->control->buffer_size);
-
 #ifdef USE_MLOCK
 	if (engine->control->real_time) {
 
@@ -502,7 +538,7 @@ jack_resize_port_segment (jack_engine_t *engine,
 		 * munlockall().
 		 */
 
-		int rc = mlock (jack_shm_addr (shm_info), size);
+		int rc = mlock (addr, size);
 		if (rc < 0) {
 			jack_error ("JACK: unable to mlock() port buffers: "
 				    "%s", strerror (errno));
@@ -510,6 +546,151 @@ jack_resize_port_segment (jack_engine_t *engine,
 	}
 #endif  /* USE_MLOCK */
 
+	port_type->shm_registry_index[seg] = shm_info->index;
+
+	return 0;
+}
+
+/* Append a segment of free buffers to port type `ptid', unless
+ * another one was added since the caller saw `n_segments'.
+ */
+static int
+jack_port_segment_grow (jack_engine_t *engine, jack_port_type_id_t ptid,
+			uint32_t n_segments)
+{
+	jack_port_buffer_list_t* pti = &engine->port_buffers[ptid];
+	jack_port_type_info_t* port_type = &engine->control->port_types[ptid];
+	jack_port_buffer_info_t *bi;
+	jack_shmsize_t one_buffer;
+	uint32_t seg, i;
+	int ret = 0;
+
+	pthread_mutex_lock (&pti->lock);
+
+	if ((seg = pti->n_segments) != n_segments) {
+		goto out;
+	}
+
+	if (seg == JACK_PORT_MAX_SEGMENTS) {
+		ret = -1;
+		goto out;
+	}
+
+	one_buffer = port_type->segment_size / pti->segment_buffers;
+
+	if ((pti->info[seg] = (jack_port_buffer_info_t*)
+			      malloc (pti->segment_buffers
+				      * sizeof(jack_port_buffer_info_t))) == NULL
+	    || jack_port_segment_create (engine, ptid, seg)) {
+		free (pti->info[seg]);
+		pti->info[seg] = NULL;
+		ret = -1;
+		goto out;
+	}
+
+	for (i = 0; i < pti->segment_buffers; ++i) {
+		bi = &pti->info[seg][i];
+		bi->shm_info = &engine->port_segment[ptid][seg];
+		bi->offset = seg * port_type->segment_size + i * one_buffer;
+		bi->index = seg * pti->segment_buffers + i;
+	}
+
+	/* clients look the segment up once they see a port in it */
+	release_fence ();
+	port_type->n_segments = seg + 1;
+	pti->n_segments = seg + 1;
+
+	VERBOSE (engine, "added %s port segment %" PRIu32 " (%" PRIu32
+		 " buffers)", port_type->type_name, seg, pti->segment_buffers);
+
+	/* lowest offset comes off the free list first */
+	for (i = pti->segment_buffers; i > 0; --i) {
+		jack_port_buffer_push (pti, &pti->info[seg][i - 1]);
+	}
+
+out:
+	pthread_mutex_unlock (&pti->lock);
+	return ret;
+}
+
+/* Set up the port buffers of type `ptid' for the current buffer
+ * size: the first time, make the first segment and take the zero
+ * buffer from it; after that, rebuild every segment and move the
+ * output ports' offsets along.
+ */
+static int
+jack_resize_port_segments (jack_engine_t *engine, jack_port_type_id_t ptid)
+{
+	jack_event_t event;
+	jack_shmsize_t one_buffer;      /* size of one buffer */
+	jack_port_type_info_t* port_type = &engine->control->port_types[ptid];
+	jack_port_buffer_list_t* pti = &engine->port_buffers[ptid];
+	jack_port_buffer_info_t *bi;
+	uint32_t seg, i;
+
+	one_buffer = jack_port_type_buffer_size (port_type, engine->control->buffer_size);
+	VERBOSE (engine, "resizing port buffer segments for type %d, one buffer = %u bytes", ptid, one_buffer);
+
+	if (pti->n_segments == 0) {
+
+		pti->segment_buffers = (engine->port_max + JACK_PORT_MAX_SEGMENTS - 1)
+				       / JACK_PORT_MAX_SEGMENTS;
+		if (pti->segment_buffers < JACK_PORT_SEGMENT_MIN_BUFFERS) {
+			pti->segment_buffers = JACK_PORT_SEGMENT_MIN_BUFFERS;
+		}
+		port_type->segment_size = pti->segment_buffers * one_buffer;
+
+		if (jack_port_segment_grow (engine, ptid, 0)) {
+			return -1;
+		}
+
+		/* Allocate the first buffer of the port segment
+		 * for an empy buffer area.
+		 */
+		bi = jack_port_buffer_pop (pti);
+		port_type->zero_buffer_offset = bi->offset;
+		if (ptid == JACK_AUDIO_PORT_TYPE) {
+			engine->silent_buffer = bi;
+		}
+
+	} else {
+
+		pthread_mutex_lock (&pti->lock);
+
+		port_type->segment_size = pti->segment_buffers * one_buffer;
+
+		for (seg = 0; seg < pti->n_segments; ++seg) {
+			if (jack_port_segment_create (engine, ptid, seg)) {
+				pthread_mutex_unlock (&pti->lock);
+				return -1;
+			}
+			for (i = 0; i < pti->segment_buffers; ++i) {
+				pti->info[seg][i].offset =
+					seg * port_type->segment_size + i * one_buffer;
+			}
+		}
+
+		port_type->zero_buffer_offset = 0;
+		if (engine->silent_buffer && ptid == JACK_AUDIO_PORT_TYPE) {
+			port_type->zero_buffer_offset = engine->silent_buffer->offset;
+		}
+
+		/* update any existing output port offsets */
+		for (i = 0; i < engine->port_max; i++) {
+			jack_port_shared_t *port = &engine->control->ports[i];
+			if (port->in_use &&
+			    (port->flags & JackPortIsOutput) &&
+			    port->ptype_id == ptid) {
+				bi = engine->internal_ports[i].buffer_info;
+				if (bi) {
+					port->offset = bi->offset;
+				}
+			}
+		}
+
+		pthread_mutex_unlock (&pti->lock);
+	}
+
 	/* Tell everybody about this segment. */
 	event.type = AttachPortSegment;
 	event.y.ptid = ptid;
@@ -538,7 +719,7 @@ jack_driver_buffer_size (jack_engine_t *engine, jack_nframes_t nframes)
 	}
 
 	for (i = 0; i < engine->control->n_port_types; ++i) {
-		if (jack_resize_port_segment (engine, i, engine->control->port_max)) {
+		if (jack_resize_port_segments (engine, i)) {
 			return -1;
 		}
 	}
@@ -578,14 +759,14 @@ jack_set_buffer_size_request (jack_engine_t *engine, jack_nframes_t nframes)
 }
 
 
-static JSList *
-jack_process_internal (jack_engine_t *engine, JSList *node,
-		       jack_nframes_t nframes)
+static unsigned int
+jack_process_internal (jack_engine_t *engine, jack_cycle_plan_t *plan,
+		       unsigned int i, jack_nframes_t nframes)
 {
 	jack_client_internal_t *client;
 	jack_client_control_t *ctl;
 
-	client = (jack_client_internal_t*)node->data;
+	client = plan->steps[i].client;
 	ctl = client->control;
 
 	/* internal client */
@@ -614,9 +795,9 @@ jack_process_internal (jack_engine_t *engine, JSList *node,
 	ctl->state = Finished;
 
 	if (engine->process_errors) {
-		return NULL;            /* will stop the loop */
+		return plan->n_steps;   /* will stop the loop */
 	} else {
-		return jack_slist_next (node);
+		return i + 1;
 	}
 }
 
@@ -657,13 +838,13 @@ linux_poll_bug_encountered (jack_engine_t* engine, jack_time_t then, jack_time_t
 #endif
 
 #ifdef JACK_USE_MACH_THREADS
-static JSList *
-jack_process_external (jack_engine_t *engine, JSList *node)
+static unsigned int
+jack_process_external (jack_engine_t *engine, jack_cycle_plan_t *plan,
+		       unsigned int i)
 {
-	jack_client_internal_t * client = (jack_client_internal_t*)node->data;
+	jack_client_internal_t * client = plan->steps[i].client;
 	jack_client_control_t *ctl;
 
-	client = (jack_client_internal_t*)node->data;
 	ctl = client->control;
 
 	engine->current_client = client;
@@ -677,46 +858,50 @@ jack_process_external (jack_engine_t *engine, JSList *node)
 		ctl->state = Finished;
 	}
 
-	return jack_slist_next (node);
+	return i + 1;
 }
 #else /* !JACK_USE_MACH_THREADS */
-static JSList *
-jack_process_external (jack_engine_t *engine, JSList *node)
+
+/* Start the external client(s) waiting on FIFO `fd', or on wakeup
+ * slot `slot' when the graph uses futexes.
+ */
+static int
+jack_trigger_subgraph (jack_engine_t *engine, jack_cycle_plan_t *plan,
+		       int fd, int slot)
+{
+	char c = 0;
+
+#ifdef HAVE_LINUX_FUTEX
+	if (plan->futex) {
+		jack_wakeup_signal (&engine->control->wakeup[slot]);
+		return 0;
+	}
+#endif
+
+	if (write (fd, &c, sizeof(c)) != sizeof(c)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Wait for the external clients started at `client' to signal
+ * completion on `wait_fd' (or wakeup slot `wait_slot').  Returns
+ * non-zero if the cycle has to be abandoned.
+ */
+static int
+jack_wait_subgraph (jack_engine_t *engine, jack_cycle_plan_t *plan,
+		    jack_client_internal_t *client, int wait_fd, int wait_slot)
 {
 	int status = 0;
 	char c = 0;
 	struct pollfd pfd[1];
 	int poll_timeout;
 	jack_time_t poll_timeout_usecs;
-	jack_client_internal_t *client;
-	jack_client_control_t *ctl;
+	jack_client_control_t *ctl = client->control;
 	jack_time_t now, then;
 	int pollret;
 
-	client = (jack_client_internal_t*)node->data;
-
-	ctl = client->control;
-
-	/* external subgraph */
-
-	/* a race exists if we do this after the write(2) */
-	ctl->state = Triggered;
-
-	ctl->signalled_at = jack_get_microseconds ();
-
-	engine->current_client = client;
-
-	DEBUG ("calling process() on an external subgraph, fd==%d",
-	       client->subgraph_start_fd);
-
-	if (write (client->subgraph_start_fd, &c, sizeof(c)) != sizeof(c)) {
-		jack_error ("cannot initiate graph processing (%s)",
-			    strerror (errno));
-		engine->process_errors++;
-		jack_engine_signal_problems (engine);
-		return NULL; /* will stop the loop */
-	}
-
 	then = jack_get_microseconds ();
 
 	if (engine->freewheeling) {
@@ -729,12 +914,26 @@ jack_process_external (jack_engine_t *engine, JSList *node)
 
 again:
 	poll_timeout = 1 + poll_timeout_usecs / 1000;
-	pfd[0].fd = client->subgraph_wait_fd;
+	pfd[0].fd = wait_fd;
 	pfd[0].events = POLLERR | POLLIN | POLLHUP | POLLNVAL;
 
 	DEBUG ("waiting on fd==%d for process() subgraph to finish (timeout = %d, period_usecs = %d)",
-	       client->subgraph_wait_fd, poll_timeout, engine->driver->period_usecs);
-
+	       wait_fd, poll_timeout, engine->driver->period_usecs);
+
+#ifdef HAVE_LINUX_FUTEX
+	if (plan->futex) {
+		pollret = jack_wakeup_wait_timeout (
+			&engine->control->wakeup[wait_slot], poll_timeout_usecs);
+		pfd[0].revents = (pollret > 0 ? POLLIN : 0);
+		if (pollret < 0) {
+			/* the server thread puts the graph back on
+			   the FIFOs */
+			engine->futex_failed = 1;
+			jack_engine_signal_problems (engine);
+			status = -1;
+		}
+	} else
+#endif
 	if ((pollret = poll (pfd, 1, poll_timeout)) < 0) {
 		jack_error ("poll on subgraph processing failed (%s)",
 			    strerror (errno));
@@ -761,7 +960,7 @@ again:
 
 		if (engine->freewheeling) {
 			if (jack_check_client_status (engine)) {
-				return NULL;
+				return -1;
 			} else {
 				/* all clients are fine - we're just not done yet. since
 				   we're freewheeling, that is fine.
@@ -783,7 +982,7 @@ again:
 		jack_error ("subgraph starting at %s timed out "
 			    "(subgraph_wait_fd=%d, status = %d, state = %s, pollret = %d revents = 0x%x)",
 			    client->control->name,
-			    client->subgraph_wait_fd, status,
+			    wait_fd, status,
 			    jack_client_state_name (client),
 			    pollret, pfd[0].revents);
 		status = 1;
@@ -801,7 +1000,7 @@ again:
 			 " awa = %" PRIu64 " fin = %" PRIu64
 			 " dur=%" PRIu64,
 			 now,
-			 client->subgraph_wait_fd,
+			 wait_fd,
 			 now - then,
 			 status,
 			 ctl->signalled_at,
@@ -813,17 +1012,22 @@ again:
 		if (jack_check_clients (engine, 1)) {
 
 			engine->process_errors++;
-			return NULL;            /* will stop the loop */
+			return -1;
 		}
 	} else {
 		engine->timeout_count = 0;
 	}
 
 
-	DEBUG ("reading byte from subgraph_wait_fd==%d",
-	       client->subgraph_wait_fd);
+#ifdef HAVE_LINUX_FUTEX
+	if (plan->futex) {
+		return 0;       /* the wakeup was consumed above */
+	}
+#endif
+
+	DEBUG ("reading byte from subgraph_wait_fd==%d", wait_fd);
 
-	if (read (client->subgraph_wait_fd, &c, sizeof(c)) != sizeof(c)) {
+	if (read (wait_fd, &c, sizeof(c)) != sizeof(c)) {
 		if (errno == EAGAIN) {
 			jack_error ("pp: cannot clean up byte from graph wait "
 				    "fd - no data present");
@@ -832,61 +1036,374 @@ again:
 				    strerror (errno));
 			client->error++;
 		}
-		return NULL;    /* will stop the loop */
-	}
-
-	/* Move to next internal client (or end of client list) */
-	while (node) {
-		if (jack_client_is_internal ((jack_client_internal_t*)
-					     node->data)) {
-			break;
-		}
-		node = jack_slist_next (node);
+		return -1;
 	}
 
-	return node;
+	return 0;
 }
 
-#endif /* JACK_USE_MACH_THREADS */
-
-static int
-jack_engine_process (jack_engine_t *engine, jack_nframes_t nframes)
+static unsigned int
+jack_process_external (jack_engine_t *engine, jack_cycle_plan_t *plan,
+		       unsigned int i)
 {
-	/* precondition: caller has graph_lock */
+	jack_cycle_step_t *step = &plan->steps[i];
 	jack_client_internal_t *client;
-	JSList *node;
+	jack_client_control_t *ctl;
 
-	engine->process_errors = 0;
+	client = step->client;
 
-	for (node = engine->clients; node; node = jack_slist_next (node)) {
-		jack_client_control_t *ctl =
-			((jack_client_internal_t*)node->data)->control;
-		ctl->state = NotTriggered;
-		ctl->timed_out = 0;
-		ctl->awake_at = 0;
-		ctl->finished_at = 0;
-	}
+	ctl = client->control;
 
-	for (node = engine->clients; engine->process_errors == 0 && node; ) {
+	/* external subgraph */
 
-		client = (jack_client_internal_t*)node->data;
+	/* a race exists if we do this after the write(2) */
+	ctl->state = Triggered;
 
-		DEBUG ("considering client %s for processing",
-		       client->control->name);
+	ctl->signalled_at = jack_get_microseconds ();
 
-		if (!client->control->active ||
-		    (!client->control->process_cbset && !client->control->thread_cb_cbset) ||
-		    client->control->dead) {
-			node = jack_slist_next (node);
-		} else if (jack_client_is_internal (client)) {
-			node = jack_process_internal (engine, node, nframes);
-		} else {
-			node = jack_process_external (engine, node);
-		}
-	}
+	engine->current_client = client;
 
-	return engine->process_errors > 0;
-}
+	DEBUG ("calling process() on an external subgraph, fd==%d",
+	       step->start_fd);
+
+	if (jack_trigger_subgraph (engine, plan, step->start_fd,
+				   step->start_slot)) {
+		jack_error ("cannot initiate graph processing (%s)",
+			    strerror (errno));
+		engine->process_errors++;
+		jack_engine_signal_problems (engine);
+		return plan->n_steps; /* will stop the loop */
+	}
+
+	if (jack_wait_subgraph (engine, plan, client, step->wait_fd,
+				step->wait_slot)) {
+		return plan->n_steps;   /* will stop the loop */
+	}
+
+	/* Move to next internal client (or end of client list) */
+	while (i < plan->n_steps && !plan->steps[i].internal) {
+		i++;
+	}
+
+	return i;
+}
+
+/* Run the external clients of the parallel execution plan.  Clients
+ * with no upstream clients in the plan are all started at once; every
+ * other client is woken by whichever upstream client brings its
+ * activation counter down to zero, and the last sink client to finish
+ * wakes the server.
+ */
+static unsigned int
+jack_process_parallel (jack_engine_t *engine, jack_cycle_plan_t *plan,
+		       unsigned int i)
+{
+	jack_cycle_step_t *step;
+	jack_client_internal_t *first = NULL;
+	jack_control_t *ectl = engine->control;
+	unsigned int n;
+
+	for (n = 0; n < plan->n_steps; n++) {
+		step = &plan->steps[n];
+		if (step->parallel_node) {
+			ectl->activation[step->execution_order] =
+				step->parallel_indegree;
+		}
+	}
+	ectl->activation[plan->parallel_nodes] = plan->parallel_sinks;
+
+	for (n = 0; n < plan->n_steps; n++) {
+		step = &plan->steps[n];
+
+		if (!step->parallel_node || step->parallel_indegree) {
+			continue;
+		}
+
+		if (first == NULL) {
+			first = step->client;
+		}
+
+		/* a race exists if we do this after the write(2) */
+		step->client->control->state = Triggered;
+		step->client->control->signalled_at = jack_get_microseconds ();
+
+		if (jack_trigger_subgraph (engine, plan, step->start_fd,
+					   step->start_slot)) {
+			jack_error ("cannot initiate parallel graph "
+				    "processing (%s)", strerror (errno));
+			engine->process_errors++;
+			jack_engine_signal_problems (engine);
+			return plan->n_steps; /* will stop the loop */
+		}
+	}
+
+	engine->current_client = first;
+
+	if (jack_wait_subgraph (engine, plan, first, plan->parallel_wait_fd,
+				plan->parallel_wait_slot)) {
+		return plan->n_steps;   /* will stop the loop */
+	}
+
+	/* the plan covers every external client, so only internal
+	 * clients (if any) are left to run.
+	 */
+	while (i < plan->n_steps && !plan->steps[i].internal) {
+		i++;
+	}
+
+	return i;
+}
+
+#endif /* JACK_USE_MACH_THREADS */
+
+/* Sleep until the cycle running from a plan, if any, is over.  The
+ * engine thread only takes plan_lock to wake us (see
+ * jack_plan_cycle_clear()), which is rare: the writer holds the graph
+ * lock while it waits here.
+ */
+static void
+jack_engine_wait_plan_cycle (jack_engine_t *engine)
+{
+	unsigned int cycles = engine->plan_cycles;
+
+	pthread_mutex_lock (&engine->plan_lock);
+	engine->plan_waiting = 1;
+	full_fence ();
+
+	while (engine->plan_cycle && engine->plan_cycles == cycles) {
+		pthread_cond_wait (&engine->plan_done, &engine->plan_lock);
+	}
+
+	engine->plan_waiting = 0;
+	pthread_mutex_unlock (&engine->plan_lock);
+}
+
+/* Graph edits that hold the write lock (see jack_lock_graph_edit())
+ * don't stop the engine: it runs the cycle from the published plan
+ * instead of taking the read lock.  A writer that is about to change
+ * something such a cycle uses stops them here, first waiting for the
+ * one in progress.
+ */
+void
+jack_engine_quiesce (jack_engine_t *engine)
+{
+	/* caller holds the graph write lock */
+
+	if (engine->plan_quiesced) {
+		return;
+	}
+
+	engine->plan_quiesced = 1;
+	full_fence ();
+
+	jack_engine_wait_plan_cycle (engine);
+}
+
+/* The fence pairs with the one in jack_engine_wait_plan_cycle():
+ * either the writer sees plan_cycle clear, or we see it waiting.
+ */
+static void
+jack_plan_cycle_clear (jack_engine_t *engine)
+{
+	engine->plan_cycle = 0;
+	full_fence ();
+
+	if (engine->plan_waiting) {
+		pthread_mutex_lock (&engine->plan_lock);
+		pthread_cond_signal (&engine->plan_done);
+		pthread_mutex_unlock (&engine->plan_lock);
+	}
+}
+
+/* Called by the engine thread when the graph is write locked.
+ * Returns non-zero if the writer doesn't allow a cycle now.
+ */
+static int
+jack_plan_cycle_begin (jack_engine_t *engine)
+{
+	engine->plan_cycle = 1;
+	full_fence ();
+
+	if (engine->plan_quiesced) {
+		jack_plan_cycle_clear (engine);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+jack_plan_cycle_end (jack_engine_t *engine)
+{
+	engine->plan_cycles++;
+	release_fence ();
+	jack_plan_cycle_clear (engine);
+}
+
+/* Make room for `n' clients in both cycle plans, so that publishing
+ * one never has to allocate: a graph edit that cannot get the memory
+ * fails here, before it is made, instead of leaving the engine
+ * without a plan that matches the graph.
+ */
+int
+jack_engine_reserve_cycle_plan (jack_engine_t *engine, unsigned int n)
+{
+	jack_cycle_plan_t *plan;
+	jack_cycle_step_t *steps;
+	int i;
+
+	/* caller holds the graph write lock */
+
+	for (i = 0; i < 2; i++) {
+
+		plan = &engine->cycle_plans[i];
+
+		if (n <= plan->max_steps) {
+			continue;
+		}
+
+		/* no cycle may run from a plan while it moves */
+		jack_engine_quiesce (engine);
+
+		steps = (jack_cycle_step_t*)
+			realloc (plan->steps, 2 * n * sizeof(jack_cycle_step_t));
+		if (steps == NULL) {
+			jack_error ("cannot allocate cycle plan for %u clients",
+				    n);
+			return -1;
+		}
+		plan->steps = steps;
+		plan->max_steps = 2 * n;
+	}
+
+	return 0;
+}
+
+/* Build the cycle plan for the current graph into the spare plan and
+ * make it the one the engine runs.  The old plan is left alone until
+ * any cycle still running from it is done, so it can be rebuilt next
+ * time, and clients that are no longer in the new plan can be freed.
+ * The plans have room for every client (see
+ * jack_engine_reserve_cycle_plan()); if not, the current plan stays
+ * and -1 is returned.
+ */
+int
+jack_engine_publish_cycle_plan (jack_engine_t *engine)
+{
+	jack_cycle_plan_t *plan;
+	jack_cycle_step_t *step;
+	jack_client_internal_t *client;
+	JSList *node;
+	unsigned int i, n;
+
+	/* caller holds the graph write lock */
+
+	plan = (engine->cycle_plan == &engine->cycle_plans[0] ?
+		&engine->cycle_plans[1] : &engine->cycle_plans[0]);
+
+	n = jack_slist_length (engine->clients);
+
+	if (n > plan->max_steps) {
+		jack_error ("no room for %u clients in the cycle plan", n);
+		return -1;
+	}
+
+	plan->n_steps = n;
+
+	for (i = 0, node = engine->clients; i < n;
+	     i++, node = jack_slist_next (node)) {
+
+		client = (jack_client_internal_t*)node->data;
+		step = &plan->steps[i];
+
+		step->client = client;
+		step->internal = jack_client_is_internal (client);
+		step->start_fd = client->subgraph_start_fd;
+		step->start_slot = client->subgraph_start_slot;
+		step->wait_fd = client->subgraph_wait_fd;
+		step->wait_slot = client->subgraph_wait_slot;
+		step->parallel_node = client->parallel_node;
+		step->parallel_indegree = client->parallel_indegree;
+		step->execution_order = client->execution_order;
+	}
+
+	plan->parallel = engine->parallel_active;
+	plan->parallel_nodes = engine->parallel_nodes;
+	plan->parallel_sinks = engine->parallel_sinks;
+	plan->parallel_wait_fd = engine->parallel_wait_fd;
+	plan->parallel_wait_slot = engine->parallel_wait_slot;
+	plan->futex = engine->futex_active;
+
+	release_fence ();
+	engine->cycle_plan = plan;
+	full_fence ();
+
+	/* wait out a cycle that started from the old plan */
+	jack_engine_wait_plan_cycle (engine);
+
+	return 0;
+}
+
+/* Called before the drivers read, so that anything they write
+ * belongs to the new cycle.
+ */
+static void
+jack_engine_cycle_start (jack_engine_t *engine)
+{
+	/* ends the silence marked by any port in the last cycle */
+	if (++engine->control->cycle_count == 0) {
+		engine->control->cycle_count = 1;
+	}
+
+	/* MIDI buffers moved to the overflow arena last cycle are
+	   ignored from now on (see jack_midi_overflow_t) */
+	jack_midi_overflow_arena (engine->control)->used = 0;
+}
+
+static int
+jack_engine_process (jack_engine_t *engine, jack_nframes_t nframes)
+{
+	/* precondition: caller has graph_lock, or runs a cycle from
+	   the published plan (see jack_plan_cycle_begin()) */
+	jack_cycle_plan_t *plan = engine->cycle_plan;
+	jack_client_internal_t *client;
+	unsigned int i;
+
+	engine->process_errors = 0;
+
+	for (i = 0; i < plan->n_steps; i++) {
+		jack_client_control_t *ctl = plan->steps[i].client->control;
+		ctl->state = NotTriggered;
+		ctl->timed_out = 0;
+		ctl->signalled_at = 0;
+		ctl->awake_at = 0;
+		ctl->finished_at = 0;
+	}
+
+	for (i = 0; engine->process_errors == 0 && i < plan->n_steps; ) {
+
+		client = plan->steps[i].client;
+
+		DEBUG ("considering client %s for processing",
+		       client->control->name);
+
+		if (!client->control->active ||
+		    (!client->control->process_cbset && !client->control->thread_cb_cbset) ||
+		    client->control->dead) {
+			i++;
+		} else if (plan->steps[i].internal) {
+			i = jack_process_internal (engine, plan, i, nframes);
+#ifndef JACK_USE_MACH_THREADS
+		} else if (plan->parallel) {
+			i = jack_process_parallel (engine, plan, i);
+#endif
+		} else {
+			i = jack_process_external (engine, plan, i);
+		}
+	}
+
+	return engine->process_errors > 0;
+}
 
 static void
 jack_calc_cpu_load (jack_engine_t *engine)
@@ -943,13 +1460,160 @@ jack_calc_cpu_load (jack_engine_t *engine)
 
 }
 
+/* Append this cycle's timings to the trace ring of every client that
+ * ran.  A client that was not started by the server itself was woken
+ * by an upstream client, so its trigger time is taken to be the latest
+ * finish of any client before it in the (sorted) client list, as long
+ * as that came before it woke.
+ */
+static void
+jack_trace_cycle (jack_engine_t *engine)
+{
+	jack_control_t *ectl = engine->control;
+	jack_time_t cycle_start = ectl->current_time.usecs;
+	jack_time_t upstream_done = cycle_start;
+	jack_time_t triggered;
+	jack_client_internal_t *client;
+	jack_client_control_t *ctl;
+	jack_trace_slot_t *slot;
+	jack_trace_entry_t *entry;
+	jack_cycle_plan_t *plan = engine->cycle_plan;
+	unsigned int i;
+	uint32_t cycle = engine->trace_cycle++;
+
+	for (i = 0; i < plan->n_steps; i++) {
+
+		client = plan->steps[i].client;
+		ctl = client->control;
+
+		if (client->trace_slot < 0 || !ctl->active ||
+		    (!ctl->process_cbset && !ctl->thread_cb_cbset) ||
+		    ctl->awake_at == 0) {
+			continue;
+		}
+
+		slot = &jack_trace_slots (ectl)[client->trace_slot];
+		entry = &slot->ring[slot->head & (JACK_TRACE_RING - 1)];
+
+		if (ctl->signalled_at >= cycle_start) {
+			triggered = ctl->signalled_at;
+		} else if (upstream_done <= ctl->awake_at) {
+			triggered = upstream_done;
+		} else {
+			triggered = cycle_start;
+		}
+
+		entry->cycle = cycle;
+		entry->flags = 0;
+		entry->wakeup_usecs = ctl->awake_at > triggered ?
+				      ctl->awake_at - triggered : 0;
+
+		if (ctl->finished_at >= ctl->awake_at) {
+			entry->process_usecs = ctl->finished_at - ctl->awake_at;
+			entry->finish_usecs = ctl->finished_at - cycle_start;
+			if (ctl->finished_at > upstream_done) {
+				upstream_done = ctl->finished_at;
+			}
+		} else {
+			entry->flags |= JackTraceUnfinished;
+			entry->process_usecs = 0;
+			entry->finish_usecs = 0;
+		}
+
+		if (!engine->freewheeling &&
+		    ((entry->flags & JackTraceUnfinished) ||
+		     entry->finish_usecs > engine->driver->period_usecs)) {
+			entry->flags |= JackTraceLate;
+		}
+
+		/* publish the entry */
+		release_fence ();
+		slot->head++;
+	}
+}
+
+/* Claim a trace slot for a new client.  Clients beyond the first
+ * JACK_TRACE_SLOTS simply go untraced.
+ */
+int
+jack_trace_slot_alloc (jack_engine_t *engine, jack_client_internal_t *client)
+{
+	jack_trace_slot_t *slot;
+	int i;
+
+	for (i = 0; i < JACK_TRACE_SLOTS; i++) {
+		slot = &jack_trace_slots (engine->control)[i];
+		if (!slot->in_use) {
+			jack_uuid_copy (&slot->client_id, client->control->uuid);
+			snprintf (slot->client_name, sizeof(slot->client_name),
+				  "%s", client->control->name);
+			slot->head = 0;
+			release_fence ();
+			slot->in_use = 1;
+			return i;
+		}
+	}
+
+	VERBOSE (engine, "no timing trace slot left for %s",
+		 client->control->name);
+	return -1;
+}
+
+void
+jack_trace_slot_free (jack_engine_t *engine, jack_client_internal_t *client)
+{
+	if (client->trace_slot >= 0) {
+		jack_trace_slots (engine->control)[client->trace_slot].in_use = 0;
+		client->trace_slot = -1;
+	}
+}
+
+static inline void
+jack_profile_add (jack_profile_histogram_t *hist, uint32_t usecs)
+{
+	hist->count++;
+	hist->total_usecs += usecs;
+	if (usecs > hist->max_usecs) {
+		hist->max_usecs = usecs;
+	}
+	hist->buckets[jack_profile_bucket (usecs)]++;
+}
+
+/* Count one cycle into the profile.  `t' holds the times at which
+ * the driver read started and at which it, the client graph, the
+ * driver write and post-processing were done.
+ */
+static void
+jack_profile_cycle (jack_engine_t *engine, const jack_time_t *t)
+{
+	jack_cycle_profile_t *profile = &engine->control->profile;
+	int i;
+
+	profile->guard1++;
+	release_fence ();
+
+	if (engine->profile_jitter >= 0) {
+		jack_profile_add (&profile->phase[JackProfileWakeup],
+				  engine->profile_jitter);
+	}
+
+	for (i = JackProfileRead; i < JackProfilePhases; i++) {
+		jack_profile_add (&profile->phase[i], t[i] - t[i - 1]);
+	}
+
+	release_fence ();
+	profile->guard2++;
+}
+
 static void
 jack_engine_post_process (jack_engine_t *engine)
 {
-	/* precondition: caller holds the graph lock. */
+	/* precondition: caller holds the graph lock, or runs a cycle
+	   from the published plan. */
 
 	jack_transport_cycle_end (engine);
 	jack_calc_cpu_load (engine);
+	jack_trace_cycle (engine);
 	jack_check_clients (engine, 0);
 }
 
@@ -1236,6 +1900,14 @@ do_request (jack_engine_t *engine, jack_request_t *req, int *reply_fd)
 				      req->x.connect.destination_port);
 		break;
 
+	case ConnectPortsBatch:
+		req->status = jack_port_do_connect_batch
+				      (engine, req->x.connect_batch.ops,
+				      req->x.connect_batch.nbytes,
+				      req->x.connect_batch.count,
+				      req->x.connect_batch.results);
+		break;
+
 	case DisconnectPort:
 		req->status = jack_port_do_disconnect_all
 				      (engine, req->x.port_info.port_id);
@@ -1385,6 +2057,10 @@ do_request (jack_engine_t *engine, jack_request_t *req, int *reply_fd)
 		jack_property_change_notify (engine, req->x.property.change, req->x.property.uuid, req->x.property.key);
 		break;
 
+	case ReindexPort:
+		req->status = jack_port_do_reindex (engine, req);
+		break;
+
 	case PortNameChanged:
 		jack_rdlock_graph (engine);
 		jack_port_rename_notify (engine, req->x.connect.source_port, req->x.connect.destination_port);
@@ -1419,6 +2095,7 @@ handle_external_client_request (jack_engine_t *engine, int fd)
 	int reply_fd;
 	JSList *node;
 	ssize_t r;
+	size_t got;
 
 	for (node = engine->clients; node; node = jack_slist_next (node)) {
 		if (((jack_client_internal_t*)node->data)->request_fd == fd) {
@@ -1472,11 +2149,42 @@ handle_external_client_request (jack_engine_t *engine, int fd)
 		}
 	}
 
+	if (req.type == ConnectPortsBatch) {
+		if (req.x.connect_batch.nbytes > JACK_CONNECT_BATCH_MAX_BYTES
+		    || req.x.connect_batch.count > req.x.connect_batch.nbytes) {
+			jack_error ("connection batch from client too large"
+				    " (%" PRIu32 " ops, %" PRIu32 " bytes)",
+				    req.x.connect_batch.count,
+				    req.x.connect_batch.nbytes);
+			return -1;
+		}
+		req.x.connect_batch.ops = (char*)malloc (req.x.connect_batch.nbytes);
+		req.x.connect_batch.results = (int8_t*)malloc (req.x.connect_batch.count + 1);
+		for (got = 0; got < req.x.connect_batch.nbytes; got += r) {
+			r = read (client->request_fd,
+				  (char*)req.x.connect_batch.ops + got,
+				  req.x.connect_batch.nbytes - got);
+			if (r <= 0 && !(r < 0 && errno == EINTR)) {
+				break;
+			}
+			if (r < 0) {
+				r = 0;
+			}
+		}
+		if (got < req.x.connect_batch.nbytes) {
+			jack_error ("cannot read connection batch from client (%s)",
+				    strerror (errno));
+			free ((char*)req.x.connect_batch.ops);
+			free (req.x.connect_batch.results);
+			return -1;
+		}
+	}
+
 	reply_fd = client->request_fd;
 
 	jack_unlock_graph (engine);
 	do_request (engine, &req, &reply_fd);
-	jack_lock_graph (engine);
+	jack_lock_graph_edit (engine);
 
 	if (req.type == PropertyChangeNotify && req.x.property.key) {
 		free ((char*)req.x.property.key);
@@ -1487,13 +2195,27 @@ handle_external_client_request (jack_engine_t *engine, int fd)
 		if (write (reply_fd, &req, sizeof(req))
 		    < (ssize_t)sizeof(req)) {
 			jack_error ("cannot write request result to client");
-			return -1;
+			r = -1;
+		} else if (req.type == ConnectPortsBatch && req.status >= 0
+			   && write (reply_fd, req.x.connect_batch.results,
+				     req.x.connect_batch.count)
+			   < (ssize_t)req.x.connect_batch.count) {
+			jack_error ("cannot write connection batch results to client");
+			r = -1;
+		} else {
+			r = 0;
 		}
 	} else {
 		DEBUG ("*not* replying to client");
+		r = 0;
 	}
 
-	return 0;
+	if (req.type == ConnectPortsBatch) {
+		free ((char*)req.x.connect_batch.ops);
+		free (req.x.connect_batch.results);
+	}
+
+	return r;
 }
 
 static int
@@ -1529,22 +2251,195 @@ handle_client_ack_connection (jack_engine_t *engine, int client_fd)
 }
 
 
-static void *
-jack_server_thread (void *arg)
+#ifdef HAVE_LINUX_FUTEX
 
+/* Answer one query from a client's request channel.  `payload' holds
+ * msg->size bytes and has room for JACK_CHANNEL_MAX_PAYLOAD; the reply
+ * replaces both.  A reply of type 0 tells the client to send the
+ * request through its socket instead.
+ */
+static void
+jack_channel_do_request (jack_engine_t *engine, jack_channel_msg_t *msg,
+			 char *payload)
 {
-	jack_engine_t *engine = (jack_engine_t*)arg;
-	struct sockaddr_un client_addr;
-	socklen_t client_addrlen;
-	int problemsProblemsPROBLEMS = 0;
-	int client_socket;
-	int done = 0;
-	int i;
-	const int fixed_fd_cnt = 3;
-	int stop_freewheeling;
-
-	while (!done) {
-		JSList* node;
+	jack_request_t req;
+	jack_port_internal_t *port;
+	jack_port_id_t port_id, *ids;
+	jack_connection_internal_t *connection;
+	uint32_t nports;
+	JSList *node;
+
+	/* caller must hold the graph lock */
+
+	switch (msg->type) {
+	case GetPortConnections:
+	case GetPortNConnections:
+		if (msg->size != sizeof(port_id)) {
+			break;
+		}
+		memcpy (&port_id, payload, sizeof(port_id));
+		if (port_id >= engine->port_max
+		    || !engine->control->ports[port_id].in_use) {
+			msg->status = -1;
+			msg->size = 0;
+			return;
+		}
+		port = &engine->internal_ports[port_id];
+		nports = jack_slist_length (port->connections);
+
+		if (msg->type == GetPortNConnections) {
+			memcpy (payload, &nports, sizeof(nports));
+			msg->status = 0;
+			msg->size = sizeof(nports);
+			return;
+		}
+
+		if (sizeof(nports) + nports * sizeof(port_id)
+		    > JACK_CHANNEL_MAX_PAYLOAD) {
+			break;
+		}
+
+		memcpy (payload, &nports, sizeof(nports));
+		ids = (jack_port_id_t*)(payload + sizeof(nports));
+
+		for (node = port->connections; node; node = jack_slist_next (node)) {
+			connection = (jack_connection_internal_t*)node->data;
+			if (connection->source == port) {
+				port_id = connection->destination->shared->id;
+			} else {
+				port_id = connection->source->shared->id;
+			}
+			memcpy (ids++, &port_id, sizeof(port_id));
+		}
+
+		msg->status = 0;
+		msg->size = sizeof(nports) + nports * sizeof(port_id);
+		return;
+
+	case GetClientByUUID:
+		if (msg->size != sizeof(req.x.client_id)) {
+			break;
+		}
+		memcpy (&req.x.client_id, payload, sizeof(req.x.client_id));
+		jack_do_get_client_by_uuid (engine, &req);
+		msg->status = req.status;
+		msg->size = 0;
+		if (req.status == 0) {
+			msg->size = strlen (req.x.port_info.name) + 1;
+			memcpy (payload, req.x.port_info.name, msg->size);
+		}
+		return;
+
+	case GetUUIDByClientName:
+		if (msg->size == 0 || msg->size > sizeof(req.x.name)
+		    || payload[msg->size - 1] != '\0') {
+			break;
+		}
+		memcpy (req.x.name, payload, msg->size);
+		jack_do_get_uuid_by_client_name (engine, &req);
+		msg->status = req.status;
+		msg->size = 0;
+		if (req.status == 0) {
+			msg->size = sizeof(req.x.client_id);
+			memcpy (payload, &req.x.client_id, msg->size);
+		}
+		return;
+
+	default:
+		break;
+	}
+
+	msg->type = 0;
+	msg->status = -1;
+	msg->size = 0;
+}
+
+/* Serve the clients' shared memory request channels.  Clients kick
+ * control->channel_doorbell after writing a request; we answer every
+ * request waiting in any channel and then go back to sleep on it.
+ */
+static void *
+jack_channel_thread (void *arg)
+{
+	jack_engine_t *engine = (jack_engine_t*)arg;
+	jack_wakeup_t *doorbell = &engine->control->channel_doorbell;
+	jack_client_internal_t *client;
+	jack_channel_ring_t *requests, *replies;
+	jack_channel_msg_t msg;
+	char payload[JACK_CHANNEL_MAX_PAYLOAD];
+	JSList *node;
+	int seq, served;
+
+	while (!engine->channel_stop) {
+
+		seq = doorbell->seq;
+		served = 0;
+
+		jack_rdlock_graph (engine);
+
+		for (node = engine->clients; node; node = jack_slist_next (node)) {
+
+			client = (jack_client_internal_t*)node->data;
+
+			if (!client->control->request_channel
+			    || client->control->dead
+			    || client->error >= JACK_ERROR_WITH_SOCKETS) {
+				continue;
+			}
+
+			requests = (jack_channel_ring_t*)&client->control->request_ring;
+			replies = (jack_channel_ring_t*)&client->control->reply_ring;
+
+			while (jack_channel_get (requests, &msg, payload,
+						 sizeof(payload))) {
+				jack_channel_do_request (engine, &msg, payload);
+				if (jack_channel_put (replies, &msg, payload)) {
+					jack_error ("no room for a reply in the"
+						    " request channel of %s",
+						    client->control->name);
+				}
+				jack_wakeup_kick (&replies->doorbell);
+				served++;
+			}
+		}
+
+		jack_unlock_graph (engine);
+
+		if (!served && jack_wakeup_wait (doorbell, seq, 1000000)) {
+			/* clients go back to the socket */
+			jack_error ("request channel disabled");
+			engine->channel_stop = 1;
+			jack_rdlock_graph (engine);
+			for (node = engine->clients; node;
+			     node = jack_slist_next (node)) {
+				client = (jack_client_internal_t*)node->data;
+				client->control->request_channel = 0;
+			}
+			jack_unlock_graph (engine);
+		}
+	}
+
+	return NULL;
+}
+
+#endif /* HAVE_LINUX_FUTEX */
+
+static void *
+jack_server_thread (void *arg)
+
+{
+	jack_engine_t *engine = (jack_engine_t*)arg;
+	struct sockaddr_un client_addr;
+	socklen_t client_addrlen;
+	int problemsProblemsPROBLEMS = 0;
+	int client_socket;
+	int done = 0;
+	int i;
+	const int fixed_fd_cnt = 3;
+	int stop_freewheeling;
+
+	while (!done) {
+		JSList* node;
 		int clients;
 
 		jack_rdlock_graph (engine);
@@ -1642,6 +2537,10 @@ jack_server_thread (void *arg)
 
 		jack_rdlock_graph (engine);
 
+		/* hold back notifications until every request has been
+		   handled */
+		engine->event_batch = 1;
+
 		for (i = fixed_fd_cnt; i < engine->pfd_max; i++) {
 
 			if (engine->pfd[i].fd < 0) {
@@ -1663,6 +2562,8 @@ jack_server_thread (void *arg)
 			}
 		}
 
+		jack_flush_event_batch (engine);
+
 		problemsProblemsPROBLEMS = engine->problems;
 
 		jack_unlock_graph (engine);
@@ -1679,6 +2580,13 @@ jack_server_thread (void *arg)
 			jack_lock_graph (engine);
 			VERBOSE (engine, "we have problem clients (problems = %d", problemsProblemsPROBLEMS);
 			jack_remove_clients (engine, &stop_freewheeling);
+			if (engine->futex_failed) {
+				VERBOSE (engine, "futex wait failed, client "
+					 "wakeups go back to FIFOs");
+				engine->futex_available = 0;
+				engine->futex_failed = 0;
+				jack_sort_graph (engine);
+			}
 			if (stop_freewheeling) {
 				VERBOSE (engine, "need to stop freewheeling once problems are cleared");
 			}
@@ -1757,10 +2665,13 @@ jack_engine_t *
 jack_engine_new (int realtime, int rtpriority, int do_mlock, int do_unlock,
 		 const char *server_name, int temporary, int verbose,
 		 int client_timeout, unsigned int port_max, pid_t wait_pid,
-		 jack_nframes_t frame_time_offset, int nozombies, int timeout_count_threshold, JSList *drivers)
+		 jack_nframes_t frame_time_offset, int nozombies, int timeout_count_threshold,
+		 int parallel_graph, int hugepages, JSList *drivers)
 {
 	jack_engine_t *engine;
-	unsigned int i;
+	unsigned int i, j;
+	uint32_t port_hash_size;
+	uint32_t midi_overflow_size;
 	char server_dir[PATH_MAX + 1] = "";
 
 #ifdef USE_CAPABILITIES
@@ -1797,6 +2708,13 @@ jack_engine_new (int realtime, int rtpriority, int do_mlock, int do_unlock,
 
 	jack_init_time ();
 
+	/* a TSC that is no clock is refused, rather than replaced */
+	if (jack_set_clock_source (clock_source) &&
+	    clock_source == JACK_TIMER_TSC) {
+		jack_error ("cannot use the TSC as clock source");
+		return NULL;
+	}
+
 	/* allocate the engine, zero the structure to ease debugging */
 	engine = (jack_engine_t*)calloc (1, sizeof(jack_engine_t));
 
@@ -1819,6 +2737,8 @@ jack_engine_new (int realtime, int rtpriority, int do_mlock, int do_unlock,
 
 	engine->port_max = port_max;
 	engine->server_thread = 0;
+	engine->channel_running = 0;
+	engine->channel_stop = 0;
 	engine->rtpriority = rtpriority;
 	engine->silent_buffer = 0;
 	engine->verbose = verbose;
@@ -1828,9 +2748,43 @@ jack_engine_new (int realtime, int rtpriority, int do_mlock, int do_unlock,
 	engine->stop_freewheeling = 0;
 	jack_uuid_clear (&engine->fwclient);
 	engine->feedbackcount = 0;
+	engine->sort_mark = 0;
 	engine->wait_pid = wait_pid;
 	engine->nozombies = nozombies;
 	engine->timeout_count_threshold = timeout_count_threshold;
+#ifdef JACK_USE_MACH_THREADS
+	if (parallel_graph) {
+		jack_info ("parallel graph execution is not supported "
+			   "with Mach threads, using the serial chain");
+		parallel_graph = 0;
+	}
+#endif
+	engine->parallel_graph = parallel_graph;
+	engine->parallel_active = 0;
+	engine->parallel_nodes = 0;
+	engine->parallel_sinks = 0;
+	engine->parallel_wait_fd = -1;
+	engine->parallel_wait_slot = -1;
+	engine->futex_available = 0;
+	engine->futex_active = 0;
+	engine->futex_failed = 0;
+#if defined(HAVE_LINUX_FUTEX) && !defined(JACK_USE_MACH_THREADS)
+	engine->futex_available = jack_futex_available ();
+#endif
+	engine->cycle_plan = &engine->cycle_plans[0];
+	engine->plan_quiesced = 1;
+	engine->plan_cycle = 0;
+	engine->plan_cycles = 0;
+	pthread_mutex_init (&engine->plan_lock, 0);
+	pthread_cond_init (&engine->plan_done, 0);
+	engine->plan_waiting = 0;
+	engine->chain_changed = 0;
+	engine->hugepages = hugepages;
+	engine->numa_node = hugepages ? jack_sound_numa_node () : -1;
+	if (engine->numa_node >= 0) {
+		VERBOSE (engine, "port buffers will be placed on NUMA node %d",
+			 engine->numa_node);
+	}
 	engine->removing_clients = 0;
 	engine->new_clients_allowed = 1;
 
@@ -1849,6 +2803,9 @@ jack_engine_new (int realtime, int rtpriority, int do_mlock, int do_unlock,
 	pthread_mutex_init (&engine->port_lock, 0);
 	pthread_mutex_init (&engine->request_lock, 0);
 	pthread_mutex_init (&engine->problem_lock, 0);
+	pthread_mutex_init (&engine->event_lock, 0);
+	engine->event_batch = 0;
+	engine->defer_replies = 0;
 
 	engine->clients = 0;
 	engine->reserved_client_names = 0;
@@ -1881,8 +2838,23 @@ jack_engine_new (int realtime, int rtpriority, int do_mlock, int do_unlock,
 
 	srandom (time ((time_t*)0));
 
+	/* each port has up to three keys in the name index; keep it
+	   at most half full */
+	for (port_hash_size = 1; port_hash_size < 6 * engine->port_max;
+	     port_hash_size <<= 1) ;
+
+	midi_overflow_size = JACK_MIDI_OVERFLOW_BUFFERS
+			     * jack_builtin_port_types[JACK_MIDI_PORT_TYPE].buffer_size;
+	if (midi_overflow_size < JACK_MIDI_OVERFLOW_MIN) {
+		midi_overflow_size = JACK_MIDI_OVERFLOW_MIN;
+	}
+
 	if (jack_shmalloc (sizeof(jack_control_t)
-			   + ((sizeof(jack_port_shared_t) * engine->port_max)),
+			   + ((sizeof(jack_port_shared_t) * engine->port_max))
+			   + ((sizeof(jack_port_hash_entry_t) * port_hash_size))
+			   + ((sizeof(jack_trace_slot_t) * JACK_TRACE_SLOTS))
+			   + JACK_MIDI_OVERFLOW_PAD
+			   + sizeof(jack_midi_overflow_t) + midi_overflow_size,
 			   &engine->control_shm)) {
 		jack_error ("cannot create engine control shared memory "
 			    "segment (%s)", strerror (errno));
@@ -1918,12 +2890,17 @@ jack_engine_new (int realtime, int rtpriority, int do_mlock, int do_unlock,
 		pthread_mutex_init (&engine->port_buffers[i].lock, NULL);
 
 		/* set buffer list info correctly */
-		engine->port_buffers[i].freelist = NULL;
-		engine->port_buffers[i].info = NULL;
+		engine->port_buffers[i].freelist = 0;
+		engine->port_buffers[i].segment_buffers = 0;
+		engine->port_buffers[i].n_segments = 0;
+		engine->control->port_types[i].n_segments = 0;
 
 		/* mark each port segment as not allocated */
-		engine->port_segment[i].index = -1;
-		engine->port_segment[i].attached_at = 0;
+		for (j = 0; j < JACK_PORT_MAX_SEGMENTS; ++j) {
+			engine->port_buffers[i].info[j] = NULL;
+			engine->port_segment[i][j].index = -1;
+			engine->port_segment[i][j].attached_at = 0;
+		}
 	}
 
 	engine->control->n_port_types = i;
@@ -1943,15 +2920,34 @@ jack_engine_new (int realtime, int rtpriority, int do_mlock, int do_unlock,
 	engine->internal_ports = (jack_port_internal_t*)
 				 malloc (sizeof(jack_port_internal_t) * engine->port_max);
 
-	for (i = 0; i < engine->port_max; i++)
+	for (i = 0; i < engine->port_max; i++) {
 		engine->internal_ports[i].connections = 0;
+		engine->internal_ports[i].n_name_hash = 0;
+	}
+
+	engine->control->port_max = engine->port_max;
+	engine->control->cycle_count = 0;
+	memset (&engine->control->profile, 0, sizeof(jack_cycle_profile_t));
+	engine->profile_jitter = -1;
+	engine->control->midi_overflow_size = midi_overflow_size;
+	jack_midi_overflow_arena (engine->control)->used = 0;
+	jack_midi_overflow_arena (engine->control)->size = midi_overflow_size;
+	jack_midi_set_overflow_arena (engine->control);
+	engine->control->port_hash_size = port_hash_size;
+	engine->control->port_hash_seq = 0;
+	for (i = 0; i < port_hash_size; i++) {
+		jack_port_hash_table (engine->control)[i].id = JACK_PORT_HASH_EMPTY;
+	}
+	for (i = 0; i < JACK_TRACE_SLOTS; i++) {
+		jack_trace_slots (engine->control)[i].in_use = 0;
+	}
+	engine->trace_cycle = 0;
 
 	if (make_sockets (engine->server_name, engine->fds) < 0) {
 		jack_error ("cannot create server sockets");
 		return NULL;
 	}
 
-	engine->control->port_max = engine->port_max;
 	engine->control->real_time = realtime;
 
 	/* leave some headroom for other client threads to run
@@ -1973,12 +2969,27 @@ jack_engine_new (int realtime, int rtpriority, int do_mlock, int do_unlock,
 	engine->control->xrun_delayed_usecs = 0;
 	engine->control->max_delayed_usecs = 0;
 
-	jack_set_clock_source (clock_source);
 	engine->control->clock_source = clock_source;
+	engine->control->tsc_calibration = jack_tsc_calibration;
 	engine->get_microseconds = jack_get_microseconds_pointer ();
 
 	VERBOSE (engine, "clock source = %s", jack_clock_source_name (clock_source));
 
+	memset (engine->control->wakeup, 0, sizeof(engine->control->wakeup));
+	memset ((void*)&engine->control->channel_doorbell, 0,
+		sizeof(engine->control->channel_doorbell));
+#if defined(HAVE_LINUX_FUTEX) && !defined(JACK_USE_MACH_THREADS)
+	if (engine->futex_available
+	    && (jack_wakeup_usable (&engine->control->wakeup[0])
+		|| jack_wakeup_usable (&engine->control->channel_doorbell))) {
+		jack_error ("cannot wait on the futexes in the engine "
+			    "control segment, using FIFOs");
+		engine->futex_available = 0;
+	}
+#endif
+	VERBOSE (engine, "client wakeups use %s",
+		 engine->futex_available ? "futexes" : "FIFOs");
+
 	engine->control->frame_timer.frames = frame_time_offset;
 	engine->control->frame_timer.reset_pending = 0;
 	engine->control->frame_timer.current_wakeup = 0;
@@ -2041,6 +3052,15 @@ jack_engine_new (int realtime, int rtpriority, int do_mlock, int do_unlock,
 	jack_client_create_thread (NULL, &engine->server_thread, 0, FALSE,
 				   &jack_server_thread, engine);
 
+#if defined(HAVE_LINUX_FUTEX) && !defined(JACK_USE_MACH_THREADS)
+	if (engine->futex_available
+	    && jack_client_create_thread (NULL, &engine->channel_thread, 0,
+					  FALSE, &jack_channel_thread,
+					  engine) == 0) {
+		engine->channel_running = 1;
+	}
+#endif
+
 	return engine;
 }
 
@@ -2062,6 +3082,16 @@ jack_engine_delay (jack_engine_t *engine, float delayed_usecs)
 	jack_deliver_event_to_all (engine, &event);
 }
 
+/* The freewheel thread.  Each cycle runs the parallel plan when the
+ * graph qualifies (see jack_freewheel_rechain()), so independent
+ * subgraphs render on separate cores, and cycles are run in batches
+ * under one graph lock (see jack_run_freewheel_cycles()).
+ *
+ * Cycles are not overlapped: every cycle uses the same port buffers,
+ * so cycle n + 1 cannot start in one subgraph before cycle n has
+ * finished in all of them.  Nor is a client handed several periods
+ * per wakeup; its port buffers hold exactly one period.
+ */
 static void*
 jack_engine_freewheel (void *arg)
 {
@@ -2078,7 +3108,8 @@ jack_engine_freewheel (void *arg)
 
 	while (!engine->stop_freewheeling) {
 
-		jack_run_one_cycle (engine, engine->control->buffer_size, 0.0f);
+		jack_run_freewheel_cycles (engine, engine->control->buffer_size,
+					   JACK_FREEWHEEL_BATCH);
 
 		if (client && client->error) {
 			/* run one cycle() will already have told the server thread
@@ -2093,6 +3124,23 @@ jack_engine_freewheel (void *arg)
 	return 0;
 }
 
+/* Switch the graph between the serial chain and the parallel plan
+ * when freewheeling starts or stops.  There is no deadline to meet
+ * while freewheeling, so independent subgraphs are always spread
+ * across cores, whether or not parallel execution was asked for.
+ */
+static void
+jack_freewheel_rechain (jack_engine_t *engine)
+{
+	if (engine->parallel_graph) {
+		return;         /* the plan is already in use */
+	}
+
+	jack_lock_graph (engine);
+	jack_rechain_graph (engine);
+	jack_unlock_graph (engine);
+}
+
 static void
 jack_slave_driver_remove (jack_engine_t *engine, jack_driver_t *sdriver)
 {
@@ -2204,6 +3252,8 @@ jack_start_freewheeling (jack_engine_t* engine, jack_uuid_t client_id)
 	engine->freewheeling = 1;
 	engine->stop_freewheeling = 0;
 
+	jack_freewheel_rechain (engine);
+
 	event.type = StartFreewheel;
 	jack_deliver_event_to_all (engine, &event);
 
@@ -2251,6 +3301,8 @@ jack_stop_freewheeling (jack_engine_t* engine, int engine_exiting)
 	engine->control->frame_timer.reset_pending = 1;
 
 	if (!engine_exiting) {
+		jack_freewheel_rechain (engine);
+
 		/* tell everyone we've stopped */
 
 		event.type = StopFreewheel;
@@ -2270,7 +3322,8 @@ jack_stop_freewheeling (jack_engine_t* engine, int engine_exiting)
 static int
 jack_check_client_status (jack_engine_t* engine)
 {
-	JSList *node;
+	jack_cycle_plan_t *plan = engine->cycle_plan;
+	unsigned int i;
 	int err = 0;
 
 	/* we are already late, or something else went wrong,
@@ -2278,10 +3331,8 @@ jack_check_client_status (jack_engine_t* engine)
 	   clients.
 	 */
 
-	for (node = engine->clients; node;
-	     node = jack_slist_next (node)) {
-		jack_client_internal_t *client =
-			(jack_client_internal_t*)node->data;
+	for (i = 0; i < plan->n_steps; i++) {
+		jack_client_internal_t *client = plan->steps[i].client;
 
 		if (client->control->type == ClientExternal) {
 			if (kill (client->control->pid, 0)) {
@@ -2307,12 +3358,25 @@ jack_check_client_status (jack_engine_t* engine)
 	return err;
 }
 
+/* Let go of the graph read lock, or end a cycle run from the plan. */
+static inline void
+jack_release_graph (jack_engine_t *engine, int locked)
+{
+	if (locked) {
+		jack_unlock_graph (engine);
+	} else {
+		jack_plan_cycle_end (engine);
+	}
+}
+
 static int
 jack_run_one_cycle (jack_engine_t *engine, jack_nframes_t nframes,
 		    float delayed_usecs)
 {
 	jack_driver_t* driver = engine->driver;
+	jack_time_t t[JackProfilePhases];
 	int ret = -1;
+	int locked = TRUE;
 	static int consecutive_excessive_delays = 0;
 
 #define WORK_SCALE 1.0f
@@ -2342,19 +3406,23 @@ jack_run_one_cycle (jack_engine_t *engine, jack_nframes_t nframes,
 
 	DEBUG ("trying to acquire read lock (FW = %d)", engine->freewheeling);
 	if (jack_try_rdlock_graph (engine)) {
-		VERBOSE (engine, "lock-driven null cycle");
-		if (!engine->freewheeling) {
-			driver->null_cycle (driver, nframes);
-		} else {
-			/* don't return too fast */
-			usleep (1000);
+		if (engine->freewheeling || jack_plan_cycle_begin (engine)) {
+			VERBOSE (engine, "lock-driven null cycle");
+			if (!engine->freewheeling) {
+				driver->null_cycle (driver, nframes);
+			} else {
+				/* don't return too fast */
+				usleep (1000);
+			}
+			return 0;
 		}
-		return 0;
+		/* the graph is being edited, run from the plan */
+		locked = FALSE;
 	}
 
 	if (jack_trylock_problems (engine)) {
 		VERBOSE (engine, "problem-lock-driven null cycle");
-		jack_unlock_graph (engine);
+		jack_release_graph (engine, locked);
 		if (!engine->freewheeling) {
 			driver->null_cycle (driver, nframes);
 		} else {
@@ -2367,7 +3435,7 @@ jack_run_one_cycle (jack_engine_t *engine, jack_nframes_t nframes,
 	if (engine->problems || (engine->timeout_count_threshold && (engine->timeout_count > (1 + engine->timeout_count_threshold * 1000 / engine->driver->period_usecs) ))) {
 		VERBOSE (engine, "problem-driven null cycle problems=%d", engine->problems);
 		jack_unlock_problems (engine);
-		jack_unlock_graph (engine);
+		jack_release_graph (engine, locked);
 		if (!engine->freewheeling) {
 			driver->null_cycle (driver, nframes);
 		} else {
@@ -2379,6 +3447,10 @@ jack_run_one_cycle (jack_engine_t *engine, jack_nframes_t nframes,
 
 	jack_unlock_problems (engine);
 
+	jack_engine_cycle_start (engine);
+
+	t[0] = jack_get_microseconds ();
+
 	if (!engine->freewheeling) {
 		DEBUG ("waiting for driver read\n");
 		if (jack_drivers_read (engine, nframes)) {
@@ -2386,6 +3458,8 @@ jack_run_one_cycle (jack_engine_t *engine, jack_nframes_t nframes,
 		}
 	}
 
+	t[JackProfileRead] = jack_get_microseconds ();
+
 	DEBUG ("run process\n");
 
 	if (jack_engine_process (engine, nframes) != 0) {
@@ -2393,14 +3467,23 @@ jack_run_one_cycle (jack_engine_t *engine, jack_nframes_t nframes,
 		jack_check_client_status (engine);
 	}
 
+	t[JackProfileProcess] = jack_get_microseconds ();
+
 	if (!engine->freewheeling) {
 		if (jack_drivers_write (engine, nframes)) {
 			goto unlock;
 		}
 	}
 
+	t[JackProfileWrite] = jack_get_microseconds ();
+
 	jack_engine_post_process (engine);
 
+	if (!engine->freewheeling) {
+		t[JackProfilePostProcess] = jack_get_microseconds ();
+		jack_profile_cycle (engine, t);
+	}
+
 	if (delayed_usecs > engine->control->max_delayed_usecs) {
 		engine->control->max_delayed_usecs = delayed_usecs;
 	}
@@ -2408,12 +3491,68 @@ jack_run_one_cycle (jack_engine_t *engine, jack_nframes_t nframes,
 	ret = 0;
 
 unlock:
-	jack_unlock_graph (engine);
+	jack_release_graph (engine, locked);
 	DEBUG ("cycle finished, status = %d", ret);
 
 	return ret;
 }
 
+/* Run up to `cycles' freewheel cycles back to back.  The graph read
+ * lock is held across the whole batch, so the cost of taking it (and
+ * of backing off when a writer wants it) is paid once per batch rather
+ * than once per period.  The batch is kept short, since a request
+ * for the write lock (a connection change, say) has to wait for it,
+ * and it ends early if the graph has problems or freewheeling is
+ * being stopped.
+ */
+static void
+jack_run_freewheel_cycles (jack_engine_t *engine, jack_nframes_t nframes,
+			   int cycles)
+{
+	int n;
+
+	if (jack_try_rdlock_graph (engine)) {
+		VERBOSE (engine, "lock-driven null cycle");
+		/* don't return too fast */
+		usleep (1000);
+		return;
+	}
+
+	for (n = 0; n < cycles && !engine->stop_freewheeling; n++) {
+
+		if (jack_trylock_problems (engine)) {
+			break;
+		}
+
+		if (engine->problems || (engine->timeout_count_threshold && (engine->timeout_count > (1 + engine->timeout_count_threshold * 1000 / engine->driver->period_usecs) ))) {
+			VERBOSE (engine, "problem-driven null cycle problems=%d", engine->problems);
+			jack_unlock_problems (engine);
+			break;
+		}
+
+		jack_unlock_problems (engine);
+
+		jack_engine_cycle_start (engine);
+
+		if (jack_engine_process (engine, nframes) != 0) {
+			DEBUG ("engine process cycle failed");
+			jack_check_client_status (engine);
+			jack_engine_post_process (engine);
+			n++;
+			break;
+		}
+
+		jack_engine_post_process (engine);
+	}
+
+	jack_unlock_graph (engine);
+
+	if (n == 0) {
+		/* don't return too fast */
+		usleep (1000);
+	}
+}
+
 static void
 jack_engine_driver_exit (jack_engine_t* engine)
 {
@@ -2491,8 +3630,24 @@ jack_run_cycle (jack_engine_t *engine, jack_nframes_t nframes,
 		   FA 13/02/2012
 		 */
 
-		// maybe need a memory barrier here
+		/* how far off the DLL's prediction this wakeup was; the
+		   cycles that follow in this loop had no wakeup of their own */
+		if (left == nframes && !engine->first_wakeup &&
+		    !timer->reset_pending) {
+			int64_t jitter = (int64_t)now - (int64_t)timer->next_wakeup;
+			if (jitter < 0) {
+				jitter = -jitter;
+			}
+			engine->profile_jitter = (jitter > INT32_MAX ?
+						  INT32_MAX : (int32_t)jitter);
+		} else {
+			engine->profile_jitter = -1;
+		}
+
+		/* clients read the timer as a seqlock (see
+		   jack_read_frame_time()) */
 		timer->guard1++;
+		release_fence ();
 
 		if (timer->reset_pending) {
 			// Adjust frame time after a discontinuity.
@@ -2528,7 +3683,7 @@ jack_run_cycle (jack_engine_t *engine, jack_nframes_t nframes,
 			timer->next_wakeup += (int64_t)floorf (timer->period_usecs + 1.41f * delta + 0.5f);
 		}
 
-		// maybe need a memory barrier here
+		release_fence ();
 		timer->guard2++;
 
 		if (jack_run_one_cycle (engine, b_size, delayed_usecs)) {
@@ -2543,7 +3698,7 @@ jack_run_cycle (jack_engine_t *engine, jack_nframes_t nframes,
 void
 jack_engine_delete (jack_engine_t *engine)
 {
-	int i;
+	unsigned int i, j;
 
 	if (engine == NULL) {
 		return;
@@ -2583,11 +3738,24 @@ jack_engine_delete (jack_engine_t *engine)
 
 	VERBOSE (engine, "freeing shared port segments");
 	for (i = 0; i < engine->control->n_port_types; ++i) {
-		jack_release_shm (&engine->port_segment[i]);
-		jack_destroy_shm (&engine->port_segment[i]);
+		for (j = 0; j < engine->port_buffers[i].n_segments; ++j) {
+			jack_release_shm (&engine->port_segment[i][j]);
+			jack_destroy_shm (&engine->port_segment[i][j]);
+			free (engine->port_buffers[i].info[j]);
+		}
 	}
 
 	/* stop the other engine threads */
+#ifdef HAVE_LINUX_FUTEX
+	if (engine->channel_running) {
+		VERBOSE (engine, "stopping request channel thread");
+		engine->channel_stop = 1;
+		jack_wakeup_kick (&engine->control->channel_doorbell);
+		pthread_join (engine->channel_thread, NULL);
+		engine->channel_running = 0;
+	}
+#endif
+
 	VERBOSE (engine, "stopping server thread");
 
 #if JACK_USE_MACH_THREADS
@@ -2613,6 +3781,8 @@ jack_engine_delete (jack_engine_t *engine)
 
 	VERBOSE (engine, "max usecs: %.3f, engine deleted", engine->max_usecs);
 
+	free (engine->cycle_plans[0].steps);
+	free (engine->cycle_plans[1].steps);
 	free (engine);
 
 	jack_messagebuffer_exit ();
@@ -2643,12 +3813,16 @@ jack_deliver_event_to_all (jack_engine_t *engine, jack_event_t *event)
 {
 	JSList *node;
 
+	jack_client_internal_t **clients;
+	int n = 0;
+
 	jack_rdlock_graph (engine);
+	clients = (jack_client_internal_t**)
+		  alloca (jack_slist_length (engine->clients) * sizeof(jack_client_internal_t*));
 	for (node = engine->clients; node; node = jack_slist_next (node)) {
-		jack_deliver_event (engine,
-				    (jack_client_internal_t*)node->data,
-				    event);
+		clients[n++] = (jack_client_internal_t*)node->data;
 	}
+	jack_deliver_event_to_clients (engine, clients, n, event);
 	jack_unlock_graph (engine);
 }
 
@@ -2915,64 +4089,364 @@ jack_notify_all_port_interested_clients (jack_engine_t *engine, jack_uuid_t src,
 
 	jack_client_internal_t* src_client = jack_client_internal_by_id (engine, src);
 	jack_client_internal_t* dst_client = jack_client_internal_by_id (engine, dst);
+	jack_client_internal_t **clients;
+	int n = 0;
+
+	clients = (jack_client_internal_t**)
+		  alloca (jack_slist_length (engine->clients) * sizeof(jack_client_internal_t*));
 
 	for (node = engine->clients; node; node = jack_slist_next (node)) {
 		jack_client_internal_t* client = (jack_client_internal_t*)node->data;
 		if (src_client != client &&  dst_client  != client && client->control->port_connect_cbset != FALSE) {
 
 			/* one of the ports belong to this client or it has a port connect callback */
-			jack_deliver_event (engine, client, &event);
+			clients[n++] = client;
 		}
 	}
-}
-
-int
-jack_deliver_event (jack_engine_t *engine, jack_client_internal_t *client,
-		    const jack_event_t *event, ...)
-{
-	va_list ap;
-	char status = 0;
-	char* key = 0;
-	size_t keylen = 0;
 
-	va_start (ap, event);
+	jack_deliver_event_to_clients (engine, clients, n, &event);
+}
 
-	/* caller must hold the graph lock */
+/* Event delivery to external clients.
+ *
+ * Every event sent to a client is answered with one status byte, but
+ * notifications that the server does not act upon (see
+ * jack_event_needs_reply()) are not waited for: they are queued in the
+ * client's event buffer, and their replies are read later, before the
+ * reply to the next event that does matter.  While the server thread
+ * handles a round of requests, queued events are only written out at
+ * the end of it, so a burst of registrations reaches each client in one
+ * write.  Events that need a reply are sent to every client before any
+ * reply is waited for, and all replies share one deadline.
+ *
+ * The event buffers and reply counts are protected by
+ * engine->event_lock.
+ */
 
-	DEBUG ("delivering event (type %s)", jack_event_type_name (event->type));
+/* at most this many replies may be outstanding for one client */
+#define JACK_EVENT_MAX_UNANSWERED 64
 
-	/* we are not RT-constrained here, so use kill(2) to beef up
-	   our check on a client's continued well-being
-	 */
+static void jack_collect_event_replies(jack_engine_t *engine,
+				       jack_client_internal_t **clients,
+				       int n, char *status);
 
-	if (client->control->dead || client->error >= JACK_ERROR_WITH_SOCKETS
-	    || (client->control->type == ClientExternal && kill (client->control->pid, 0))) {
-		DEBUG ("client %s is dead - no event sent",
-		       client->control->name);
-		va_end (ap);
-		return 0;
+static int
+jack_event_needs_reply (JackEventType type)
+{
+	switch (type) {
+	case PortRegistered:
+	case PortUnregistered:
+	case PortRename:
+	case ClientRegistered:
+	case ClientUnregistered:
+	case PropertyChange:
+	case XRun:
+		return FALSE;
+	default:
+		return TRUE;
 	}
+}
 
-	DEBUG ("client %s is still alive", client->control->name);
+static int
+jack_event_batching (jack_engine_t *engine)
+{
+	return engine->event_batch &&
+	       pthread_equal (pthread_self (), engine->server_thread);
+}
 
-	/* Check property change events for matching key_size and keys */
+static void
+jack_client_write_events (jack_engine_t *engine, jack_client_internal_t *client,
+			  const char *buf, size_t len)
+{
+	ssize_t n;
 
-	if (event->type == PropertyChange) {
-		key = va_arg (ap, char*);
-		if (key && key[0] != '\0') {
-			keylen = strlen (key) + 1;
-			if (event->y.key_size != keylen) {
-				jack_error ("property change key %s sent with wrong length (%d vs %d)", key, event->y.key_size, keylen);
-				va_end (ap);
-				return -1;
+	while (len) {
+		if ((n = write (client->event_fd, buf, len)) < 0) {
+			if (errno == EINTR) {
+				continue;
 			}
+			jack_error ("cannot send event to client [%s] (%s)",
+				    client->control->name,
+				    strerror (errno));
+			client->error += JACK_ERROR_WITH_SOCKETS;
+			jack_engine_signal_problems (engine);
+			return;
 		}
+		buf += n;
+		len -= n;
 	}
+}
+
+static void
+jack_client_flush_events (jack_engine_t *engine, jack_client_internal_t *client)
+{
+	if (client->event_buf_len == 0) {
+		return;
+	}
+
+	DEBUG ("engine writing %zu bytes of events on event fd",
+	       client->event_buf_len);
+
+	jack_client_write_events (engine, client, client->event_buf,
+				  client->event_buf_len);
+	client->event_buf_len = 0;
+
+#ifdef HAVE_LINUX_FUTEX
+	/* a client sleeping on a futex will not notice the
+	   event fd becoming readable, so wake it up.
+	 */
+	if (client->control->wakeup_slot >= 0 &&
+	    client->control->wakeup_slot < JACK_WAKEUP_SLOTS) {
+		client->control->event_pending = TRUE;
+		jack_wakeup_kick (&engine->control->wakeup[
+					  client->control->wakeup_slot]);
+	}
+#endif
+}
+
+static void
+jack_client_queue_event (jack_engine_t *engine, jack_client_internal_t *client,
+			 const jack_event_t *event, const char *key,
+			 size_t keylen)
+{
+	char status;
+
+	if (client->event_replies_pending >= JACK_EVENT_MAX_UNANSWERED) {
+		jack_client_flush_events (engine, client);
+		jack_collect_event_replies (engine, &client, 1, &status);
+	}
+
+	if (client->event_buf_len + sizeof(*event) + keylen
+	    > sizeof(client->event_buf)) {
+		jack_client_flush_events (engine, client);
+	}
+
+	if (sizeof(*event) + keylen > sizeof(client->event_buf)) {
+		/* too big to buffer (a very long property key) */
+		jack_client_write_events (engine, client, (const char*)event,
+					  sizeof(*event));
+		jack_client_write_events (engine, client, key, keylen);
+	} else {
+		memcpy (client->event_buf + client->event_buf_len, event,
+			sizeof(*event));
+		client->event_buf_len += sizeof(*event);
+
+		/* for property changes, deliver the extra data representing
+		   the variable length "key" that has changed in some way.
+		 */
+		if (keylen) {
+			memcpy (client->event_buf + client->event_buf_len, key,
+				keylen);
+			client->event_buf_len += keylen;
+		}
+	}
+
+	client->event_replies_pending++;
+}
+
+/* Read the outstanding replies of `n' clients, all of whose events
+ * have already been written, until none are left or the deadline
+ * passes.  The last reply read from each client is left in `status'.
+ */
+static void
+jack_collect_event_replies (jack_engine_t *engine,
+			    jack_client_internal_t **clients, int n,
+			    char *status)
+{
+	struct pollfd *pfd;
+	jack_client_internal_t **waiting;
+	jack_time_t timeout = JACKD_CLIENT_EVENT_TIMEOUT;
+	jack_time_t then, now;
+	char replies[JACK_EVENT_MAX_UNANSWERED];
+	ssize_t got;
+	int nwaiting, i, j, k;
+
+	/* if we're not running realtime and there is a client timeout set
+	   that exceeds the default client event timeout (which is not
+	   bound by RT limits, then use the larger timeout.
+	 */
+	if (!engine->control->real_time && (engine->client_timeout_msecs > timeout)) {
+		timeout = engine->client_timeout_msecs;
+	}
+
+	pfd = (struct pollfd*)alloca (n * sizeof(struct pollfd));
+	waiting = (jack_client_internal_t**)alloca (n * sizeof(jack_client_internal_t*));
+
+	for (i = 0; i < n; i++) {
+		status[i] = 0;
+	}
+
+	then = jack_get_microseconds ();
+
+	while (1) {
+
+		nwaiting = 0;
+
+		for (i = 0; i < n; i++) {
+			if (clients[i]->event_replies_pending > 0) {
+				if (clients[i]->error >= JACK_ERROR_WITH_SOCKETS) {
+					clients[i]->event_replies_pending = 0;
+					status[i] = -1;
+					continue;
+				}
+				waiting[nwaiting] = clients[i];
+				pfd[nwaiting].fd = clients[i]->event_fd;
+				pfd[nwaiting].events = POLLERR | POLLIN | POLLHUP | POLLNVAL;
+				nwaiting++;
+			}
+		}
+
+		if (nwaiting == 0) {
+			break;
+		}
+
+		now = jack_get_microseconds ();
+
+		if (now - then >= timeout * 1000) {
+			for (j = 0; j < nwaiting; j++) {
+				jack_error ("timeout waiting for client %s to handle "
+					    "%d event(s)", waiting[j]->control->name,
+					    waiting[j]->event_replies_pending);
+				waiting[j]->event_replies_pending = 0;
+				waiting[j]->error += JACK_ERROR_WITH_SOCKETS;
+				jack_engine_signal_problems (engine);
+			}
+			break;
+		}
+
+		VERBOSE (engine, "polling for event replies from %d client(s)",
+			 nwaiting);
+
+		if (poll (pfd, nwaiting, 1 + (timeout * 1000 - (now - then)) / 1000) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			jack_error ("poll on client event replies failed (%s)",
+				    strerror (errno));
+			for (j = 0; j < nwaiting; j++) {
+				waiting[j]->event_replies_pending = 0;
+			}
+			break;
+		}
+
+		for (j = 0; j < nwaiting; j++) {
+
+			jack_client_internal_t *client = waiting[j];
+
+			for (i = 0; clients[i] != client; i++) ;
+
+			if (pfd[j].revents & POLLIN) {
+
+				got = read (client->event_fd, replies,
+					    client->event_replies_pending);
+
+				if (got <= 0) {
+					jack_error ("cannot read event response from client [%s] (%s)",
+						    client->control->name,
+						    strerror (errno));
+					status[i] = -1;
+				} else {
+					client->event_replies_pending -= got;
+					status[i] = replies[got - 1];
+					for (k = 0; k < got; k++) {
+						if (replies[k] < 0) {
+							jack_error ("bad status (%d) from client %s "
+								    "while handling an event",
+								    (int)replies[k],
+								    client->control->name);
+							status[i] = replies[k];
+						}
+					}
+					if (status[i] >= 0) {
+						continue;
+					}
+				}
+
+			} else if (pfd[j].revents & ~POLLIN) {
+
+				/* some kind of OOB socket event */
+				jack_error ("lost client %s while waiting for event replies",
+					    client->control->name);
+				status[i] = -2;
+
+			} else {
+				continue;
+			}
+
+			client->event_replies_pending = 0;
+			client->error += JACK_ERROR_WITH_SOCKETS;
+			jack_engine_signal_problems (engine);
+		}
+	}
+}
+
+/* Write out the events queued while the server thread was handling a
+ * round of requests.
+ */
+static void
+jack_flush_event_batch (jack_engine_t *engine)
+{
+	JSList *node;
+	jack_client_internal_t *client;
+
+	/* caller must hold the graph lock */
+
+	pthread_mutex_lock (&engine->event_lock);
+
+	engine->event_batch = 0;
+
+	for (node = engine->clients; node; node = jack_slist_next (node)) {
+		client = (jack_client_internal_t*)node->data;
+		if (!jack_client_is_internal (client)) {
+			jack_client_flush_events (engine, client);
+		}
+	}
+
+	pthread_mutex_unlock (&engine->event_lock);
+}
+
+/* Send `event' to `client'.  If the client has to reply, and
+ * `awaiting' is not NULL, the reply is left to be collected by the
+ * caller and *awaiting is set; otherwise the reply is waited for here.
+ */
+static int
+jack_send_event (jack_engine_t *engine, jack_client_internal_t *client,
+		 const jack_event_t *event, const char *key, int *awaiting)
+{
+	char status = 0;
+	size_t keylen = 0;
+
+	/* caller must hold the graph lock */
+
+	DEBUG ("delivering event (type %s)", jack_event_type_name (event->type));
+
+	/* we are not RT-constrained here, so use kill(2) to beef up
+	   our check on a client's continued well-being
+	 */
+
+	if (client->control->dead || client->error >= JACK_ERROR_WITH_SOCKETS
+	    || (client->control->type == ClientExternal && kill (client->control->pid, 0))) {
+		DEBUG ("client %s is dead - no event sent",
+		       client->control->name);
+		return 0;
+	}
+
+	DEBUG ("client %s is still alive", client->control->name);
+
+	/* Check property change events for matching key_size and keys */
+
+	if (event->type == PropertyChange) {
+		if (key && key[0] != '\0') {
+			keylen = strlen (key) + 1;
+			if (event->y.key_size != keylen) {
+				jack_error ("property change key %s sent with wrong length (%d vs %d)", key, event->y.key_size, keylen);
+				return -1;
+			}
+		}
+	}
+
+	if (jack_client_is_internal (client)) {
 
-	va_end (ap);
-
-	if (jack_client_is_internal (client)) {
-
 		switch (event->type) {
 		case PortConnected:
 		case PortDisconnected:
@@ -3030,161 +4504,296 @@ jack_deliver_event (jack_engine_t *engine, jack_client_internal_t *client,
 			break;
 		}
 
-	} else {
+	} else if (client->control->active) {
 
-		if (client->control->active) {
+		/* there's a thread waiting for events, so
+		 * it's worth telling the client */
 
-			/* there's a thread waiting for events, so
-			 * it's worth telling the client */
+		pthread_mutex_lock (&engine->event_lock);
 
-			DEBUG ("engine writing on event fd");
+		jack_client_queue_event (engine, client, event, key, keylen);
 
-			if (write (client->event_fd, event, sizeof(*event)) != sizeof(*event)) {
-				jack_error ("cannot send event to client [%s] (%s)",
-					    client->control->name,
-					    strerror (errno));
-				client->error += JACK_ERROR_WITH_SOCKETS;
-				jack_engine_signal_problems (engine);
+		if (jack_event_needs_reply (event->type)) {
+			jack_client_flush_events (engine, client);
+			if (awaiting) {
+				*awaiting = TRUE;
+			} else if (!engine->defer_replies) {
+				jack_collect_event_replies (engine, &client, 1, &status);
 			}
+		} else if (!jack_event_batching (engine)) {
+			jack_client_flush_events (engine, client);
+		}
 
-			/* for property changes, deliver the extra data representing
-			   the variable length "key" that has changed in some way.
-			 */
+		pthread_mutex_unlock (&engine->event_lock);
+	}
+	DEBUG ("event delivered");
 
-			if (event->type == PropertyChange) {
-				if (keylen) {
-					if (write (client->event_fd, key, keylen) != keylen) {
-						jack_error ("cannot send property change key to client [%s] (%s)",
-							    client->control->name,
-							    strerror (errno));
-						client->error += JACK_ERROR_WITH_SOCKETS;
-						jack_engine_signal_problems (engine);
-					}
-				}
-			}
+	return status;
+}
 
-			if (client->error) {
-				status = -1;
-			} else {
-				// then we check whether there really is an error.... :)
-
-				struct pollfd pfd[1];
-				pfd[0].fd = client->event_fd;
-				pfd[0].events = POLLERR | POLLIN | POLLHUP | POLLNVAL;
-				jack_time_t poll_timeout = JACKD_CLIENT_EVENT_TIMEOUT;
-				int poll_ret;
-				jack_time_t then = jack_get_microseconds ();
-				jack_time_t now;
-
-				/* if we're not running realtime and there is a client timeout set
-				   that exceeds the default client event timeout (which is not
-				   bound by RT limits, then use the larger timeout.
-				 */
+int
+jack_deliver_event (jack_engine_t *engine, jack_client_internal_t *client,
+		    const jack_event_t *event, ...)
+{
+	va_list ap;
+	char* key = 0;
 
-				if (!engine->control->real_time && (engine->client_timeout_msecs > poll_timeout)) {
-					poll_timeout = engine->client_timeout_msecs;
-				}
+	if (event->type == PropertyChange) {
+		va_start (ap, event);
+		key = va_arg (ap, char*);
+		va_end (ap);
+	}
 
-#ifdef __linux
-again:
-#endif
-				VERBOSE (engine, "client event poll on %d for %s starts at %lld",
-					 client->event_fd, client->control->name, then);
-				if ((poll_ret = poll (pfd, 1, poll_timeout)) < 0) {
-					DEBUG ("client event poll not ok! (-1) poll returned an error");
-					jack_error ("poll on subgraph processing failed (%s)", strerror (errno));
-					status = -1;
-				} else {
+	return jack_send_event (engine, client, event, key, NULL);
+}
 
-					DEBUG ("\n\n\n\n\n back from client event poll, revents = 0x%x\n\n\n", pfd[0].revents);
-					now = jack_get_microseconds ();
-					VERBOSE (engine, "back from client event poll after %lld usecs", now - then);
+/* Deliver `event' to the `n' clients in `clients', and then wait for
+ * all of their replies together.
+ */
+static void
+jack_deliver_event_to_clients (jack_engine_t *engine,
+			       jack_client_internal_t **clients, int n,
+			       const jack_event_t *event)
+{
+	jack_client_internal_t **awaiting;
+	char *status;
+	int i, nawaiting = 0, waits;
 
-					if (pfd[0].revents & ~POLLIN) {
+	awaiting = (jack_client_internal_t**)alloca (n * sizeof(jack_client_internal_t*));
 
-						/* some kind of OOB socket event */
+	for (i = 0; i < n; i++) {
+		waits = FALSE;
+		jack_send_event (engine, clients[i], event, NULL, &waits);
+		if (waits) {
+			awaiting[nawaiting++] = clients[i];
+		}
+	}
 
-						DEBUG ("client event poll not ok! (-2), revents = %d\n", pfd[0].revents);
-						jack_error ("subgraph starting at %s lost client", client->control->name);
-						status = -2;
+	if (nawaiting && !engine->defer_replies) {
+		status = (char*)alloca (nawaiting);
+		pthread_mutex_lock (&engine->event_lock);
+		jack_collect_event_replies (engine, awaiting, nawaiting, status);
+		pthread_mutex_unlock (&engine->event_lock);
+	}
+}
 
-					} else if (pfd[0].revents & POLLIN) {
+/* Futex wakeups are used when the kernel supports them and the graph
+ * needs no more FIFO numbers than there are wakeup slots: at most one
+ * per client, plus the one the server waits on.
+ */
+static int
+jack_graph_use_futex (jack_engine_t *engine)
+{
+	JSList *node;
+	jack_client_internal_t *client;
+	unsigned long n = 1;
 
-						/* client responded normally */
+	if (!engine->futex_available) {
+		return 0;
+	}
 
-						DEBUG ("client event poll ok!");
-						status = 0;
+	for (node = engine->clients; node; node = jack_slist_next (node)) {
+		client = (jack_client_internal_t*)node->data;
+		if (client->control->active &&
+		    (client->control->process_cbset ||
+		     client->control->thread_cb_cbset)) {
+			n++;
+		}
+	}
 
-					} else if (poll_ret == 0) {
+	return n <= JACK_WAKEUP_SLOTS;
+}
 
-						/* no events, no errors, we woke up because poll()
-						   decided that time was up ...
-						 */
+#ifndef JACK_USE_MACH_THREADS
 
-#ifdef __linux
-						if (linux_poll_bug_encountered (engine, then, &poll_timeout)) {
-							goto again;
-						}
+/* Add the plan clients fed by `src' to its downstream list.  Active
+ * external clients outside the plan (no process callback) carry no
+ * data of their own, so walk through them to whatever they feed.
+ */
+static void
+jack_parallel_add_downstream (jack_client_internal_t *src, JSList *feeds)
+{
+	jack_client_control_t *ctl = src->control;
+	jack_client_internal_t *dst;
+	JSList *node;
+	uint32_t i;
 
-						if (poll_timeout < 200) {
-							VERBOSE (engine, "FALSE WAKEUP skipped, remaining = %lld usec", poll_timeout);
-							status = 0;
-						} else {
-#endif
-						DEBUG ("client event poll not ok! (1 = poll timed out, revents = 0x%04x, poll_ret = %d)", pfd[0].revents, poll_ret);
-						VERBOSE (engine, "client %s did not respond to event type %d in time"
-							 "(fd=%d, revents = 0x%04x, timeout was %lld)",
-							 client->control->name, event->type,
-							 client->event_fd,
-							 pfd[0].revents,
-							 poll_timeout);
-						status = -2;
-#ifdef __linux
-					}
-#endif
-					}
-				}
-			}
+	for (node = feeds; node; node = jack_slist_next (node)) {
 
-			if (status == 0) {
-				if (read (client->event_fd, &status, sizeof(status)) != sizeof(status)) {
-					jack_error ("cannot read event response from client [%s] (%s)",
-						    client->control->name,
-						    strerror (errno));
-					status = -1;
-				}
+		dst = (jack_client_internal_t*)node->data;
 
-			} else {
-				switch (status) {
-				case -1:
-					jack_error ("internal poll failure reading response from client %s to a %s event",
-						    client->control->name,
-						    jack_event_type_name (event->type));
-					break;
-				case -2:
-					jack_error ("timeout waiting for client %s to handle a %s event",
-						    client->control->name,
-						    jack_event_type_name (event->type));
-					break;
-				default:
-					jack_error ("bad status (%d) from client %s while handling a %s event",
-						    (int)status,
-						    client->control->name,
-						    jack_event_type_name (event->type));
-				}
+		if (dst == src) {
+			continue;
+		}
+
+		if (!dst->parallel_node) {
+			if (dst->control->type == ClientExternal) {
+				jack_parallel_add_downstream (src,
+							      dst->sortfeeds);
 			}
+			continue;
+		}
 
-			if (status < 0) {
-				client->error += JACK_ERROR_WITH_SOCKETS;
-				jack_engine_signal_problems (engine);
+		for (i = 0; i < ctl->n_downstream; i++) {
+			if (ctl->downstream[i] == dst->execution_order) {
+				break;
 			}
 		}
+
+		if (i == ctl->n_downstream) {
+			ctl->downstream[ctl->n_downstream++] =
+				dst->execution_order;
+			dst->parallel_indegree++;
+		}
 	}
-	DEBUG ("event delivered");
+}
 
-	return status;
+/* Build the parallel execution plan.  Each active external client gets
+ * its own FIFO and a list of the plan clients it feeds (taken from the
+ * sortfeeds lists), so that every client whose inputs are ready can
+ * run at the same time.  Returns non-zero if the current graph cannot
+ * be run this way; the caller then builds the serial chain instead.
+ */
+static int
+jack_rechain_graph_parallel (jack_engine_t *engine)
+{
+	JSList *node;
+	jack_client_internal_t *client;
+	jack_event_t event;
+	unsigned long n = 0;
+	unsigned int sinks = 0;
+	int seen_external = 0;
+	int seen_trailing = 0;
+	int fd;
+
+	/* caller must hold engine->client_lock */
+
+	if (engine->feedbackcount) {
+		VERBOSE (engine, "graph has %d feedback connections, "
+			 "using serial chain", engine->feedbackcount);
+		return -1;
+	}
+
+	/* internal clients are run by the server thread, so they can
+	 * only come before or after the external clients in the plan,
+	 * not between them.
+	 */
+	for (node = engine->clients; node; node = jack_slist_next (node)) {
+
+		client = (jack_client_internal_t*)node->data;
+
+		client->parallel_node = FALSE;
+		client->parallel_indegree = 0;
+		client->control->n_downstream = 0;
+
+		if (!client->control->active ||
+		    (!client->control->process_cbset &&
+		     !client->control->thread_cb_cbset)) {
+			continue;
+		}
+
+		if (jack_client_is_internal (client)) {
+			if (seen_external) {
+				seen_trailing = 1;
+			}
+			client->execution_order = n;
+		} else if (seen_trailing) {
+			VERBOSE (engine, "client %s runs after an internal "
+				 "client, using serial chain",
+				 client->control->name);
+			return -1;
+		} else {
+			seen_external = 1;
+			client->parallel_node = TRUE;
+			client->execution_order = n++;
+		}
+	}
+
+	if (n == 0) {
+		return -1;
+	}
+
+	if (n > JACK_PARALLEL_MAX_CLIENTS) {
+		VERBOSE (engine, "%lu external clients, too many for "
+			 "parallel execution, using serial chain", n);
+		return -1;
+	}
+
+	/* the server waits on the FIFO after the last client's */
+	if ((engine->parallel_wait_fd = jack_get_fifo_fd (engine, n)) < 0) {
+		return -1;
+	}
+	engine->parallel_wait_slot = n;
+
+	for (node = engine->clients; node; node = jack_slist_next (node)) {
+
+		client = (jack_client_internal_t*)node->data;
+
+		if (!client->parallel_node) {
+			continue;
+		}
+
+		if ((fd = jack_get_fifo_fd (engine,
+					    client->execution_order)) < 0) {
+			return -1;
+		}
+
+		client->subgraph_start_fd = fd;
+		client->subgraph_start_slot = client->execution_order;
+		client->subgraph_wait_fd = -1;
+		client->subgraph_wait_slot = -1;
+		client->next_client = NULL;
+
+		jack_parallel_add_downstream (client, client->sortfeeds);
+
+		if (client->control->n_downstream == 0) {
+			client->control->downstream[0] = n;
+			client->control->n_downstream = 1;
+			sinks++;
+		}
+	}
+
+	engine->parallel_active = 1;
+	engine->parallel_nodes = n;
+	engine->parallel_sinks = sinks;
+
+	VALGRIND_MEMSET (&event, 0, sizeof(event));
+	event.type = GraphReordered;
+
+	for (node = engine->clients; node; node = jack_slist_next (node)) {
+
+		client = (jack_client_internal_t*)node->data;
+
+		if (!client->control->active ||
+		    (!client->control->process_cbset &&
+		     !client->control->thread_cb_cbset)) {
+			continue;
+		}
+
+		if (client->parallel_node) {
+			VERBOSE (engine, "client %s: execution_order=%lu, "
+				 "%d upstream, %" PRIu32 " downstream",
+				 client->control->name,
+				 client->execution_order,
+				 client->parallel_indegree,
+				 client->control->n_downstream);
+			client->control->parallel_graph = TRUE;
+			client->control->wakeup_futex = engine->futex_active;
+			event.x.n = client->execution_order;
+			event.y.n = (client->parallel_indegree == 0);
+		}
+
+		jack_deliver_event (engine, client, &event);
+	}
+
+	VERBOSE (engine, "parallel plan: %lu clients, %u sinks, "
+		 "wait_fd=%d", n, sinks, engine->parallel_wait_fd);
+
+	return 0;
 }
 
+#endif /* !JACK_USE_MACH_THREADS */
+
 int
 jack_rechain_graph (jack_engine_t *engine)
 {
@@ -3197,12 +4806,27 @@ jack_rechain_graph (jack_engine_t *engine)
 
 	VALGRIND_MEMSET (&event, 0, sizeof(event));
 
+	/* clients are about to be given new FIFOs */
+	jack_engine_quiesce (engine);
+
 	jack_clear_fifos (engine);
 
 	subgraph_client = 0;
 
 	VERBOSE (engine, "++ jack_rechain_graph():");
 
+	engine->futex_active = jack_graph_use_futex (engine);
+
+#ifndef JACK_USE_MACH_THREADS
+	if ((engine->parallel_graph || engine->freewheeling) &&
+	    jack_rechain_graph_parallel (engine) == 0) {
+		err = jack_engine_publish_cycle_plan (engine);
+		VERBOSE (engine, "-- jack_rechain_graph() (parallel)");
+		return err;
+	}
+#endif
+	engine->parallel_active = 0;
+
 	event.type = GraphReordered;
 
 	for (n = 0, node = engine->clients, next = NULL; node; node = next) {
@@ -3252,6 +4876,7 @@ jack_rechain_graph (jack_engine_t *engine)
 				if (subgraph_client) {
 					subgraph_client->subgraph_wait_fd =
 						jack_get_fifo_fd (engine, n);
+					subgraph_client->subgraph_wait_slot = n;
 					VERBOSE (engine, "client %s: wait_fd="
 						 "%d, execution_order="
 						 "%lu.",
@@ -3288,6 +4913,7 @@ jack_rechain_graph (jack_engine_t *engine)
 					subgraph_client = client;
 					subgraph_client->subgraph_start_fd =
 						jack_get_fifo_fd (engine, n);
+					subgraph_client->subgraph_start_slot = n;
 					VERBOSE (engine, "client %s: "
 						 "start_fd=%d, execution"
 						 "_order=%lu.",
@@ -3312,6 +4938,7 @@ jack_rechain_graph (jack_engine_t *engine)
 						 subgraph_client->
 						 control->name, n);
 					subgraph_client->subgraph_wait_fd = -1;
+					subgraph_client->subgraph_wait_slot = -1;
 
 					/* this external client after
 					   this will have another
@@ -3327,6 +4954,8 @@ jack_rechain_graph (jack_engine_t *engine)
 				 */
 				(void)jack_get_fifo_fd (
 					engine, client->execution_order + 1);
+				client->control->parallel_graph = FALSE;
+				client->control->wakeup_futex = engine->futex_active;
 				event.x.n = client->execution_order;
 				event.y.n = upstream_is_jackd;
 				jack_deliver_event (engine, client, &event);
@@ -3338,12 +4967,17 @@ jack_rechain_graph (jack_engine_t *engine)
 	if (subgraph_client) {
 		subgraph_client->subgraph_wait_fd =
 			jack_get_fifo_fd (engine, n);
+		subgraph_client->subgraph_wait_slot = n;
 		VERBOSE (engine, "client %s: wait_fd=%d, "
 			 "execution_order=%lu (last client).",
 			 subgraph_client->control->name,
 			 subgraph_client->subgraph_wait_fd, n);
 	}
 
+	if (jack_engine_publish_cycle_plan (engine)) {
+		err = -1;
+	}
+
 	VERBOSE (engine, "-- jack_rechain_graph()");
 
 	return err;
@@ -3535,36 +5169,173 @@ jack_compute_new_latency (jack_engine_t *engine)
 		jack_deliver_event (engine, engine->driver->internal_client, &event);
 	}
 
-	jack_slist_free (reverse_list);
-}
+	jack_slist_free (reverse_list);
+}
+
+
+/* How the sort works:
+ *
+ * Each client has a "sortfeeds" list of clients indicating which clients
+ * it should be considered as feeding for the purposes of sorting the
+ * graph. This list differs from the clients it /actually/ feeds in the
+ * following ways:
+ *
+ * 1. Connections from a client to itself are disregarded
+ *
+ * 2. Connections to a driver client are disregarded
+ *
+ * 3. If a connection from A to B is a feedback connection (ie there was
+ *    already a path from B to A when the connection was made) then instead
+ *    of B appearing on A's sortfeeds list, A will appear on B's sortfeeds
+ *    list.
+ *
+ * If client A is on client B's sortfeeds list, client A must come after
+ * client B in the execution order. The above 3 rules ensure that the
+ * sortfeeds relation is always acyclic so that all ordering constraints
+ * can actually be met.
+ *
+ * Each client also has a "truefeeds" list which is the same as sortfeeds
+ * except that feedback connections appear normally instead of reversed.
+ * This is used to detect whether the graph has become acyclic.
+ *
+ * The client list is put in order with a depth-first topological sort
+ * of the sortfeeds relation, which takes time linear in the number of
+ * clients and connections.  Each client remembers its position in the
+ * list (sort_order), which lets jack_client_feeds_transitive() skip
+ * every client that comes after the one it is looking for: a new
+ * connection that goes forward in the current order is recognised as
+ * such without searching at all.  A connection that goes against the
+ * order makes it stale until the next sort, which may be some time
+ * away during a batch of connections, so every sort_order is then
+ * reset to -1 (see jack_note_sort_edge()).
+ *
+ */
+
+/* Depth-first visit from `root', appending clients to `order' (filled
+ * from the back) once everything they feed has been placed.
+ */
+static void
+jack_sort_visit (jack_engine_t *engine, jack_client_internal_t *root,
+		 jack_client_internal_t **order, unsigned long *pos,
+		 jack_client_internal_t **stack, JSList **edges)
+{
+	jack_client_internal_t *client, *next;
+	unsigned long depth = 0;
+
+	if (root->sort_mark == engine->sort_mark) {
+		return;
+	}
+
+	root->sort_mark = engine->sort_mark;
+	stack[0] = root;
+	edges[0] = root->sortfeeds;
+
+	while (1) {
+		client = stack[depth];
+
+		if (edges[depth]) {
+			next = (jack_client_internal_t*)edges[depth]->data;
+			edges[depth] = jack_slist_next (edges[depth]);
+			if (next->sort_mark != engine->sort_mark) {
+				next->sort_mark = engine->sort_mark;
+				depth++;
+				stack[depth] = next;
+				edges[depth] = next->sortfeeds;
+			}
+			continue;
+		}
+
+		order[--(*pos)] = client;
+
+		if (depth == 0) {
+			break;
+		}
+		depth--;
+	}
+}
+
+/* Returns non-zero if the order of the clients changed. */
+static int
+jack_sort_clients (jack_engine_t *engine)
+{
+	jack_client_internal_t **clients, **order, **stack;
+	jack_client_internal_t *client;
+	JSList **edges;
+	JSList *node, *sorted = NULL;
+	unsigned long n, i, pos;
+	int drivers;
+
+	n = jack_slist_length (engine->clients);
+
+	if (n < 2) {
+		for (node = engine->clients; node; node = jack_slist_next (node)) {
+			((jack_client_internal_t*)node->data)->sort_order = 0;
+		}
+		return 0;
+	}
+
+	clients = (jack_client_internal_t**)malloc (3 * n * sizeof(jack_client_internal_t*));
+	edges = (JSList**)malloc (n * sizeof(JSList*));
+
+	if (clients == NULL || edges == NULL) {
+		jack_error ("cannot allocate memory to sort the graph");
+		free (clients);
+		free (edges);
+		/* the order is stale now, so don't rely on it */
+		for (node = engine->clients; node; node = jack_slist_next (node)) {
+			((jack_client_internal_t*)node->data)->sort_order = -1;
+		}
+		return 1;
+	}
+
+	order = clients + n;
+	stack = clients + 2 * n;
+
+	for (i = 0, node = engine->clients; node; node = jack_slist_next (node), i++) {
+		clients[i] = (jack_client_internal_t*)node->data;
+	}
+
+	/* the last client visited ends up first, so go through the list
+	   backwards, leaving the drivers until the end */
+	engine->sort_mark++;
+	pos = n;
+
+	for (drivers = 0; drivers < 2; drivers++) {
+		for (i = n; i-- > 0; ) {
+			client = clients[i];
+			if ((client->control->type == ClientDriver) == drivers) {
+				jack_sort_visit (engine, client, order, &pos,
+						 stack, edges);
+			}
+		}
+	}
+
+	for (i = 0; i < n && order[i] == clients[i]; i++) {
+		order[i]->sort_order = i;
+	}
+
+	if (i == n) {
+		free (clients);
+		free (edges);
+		return 0;
+	}
+
+	for (i = n; i-- > 0; ) {
+		order[i]->sort_order = i;
+		sorted = jack_slist_prepend (sorted, order[i]);
+	}
+
+	/* cycles run from the plan still look at the list */
+	jack_engine_quiesce (engine);
+
+	jack_slist_free (engine->clients);
+	engine->clients = sorted;
 
+	free (clients);
+	free (edges);
 
-/* How the sort works:
- *
- * Each client has a "sortfeeds" list of clients indicating which clients
- * it should be considered as feeding for the purposes of sorting the
- * graph. This list differs from the clients it /actually/ feeds in the
- * following ways:
- *
- * 1. Connections from a client to itself are disregarded
- *
- * 2. Connections to a driver client are disregarded
- *
- * 3. If a connection from A to B is a feedback connection (ie there was
- *    already a path from B to A when the connection was made) then instead
- *    of B appearing on A's sortfeeds list, A will appear on B's sortfeeds
- *    list.
- *
- * If client A is on client B's sortfeeds list, client A must come after
- * client B in the execution order. The above 3 rules ensure that the
- * sortfeeds relation is always acyclic so that all ordering constraints
- * can actually be met.
- *
- * Each client also has a "truefeeds" list which is the same as sortfeeds
- * except that feedback connections appear normally instead of reversed.
- * This is used to detect whether the graph has become acyclic.
- *
- */
+	return 1;
+}
 
 void
 jack_sort_graph (jack_engine_t *engine)
@@ -3572,56 +5343,149 @@ jack_sort_graph (jack_engine_t *engine)
 	/* called, obviously, must hold engine->client_lock */
 
 	VERBOSE (engine, "++ jack_sort_graph");
-	engine->clients = jack_slist_sort (engine->clients,
-					   (JCompareFunc)jack_client_sort);
+	jack_sort_clients (engine);
 	jack_compute_all_port_total_latencies (engine);
 	jack_compute_new_latency (engine);
 	jack_rechain_graph (engine);
+	engine->chain_changed = 0;
 	engine->timeout_count = 0;
 	VERBOSE (engine, "-- jack_sort_graph");
 }
 
-static int
-jack_client_sort (jack_client_internal_t *a, jack_client_internal_t *b)
+/* Sort the graph after connections were made or broken.  Unless that
+ * changed the order of the clients or the edges between external
+ * clients (see jack_note_feeds_change()), the chain stays as it is,
+ * and so does the cycle plan: cycles go on while the graph is edited.
+ */
+static void
+jack_resort_graph (jack_engine_t *engine)
 {
-	/* drivers are forced to the front, ie considered as sources
-	   rather than sinks for purposes of the sort */
+	int reordered;
 
-	if (jack_client_feeds_transitive (a, b) ||
-	    (a->control->type == ClientDriver &&
-	     b->control->type != ClientDriver)) {
-		return -1;
-	} else if (jack_client_feeds_transitive (b, a) ||
-		   (b->control->type == ClientDriver &&
-		    a->control->type != ClientDriver)) {
-		return 1;
-	} else {
-		return 0;
+	/* caller must hold engine->client_lock */
+
+	VERBOSE (engine, "++ jack_resort_graph");
+	reordered = jack_sort_clients (engine);
+	jack_compute_all_port_total_latencies (engine);
+	jack_compute_new_latency (engine);
+	if (reordered || engine->chain_changed) {
+		jack_rechain_graph (engine);
 	}
+	engine->chain_changed = 0;
+	engine->timeout_count = 0;
+	VERBOSE (engine, "-- jack_resort_graph");
 }
 
-/* transitive closure of the relation expressed by the sortfeeds lists. */
+/* transitive closure of the relation expressed by the sortfeeds lists.
+ * Clients that are sorted after `dest' cannot feed it, so the search
+ * never looks at them; each client is looked at once at most.
+ */
 static int
-jack_client_feeds_transitive (jack_client_internal_t *source,
-			      jack_client_internal_t *dest )
+jack_client_feeds_transitive (jack_engine_t *engine,
+			      jack_client_internal_t *source,
+			      jack_client_internal_t *dest)
 {
-	jack_client_internal_t *med;
+	jack_client_internal_t **pending;
+	jack_client_internal_t *med, *next;
 	JSList *node;
+	unsigned long n = 0, max;
+	int found = 0;
+
+	if (source->sort_order >= 0 && dest->sort_order >= 0 &&
+	    source->sort_order > dest->sort_order) {
+		return 0;
+	}
 
-	if (jack_slist_find (source->sortfeeds, dest)) {
+	/* every client is pushed once at most */
+	max = jack_slist_length (engine->clients) + 1;
+	pending = (jack_client_internal_t**)
+		  malloc (max * sizeof(jack_client_internal_t*));
+
+	if (pending == NULL) {
+		/* assume the worst: a feedback connection only costs
+		   latency */
 		return 1;
 	}
 
-	for (node = source->sortfeeds; node; node = jack_slist_next (node)) {
+	engine->sort_mark++;
+	source->sort_mark = engine->sort_mark;
+	pending[n++] = source;
 
-		med = (jack_client_internal_t*)node->data;
+	while (n && !found) {
 
-		if (jack_client_feeds_transitive (med, dest)) {
-			return 1;
+		med = pending[--n];
+
+		for (node = med->sortfeeds; node; node = jack_slist_next (node)) {
+
+			next = (jack_client_internal_t*)node->data;
+
+			if (next == dest) {
+				found = 1;
+				break;
+			}
+
+			if (next->sort_mark == engine->sort_mark ||
+			    (next->sort_order >= 0 && dest->sort_order >= 0 &&
+			     next->sort_order > dest->sort_order)) {
+				continue;
+			}
+
+			next->sort_mark = engine->sort_mark;
+			if (n < max) {
+				pending[n++] = next;
+			}
 		}
 	}
 
-	return 0;
+	free (pending);
+
+	return found;
+}
+
+static int
+jack_client_in_feeds (JSList *feeds, jack_client_internal_t *client)
+{
+	for (; feeds; feeds = jack_slist_next (feeds)) {
+		if (feeds->data == client) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* The parallel chain is built from the sortfeeds lists, so the graph
+ * has to be rechained when a client starts or stops feeding another,
+ * or when feedback connections come or go.  The serial chain only
+ * depends on the order of the clients, which jack_resort_graph()
+ * checks for itself.
+ */
+static void
+jack_note_feeds_change (jack_engine_t *engine)
+{
+	if (engine->parallel_graph) {
+		engine->chain_changed = 1;
+	}
+}
+
+/* Called when `from' starts feeding `to' in the sortfeeds relation.  If
+ * that goes against the current order, the order can no longer be
+ * used to prune jack_client_feeds_transitive() until the graph is
+ * sorted again.
+ */
+static void
+jack_note_sort_edge (jack_engine_t *engine, jack_client_internal_t *from,
+		     jack_client_internal_t *to)
+{
+	JSList *node;
+
+	if (from->sort_order >= 0 && to->sort_order >= 0 &&
+	    from->sort_order < to->sort_order) {
+		return;
+	}
+
+	for (node = engine->clients; node; node = jack_slist_next (node)) {
+		((jack_client_internal_t*)node->data)->sort_order = -1;
+	}
 }
 
 /**
@@ -3636,8 +5500,11 @@ jack_check_acyclic (jack_engine_t *engine)
 	jack_client_internal_t *src, *dst;
 	jack_port_internal_t *port;
 	jack_connection_internal_t *conn;
+	jack_client_internal_t **ready;
+	unsigned long nready = 0;
 	int stuck;
 	int unsortedclients = 0;
+	int nclients;
 
 	VERBOSE (engine, "checking for graph become acyclic");
 
@@ -3649,35 +5516,43 @@ jack_check_acyclic (jack_engine_t *engine)
 		unsortedclients++;
 	}
 
-	stuck = FALSE;
+	nclients = unsortedclients;
 
-	/* find out whether a normal sort would have been possible */
-	while (unsortedclients && !stuck) {
-
-		stuck = TRUE;
+	if ((ready = (jack_client_internal_t**)
+		     malloc ((nclients + 1) * sizeof(jack_client_internal_t*))) == NULL) {
+		return;
+	}
 
-		for (srcnode = engine->clients; srcnode;
-		     srcnode = jack_slist_next (srcnode)) {
+	for (srcnode = engine->clients; srcnode;
+	     srcnode = jack_slist_next (srcnode)) {
 
-			src = (jack_client_internal_t*)srcnode->data;
+		src = (jack_client_internal_t*)srcnode->data;
+		if (!src->tfedcount) {
+			ready[nready++] = src;
+		}
+	}
 
-			if (!src->tfedcount) {
+	/* find out whether a normal sort would have been possible,
+	   looking at each client and connection once */
+	while (nready) {
 
-				stuck = FALSE;
-				unsortedclients--;
-				src->tfedcount = -1;
+		src = ready[--nready];
+		unsortedclients--;
 
-				for (dstnode = src->truefeeds; dstnode;
-				     dstnode = jack_slist_next (dstnode)) {
+		for (dstnode = src->truefeeds; dstnode;
+		     dstnode = jack_slist_next (dstnode)) {
 
-					dst = (jack_client_internal_t*)
-					      dstnode->data;
-					dst->tfedcount--;
-				}
+			dst = (jack_client_internal_t*)dstnode->data;
+			if (--dst->tfedcount == 0 && nready < nclients) {
+				ready[nready++] = dst;
 			}
 		}
 	}
 
+	free (ready);
+
+	stuck = (unsortedclients > 0);
+
 	if (stuck) {
 
 		VERBOSE (engine, "graph is still cyclic" );
@@ -3721,11 +5596,15 @@ jack_check_acyclic (jack_engine_t *engine)
 							jack_slist_prepend
 								(conn->srcclient->sortfeeds,
 								conn->dstclient );
+						jack_note_sort_edge (engine,
+								     conn->srcclient,
+								     conn->dstclient);
 					}
 				}
 			}
 		}
 		engine->feedbackcount = 0;
+		jack_note_feeds_change (engine);
 	}
 }
 
@@ -3794,10 +5673,14 @@ void jack_dump_configuration (jack_engine_t *engine, int take_lock)
 	jack_info ("engine.c: <-- dump ends -->");
 }
 
+/* Connect two ports by name.  The caller holds the graph write lock,
+ * and sorts the graph afterwards unless `sort' is set.
+ */
 static int
-jack_port_do_connect (jack_engine_t *engine,
-		      const char *source_port,
-		      const char *destination_port)
+jack_port_connect_internal (jack_engine_t *engine,
+			    const char *source_port,
+			    const char *destination_port,
+			    int sort)
 {
 	jack_connection_internal_t *connection;
 	jack_port_internal_t *srcport, *dstport;
@@ -3884,15 +5767,12 @@ jack_port_do_connect (jack_engine_t *engine,
 	src_id = srcport->shared->id;
 	dst_id = dstport->shared->id;
 
-	jack_lock_graph (engine);
-
 	if (dstport->connections && !dstport->shared->has_mixdown) {
 		jack_port_type_info_t *port_type =
 			jack_port_type_info (engine, dstport);
 		jack_error ("cannot make multiple connections to a port of"
 			    " type [%s]", port_type->type_name);
 		free (connection);
-		jack_unlock_graph (engine);
 		return -1;
 	} else {
 
@@ -3917,8 +5797,8 @@ jack_port_do_connect (jack_engine_t *engine,
 
 			dstclient->fedcount++;
 
-			if (jack_client_feeds_transitive (dstclient,
-							  srcclient ) ||
+			if (jack_client_feeds_transitive (engine, dstclient,
+							  srcclient) ||
 			    (dstclient->control->type == ClientDriver &&
 			     srcclient->control->type != ClientDriver)) {
 
@@ -3930,8 +5810,15 @@ jack_port_do_connect (jack_engine_t *engine,
 					 srcport->shared->name,
 					 dstport->shared->name);
 
+				if (engine->feedbackcount == 0 ||
+				    !jack_client_in_feeds (dstclient->sortfeeds,
+							   srcclient)) {
+					jack_note_feeds_change (engine);
+				}
+
 				dstclient->sortfeeds = jack_slist_prepend
 							       (dstclient->sortfeeds, srcclient);
+				jack_note_sort_edge (engine, dstclient, srcclient);
 
 				connection->dir = -1;
 				engine->feedbackcount++;
@@ -3948,8 +5835,14 @@ jack_port_do_connect (jack_engine_t *engine,
 					 srcport->shared->name,
 					 dstport->shared->name);
 
+				if (!jack_client_in_feeds (srcclient->sortfeeds,
+							   dstclient)) {
+					jack_note_feeds_change (engine);
+				}
+
 				srcclient->sortfeeds = jack_slist_prepend
 							       (srcclient->sortfeeds, dstclient);
+				jack_note_sort_edge (engine, srcclient, dstclient);
 
 				connection->dir = 1;
 			}
@@ -3984,25 +5877,41 @@ jack_port_do_connect (jack_engine_t *engine,
 
 		jack_notify_all_port_interested_clients (engine, srcport->shared->client_id, dstport->shared->client_id, src_id, dst_id, 1);
 
-		jack_sort_graph (engine);
+		if (sort) {
+			jack_resort_graph (engine);
+		}
 	}
 
+	return 0;
+}
+
+static int
+jack_port_do_connect (jack_engine_t *engine,
+		      const char *source_port,
+		      const char *destination_port)
+{
+	int ret;
+
+	jack_lock_graph_edit (engine);
+	ret = jack_port_connect_internal (engine, source_port,
+					  destination_port, TRUE);
 	jack_unlock_graph (engine);
 
-	return 0;
+	return ret;
 }
 
-int
-jack_port_disconnect_internal (jack_engine_t *engine,
+/* Remove the connection between two ports, without sorting the graph
+ * afterwards.
+ */
+static int
+jack_port_disconnect_unsorted (jack_engine_t *engine,
 			       jack_port_internal_t *srcport,
-			       jack_port_internal_t *dstport )
-
+			       jack_port_internal_t *dstport)
 {
 	JSList *node;
 	jack_connection_internal_t *connect;
 	int ret = -1;
 	jack_port_id_t src_id, dst_id;
-	int check_acyclic = engine->feedbackcount;
 
 	/* call tree **** MUST HOLD **** engine->client_lock. */
 	for (node = srcport->connections; node;
@@ -4071,12 +5980,21 @@ jack_port_disconnect_internal (jack_engine_t *engine,
 					   source's sortfeeds list */
 					src->sortfeeds = jack_slist_remove
 								 (src->sortfeeds, dst);
+					if (!jack_client_in_feeds (src->sortfeeds,
+								   dst)) {
+						jack_note_feeds_change (engine);
+					}
 				} else {
 					/* feedback connection: remove source
 					   from dest's sortfeeds list */
 					dst->sortfeeds = jack_slist_remove
 								 (dst->sortfeeds, src);
 					engine->feedbackcount--;
+					if (engine->feedbackcount == 0 ||
+					    !jack_client_in_feeds (dst->sortfeeds,
+								   src)) {
+						jack_note_feeds_change (engine);
+					}
 					VERBOSE (engine,
 						 "feedback count down to %d",
 						 engine->feedbackcount);
@@ -4090,11 +6008,27 @@ jack_port_disconnect_internal (jack_engine_t *engine,
 		}
 	}
 
+	return ret;
+}
+
+int
+jack_port_disconnect_internal (jack_engine_t *engine,
+			       jack_port_internal_t *srcport,
+			       jack_port_internal_t *dstport )
+
+{
+	int ret;
+	int check_acyclic = engine->feedbackcount;
+
+	/* call tree **** MUST HOLD **** engine->client_lock. */
+
+	ret = jack_port_disconnect_unsorted (engine, srcport, dstport);
+
 	if (check_acyclic) {
 		jack_check_acyclic (engine);
 	}
 
-	jack_sort_graph (engine);
+	jack_resort_graph (engine);
 
 	return ret;
 }
@@ -4112,9 +6046,9 @@ jack_port_do_disconnect_all (jack_engine_t *engine,
 	VERBOSE (engine, "clear connections for %s",
 		 engine->internal_ports[port_id].shared->name);
 
-	jack_lock_graph (engine);
+	jack_lock_graph_edit (engine);
 	jack_port_clear_connections (engine, &engine->internal_ports[port_id]);
-	jack_sort_graph (engine);
+	jack_resort_graph (engine);
 	jack_unlock_graph (engine);
 
 	return 0;
@@ -4141,7 +6075,7 @@ jack_port_do_disconnect (jack_engine_t *engine,
 		return -1;
 	}
 
-	jack_lock_graph (engine);
+	jack_lock_graph_edit (engine);
 
 	ret = jack_port_disconnect_internal (engine, srcport, dstport);
 
@@ -4150,6 +6084,116 @@ jack_port_do_disconnect (jack_engine_t *engine,
 	return ret;
 }
 
+/* Apply a ConnectPortsBatch request.  `ops' holds `count' records of
+ * an op byte (1 to connect, 0 to disconnect) followed by the
+ * NUL-terminated source and destination port names.  The graph is
+ * locked, sorted and checked for feedback once for the whole batch,
+ * and the clients' replies to the connection events are collected
+ * together at the end rather than one event at a time.  Returns the
+ * number of ops that failed, or -1 if the records are malformed.
+ */
+static int
+jack_port_do_connect_batch (jack_engine_t *engine, const char *ops,
+			    uint32_t nbytes, uint32_t count, int8_t *results)
+{
+	const char *p = ops, *end = ops + nbytes;
+	const char *source_port, *destination_port;
+	jack_port_internal_t *srcport, *dstport;
+	jack_client_internal_t **clients;
+	JSList *node;
+	uint32_t i;
+	int op, ret, failed = 0, disconnected = 0, n;
+	int check_acyclic = engine->feedbackcount;
+	char *status;
+
+	/* check the whole batch before touching the graph */
+
+	for (i = 0; i < count; i++) {
+		if (p >= end
+		    || (op = *p++) > 1 || op < 0
+		    || (p = memchr (p, '\0', end - p)) == NULL
+		    || (p = memchr (p + 1, '\0', end - (p + 1))) == NULL) {
+			jack_error ("malformed connection batch from client"
+				    " (op %" PRIu32 " of %" PRIu32 ")", i, count);
+			return -1;
+		}
+		p++;
+	}
+
+	jack_lock_graph_edit (engine);
+
+	engine->defer_replies = TRUE;
+
+	for (i = 0, p = ops; i < count; i++) {
+
+		op = *p++;
+		source_port = p;
+		p += strlen (p) + 1;
+		destination_port = p;
+		p += strlen (p) + 1;
+
+		if (op) {
+			ret = jack_port_connect_internal (engine, source_port,
+							  destination_port,
+							  FALSE);
+		} else if ((srcport = jack_get_port_by_name (engine, source_port)) == NULL) {
+			jack_error ("unknown source port in attempted"
+				    " disconnection [%s]", source_port);
+			ret = -1;
+		} else if ((dstport = jack_get_port_by_name (engine, destination_port)) == NULL) {
+			jack_error ("unknown destination port in attempted"
+				    " disconnection [%s]", destination_port);
+			ret = -1;
+		} else if ((ret = jack_port_disconnect_unsorted (engine, srcport, dstport)) == 0) {
+			disconnected = TRUE;
+		}
+
+		results[i] = (ret < 0) ? -1 : ret;
+
+		if (ret < 0) {
+			failed++;
+		}
+	}
+
+	if (disconnected && check_acyclic) {
+		jack_check_acyclic (engine);
+	}
+
+	jack_resort_graph (engine);
+
+	engine->defer_replies = FALSE;
+
+	/* now wait for everyone who was sent an event that needs a reply */
+
+	clients = (jack_client_internal_t**)
+		  alloca (jack_slist_length (engine->clients)
+			  * sizeof(jack_client_internal_t*));
+	n = 0;
+
+	pthread_mutex_lock (&engine->event_lock);
+
+	for (node = engine->clients; node; node = jack_slist_next (node)) {
+		jack_client_internal_t *client = (jack_client_internal_t*)node->data;
+		if (client->event_replies_pending > 0) {
+			clients[n++] = client;
+		}
+	}
+
+	if (n) {
+		status = (char*)alloca (n);
+		jack_collect_event_replies (engine, clients, n, status);
+	}
+
+	pthread_mutex_unlock (&engine->event_lock);
+
+	jack_unlock_graph (engine);
+
+	VERBOSE (engine, "connection batch: %" PRIu32 " ops, %d failed",
+		 count, failed);
+
+	return failed;
+}
+
 int
 jack_get_fifo_fd (jack_engine_t *engine, unsigned int which_fifo)
 {
@@ -4231,6 +6275,11 @@ jack_clear_fifos (jack_engine_t *engine)
 			}
 		}
 	}
+
+	/* same for wakeups left pending in the futex slots */
+	for (i = 0; i < JACK_WAKEUP_SLOTS; i++) {
+		engine->control->wakeup[i].pending = 0;
+	}
 }
 
 int
@@ -4274,6 +6323,116 @@ jack_add_slave_driver (jack_engine_t *engine, jack_driver_t *driver)
 /* PORT RELATED FUNCTIONS */
 
 
+/* Port name index.  These are called with the port_lock held, and
+ * bracket every change with port_hash_seq so that clients reading the
+ * index without a lock can tell when a miss may be spurious.
+ */
+
+static void
+jack_port_hash_insert (jack_engine_t *engine, jack_port_internal_t *port,
+		       const char *key)
+{
+	jack_port_hash_entry_t *table = jack_port_hash_table (engine->control);
+	uint32_t mask = engine->control->port_hash_size - 1;
+	uint32_t h = jack_port_name_hash (key);
+	uint32_t i;
+
+	for (i = h & mask; table[i].id != JACK_PORT_HASH_EMPTY; i = (i + 1) & mask) ;
+
+	table[i].hash = h;
+	release_fence ();
+	table[i].id = port->shared->id;
+
+	port->name_hash[port->n_name_hash++] = h;
+}
+
+static void
+jack_port_hash_delete (jack_engine_t *engine, jack_port_internal_t *port,
+		       uint32_t h)
+{
+	jack_port_hash_entry_t *table = jack_port_hash_table (engine->control);
+	uint32_t mask = engine->control->port_hash_size - 1;
+	uint32_t i, j, k;
+
+	for (i = h & mask; table[i].id != JACK_PORT_HASH_EMPTY; i = (i + 1) & mask) {
+		if (table[i].hash == h && table[i].id == port->shared->id) {
+			break;
+		}
+	}
+
+	if (table[i].id == JACK_PORT_HASH_EMPTY) {
+		return;
+	}
+
+	/* backward shift deletion: move later members of the probe
+	   sequence into the hole, so that lookups never need
+	   tombstones */
+	for (j = (i + 1) & mask; table[j].id != JACK_PORT_HASH_EMPTY; j = (j + 1) & mask) {
+		k = table[j].hash & mask;
+		if ((j > i && (k <= i || k > j)) ||
+		    (j < i && (k <= i && k > j))) {
+			table[i] = table[j];
+			i = j;
+		}
+	}
+
+	table[i].id = JACK_PORT_HASH_EMPTY;
+}
+
+static void
+jack_port_hash_remove (jack_engine_t *engine, jack_port_internal_t *port)
+{
+	exchange_and_add_seq_cst (&engine->control->port_hash_seq, 1);
+
+	while (port->n_name_hash > 0) {
+		jack_port_hash_delete (engine, port,
+				       port->name_hash[--port->n_name_hash]);
+	}
+
+	exchange_and_add_seq_cst (&engine->control->port_hash_seq, 1);
+}
+
+static void
+jack_port_hash_add (jack_engine_t *engine, jack_port_internal_t *port)
+{
+	jack_port_shared_t *shared = port->shared;
+
+	exchange_and_add_seq_cst (&engine->control->port_hash_seq, 1);
+
+	jack_port_hash_insert (engine, port, shared->name);
+	if (shared->alias1[0] != '\0') {
+		jack_port_hash_insert (engine, port, shared->alias1);
+	}
+	if (shared->alias2[0] != '\0') {
+		jack_port_hash_insert (engine, port, shared->alias2);
+	}
+
+	exchange_and_add_seq_cst (&engine->control->port_hash_seq, 1);
+}
+
+static int
+jack_port_do_reindex (jack_engine_t *engine, jack_request_t *req)
+{
+	jack_port_internal_t *port;
+
+	if (req->x.port_info.port_id >= engine->port_max) {
+		jack_error ("invalid port ID %" PRIu32 " in reindex request",
+			    req->x.port_info.port_id);
+		return -1;
+	}
+
+	port = &engine->internal_ports[req->x.port_info.port_id];
+
+	pthread_mutex_lock (&engine->port_lock);
+	if (port->shared->in_use) {
+		jack_port_hash_remove (engine, port);
+		jack_port_hash_add (engine, port);
+	}
+	pthread_mutex_unlock (&engine->port_lock);
+
+	return 0;
+}
+
 static jack_port_id_t
 jack_get_free_port (jack_engine_t *engine)
 
@@ -4313,19 +6472,18 @@ jack_port_release (jack_engine_t *engine, jack_port_internal_t *port)
 
 
 	pthread_mutex_lock (&engine->port_lock);
+	/* clear in_use first: the index update that follows bumps the
+	   port generation that cached port queries check */
 	port->shared->in_use = 0;
+	jack_port_hash_remove (engine, port);
 	port->shared->alias1[0] = '\0';
 	port->shared->alias2[0] = '\0';
 
 	if (port->buffer_info) {
 		jack_port_buffer_list_t *blist =
 			jack_port_buffer_list (engine, port);
-		pthread_mutex_lock (&blist->lock);
-		blist->freelist =
-			jack_slist_prepend (blist->freelist,
-					    port->buffer_info);
+		jack_port_buffer_push (blist, port->buffer_info);
 		port->buffer_info = NULL;
-		pthread_mutex_unlock (&blist->lock);
 	}
 	pthread_mutex_unlock (&engine->port_lock);
 }
@@ -4336,16 +6494,10 @@ jack_get_port_internal_by_name (jack_engine_t *engine, const char *name)
 	jack_port_id_t id;
 
 	pthread_mutex_lock (&engine->port_lock);
-
-	for (id = 0; id < engine->port_max; id++) {
-		if (jack_port_name_equals (&engine->control->ports[id], name)) {
-			break;
-		}
-	}
-
+	id = jack_port_hash_lookup (engine->control, name);
 	pthread_mutex_unlock (&engine->port_lock);
 
-	if (id != engine->port_max) {
+	if (id != JACK_PORT_HASH_EMPTY) {
 		return &engine->internal_ports[id];
 	} else {
 		return NULL;
@@ -4376,7 +6528,7 @@ jack_port_do_register (jack_engine_t *engine, jack_request_t *req, int internal)
 		return -1;
 	}
 
-	jack_lock_graph (engine);
+	jack_lock_graph_edit (engine);
 	if ((client = jack_client_internal_by_id (engine,
 						  req->x.port_info.client_id))
 	    == NULL) {
@@ -4454,6 +6606,7 @@ next:
 	shared->capture_latency.min = shared->capture_latency.max = 0;
 	shared->playback_latency.min = shared->playback_latency.max = 0;
 	shared->monitor_requests = 0;
+	shared->silent_cycle = 0;
 
 	port = &engine->internal_ports[port_id];
 
@@ -4468,6 +6621,10 @@ next:
 		return -1;
 	}
 
+	pthread_mutex_lock (&engine->port_lock);
+	jack_port_hash_add (engine, port);
+	pthread_mutex_unlock (&engine->port_lock);
+
 	client->ports = jack_slist_prepend (client->ports, port);
 	if ( client->control->active ) {
 		jack_port_registration_notify (engine, port_id, TRUE);
@@ -4783,24 +6940,20 @@ jack_port_assign_buffer (jack_engine_t *engine, jack_port_internal_t *port)
 		return 0;
 	}
 
-	pthread_mutex_lock (&blist->lock);
-
-	if (blist->freelist == NULL) {
-		jack_port_type_info_t *port_type =
-			jack_port_type_info (engine, port);
-		jack_error ("all %s port buffers in use!",
-			    port_type->type_name);
-		pthread_mutex_unlock (&blist->lock);
-		return -1;
+	while ((bi = jack_port_buffer_pop (blist)) == NULL) {
+		if (jack_port_segment_grow (engine, port->shared->ptype_id,
+					    blist->n_segments)) {
+			jack_port_type_info_t *port_type =
+				jack_port_type_info (engine, port);
+			jack_error ("all %s port buffers in use!",
+				    port_type->type_name);
+			return -1;
+		}
 	}
 
-	bi = (jack_port_buffer_info_t*)blist->freelist->data;
-	blist->freelist = jack_slist_remove (blist->freelist, bi);
-
 	port->shared->offset = bi->offset;
 	port->buffer_info = bi;
 
-	pthread_mutex_unlock (&blist->lock);
 	return 0;
 }
 
@@ -4813,11 +6966,9 @@ jack_get_port_by_name (jack_engine_t *engine, const char *name)
 	   elements prevent this from being a problem.
 	 */
 
-	for (id = 0; id < engine->port_max; id++) {
-		if (engine->control->ports[id].in_use &&
-		    jack_port_name_equals (&engine->control->ports[id], name)) {
-			return &engine->internal_ports[id];
-		}
+	if ((id = jack_port_hash_lookup (engine->control, name))
+	    != JACK_PORT_HASH_EMPTY) {
+		return &engine->internal_ports[id];
 	}
 
 	return NULL;
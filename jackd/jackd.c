@@ -72,6 +72,8 @@ static int do_unlock = 0;
 static jack_nframes_t frame_time_offset = 0;
 static int nozombies = 0;
 static int timeout_count_threshold = 0;
+static int parallel_graph = 0;
+static int hugepages = 0;
 
 extern int sanitycheck(int, int);
 
@@ -306,7 +308,8 @@ jack_main (jack_driver_desc_t * driver_desc, JSList * driver_params, JSList * sl
 				       do_mlock, do_unlock, server_name,
 				       temporary, verbose, client_timeout,
 				       port_max, getpid (), frame_time_offset,
-				       nozombies, timeout_count_threshold, drivers)) == 0) {
+				       nozombies, timeout_count_threshold,
+				       parallel_graph, hugepages, drivers)) == 0) {
 		jack_error ("cannot create engine");
 		return -1;
 	}
@@ -676,9 +679,9 @@ main (int argc, char *argv[])
 	int show_version = 0;
 
 #ifdef HAVE_ZITA_BRIDGE_DEPS
-	const char *options = "A:d:P:uvshVrRZTFlI:t:mM:n:Np:c:X:C:";
+	const char *options = "A:d:GHP:uvshVrRZTFlI:t:mM:n:Np:c:X:C:";
 #else
-	const char *options = "d:P:uvshVrRZTFlI:t:mM:n:Np:c:X:C:";
+	const char *options = "d:GHP:uvshVrRZTFlI:t:mM:n:Np:c:X:C:";
 #endif
 	struct option long_options[] =
 	{
@@ -689,7 +692,9 @@ main (int argc, char *argv[])
 #endif
 		{ "clock-source",      1, 0,		     'c' },
 		{ "driver",	       1, 0,		     'd' },
+		{ "parallel-graph",    0, 0,		     'G' },
 		{ "help",	       0, 0,		     'h' },
+		{ "hugepages",	       0, 0,		     'H' },
 		{ "tmpdir-location",   0, 0,		     'l' },
 		{ "internal-client",   0, 0,		     'I' },
 		{ "no-mlock",	       0, 0,		     'm' },
@@ -787,6 +792,8 @@ main (int argc, char *argv[])
 				clock_source = JACK_TIMER_SYSTEM_CLOCK;
 			} else if (tolower (optarg[0]) == 's') {
 				clock_source = JACK_TIMER_SYSTEM_CLOCK;
+			} else if (tolower (optarg[0]) == 't') {
+				clock_source = JACK_TIMER_TSC;
 			} else {
 				usage (stderr);
 				return -1;
@@ -810,6 +817,14 @@ main (int argc, char *argv[])
 			frame_time_offset = JACK_MAX_FRAMES - atoi (optarg);
 			break;
 
+		case 'G':
+			parallel_graph = 1;
+			break;
+
+		case 'H':
+			hugepages = 1;
+			break;
+
 		case 'l':
 			/* special flag to allow libjack to determine jackd's idea of where tmpdir is */
 			printf("%s\n", DEFAULT_TMP_DIR);
@@ -30,7 +30,6 @@
 #ifdef HAVE_STDINT_H
 #include <stdint.h>
 #endif
-#include <regex.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -45,6 +44,8 @@
 #include <jack/uuid.h>
 
 #include "internal.h"
+#include "futex.h"
+#include "channel.h"
 #include "engine.h"
 #include "pool.h"
 #include "version.h"
@@ -82,6 +83,16 @@ typedef struct {
 	const char *client_name;
 } client_info;
 
+/* A connection list node unlinked from a port, and the port it
+ * pointed to, kept until whatever process() call could have seen it
+ * has returned (see jack_client_cycles_done()).
+ */
+typedef struct {
+	JSList *node;
+	jack_port_t *other;
+	uint32_t cycle;
+} jack_retired_connection_t;
+
 #ifdef USE_DYNSIMD
 
 #ifdef ARCH_X86
@@ -91,7 +102,7 @@ int cpu_type = 0;
 static void
 init_cpu ()
 {
-	cpu_type = ((have_3dnow () << 8) | have_sse ());
+	cpu_type = ((have_avx () << 16) | (have_3dnow () << 8) | have_sse ());
 #if 0
 	if (ARCH_X86_HAVE_3DNOW (cpu_type)) {
 		jack_debug ("Enhanced3DNow! detected");
@@ -106,6 +117,17 @@ init_cpu ()
 	jack_port_set_funcs ();
 }
 
+#elif defined(ARCH_AARCH64)
+
+int cpu_type = 0;
+
+static void
+init_cpu ()
+{
+	cpu_type = have_neon ();
+	jack_port_set_funcs ();
+}
+
 #else /* ARCH_X86 */
 
 static void
@@ -274,6 +296,7 @@ oop_client_deliver_request (void *ptr, jack_request_t *req)
 {
 	int wok, rok;
 	jack_client_t *client = (jack_client_t*)ptr;
+	int8_t *results = NULL;
 
 	wok = (write_retry (client->request_fd, req, sizeof(*req))
 	       == sizeof(*req));
@@ -292,9 +315,33 @@ oop_client_deliver_request (void *ptr, jack_request_t *req)
 		}
 	}
 
+	/* and the records of a ConnectPortsBatch request
+	 */
+
+	if (req->type == ConnectPortsBatch) {
+		results = req->x.connect_batch.results;
+		if (wok && write_retry (client->request_fd, req->x.connect_batch.ops,
+					req->x.connect_batch.nbytes)
+		    != (int)req->x.connect_batch.nbytes) {
+			jack_error ("cannot send connection batch of %" PRIu32
+				    " bytes to server", req->x.connect_batch.nbytes);
+			req->status = -1;
+			return req->status;
+		}
+	}
+
 	rok = (read_retry (client->request_fd, req, sizeof(*req))
 	       == sizeof(*req));
 
+	/* the server's reply carries its own pointers, not ours */
+
+	if (rok && req->type == ConnectPortsBatch && req->status >= 0) {
+		req->x.connect_batch.results = results;
+		rok = (read_retry (client->request_fd, results,
+				   req->x.connect_batch.count)
+		       == (int)req->x.connect_batch.count);
+	}
+
 	if (wok && rok) {               /* everything OK? */
 		return req->status;
 	}
@@ -318,6 +365,95 @@ oop_client_deliver_request (void *ptr, jack_request_t *req)
 	return req->status;
 }
 
+/* how long to wait for the server to answer on the request channel
+   before trying the socket instead */
+#define JACK_CHANNEL_TIMEOUT_USECS 2000000
+
+/* Send a query through the shared memory request channel in our
+ * control segment instead of the request socket.  `payload' holds
+ * `size' bytes; the reply payload is copied to `reply', which must hold
+ * JACK_CHANNEL_MAX_PAYLOAD bytes, and its size to *reply_size.  Returns
+ * -1 if the channel could not carry the request, in which case the
+ * caller should use the socket; otherwise 0, with the server's status
+ * in *status.
+ */
+int
+jack_channel_request (jack_client_t *client, uint32_t type,
+		      const void *payload, uint32_t size, int32_t *status,
+		      void *reply, uint32_t *reply_size)
+{
+#ifdef HAVE_LINUX_FUTEX
+	jack_channel_ring_t *requests, *replies;
+	jack_channel_msg_t msg;
+	jack_time_t now, deadline;
+	int seq, ret = -1;
+
+	if (client->request_fd < 0 || client->control == NULL
+	    || !client->control->request_channel
+	    || client->channel_failed
+	    || size > JACK_CHANNEL_MAX_PAYLOAD) {
+		return -1;
+	}
+
+	requests = (jack_channel_ring_t*)&client->control->request_ring;
+	replies = (jack_channel_ring_t*)&client->control->reply_ring;
+
+	pthread_mutex_lock (&client->channel_lock);
+
+	msg.id = ++client->channel_id;
+	msg.type = type;
+	msg.size = size;
+	msg.status = 0;
+
+	if (jack_channel_put (requests, &msg, payload)) {
+		pthread_mutex_unlock (&client->channel_lock);
+		return -1;
+	}
+
+	jack_wakeup_kick (&client->engine->channel_doorbell);
+
+	now = jack_get_microseconds ();
+	deadline = now + JACK_CHANNEL_TIMEOUT_USECS;
+
+	while (client->engine->engine_ok) {
+
+		seq = replies->doorbell.seq;
+
+		if (jack_channel_get (replies, &msg, reply,
+				      JACK_CHANNEL_MAX_PAYLOAD)) {
+			/* replies to requests we gave up on are dropped */
+			if (msg.id != client->channel_id) {
+				continue;
+			}
+			if (msg.type != 0) {
+				*status = msg.status;
+				*reply_size = msg.size;
+				ret = 0;
+			}
+			break;
+		}
+
+		if (now >= deadline) {
+			jack_error ("no reply on the request channel, "
+				    "using the socket");
+			break;
+		}
+
+		if (jack_wakeup_wait (&replies->doorbell, seq, deadline - now)) {
+			client->channel_failed = 1;
+			break;
+		}
+		now = jack_get_microseconds ();
+	}
+
+	pthread_mutex_unlock (&client->channel_lock);
+
+	return ret;
+#else
+	return -1;
+#endif  /* HAVE_LINUX_FUTEX */
+}
+
 int
 jack_client_deliver_request (const jack_client_t *client, jack_request_t *req)
 {
@@ -352,6 +488,13 @@ jack_client_alloc ()
 	client->graph_next_fd = -1;
 	client->ports = NULL;
 	client->ports_ext = NULL;
+	client->port_queries = NULL;
+	client->retired_connections = NULL;
+	client->process_cycles = 0;
+	pthread_mutex_init (&client->port_query_lock, NULL);
+	pthread_mutex_init (&client->channel_lock, NULL);
+	client->channel_id = 0;
+	client->channel_failed = 0;
 	client->engine = NULL;
 	client->control = NULL;
 	client->thread_ok = FALSE;
@@ -390,8 +533,19 @@ jack_client_alloc ()
 	client->upstream_is_jackd = 0;
 	client->graph_wait_fd = -1;
 	client->graph_next_fd = -1;
+	client->n_downstream = 0;
+	client->wakeup_slot = -1;
+	client->wakeup_next = -1;
+	client->wakeup_failed = 0;
 	client->ports = NULL;
 	client->ports_ext = NULL;
+	client->port_queries = NULL;
+	client->retired_connections = NULL;
+	client->process_cycles = 0;
+	pthread_mutex_init (&client->port_query_lock, NULL);
+	pthread_mutex_init (&client->channel_lock, NULL);
+	client->channel_id = 0;
+	client->channel_failed = 0;
 	client->engine = NULL;
 	client->control = NULL;
 	client->thread_ok = FALSE;
@@ -424,11 +578,86 @@ jack_client_alloc_internal (jack_client_control_t *cc, jack_engine_t* engine)
 	client->engine = engine->control;
 
 	client->n_port_types = client->engine->n_port_types;
-	client->port_segment = &engine->port_segment[0];
+	client->port_segment = engine->port_segment;
 
 	return client;
 }
 
+/* The count of cycles this client is done with.  The engine runs
+ * internal clients and drivers inside its own cycle, so its cycle
+ * count will do for them.  An external client's process() can overrun
+ * the cycle it was started for, and the engine gives up on it and
+ * starts more, so only our process thread, which bumps process_cycles
+ * after each call, can tell.
+ */
+static uint32_t
+jack_client_cycles_done (jack_client_t *client)
+{
+	if (client->control->type == ClientExternal) {
+		return (uint32_t)client->process_cycles;
+	}
+	return client->engine->cycle_count;
+}
+
+/* Free retired connections that no process() callback can still be
+ * looking at, or all of them if `all' is set.
+ */
+static void
+jack_client_free_retired (jack_client_t *client, int all)
+{
+	jack_retired_connection_t *retired;
+	JSList *node, *next, *kept = NULL;
+	uint32_t done = jack_client_cycles_done (client);
+
+	for (node = client->retired_connections; node; node = next) {
+		next = jack_slist_next (node);
+		retired = (jack_retired_connection_t*)node->data;
+		if (all || (uint32_t)(done - retired->cycle) >= 2) {
+			jack_slist_free_1 (retired->node);
+			free (retired->other);
+			free (retired);
+			jack_slist_free_1 (node);
+		} else {
+			node->next = kept;
+			kept = node;
+		}
+	}
+
+	client->retired_connections = kept;
+}
+
+/* The engine no longer stops cycles while connections are made and
+ * broken, so the process thread may be walking a port's connection
+ * list while this thread changes it.  New nodes are only published
+ * once complete, and unlinked nodes keep their `next' pointer and
+ * stay allocated until two more process() calls have returned (see
+ * jack_client_cycles_done()); by then the call that could have seen
+ * them is over.  The fence pairs with the one in jack_cycle_signal():
+ * either that process thread sees the node unlinked, or we see its
+ * count from before it looked.
+ */
+static void
+jack_client_retire_connection (jack_client_t *client, JSList *node)
+{
+	jack_retired_connection_t *retired;
+
+	if ((retired = (jack_retired_connection_t*)
+		       malloc (sizeof(jack_retired_connection_t))) == NULL) {
+		/* leak it rather than free it under a reader */
+		jack_error ("cannot retire connection");
+		return;
+	}
+
+	full_fence ();
+
+	retired->node = node;
+	retired->other = (jack_port_t*)node->data;
+	retired->cycle = jack_client_cycles_done (client);
+
+	client->retired_connections =
+		jack_slist_prepend (client->retired_connections, retired);
+}
+
 static void
 jack_client_free (jack_client_t *client)
 {
@@ -436,9 +665,30 @@ jack_client_free (jack_client_t *client)
 		free (client->pollfd);
 	}
 
+	jack_client_free_retired (client, TRUE);
+	jack_port_query_cache_free (client);
+	pthread_mutex_destroy (&client->port_query_lock);
+	pthread_mutex_destroy (&client->channel_lock);
+
 	free (client);
 }
 
+/* Take a mix buffer.  This may be on the process thread, so it comes
+ * from the blocks jack_port_register() reserved, and only from the
+ * heap if they ran out, as they can after a change of buffer size.
+ */
+static void *
+jack_client_mix_buffer_alloc (size_t buffer_size)
+{
+	void *buffer;
+
+	if ((buffer = jack_pool_alloc_rt (buffer_size)) == NULL) {
+		buffer = jack_pool_alloc (buffer_size);
+	}
+
+	return buffer;
+}
+
 void
 jack_client_fix_port_buffers (jack_client_t *client)
 {
@@ -463,13 +713,16 @@ jack_client_fix_port_buffers (jack_client_t *client)
 				port->mix_buffer = NULL;
 				pthread_mutex_lock (&port->connection_lock);
 				if (jack_slist_length (port->connections) > 1) {
-					port->mix_buffer = jack_pool_alloc (buffer_size);
+					port->mix_buffer = jack_client_mix_buffer_alloc (buffer_size);
 					port->fptr.buffer_init (port->mix_buffer,
 								buffer_size,
 								client->engine->buffer_size);
 				}
 				pthread_mutex_unlock (&port->connection_lock);
 			}
+		} else {
+			/* the engine has just initialized a new buffer */
+			jack_port_set_buffer_limit (port);
 		}
 	}
 }
@@ -479,7 +732,7 @@ jack_client_handle_port_connection (jack_client_t *client, jack_event_t *event)
 {
 	jack_port_t *control_port;
 	jack_port_t *other = 0;
-	JSList *node;
+	JSList *node, *prev;
 	int need_free = FALSE;
 
 	if (jack_uuid_compare (client->engine->ports[event->x.self_id].client_id, client->control->uuid) == 0 ||
@@ -487,6 +740,8 @@ jack_client_handle_port_connection (jack_client_t *client, jack_event_t *event)
 
 		/* its one of ours */
 
+		jack_client_free_retired (client, FALSE);
+
 		switch (event->type) {
 		case PortConnected:
 			other = jack_port_new (client, event->y.other_id,
@@ -504,15 +759,17 @@ jack_client_handle_port_connection (jack_client_t *client, jack_event_t *event)
 				size_t buffer_size =
 					jack_port_type_buffer_size ( control_port->type_info,
 								     client->engine->buffer_size );
-				control_port->mix_buffer = jack_pool_alloc (buffer_size);
+				control_port->mix_buffer = jack_client_mix_buffer_alloc (buffer_size);
 				control_port->fptr.buffer_init (control_port->mix_buffer,
 								buffer_size,
 								client->engine->buffer_size);
 			}
 
-			control_port->connections =
-				jack_slist_prepend (control_port->connections,
-						    (void*)other);
+			node = jack_slist_prepend (control_port->connections,
+						   (void*)other);
+			/* the mix buffer and the node come first */
+			release_fence ();
+			control_port->connections = node;
 			pthread_mutex_unlock (&control_port->connection_lock);
 			break;
 
@@ -524,18 +781,22 @@ jack_client_handle_port_connection (jack_client_t *client, jack_event_t *event)
 							    &need_free);
 			pthread_mutex_lock (&control_port->connection_lock);
 
-			for (node = control_port->connections; node;
-			     node = jack_slist_next (node)) {
+			for (prev = NULL, node = control_port->connections;
+			     node; prev = node, node = jack_slist_next (node)) {
 
 				other = (jack_port_t*)node->data;
 
 				if (other->shared->id == event->y.other_id) {
-					control_port->connections =
-						jack_slist_remove_link (
-							control_port->connections,
-							node);
-					jack_slist_free_1 (node);
-					free (other);
+					/* unlink it, leaving node->next
+					   for anyone standing on it */
+					if (prev) {
+						prev->next = node->next;
+					} else {
+						control_port->connections =
+							node->next;
+					}
+					jack_client_retire_connection (client,
+								       node);
 					break;
 				}
 			}
@@ -746,6 +1007,59 @@ jack_handle_reorder (jack_client_t *client, jack_event_t *event)
 
 #else
 
+static void
+jack_close_downstream_fifos (jack_client_t *client)
+{
+	uint32_t i;
+
+	for (i = 0; i < client->n_downstream; i++) {
+		if (client->downstream_fd[i] >= 0) {
+			DEBUG ("closing downstream fd==%d",
+			       client->downstream_fd[i]);
+			close (client->downstream_fd[i]);
+		}
+	}
+
+	client->n_downstream = 0;
+}
+
+static int
+jack_open_downstream_fifos (jack_client_t *client)
+{
+	char path[PATH_MAX + 1];
+	uint32_t i;
+
+	for (i = 0; i < client->control->n_downstream; i++) {
+
+		client->downstream[i] = client->control->downstream[i];
+		client->downstream_fd[i] = -1;
+
+		if (client->wakeup_slot >= 0) {
+			/* futex wakeups, no FIFO needed */
+			client->n_downstream = i + 1;
+			continue;
+		}
+
+		sprintf (path, "%s-%" PRIu32, client->fifo_prefix,
+			 client->downstream[i]);
+
+		if ((client->downstream_fd[i] =
+			     open (path, O_WRONLY | O_NONBLOCK)) < 0) {
+			jack_error ("cannot open specified fifo [%s] for "
+				    "writing (%s)", path, strerror (errno));
+			jack_close_downstream_fifos (client);
+			return -1;
+		}
+
+		client->n_downstream = i + 1;
+
+		DEBUG ("opened downstream fd %d (%s)",
+		       client->downstream_fd[i], path);
+	}
+
+	return 0;
+}
+
 static int
 jack_handle_reorder (jack_client_t *client, jack_event_t *event)
 {
@@ -765,29 +1079,69 @@ jack_handle_reorder (jack_client_t *client, jack_event_t *event)
 		client->graph_next_fd = -1;
 	}
 
-	sprintf (path, "%s-%" PRIu32, client->fifo_prefix, event->x.n);
+	jack_close_downstream_fifos (client);
 
-	if ((client->graph_wait_fd = open (path, O_RDONLY | O_NONBLOCK)) < 0) {
-		jack_error ("cannot open specified fifo [%s] for reading (%s)",
-			    path, strerror (errno));
-		return -1;
-	}
-	DEBUG ("opened new graph_wait_fd %d (%s)", client->graph_wait_fd, path);
+	client->wakeup_slot = -1;
+	client->wakeup_next = -1;
 
-	sprintf (path, "%s-%" PRIu32, client->fifo_prefix, event->x.n + 1);
+	if (client->control->wakeup_futex) {
 
-	if ((client->graph_next_fd = open (path, O_WRONLY | O_NONBLOCK)) < 0) {
-		jack_error ("cannot open specified fifo [%s] for writing (%s)",
-			    path, strerror (errno));
-		return -1;
+		/* futex wakeups: we sleep on the slot with our FIFO's
+		 * number, and wake the next one (or, for parallel
+		 * execution, those of the clients we feed).
+		 */
+
+		client->wakeup_slot = event->x.n;
+
+		if (client->control->parallel_graph) {
+			jack_open_downstream_fifos (client);
+		} else {
+			client->wakeup_next = event->x.n + 1;
+		}
+
+		client->pollmax = 1;
+
+	} else {
+
+		sprintf (path, "%s-%" PRIu32, client->fifo_prefix, event->x.n);
+
+		if ((client->graph_wait_fd = open (path, O_RDONLY | O_NONBLOCK)) < 0) {
+			jack_error ("cannot open specified fifo [%s] for reading (%s)",
+				    path, strerror (errno));
+			return -1;
+		}
+		DEBUG ("opened new graph_wait_fd %d (%s)", client->graph_wait_fd, path);
+
+		if (client->control->parallel_graph) {
+
+			/* parallel execution: we wake the clients we feed (or
+			 * the server) ourselves, instead of the next client in
+			 * the chain.
+			 */
+
+			if (jack_open_downstream_fifos (client)) {
+				return -1;
+			}
+
+		} else {
+
+			sprintf (path, "%s-%" PRIu32, client->fifo_prefix, event->x.n + 1);
+
+			if ((client->graph_next_fd = open (path, O_WRONLY | O_NONBLOCK)) < 0) {
+				jack_error ("cannot open specified fifo [%s] for writing (%s)",
+					    path, strerror (errno));
+				return -1;
+			}
+		}
+
+		client->pollmax = 2;
 	}
 
 	client->upstream_is_jackd = event->y.n;
-	client->pollmax = 2;
+	client->control->wakeup_slot = client->wakeup_slot;
 
-	DEBUG ("opened new graph_next_fd %d (%s) (upstream is jackd? %d)",
-	       client->graph_next_fd, path,
-	       client->upstream_is_jackd);
+	DEBUG ("opened new graph_next_fd %d (upstream is jackd? %d)",
+	       client->graph_next_fd, client->upstream_is_jackd);
 
 	/* If the client registered its own callback for graph order events,
 	   execute it now.
@@ -1196,12 +1550,34 @@ fail:
 	return -1;
 }
 
+static int
+jack_port_segment_map (jack_client_t *client, jack_port_type_id_t ptid,
+		       uint32_t seg)
+{
+	jack_shm_info_t *si = &client->port_segment[ptid][seg];
+
+	si->index = client->engine->port_types[ptid].shm_registry_index[seg];
+
+	if (jack_attach_shm (si)) {
+		jack_error ("cannot attach port segment shared memory"
+			    " (%s)", strerror (errno));
+		si->attached_at = MAP_FAILED;
+		return -1;
+	}
+
+	return 0;
+}
+
 int
 jack_attach_port_segment (jack_client_t *client, jack_port_type_id_t ptid)
 {
 	/* Lookup, attach and register the port/buffer segments in use
-	 * right now.
+	 * right now.  The first segment is always mapped; the others
+	 * only if we had mapped them before, since they get mapped on
+	 * demand by jack_port_segment_attach().
 	 */
+	uint32_t seg, n_segments;
+	int ret = 0;
 
 	if (client->control->type != ClientExternal) {
 		jack_error ("Only external clients need attach port segments");
@@ -1213,38 +1589,71 @@ jack_attach_port_segment (jack_client_t *client, jack_port_type_id_t ptid)
 	 */
 
 	if (ptid >= client->n_port_types) {
+		jack_port_type_id_t i;
 
-		client->port_segment = (jack_shm_info_t*)
+		client->port_segment = (jack_shm_info_t (*)[JACK_PORT_MAX_SEGMENTS])
 				       realloc (client->port_segment,
-						sizeof(jack_shm_info_t) * (ptid + 1));
+						sizeof(*client->port_segment) * (ptid + 1));
 
-		memset (&client->port_segment[client->n_port_types],
-			0,
-			sizeof(jack_shm_info_t) *
-			(ptid - client->n_port_types));
+		for (i = client->n_port_types; i <= ptid; ++i) {
+			for (seg = 0; seg < JACK_PORT_MAX_SEGMENTS; ++seg) {
+				client->port_segment[i][seg].index = -1;
+				client->port_segment[i][seg].attached_at = MAP_FAILED;
+			}
+		}
 
 		client->n_port_types = ptid + 1;
+	}
 
-	} else {
+	n_segments = client->engine->port_types[ptid].n_segments;
+	acquire_fence ();
+
+	for (seg = 0; seg < n_segments; ++seg) {
+		jack_shm_info_t *si = &client->port_segment[ptid][seg];
+
+		if (seg > 0 && si->attached_at == MAP_FAILED) {
+			continue;
+		}
 
 		/* release any previous segment */
-		jack_release_shm (&client->port_segment[ptid]);
-	}
+		jack_release_shm (si);
+		si->attached_at = MAP_FAILED;
 
-	/* get the index into the shm registry */
+		if (jack_port_segment_map (client, ptid, seg)) {
+			ret = -1;
+		}
+	}
 
-	client->port_segment[ptid].index =
-		client->engine->port_types[ptid].shm_registry_index;
+	return ret;
+}
 
-	/* attach the relevant segment */
+/* Map segment `seg' of port type `ptid' unless it is already.  The
+ * engine appends segments as ports are added, and a client only
+ * maps those that hold buffers of ports it knows about.
+ */
+int
+jack_port_segment_attach (jack_client_t *client, jack_port_type_id_t ptid,
+			  uint32_t seg)
+{
+	if (client->control->type != ClientExternal) {
+		/* in-process clients share the engine's mappings */
+		return 0;
+	}
 
-	if (jack_attach_shm (&client->port_segment[ptid])) {
-		jack_error ("cannot attach port segment shared memory"
-			    " (%s)", strerror (errno));
+	if (ptid >= client->n_port_types
+	    || seg >= client->engine->port_types[ptid].n_segments) {
+		jack_error ("port segment %" PRIu32 " of type %d does not exist",
+			    seg, ptid);
 		return -1;
 	}
 
-	return 0;
+	acquire_fence ();
+
+	if (client->port_segment[ptid][seg].attached_at != MAP_FAILED) {
+		return 0;
+	}
+
+	return jack_port_segment_map (client, ptid, seg);
 }
 
 jack_client_t *
@@ -1328,8 +1737,12 @@ jack_client_open_aux (const char *client_name,
 	}
 
 	client->engine = (jack_control_t*)jack_shm_addr (&client->engine_shm);
+	jack_midi_set_overflow_arena (client->engine);
 
 	/* initialize clock source as early as possible */
+	if (client->engine->clock_source == JACK_TIMER_TSC) {
+		jack_tsc_calibration = client->engine->tsc_calibration;
+	}
 	jack_set_clock_source (client->engine->clock_source);
 
 	/* now attach the client control block */
@@ -1350,14 +1763,17 @@ jack_client_open_aux (const char *client_name,
 	jack_destroy_shm (&client->control_shm);
 
 	client->n_port_types = client->engine->n_port_types;
-	if ((client->port_segment = (jack_shm_info_t*)malloc (sizeof(jack_shm_info_t) * client->n_port_types)) == NULL) {
+	if ((client->port_segment = (jack_shm_info_t (*)[JACK_PORT_MAX_SEGMENTS])malloc (sizeof(*client->port_segment) * client->n_port_types)) == NULL) {
 		goto fail;
 	}
 
 	for (ptid = 0; ptid < client->n_port_types; ++ptid) {
-		client->port_segment[ptid].index =
-			client->engine->port_types[ptid].shm_registry_index;
-		client->port_segment[ptid].attached_at = MAP_FAILED;
+		uint32_t seg;
+		for (seg = 0; seg < JACK_PORT_MAX_SEGMENTS; ++seg) {
+			client->port_segment[ptid][seg].index =
+				client->engine->port_types[ptid].shm_registry_index[seg];
+			client->port_segment[ptid][seg].attached_at = MAP_FAILED;
+		}
 
 		/* the server will send attach events during jack_activate
 		 */
@@ -1824,6 +2240,7 @@ jack_client_process_events (jack_client_t* client)
 	JSList *node;
 	jack_port_t* port;
 	char* key = 0;
+	struct pollfd pfd;
 
 	DEBUG ("process events");
 
@@ -1970,11 +2387,67 @@ jack_client_process_events (jack_client_t* client)
 				    "engine (%s)", strerror (errno));
 			return -1;
 		}
+
+		/* the server sends notifications in batches.  a client
+		   waiting on a futex would not notice the rest of the
+		   batch until the next wakeup, so make sure it looks at
+		   the event fd again before going to sleep.
+		 */
+		if (client->wakeup_slot >= 0) {
+			pfd.fd = client->event_fd;
+			pfd.events = POLLIN;
+			if (poll (&pfd, 1, 0) == 1 && (pfd.revents & POLLIN)) {
+				control->event_pending = TRUE;
+			}
+		}
+	}
+
+	return 0;
+}
+
+
+#ifndef JACK_USE_MACH_THREADS
+
+/* parallel graph execution: count down the activation counter of each
+ * client we feed, and wake the ones for which we were the last input.
+ */
+static int
+jack_wake_downstream_clients (jack_client_t* client)
+{
+	char c = 0;
+	uint32_t i;
+
+	for (i = 0; i < client->n_downstream; i++) {
+
+		if (exchange_and_add_acq_rel (
+			    &client->engine->activation[client->downstream[i]],
+			    -1) != 1) {
+			continue;
+		}
+
+#ifdef HAVE_LINUX_FUTEX
+		if (client->wakeup_slot >= 0) {
+			jack_wakeup_signal (
+				&client->engine->wakeup[client->downstream[i]]);
+			continue;
+		}
+#endif
+
+		if (write_retry (client->downstream_fd[i], &c, sizeof(c))
+		    != sizeof(c)) {
+			DEBUG ("cannot write byte to fd %d",
+			       client->downstream_fd[i]);
+			jack_error ("cannot continue execution of the "
+				    "processing graph (%s)",
+				    strerror (errno));
+			return -1;
+		}
 	}
 
 	return 0;
 }
 
+#endif
 
 static int
 jack_wake_next_client (jack_client_t* client)
@@ -1984,8 +2457,16 @@ jack_wake_next_client (jack_client_t* client)
 	int pret = 0;
 	char c = 0;
 
-	if (write_retry (client->graph_next_fd, &c, sizeof(c))
-	    != sizeof(c)) {
+	if (client->n_downstream > 0) {
+		if (jack_wake_downstream_clients (client)) {
+			return -1;
+		}
+#ifdef HAVE_LINUX_FUTEX
+	} else if (client->wakeup_next >= 0) {
+		jack_wakeup_signal (&client->engine->wakeup[client->wakeup_next]);
+#endif
+	} else if (write_retry (client->graph_next_fd, &c, sizeof(c))
+		   != sizeof(c)) {
 		DEBUG ("cannot write byte to fd %d", client->graph_next_fd);
 		jack_error ("cannot continue execution of the "
 			    "processing graph (%s)",
@@ -2088,6 +2569,41 @@ jack_osx_event_thread_work (void* arg)
 
 #else /* !JACK_USE_MACH_THREADS */
 
+#ifdef HAVE_LINUX_FUTEX
+
+/* Sleep on our futex wakeup slot until we are woken for process(), or
+ * the server announces an event.  Returns non-zero for a process()
+ * wakeup; otherwise the caller has to look at the event fd.
+ */
+static int
+jack_client_futex_wait (jack_client_t* client)
+{
+	jack_client_control_t *control = client->control;
+	jack_wakeup_t *slot = &client->engine->wakeup[client->wakeup_slot];
+	int seq;
+
+	seq = slot->seq;
+
+	if (jack_wakeup_consume (slot)) {
+		return 1;
+	}
+
+	if (!control->event_pending && !client->wakeup_failed) {
+		/* time out once a second, like the poll(2) below */
+		if (jack_wakeup_wait (slot, seq, 1000000)) {
+			/* the server cannot wait on its slot either,
+			   and will move the graph to the FIFOs */
+			client->wakeup_failed = 1;
+		}
+	}
+
+	control->event_pending = FALSE;
+
+	return jack_wakeup_consume (slot);
+}
+
+#endif
+
 static int
 jack_client_core_wait (jack_client_t* client)
 {
@@ -2100,7 +2616,26 @@ jack_client_core_wait (jack_client_t* client)
 	       "event_fd only");
 
 	while (1) {
-		if (poll (client->pollfd, client->pollmax, 1000) < 0) {
+		int poll_timeout = 1000;
+
+#ifdef HAVE_LINUX_FUTEX
+		if (client->wakeup_slot >= 0) {
+			if (jack_client_futex_wait (client)) {
+				control->awake_at = jack_get_microseconds ();
+				DEBUG ("time to run process()\n");
+				break;
+			}
+
+			/* an event was announced, or the wait timed
+			 * out: check the event fd without blocking.
+			 * If we cannot wait on the slot, the poll is
+			 * what keeps us from spinning.
+			 */
+			poll_timeout = client->wakeup_failed ? 1 : 0;
+		}
+#endif
+
+		if (poll (client->pollfd, client->pollmax, poll_timeout) < 0) {
 			if (errno == EINTR) {
 				continue;
 			}
@@ -2162,6 +2697,12 @@ jack_client_core_wait (jack_client_t* client)
 			return 0;
 		}
 
+		if (client->wakeup_slot >= 0 &&
+		    (client->pollfd[EVENT_POLL_INDEX].revents & ~POLLIN)) {
+			DEBUG ("event fd has error status\n");
+			return -1;
+		}
+
 		if (client->graph_wait_fd >= 0 &&
 		    (client->pollfd[WAIT_POLL_INDEX].revents & POLLIN)) {
 			DEBUG ("time to run process()\n");
@@ -2309,6 +2850,10 @@ void jack_cycle_signal (jack_client_t* client, int status)
 {
 	client->control->last_status = status;
 
+	/* connections retired before this call may now be freed */
+	exchange_and_add_seq_cst (&client->process_cycles, 1);
+	full_fence ();
+
 	/* SECTION ONE: HOUSEKEEPING/CLEANUP FROM LAST DATA PROCESSING */
 
 	/* housekeeping/cleanup after data processing */
@@ -2554,14 +3099,17 @@ jack_client_close_aux (jack_client_t *client)
 			client->control = NULL;
 		}
 		if (client->engine) {
+			jack_midi_release_overflow_arena (client->engine);
 			jack_release_shm (&client->engine_shm);
 			client->engine = NULL;
 		}
 
 		if (client->port_segment) {
 			jack_port_type_id_t ptid;
+			uint32_t seg;
 			for (ptid = 0; ptid < client->n_port_types; ++ptid)
-				jack_release_shm (&client->port_segment[ptid]);
+				for (seg = 0; seg < JACK_PORT_MAX_SEGMENTS; ++seg)
+					jack_release_shm (&client->port_segment[ptid][seg]);
 			free (client->port_segment);
 			client->port_segment = NULL;
 		}
@@ -2574,6 +3122,8 @@ jack_client_close_aux (jack_client_t *client)
 		if (client->graph_next_fd >= 0) {
 			close (client->graph_next_fd);
 		}
+
+		jack_close_downstream_fifos (client);
 #endif
 
 		close (client->event_fd);
@@ -2657,6 +3207,109 @@ jack_connect (jack_client_t *client, const char *source_port,
 	return jack_client_deliver_request (client, &req);
 }
 
+/* Send one ConnectPortsBatch request for ops[0..count-1], which must
+ * fit in JACK_CONNECT_BATCH_MAX_BYTES.
+ */
+static int
+jack_connect_batch_chunk (jack_client_t *client,
+			  const jack_connection_op_t *ops,
+			  unsigned int count, size_t nbytes, int *results)
+{
+	jack_request_t req;
+	int8_t *status;
+	char *buf, *p;
+	size_t len;
+	unsigned int i;
+	int ret;
+
+	if ((buf = (char*)malloc (nbytes)) == NULL
+	    || (status = (int8_t*)malloc (count)) == NULL) {
+		free (buf);
+		return -1;
+	}
+
+	for (i = 0, p = buf; i < count; i++) {
+		*p++ = ops[i].connect ? 1 : 0;
+		len = strnlen (ops[i].source_port, JACK_PORT_NAME_SIZE - 1);
+		memcpy (p, ops[i].source_port, len);
+		p += len;
+		*p++ = '\0';
+		len = strnlen (ops[i].destination_port, JACK_PORT_NAME_SIZE - 1);
+		memcpy (p, ops[i].destination_port, len);
+		p += len;
+		*p++ = '\0';
+	}
+
+	VALGRIND_MEMSET (&req, 0, sizeof(req));
+
+	req.type = ConnectPortsBatch;
+	req.x.connect_batch.count = count;
+	req.x.connect_batch.nbytes = nbytes;
+	req.x.connect_batch.ops = buf;
+	req.x.connect_batch.results = status;
+
+	if ((ret = jack_client_deliver_request (client, &req)) >= 0) {
+		ret = 0;
+		for (i = 0; i < count; i++) {
+			if (results) {
+				results[i] = status[i];
+			}
+			if (status[i] < 0) {
+				ret++;
+			}
+		}
+	}
+
+	free (status);
+	free (buf);
+
+	return ret;
+}
+
+/* Apply `count' connections and disconnections with as few server
+ * round trips as possible: the server sorts the graph and collects
+ * the clients' replies once per batch instead of once per connection.
+ * If `results' is not NULL it receives the outcome of each op, as
+ * jack_connect() or jack_disconnect() would have returned it.  Returns
+ * the number of ops that failed (a connection that already exists is
+ * not a failure), or -1 if the batch could not be delivered.
+ */
+int
+jack_connect_batch (jack_client_t *client, const jack_connection_op_t *ops,
+		    unsigned int count, int *results)
+{
+	unsigned int first = 0, i;
+	size_t nbytes = 0, len = 0;
+	int ret, failed = 0;
+
+	for (i = 0; i <= count; i++) {
+
+		if (i < count) {
+			len = 1 + strnlen (ops[i].source_port, JACK_PORT_NAME_SIZE - 1) + 1
+			      + strnlen (ops[i].destination_port, JACK_PORT_NAME_SIZE - 1) + 1;
+			if (nbytes + len <= JACK_CONNECT_BATCH_MAX_BYTES) {
+				nbytes += len;
+				continue;
+			}
+		}
+
+		if (i > first) {
+			ret = jack_connect_batch_chunk (client, ops + first,
+							i - first, nbytes,
+							results ? results + first : NULL);
+			if (ret < 0) {
+				return -1;
+			}
+			failed += ret;
+		}
+
+		first = i;
+		nbytes = len;
+	}
+
+	return failed;
+}
+
 int
 jack_port_disconnect (jack_client_t *client, jack_port_t *port)
 {
@@ -2938,13 +3591,28 @@ char *
 jack_get_client_name_by_uuid (jack_client_t *client, const char *uuid_str)
 {
 	jack_request_t request;
+	char reply[JACK_CHANNEL_MAX_PAYLOAD];
+	uint32_t reply_size;
+	int32_t status;
+	jack_uuid_t uuid;
 
-	VALGRIND_MEMSET (&request, 0, sizeof(request));
-
-	if (jack_uuid_parse (uuid_str, &request.x.client_id) != 0) {
+	if (jack_uuid_parse (uuid_str, &uuid) != 0) {
 		return NULL;
 	}
 
+	if (jack_channel_request (client, GetClientByUUID, &uuid, sizeof(uuid),
+				  &status, reply, &reply_size) == 0) {
+		if (status || reply_size == 0) {
+			return NULL;
+		}
+		reply[reply_size - 1] = '\0';
+		return strdup (reply);
+	}
+
+	VALGRIND_MEMSET (&request, 0, sizeof(request));
+
+	jack_uuid_copy (&request.x.client_id, uuid);
+
 	request.type = GetClientByUUID;
 	if ( jack_client_deliver_request (client, &request)) {
 		return NULL;
@@ -2958,11 +3626,26 @@ jack_get_uuid_for_client_name (jack_client_t *client, const char *client_name)
 {
 	jack_request_t request;
 	size_t len = strlen (client_name) + 1;
+	char reply[JACK_CHANNEL_MAX_PAYLOAD];
+	uint32_t reply_size;
+	int32_t status;
 
 	if ( len > sizeof(request.x.name) ) {
 		return NULL;
 	}
 
+	if (jack_channel_request (client, GetUUIDByClientName, client_name, len,
+				  &status, reply, &reply_size) == 0) {
+		jack_uuid_t uuid;
+		if (status || reply_size != sizeof(uuid)) {
+			return NULL;
+		}
+		memcpy (&uuid, reply, sizeof(uuid));
+		char buf[37];
+		jack_uuid_unparse (uuid, buf);
+		return strdup (buf);
+	}
+
 	VALGRIND_MEMSET (&request, 0, sizeof(request));
 
 	request.type = GetUUIDByClientName;
@@ -3008,80 +3691,8 @@ jack_get_ports (jack_client_t *client,
 		const char *type_name_pattern,
 		unsigned long flags)
 {
-	jack_control_t *engine;
-	const char **matching_ports;
-	unsigned long match_cnt;
-	jack_port_shared_t *psp;
-	unsigned long i;
-	regex_t port_regex;
-	regex_t type_regex;
-	int matching;
-
-	engine = client->engine;
-
-	if (port_name_pattern && port_name_pattern[0]) {
-		regcomp (&port_regex, port_name_pattern,
-			 REG_EXTENDED | REG_NOSUB);
-	}
-	if (type_name_pattern && type_name_pattern[0]) {
-		regcomp (&type_regex, type_name_pattern,
-			 REG_EXTENDED | REG_NOSUB);
-	}
-
-	psp = engine->ports;
-	match_cnt = 0;
-
-	if ((matching_ports = (const char**)malloc (sizeof(char *) * (engine->port_max + 1))) == NULL) {
-		return NULL;
-	}
-
-	for (i = 0; i < engine->port_max; i++) {
-		matching = 1;
-
-		if (!psp[i].in_use) {
-			continue;
-		}
-
-		if (flags) {
-			if ((psp[i].flags & flags) != flags) {
-				matching = 0;
-			}
-		}
-
-		if (matching && port_name_pattern && port_name_pattern[0]) {
-			if (regexec (&port_regex, psp[i].name, 0, NULL, 0)) {
-				matching = 0;
-			}
-		}
-
-		if (matching && type_name_pattern && type_name_pattern[0]) {
-			jack_port_type_id_t ptid = psp[i].ptype_id;
-			if (regexec (&type_regex,
-				     engine->port_types[ptid].type_name,
-				     0, NULL, 0)) {
-				matching = 0;
-			}
-		}
-
-		if (matching) {
-			matching_ports[match_cnt++] = psp[i].name;
-		}
-	}
-	if (port_name_pattern && port_name_pattern[0]) {
-		regfree (&port_regex);
-	}
-	if (type_name_pattern && type_name_pattern[0]) {
-		regfree (&type_regex);
-	}
-
-	if (match_cnt == 0) {
-		free (matching_ports);
-		matching_ports = 0;
-	} else {
-		matching_ports[match_cnt] = 0;
-	}
-
-	return matching_ports;
+	return jack_port_query_cached (client, port_name_pattern,
+				       type_name_pattern, flags);
 }
 
 float
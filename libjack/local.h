@@ -15,16 +15,48 @@ struct _jack_client {
 	int request_fd;
 	int upstream_is_jackd;
 
+	/* parallel graph execution: the FIFOs of the clients we feed,
+	 * and the activation counters that guard them.
+	 */
+	uint32_t n_downstream;
+	uint32_t downstream[JACK_PARALLEL_MAX_CLIENTS];
+	int downstream_fd[JACK_PARALLEL_MAX_CLIENTS];
+
+	/* futex wakeups: the slot we sleep on and the one we wake
+	 * after process(), or -1 when the FIFOs are in use.
+	 * wakeup_failed is set when we cannot sleep on the slot; we
+	 * then poll until the server moves the graph to the FIFOs.
+	 */
+	int wakeup_slot;
+	int wakeup_next;
+	int wakeup_failed;
+
 	/* these two are copied from the engine when the
 	 * client is created.
 	 */
 
 	jack_port_type_id_t n_port_types;
-	jack_shm_info_t*    port_segment;
+	jack_shm_info_t   (*port_segment)[JACK_PORT_MAX_SEGMENTS];
 
 	JSList *ports;
 	JSList *ports_ext;
 
+	/* compiled jack_get_ports() queries, most recently used first */
+	JSList *port_queries;
+	pthread_mutex_t port_query_lock;
+
+	/* connections dropped while process() may still be looking at
+	 * them (see jack_client_retire_connection()), and the count of
+	 * process() calls our process thread has returned from */
+	JSList *retired_connections;
+	volatile _Atomic_word process_cycles;
+
+	/* shared memory request channel: one query in flight at a time.
+	   Once we failed to wait for a reply, the socket is used. */
+	pthread_mutex_t channel_lock;
+	uint32_t channel_id;
+	int channel_failed;
+
 	pthread_t thread;
 	char fifo_prefix[PATH_MAX + 1];
 	void (*on_shutdown)(void *arg);
@@ -91,13 +123,35 @@ struct _jack_client {
 
 extern int jack_client_deliver_request(const jack_client_t *client,
 				       jack_request_t *req);
+extern int jack_channel_request(jack_client_t *client, uint32_t type,
+				const void *payload, uint32_t size,
+				int32_t *status, void *reply,
+				uint32_t *reply_size);
 extern jack_port_t *jack_port_new(const jack_client_t *client,
 				  jack_port_id_t port_id,
 				  jack_control_t *control);
+extern int jack_port_segment_attach(jack_client_t *client,
+				    jack_port_type_id_t ptid, uint32_t seg);
+extern void jack_port_set_buffer_limit(jack_port_t *port);
+
+/* precompiled port queries, see portquery.c */
+typedef struct _jack_port_query jack_port_query_t;
+
+extern jack_port_query_t *jack_port_query_new(jack_client_t *client,
+					      const char *port_name_pattern,
+					      const char *type_name_pattern,
+					      unsigned long flags);
+extern const char **jack_port_query_run(jack_port_query_t *query);
+extern void jack_port_query_free(jack_port_query_t *query);
+extern const char **jack_port_query_cached(jack_client_t *client,
+					   const char *port_name_pattern,
+					   const char *type_name_pattern,
+					   unsigned long flags);
+extern void jack_port_query_cache_free(jack_client_t *client);
 
 extern void *jack_zero_filled_buffer;
 
-extern void jack_set_clock_source (jack_timer_type_t);
+extern int jack_set_clock_source (jack_timer_type_t);
 extern char* jack_server_dir(const char* server_name, char* server_dir);
 
 #endif /* __jack_libjack_local_h__ */
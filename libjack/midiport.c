@@ -25,6 +25,7 @@
 #include <jack/jack.h>
 #include <jack/midiport.h>
 
+#include "internal.h"
 #include "port.h"
 
 enum { MIDI_INLINE_MAX = 4 }; /* 4 bytes for default event size */
@@ -35,8 +36,14 @@ typedef struct _jack_midi_port_info_private {
 	uint32_t event_count;           /**< Number of events stored in this buffer */
 	jack_nframes_t last_write_loc;  /**< Used for both writing and mixdown */
 	uint32_t events_lost;           /**< Number of events lost in this buffer */
+	uint32_t limit;                 /**< Size the buffer may grow to */
+	uint32_t moved_to;              /**< Overflow arena offset + 1, or 0 */
+	uint32_t moved_cycle;           /**< Engine cycle it was moved in */
 } POST_PACKED_STRUCTURE jack_midi_port_info_private_t;
 
+/* A full buffer may grow, by default, to this many times its size. */
+#define JACK_MIDI_DEFAULT_GROWTH 8
+
 typedef struct _jack_midi_port_internal_event {
 	uint16_t time;  /* offset within buffer limit to 64k */
 	uint16_t size;  /* event size limited to 64k */
@@ -52,6 +59,144 @@ jack_midi_internal_event_size ()
 	return sizeof(jack_midi_port_internal_event_t);
 }
 
+/* the control segment of the server we talk to, for the overflow
+   arena and the cycle count */
+static jack_control_t *midi_control;
+
+void
+jack_midi_set_overflow_arena (jack_control_t *control)
+{
+	midi_control = control;
+}
+
+void
+jack_midi_release_overflow_arena (jack_control_t *control)
+{
+	if (midi_control == control) {
+		midi_control = NULL;
+	}
+}
+
+/* The buffer holding the events of `port_buffer', which is somewhere
+ * in the overflow arena if it has grown during this cycle.
+ */
+static inline jack_midi_port_info_private_t *
+jack_midi_buffer_info (void *port_buffer)
+{
+	jack_midi_port_info_private_t *info =
+		(jack_midi_port_info_private_t*)port_buffer;
+
+	if (info->moved_to && midi_control
+	    && info->moved_cycle == midi_control->cycle_count) {
+		return (jack_midi_port_info_private_t*)
+		       (jack_midi_overflow_arena (midi_control)->data
+			+ info->moved_to - 1);
+	}
+
+	return info;
+}
+
+/* Room for the data of one more event in `info', were it
+ * `buffer_size' bytes long.
+ */
+static size_t
+jack_midi_space (const jack_midi_port_info_private_t *info,
+		 size_t buffer_size)
+{
+	/* (event_count + 1) below accounts for jack_midi_port_internal_event_t
+	 * which would be needed to store the next event */
+	size_t used_size = sizeof(jack_midi_port_info_private_t)
+			   + info->last_write_loc
+			   + ((info->event_count + 1)
+			      * sizeof(jack_midi_port_internal_event_t));
+
+	if (used_size > buffer_size) {
+		return 0;
+	} else if ((buffer_size - used_size) < MIDI_INLINE_MAX) {
+		return MIDI_INLINE_MAX;
+	} else {
+		return buffer_size - used_size;
+	}
+}
+
+/* Move the full buffer `info' of `port_buffer' into a block of the
+ * overflow arena with room for an event of `data_size' bytes.  The
+ * block is at least twice as big, so a burst moves the buffer only a
+ * few times.  Returns the moved buffer, or NULL if the port's limit or
+ * the arena would be exceeded.
+ */
+static jack_midi_port_info_private_t *
+jack_midi_buffer_grow (void *port_buffer,
+		       jack_midi_port_info_private_t *info,
+		       size_t data_size)
+{
+	jack_midi_port_info_private_t *orig =
+		(jack_midi_port_info_private_t*)port_buffer;
+	jack_midi_port_info_private_t *moved;
+	jack_midi_port_internal_event_t *events;
+	jack_midi_overflow_t *arena;
+	uint32_t size, offset, delta, i;
+	char *block;
+
+	if (midi_control == NULL) {
+		return NULL;
+	}
+
+	arena = jack_midi_overflow_arena (midi_control);
+
+	size = 2 * info->buffer_size;
+	while (jack_midi_space (info, size) < data_size) {
+		if (size > orig->limit) {
+			return NULL;
+		}
+		size *= 2;
+	}
+	size = (size + 7) & ~7;
+	if (size > orig->limit) {
+		return NULL;
+	}
+
+	offset = __atomic_fetch_add (&arena->used, size, __ATOMIC_RELAXED);
+	if (offset > arena->size || arena->size - offset < size) {
+		return NULL;
+	}
+
+	block = arena->data + offset;
+	moved = (jack_midi_port_info_private_t*)block;
+	*moved = *info;
+	moved->buffer_size = size;
+	moved->moved_to = 0;
+
+	/* the event table stays at the front, the data at the back */
+	events = (jack_midi_port_internal_event_t*)(moved + 1);
+	memcpy (events, info + 1,
+		info->event_count * sizeof(jack_midi_port_internal_event_t));
+	memcpy (block + size - 1 - info->last_write_loc,
+		(char*)info + info->buffer_size - 1 - info->last_write_loc,
+		info->last_write_loc);
+
+	delta = size - info->buffer_size;
+	for (i = 0; i < info->event_count; ++i) {
+		if (events[i].size > MIDI_INLINE_MAX) {
+			events[i].byte_offset += delta;
+		}
+	}
+
+	orig->moved_to = offset + 1;
+	orig->moved_cycle = midi_control->cycle_count;
+
+	return moved;
+}
+
+void
+jack_midi_buffer_set_limit (void *port_buffer, size_t bytes)
+{
+	jack_midi_port_info_private_t *info =
+		(jack_midi_port_info_private_t*)port_buffer;
+
+	info->limit = bytes > info->buffer_size ? bytes : info->buffer_size;
+}
+
 static inline jack_midi_data_t*
 jack_midi_event_data (void* port_buffer,
 		      const jack_midi_port_internal_event_t* event)
@@ -79,6 +224,9 @@ jack_midi_buffer_init (void  *port_buffer,
 	info->event_count = 0;
 	info->last_write_loc = 0;
 	info->events_lost = 0;
+	info->limit = JACK_MIDI_DEFAULT_GROWTH * buffer_size;
+	info->moved_to = 0;
+	info->moved_cycle = 0;
 }
 
 
@@ -86,7 +234,7 @@ uint32_t
 jack_midi_get_event_count (void           *port_buffer)
 {
 	jack_midi_port_info_private_t *info =
-		(jack_midi_port_info_private_t*)port_buffer;
+		jack_midi_buffer_info (port_buffer);
 
 	return info->event_count;
 }
@@ -99,7 +247,7 @@ jack_midi_event_get (jack_midi_event_t *event,
 {
 	jack_midi_port_internal_event_t *port_event;
 	jack_midi_port_info_private_t *info =
-		(jack_midi_port_info_private_t*)port_buffer;
+		jack_midi_buffer_info (port_buffer);
 
 	if (event_idx >= info->event_count)
 #ifdef ENODATA
@@ -112,7 +260,7 @@ jack_midi_event_get (jack_midi_event_t *event,
 	port_event += event_idx;
 	event->time = port_event->time;
 	event->size = port_event->size;
-	event->buffer = jack_midi_event_data (port_buffer, port_event);
+	event->buffer = jack_midi_event_data (info, port_event);
 
 	return 0;
 }
@@ -121,25 +269,36 @@ jack_midi_event_get (jack_midi_event_t *event,
 size_t
 jack_midi_max_event_size (void           *port_buffer)
 {
-	jack_midi_port_info_private_t *info =
+	jack_midi_port_info_private_t *orig =
 		(jack_midi_port_info_private_t*)port_buffer;
-	size_t buffer_size =
-		info->buffer_size;
-
-	/* (event_count + 1) below accounts for jack_midi_port_internal_event_t
-	 * which would be needed to store the next event */
-	size_t used_size = sizeof(jack_midi_port_info_private_t)
-			   + info->last_write_loc
-			   + ((info->event_count + 1)
-			      * sizeof(jack_midi_port_internal_event_t));
+	jack_midi_port_info_private_t *info =
+		jack_midi_buffer_info (port_buffer);
+	size_t space = jack_midi_space (info, info->buffer_size);
+
+	/* count what growing into the overflow arena would give */
+	if (midi_control) {
+		jack_midi_overflow_t *arena =
+			jack_midi_overflow_arena (midi_control);
+		uint32_t used = arena->used;
+		uint32_t size = orig->limit & ~7;
+
+		if (used > arena->size) {
+			used = arena->size;
+		}
+		if (size > arena->size - used) {
+			size = arena->size - used;
+		}
+		if (size > info->buffer_size
+		    && jack_midi_space (info, size) > space) {
+			space = jack_midi_space (info, size);
+		}
+	}
 
-	if (used_size > buffer_size) {
-		return 0;
-	} else if ((buffer_size - used_size) < MIDI_INLINE_MAX) {
-		return MIDI_INLINE_MAX;
-	} else {
-		return buffer_size - used_size;
+	if (space > UINT16_MAX) {
+		space = UINT16_MAX;     /* jack_midi_port_internal_event_t.size */
 	}
+
+	return space;
 }
 
 
@@ -148,14 +307,14 @@ jack_midi_event_reserve (void           *port_buffer,
 			 jack_nframes_t time,
 			 size_t data_size)
 {
-	jack_midi_data_t *retbuf = (jack_midi_data_t*)port_buffer;
+	jack_midi_data_t *retbuf;
 
 	jack_midi_port_info_private_t *info =
-		(jack_midi_port_info_private_t*)port_buffer;
+		jack_midi_buffer_info (port_buffer);
+	jack_midi_port_info_private_t *grown;
 	jack_midi_port_internal_event_t *event_buffer =
 		(jack_midi_port_internal_event_t*)(info + 1);
-	size_t buffer_size =
-		info->buffer_size;
+	size_t buffer_size;
 
 	if (time < 0 || time >= info->nframes) {
 		goto failed;
@@ -165,14 +324,27 @@ jack_midi_event_reserve (void           *port_buffer,
 		goto failed;
 	}
 
-	/* Check if data_size is >0 and there is enough space in the buffer for the event. */
-	if (data_size <= 0) {
+	/* Check if data_size is >0 and there is enough space in the buffer for
+	 * the event.  If there is not, move the buffer to the overflow arena. */
+	if (data_size <= 0 || data_size > UINT16_MAX) {
 		goto failed; // return NULL?
-	} else if (jack_midi_max_event_size (port_buffer) < data_size) {
-		goto failed;
-	} else {
+	}
+
+	if (jack_midi_space (info, info->buffer_size) < data_size) {
+		if ((grown = jack_midi_buffer_grow (port_buffer, info,
+						    data_size)) == NULL) {
+			goto failed;
+		}
+		info = grown;
+		event_buffer = (jack_midi_port_internal_event_t*)(info + 1);
+	}
+
+	{
 		jack_midi_port_internal_event_t *event = &event_buffer[info->event_count];
 
+		retbuf = (jack_midi_data_t*)info;
+		buffer_size = info->buffer_size;
+
 		event->time = time;
 		event->size = data_size;
 		if (data_size <= MIDI_INLINE_MAX) {
@@ -224,96 +396,161 @@ jack_midi_clear_buffer (void           *port_buffer)
 	info->event_count = 0;
 	info->last_write_loc = 0;
 	info->events_lost = 0;
+	info->moved_to = 0;
+}
+
+
+/* A source being merged by jack_midi_port_mixdown(): its next unread
+ * event, the number left, and its place in the connection list, which
+ * breaks ties between events with the same time.
+ */
+typedef struct _jack_midi_merge_source {
+	jack_midi_port_info_private_t   *info;
+	jack_midi_port_internal_event_t *event;
+	uint32_t left;
+	uint32_t order;
+} jack_midi_merge_source_t;
+
+static inline int
+jack_midi_merge_before (const jack_midi_merge_source_t *a,
+			const jack_midi_merge_source_t *b)
+{
+	return a->event->time < b->event->time
+	       || (a->event->time == b->event->time && a->order < b->order);
+}
+
+/* Restore the heap order of `heap[0..n)' below `i'. */
+static void
+jack_midi_merge_sift (jack_midi_merge_source_t *heap, uint32_t n, uint32_t i)
+{
+	jack_midi_merge_source_t tmp = heap[i];
+	uint32_t child;
+
+	while ((child = 2 * i + 1) < n) {
+		if (child + 1 < n
+		    && jack_midi_merge_before (&heap[child + 1], &heap[child])) {
+			child++;
+		}
+		if (!jack_midi_merge_before (&heap[child], &tmp)) {
+			break;
+		}
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = tmp;
 }
 
+/* Write the next event of `src' to `port_buffer' and step past it. */
+static inline int
+jack_midi_merge_take (void *port_buffer, jack_midi_merge_source_t *src)
+{
+	jack_midi_port_internal_event_t *event = src->event++;
+
+	src->left--;
+	return jack_midi_event_write (
+		port_buffer,
+		event->time,
+		jack_midi_event_data (src->info, event),
+		event->size);
+}
 
 /* jack_midi_port_functions.mixdown */
 static void
 jack_midi_port_mixdown (jack_port_t    *port, jack_nframes_t nframes)
 {
-	JSList         *node;
+	JSList         *connections, *node;
 	jack_port_t    *input;
 	jack_nframes_t num_events = 0;
 	jack_nframes_t i          = 0;
 	int err        = 0;
 	jack_nframes_t lost_events = 0;
+	uint32_t nconnections = 0;
+	uint32_t n = 0;
+	void *out_buffer = jack_port_buffer (port);
 
-	/* The next (single) event to mix in to the buffer */
-	jack_midi_port_info_private_t   *earliest_info;
-	jack_midi_port_internal_event_t *earliest_event;
-	jack_midi_data_t                *earliest_buffer;
-
-	jack_midi_port_info_private_t   *in_info;       /* For finding next event */
-	jack_midi_port_internal_event_t *in_events;     /* Corresponds to in_info */
+	jack_midi_port_info_private_t   *in_info;
 	jack_midi_port_info_private_t   *out_info;      /* Output 'buffer' */
 
 	jack_midi_clear_buffer (port->mix_buffer);
 
-	out_info = (jack_midi_port_info_private_t*)port->mix_buffer;
-
-	/* This function uses jack_midi_port_info_private_t.last_write_loc of the
-	 * source ports to store indices of the last event read from that buffer
-	 * so far.  This is OK because last_write_loc is used when writing events
-	 * to a buffer, which at this stage is already complete so the value
-	 * can be safely smashed. */
-
-	/* Iterate through all connections to see how many events we need to mix,
-	 * and initialise their 'last event read' (last_write_loc) to 0 */
-	for (node = port->connections; node; node = jack_slist_next (node)) {
-		input = (jack_port_t*)node->data;
-		in_info =
-			(jack_midi_port_info_private_t*)jack_output_port_buffer (input);
-		num_events += in_info->event_count;
-		lost_events += in_info->events_lost;
-		in_info->last_write_loc = 0;
+	/* connections may be made meanwhile, so size the heap and
+	 * fill it from the same list */
+	connections = port->connections;
+
+	for (node = connections; node; node = jack_slist_next (node)) {
+		nconnections++;
 	}
 
-	/* Write the events in the order of their timestamps */
-	for (i = 0; i < num_events; ++i) {
-		earliest_info = NULL;
-		earliest_event = NULL;
-		earliest_buffer = NULL;
-
-		/* Find the earliest unread event, to mix next
-		 * (search for an event earlier than earliest_event) */
-		for (node = port->connections; node; node = jack_slist_next (node)) {
-			in_info = (jack_midi_port_info_private_t*)
-				  jack_output_port_buffer (((jack_port_t*)node->data));
-			in_events = (jack_midi_port_internal_event_t*)(in_info + 1);
-
-			/* If there are unread events left in this port.. */
-			if (in_info->event_count > in_info->last_write_loc) {
-				/* .. and this event is the new earliest .. */
-				/* NOTE: that's why we compare time with <, not <= */
-				if (earliest_info == NULL
-				    || in_events[in_info->last_write_loc].time
-				    < earliest_event->time) {
-					/* .. then set this event as the next earliest */
-					earliest_info = in_info;
-					earliest_event = (jack_midi_port_internal_event_t*)
-							 (&in_events[in_info->last_write_loc]);
-				}
+	{
+		/* Sources with events to mix.  Ties between sources
+		 * go to the earlier connection, as the events of each
+		 * source are already in time order. */
+		jack_midi_merge_source_t heap[nconnections];
+
+		for (node = connections; node; node = jack_slist_next (node)) {
+			input = (jack_port_t*)node->data;
+			in_info = jack_midi_buffer_info (jack_output_port_buffer (input));
+			num_events += in_info->event_count;
+			lost_events += in_info->events_lost;
+			if (in_info->event_count) {
+				heap[n].info = in_info;
+				heap[n].event = (jack_midi_port_internal_event_t*)(in_info + 1);
+				heap[n].left = in_info->event_count;
+				heap[n].order = n;
+				n++;
 			}
 		}
 
-		if (earliest_info && earliest_event) {
-			earliest_buffer = (jack_midi_data_t*)earliest_info;
-
-			/* Write event to output */
-			err = jack_midi_event_write (
-				jack_port_buffer (port),
-				earliest_event->time,
-				jack_midi_event_data (earliest_buffer, earliest_event),
-				earliest_event->size);
-
-			earliest_info->last_write_loc++;
+		/* Write the events in the order of their timestamps */
+		if (n == 2) {
+			/* a plain two-way merge */
+			while (heap[0].left && heap[1].left) {
+				err = jack_midi_merge_take (
+					out_buffer,
+					&heap[jack_midi_merge_before (&heap[1], &heap[0])]);
+				if (err) {
+					goto lost;
+				}
+				i++;
+			}
+			if (heap[0].left == 0) {
+				heap[0] = heap[1];
+			}
+			n = 1;
+		} else if (n > 2) {
+			for (i = n / 2; i > 0; --i) {
+				jack_midi_merge_sift (heap, n, i - 1);
+			}
+			i = 0;
+			while (n > 1) {
+				err = jack_midi_merge_take (out_buffer, &heap[0]);
+				if (err) {
+					goto lost;
+				}
+				i++;
+				if (heap[0].left == 0) {
+					heap[0] = heap[--n];
+				}
+				jack_midi_merge_sift (heap, n, 0);
+			}
+		}
 
+		/* whatever is left comes from a single source */
+		while (n == 1 && heap[0].left) {
+			err = jack_midi_merge_take (out_buffer, &heap[0]);
 			if (err) {
-				out_info->events_lost = num_events - i;
-				break;
+				goto lost;
 			}
+			i++;
 		}
 	}
+
+lost:
+	/* writing may have moved the buffer to the overflow arena */
+	out_info = jack_midi_buffer_info (port->mix_buffer);
+	if (err) {
+		out_info->events_lost = num_events - i;
+	}
 	assert (out_info->event_count == num_events - out_info->events_lost);
 
 	// inherit total lost events count from all connected ports.
@@ -324,7 +561,7 @@ jack_midi_port_mixdown (jack_port_t    *port, jack_nframes_t nframes)
 uint32_t
 jack_midi_get_lost_event_count (void           *port_buffer)
 {
-	return ((jack_midi_port_info_private_t*)port_buffer)->events_lost;
+	return jack_midi_buffer_info (port_buffer)->events_lost;
 }
 
 jack_port_functions_t jack_builtin_midi_functions = {
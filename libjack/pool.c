@@ -23,25 +23,323 @@
 #define _XOPEN_SOURCE 600
 #endif
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include <config.h>
 
 #include "pool.h"
 
-/* XXX need RT-pool based allocator here */
+/* Real-time memory pool.
+ *
+ * Blocks come in power-of-two size classes from 64 bytes up to
+ * 64 kilobytes.  Each class owns a few chunks of memory that
+ * are allocated, mlocked and pre-faulted outside the real-time path,
+ * either explicitly with jack_pool_reserve() or when jack_pool_alloc()
+ * finds a class empty.  Free blocks sit on a lock-free LIFO per class.
+ * The list head packs a block index with a tag that is bumped on every
+ * update, so a block that is popped and pushed back between another
+ * thread's load and compare-and-swap cannot fool it (ABA).
+ *
+ * Every block is preceded by a cache line sized header, which keeps
+ * the 64 byte alignment the old posix_memalign() allocator gave and
+ * tells jack_pool_release() where the block came from.
+ */
+
+#define JACK_POOL_MIN_SHIFT  6                  /* 64 bytes */
+#define JACK_POOL_HEADER     64
+#define JACK_POOL_CHUNK      (256 * 1024)       /* bytes per chunk, at least */
+#define JACK_POOL_MAX_CHUNKS 64                 /* per class */
+#define JACK_POOL_HEAP       (-1)               /* block is from malloc */
+
+typedef struct {
+	int32_t size_class;
+	uint32_t index;                 /* 1-based, within the class */
+	volatile uint32_t next;         /* free list link, 0 = end */
+} jack_pool_header_t;
+
+typedef struct {
+	volatile uint64_t head;         /* tag << 32 | index of first free block */
+	char *chunks[JACK_POOL_MAX_CHUNKS];
+	volatile uint32_t n_chunks;
+	uint32_t blocks_per_chunk;
+	volatile uint32_t blocks;
+	volatile uint32_t in_use;
+	volatile uint32_t high_water;
+	volatile uint32_t failures;
+} jack_pool_class_t;
+
+static jack_pool_class_t pool_classes[JACK_POOL_CLASSES];
+static pthread_mutex_t pool_grow_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile uint32_t pool_heap_allocs;
+static volatile uint32_t pool_locked_bytes;
+
+static inline size_t
+jack_pool_block_size (int c)
+{
+	return (size_t)1 << (c + JACK_POOL_MIN_SHIFT);
+}
+
+static inline size_t
+jack_pool_stride (int c)
+{
+	return JACK_POOL_HEADER + jack_pool_block_size (c);
+}
+
+static inline int
+jack_pool_class_for (size_t bytes)
+{
+	int c;
+
+	for (c = 0; c < JACK_POOL_CLASSES; c++) {
+		if (bytes <= jack_pool_block_size (c)) {
+			return c;
+		}
+	}
+	return -1;
+}
+
+static inline jack_pool_header_t *
+jack_pool_header_at (jack_pool_class_t *pc, int c, uint32_t index)
+{
+	uint32_t i = index - 1;
+
+	return (jack_pool_header_t*)
+	       (pc->chunks[i / pc->blocks_per_chunk]
+		+ (i % pc->blocks_per_chunk) * jack_pool_stride (c));
+}
+
+static void
+jack_pool_push (jack_pool_class_t *pc, jack_pool_header_t *h)
+{
+	uint64_t head, next;
+
+	head = __atomic_load_n (&pc->head, __ATOMIC_ACQUIRE);
+	do {
+		__atomic_store_n (&h->next, (uint32_t)head, __ATOMIC_RELAXED);
+		next = (((head >> 32) + 1) << 32) | h->index;
+	} while (!__atomic_compare_exchange_n (&pc->head, &head, next, 1,
+					       __ATOMIC_RELEASE,
+					       __ATOMIC_ACQUIRE));
+}
+
+static jack_pool_header_t *
+jack_pool_pop (jack_pool_class_t *pc, int c)
+{
+	jack_pool_header_t *h;
+	uint64_t head, next;
+
+	head = __atomic_load_n (&pc->head, __ATOMIC_ACQUIRE);
+	do {
+		if ((uint32_t)head == 0) {
+			return NULL;
+		}
+		/* blocks are never returned to the system, so reading
+		   the link of a block that someone else just took is
+		   harmless: the tag makes the swap below fail */
+		h = jack_pool_header_at (pc, c, (uint32_t)head);
+		next = (((head >> 32) + 1) << 32)
+		       | __atomic_load_n (&h->next, __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n (&pc->head, &head, next, 1,
+					       __ATOMIC_ACQUIRE,
+					       __ATOMIC_ACQUIRE));
+
+	return h;
+}
+
+/* Add one chunk to class `c'.  Not real-time safe. */
+static int
+jack_pool_grow (int c)
+{
+	jack_pool_class_t *pc = &pool_classes[c];
+	size_t stride = jack_pool_stride (c);
+	size_t bytes;
+	uint32_t n, i, base;
+	char *chunk;
+	void *m;
+
+	pthread_mutex_lock (&pool_grow_lock);
+
+	if (pc->n_chunks == JACK_POOL_MAX_CHUNKS) {
+		pthread_mutex_unlock (&pool_grow_lock);
+		return -1;
+	}
+
+	if (pc->blocks_per_chunk == 0) {
+		pc->blocks_per_chunk = JACK_POOL_CHUNK / stride;
+		if (pc->blocks_per_chunk == 0) {
+			pc->blocks_per_chunk = 1;
+		}
+	}
+	n = pc->blocks_per_chunk;
+	bytes = n * stride;
+
+#ifdef HAVE_POSIX_MEMALIGN
+	if (posix_memalign (&m, 4096, bytes)) {
+		m = NULL;
+	}
+#else
+	m = malloc (bytes);
+#endif  /* HAVE_POSIX_MEMALIGN */
+
+	if ((chunk = (char*)m) == NULL) {
+		pthread_mutex_unlock (&pool_grow_lock);
+		return -1;
+	}
+
+	/* touch every page now rather than in a process() callback */
+	memset (chunk, 0, bytes);
+	if (mlock (chunk, bytes) == 0) {
+		__atomic_add_fetch (&pool_locked_bytes, bytes, __ATOMIC_RELAXED);
+	}
+
+	base = pc->n_chunks * n;
+	pc->chunks[pc->n_chunks] = chunk;
+	__atomic_store_n (&pc->n_chunks, pc->n_chunks + 1, __ATOMIC_RELEASE);
+	__atomic_add_fetch (&pc->blocks, n, __ATOMIC_RELAXED);
+
+	for (i = 0; i < n; i++) {
+		jack_pool_header_t *h = (jack_pool_header_t*)(chunk + i * stride);
+		h->size_class = c;
+		h->index = base + i + 1;
+		jack_pool_push (pc, h);
+	}
+
+	pthread_mutex_unlock (&pool_grow_lock);
+
+	return 0;
+}
+
+static void *
+jack_pool_take (int c, jack_pool_header_t *h)
+{
+	jack_pool_class_t *pc = &pool_classes[c];
+	uint32_t used, hw;
+
+	used = __atomic_add_fetch (&pc->in_use, 1, __ATOMIC_RELAXED);
+	hw = __atomic_load_n (&pc->high_water, __ATOMIC_RELAXED);
+	while (used > hw &&
+	       !__atomic_compare_exchange_n (&pc->high_water, &hw, used, 1,
+					     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) ;
+
+	return (char*)h + JACK_POOL_HEADER;
+}
+
+void *
+jack_pool_alloc_rt (size_t bytes)
+{
+	jack_pool_header_t *h;
+	int c;
+
+	if ((c = jack_pool_class_for (bytes)) < 0) {
+		return NULL;
+	}
+
+	if ((h = jack_pool_pop (&pool_classes[c], c)) == NULL) {
+		__atomic_add_fetch (&pool_classes[c].failures, 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+
+	return jack_pool_take (c, h);
+}
+
 void *
 jack_pool_alloc (size_t bytes)
 {
+	jack_pool_header_t *h;
+	void *m;
+	int c;
+
+	if ((c = jack_pool_class_for (bytes)) >= 0) {
+		while ((h = jack_pool_pop (&pool_classes[c], c)) == NULL) {
+			if (jack_pool_grow (c)) {
+				break;
+			}
+		}
+		if (h) {
+			return jack_pool_take (c, h);
+		}
+	}
+
+	/* too big for the pool, or the pool is full */
+
 #ifdef HAVE_POSIX_MEMALIGN
-	void* m;
-	int err = posix_memalign (&m, 64, bytes);
-	return (!err) ? m : 0;
+	if (posix_memalign (&m, 64, JACK_POOL_HEADER + bytes)) {
+		return NULL;
+	}
 #else
-	return malloc (bytes);
+	if ((m = malloc (JACK_POOL_HEADER + bytes)) == NULL) {
+		return NULL;
+	}
 #endif  /* HAVE_POSIX_MEMALIGN */
+
+	__atomic_add_fetch (&pool_heap_allocs, 1, __ATOMIC_RELAXED);
+	h = (jack_pool_header_t*)m;
+	h->size_class = JACK_POOL_HEAP;
+
+	return (char*)m + JACK_POOL_HEADER;
 }
 
 void
 jack_pool_release (void *ptr)
 {
-	free (ptr);
+	jack_pool_header_t *h;
+	jack_pool_class_t *pc;
+
+	if (ptr == NULL) {
+		return;
+	}
+
+	h = (jack_pool_header_t*)((char*)ptr - JACK_POOL_HEADER);
+
+	if (h->size_class == JACK_POOL_HEAP) {
+		free (h);
+		return;
+	}
+
+	pc = &pool_classes[h->size_class];
+	__atomic_sub_fetch (&pc->in_use, 1, __ATOMIC_RELAXED);
+	jack_pool_push (pc, h);
+}
+
+int
+jack_pool_reserve (size_t bytes, unsigned int count)
+{
+	jack_pool_class_t *pc;
+	int c;
+
+	if ((c = jack_pool_class_for (bytes)) < 0) {
+		return -1;
+	}
+
+	pc = &pool_classes[c];
+
+	while (__atomic_load_n (&pc->blocks, __ATOMIC_RELAXED)
+	       - __atomic_load_n (&pc->in_use, __ATOMIC_RELAXED) < count) {
+		if (jack_pool_grow (c)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void
+jack_pool_get_stats (jack_pool_stats_t *stats)
+{
+	jack_pool_class_t *pc;
+	int c;
+
+	for (c = 0; c < JACK_POOL_CLASSES; c++) {
+		pc = &pool_classes[c];
+		stats->classes[c].block_size = jack_pool_block_size (c);
+		stats->classes[c].blocks = __atomic_load_n (&pc->blocks, __ATOMIC_RELAXED);
+		stats->classes[c].in_use = __atomic_load_n (&pc->in_use, __ATOMIC_RELAXED);
+		stats->classes[c].high_water = __atomic_load_n (&pc->high_water, __ATOMIC_RELAXED);
+		stats->classes[c].failures = __atomic_load_n (&pc->failures, __ATOMIC_RELAXED);
+	}
+
+	stats->heap_allocs = __atomic_load_n (&pool_heap_allocs, __ATOMIC_RELAXED);
+	stats->locked_bytes = __atomic_load_n (&pool_locked_bytes, __ATOMIC_RELAXED);
 }
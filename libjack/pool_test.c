@@ -0,0 +1,292 @@
+/*
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ */
+
+/* Hammers the real-time pool from several threads at once.  Each
+ * thread takes blocks of random sizes with jack_pool_alloc_rt(), fills
+ * them with a pattern of its own, and hands some of them to the next
+ * thread, which checks the pattern and releases them; the rest it
+ * checks and releases itself.  A block handed out twice, or released
+ * onto the wrong list, shows up as a broken pattern.  The largest size
+ * is short, so its class runs empty now and then.  Afterwards the
+ * statistics have to add up: nothing in use, the high-water mark
+ * within the reserve, and a failure counted for every NULL returned.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "pool.h"
+
+#define N_THREADS    4
+#define N_ROUNDS     200000
+#define N_HELD       32                 /* blocks a thread holds at once */
+#define N_HANDOFF    64                 /* per thread, a power of two */
+#define N_SIZES      4
+
+static const size_t sizes[N_SIZES] = { 24, 64, 1000, 16384 };
+
+typedef struct {
+	unsigned char *block;
+	size_t size;
+	uint32_t tag;                   /* unique to this allocation */
+} held_t;
+
+/* blocks thread n passes on to thread n + 1 */
+typedef struct {
+	held_t slots[N_HANDOFF];
+	volatile uint32_t head;         /* w: producer */
+	volatile uint32_t tail;         /* w: consumer */
+} handoff_t;
+
+typedef struct {
+	int id;
+	unsigned int seed;
+	uint32_t allocations;
+	unsigned long failures;         /* NULLs from jack_pool_alloc_rt() */
+	unsigned long broken;           /* blocks with a broken pattern */
+} worker_t;
+
+static handoff_t handoffs[N_THREADS];
+static worker_t workers[N_THREADS];
+
+static unsigned char
+pattern (uint32_t tag, size_t i)
+{
+	return (unsigned char)((tag >> (8 * (i & 3))) + i * 13);
+}
+
+static void
+fill (const held_t *h)
+{
+	size_t i;
+
+	for (i = 0; i < h->size; i++) {
+		h->block[i] = pattern (h->tag, i);
+	}
+}
+
+/* Check and release a block.  Returns 1 if its pattern was broken. */
+static int
+check_release (const held_t *h)
+{
+	size_t i;
+	int broken = 0;
+
+	for (i = 0; i < h->size; i++) {
+		if (h->block[i] != pattern (h->tag, i)) {
+			broken = 1;
+			break;
+		}
+	}
+
+	/* not ours any more once released */
+	memset (h->block, 0, h->size);
+	jack_pool_release (h->block);
+
+	return broken;
+}
+
+static int
+handoff_put (handoff_t *h, const held_t *block)
+{
+	uint32_t head = h->head;
+
+	if (head - __atomic_load_n (&h->tail, __ATOMIC_ACQUIRE) == N_HANDOFF) {
+		return -1;
+	}
+
+	h->slots[head & (N_HANDOFF - 1)] = *block;
+	__atomic_store_n (&h->head, head + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+static int
+handoff_get (handoff_t *h, held_t *out)
+{
+	uint32_t tail = h->tail;
+
+	if (__atomic_load_n (&h->head, __ATOMIC_ACQUIRE) == tail) {
+		return -1;
+	}
+
+	*out = h->slots[tail & (N_HANDOFF - 1)];
+	__atomic_store_n (&h->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+static void *
+worker_thread (void *arg)
+{
+	worker_t *w = (worker_t*)arg;
+	handoff_t *out = &handoffs[w->id];
+	handoff_t *in = &handoffs[(w->id + N_THREADS - 1) % N_THREADS];
+	held_t held[N_HELD];
+	held_t got;
+	unsigned char *block;
+	size_t size;
+	int round, i;
+
+	memset (held, 0, sizeof(held));
+
+	for (round = 0; round < N_ROUNDS; round++) {
+
+		/* what the previous thread passed on */
+		while (handoff_get (in, &got) == 0) {
+			w->broken += check_release (&got);
+		}
+
+		i = rand_r (&w->seed) % N_HELD;
+
+		if (held[i].block) {
+			if (rand_r (&w->seed) & 1
+			    || handoff_put (out, &held[i])) {
+				w->broken += check_release (&held[i]);
+			}
+			held[i].block = NULL;
+			continue;
+		}
+
+		size = sizes[rand_r (&w->seed) % N_SIZES];
+		if ((block = (unsigned char*)jack_pool_alloc_rt (size)) == NULL) {
+			w->failures++;
+			continue;
+		}
+
+		held[i].block = block;
+		held[i].size = size;
+		held[i].tag = (w->id << 28) | (++w->allocations & 0x0fffffff);
+		fill (&held[i]);
+	}
+
+	for (i = 0; i < N_HELD; i++) {
+		if (held[i].block) {
+			w->broken += check_release (&held[i]);
+		}
+	}
+
+	return NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+	pthread_t threads[N_THREADS];
+	jack_pool_stats_t stats;
+	unsigned long failures = 0, broken = 0;
+	uint32_t pool_failures = 0;
+	void *big;
+	int i, failed = 0;
+
+	for (i = 0; i < N_SIZES; i++) {
+		/* one chunk each, which holds a few dozen blocks of
+		   the largest size, so those run out now and then */
+		if (jack_pool_reserve (sizes[i], 1)) {
+			fprintf (stderr, "cannot reserve blocks of %zu bytes\n",
+				 sizes[i]);
+			return 1;
+		}
+	}
+
+	for (i = 0; i < N_THREADS; i++) {
+		workers[i].id = i;
+		workers[i].seed = i + 1;
+		if (pthread_create (&threads[i], NULL, worker_thread,
+				    &workers[i])) {
+			fprintf (stderr, "cannot start thread %d\n", i);
+			return 1;
+		}
+	}
+
+	for (i = 0; i < N_THREADS; i++) {
+		pthread_join (threads[i], NULL);
+	}
+
+	/* the last thread may have passed on some more */
+	for (i = 0; i < N_THREADS; i++) {
+		held_t got;
+		while (handoff_get (&handoffs[i], &got) == 0) {
+			broken += check_release (&got);
+		}
+		failures += workers[i].failures;
+		broken += workers[i].broken;
+	}
+
+	/* too big for any class: from the heap, and released to it */
+	if ((big = jack_pool_alloc (1 << 20)) == NULL) {
+		fprintf (stderr, "heap fallback failed\n");
+		failed = 1;
+	} else {
+		memset (big, 1, 1 << 20);
+		jack_pool_release (big);
+	}
+
+	jack_pool_get_stats (&stats);
+
+	for (i = 0; i < JACK_POOL_CLASSES; i++) {
+		jack_pool_class_stats_t *cs = &stats.classes[i];
+
+		if (cs->in_use != 0) {
+			fprintf (stderr, "%zu byte blocks: %u still in use\n",
+				 cs->block_size, cs->in_use);
+			failed = 1;
+		}
+		if (cs->high_water > cs->blocks) {
+			fprintf (stderr, "%zu byte blocks: high water %u "
+				 "above %u blocks\n", cs->block_size,
+				 cs->high_water, cs->blocks);
+			failed = 1;
+		}
+		pool_failures += cs->failures;
+	}
+
+	if (failures == 0) {
+		fprintf (stderr, "no allocation failed\n");
+		failed = 1;
+	}
+
+	if (pool_failures != failures) {
+		fprintf (stderr, "%u failures counted, %lu seen\n",
+			 pool_failures, failures);
+		failed = 1;
+	}
+
+	if (stats.heap_allocs != 1) {
+		fprintf (stderr, "%u heap allocations, expected 1\n",
+			 stats.heap_allocs);
+		failed = 1;
+	}
+
+	if (broken) {
+		fprintf (stderr, "%lu blocks were overwritten while held\n",
+			 broken);
+		failed = 1;
+	}
+
+	printf ("%d threads, %d rounds each: %lu allocations failed, "
+		"%lu blocks broken\n", N_THREADS, N_ROUNDS, failures, broken);
+
+	return failed;
+}
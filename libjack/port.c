@@ -72,44 +72,60 @@ jack_port_type_info_t jack_builtin_port_types[] = {
 	{ .type_name = "", }
 };
 
-/* these functions have been taken from libDSP X86.c  -jl */
-
-#ifdef USE_DYNSIMD
-
-static void (*opt_copy)(float *, const float *, int);
-static void (*opt_mix)(float *, const float *, int);
+/* Sum `nsrc' buffers into `dest' in one pass.  `dest' may be src[0].
+ * The frames are taken in small blocks so that the compiler can keep a
+ * block of partial sums in registers while it walks the sources.
+ */
+#define MIXDOWN_BLOCK 16
 
 static void
-gen_copyf (float *dest, const float *src, int length)
+gen_mixnf (float *dest, const float * const *src, int nsrc, int length)
 {
-	memcpy (dest, src, length * sizeof(float));
+	float acc[MIXDOWN_BLOCK];
+	int i, j, k, n;
+
+	for (i = 0; i < length; i += MIXDOWN_BLOCK) {
+		n = length - i;
+		if (n > MIXDOWN_BLOCK) {
+			n = MIXDOWN_BLOCK;
+		}
+		for (j = 0; j < n; j++)
+			acc[j] = src[0][i + j];
+		for (k = 1; k < nsrc; k++)
+			for (j = 0; j < n; j++)
+				acc[j] += src[k][i + j];
+		for (j = 0; j < n; j++)
+			dest[i + j] = acc[j];
+	}
 }
 
-static void
-gen_mixf (float *dest, const float *src, int length)
-{
-	int n;
+#ifdef USE_DYNSIMD
 
-	n = length;
-	while (n--)
-		*dest++ += *src++;
-	/*for (iSample = 0; iSample < iDataLength; iSample++)
-	        fpDest[iSample] += fpSrc[iSample];*/
-}
+static void (*opt_mixn)(float *, const float * const *, int, int) = gen_mixnf;
 
 #ifdef ARCH_X86
 
 void jack_port_set_funcs ()
 {
-	if (ARCH_X86_HAVE_SSE2 (cpu_type)) {
-		opt_copy = x86_sse_copyf;
-		opt_mix = x86_sse_add2f;
-	} else if (ARCH_X86_HAVE_3DNOW (cpu_type)) {
-		opt_copy = x86_3dnow_copyf;
-		opt_mix = x86_3dnow_add2f;
+	if (ARCH_X86_HAVE_AVX512 (cpu_type)) {
+		opt_mixn = x86_avx512_mixnf;
+	} else if (ARCH_X86_HAVE_AVX2 (cpu_type)) {
+		opt_mixn = x86_avx2_mixnf;
+	} else if (ARCH_X86_HAVE_SSE2 (cpu_type)) {
+		opt_mixn = x86_sse_mixnf;
 	} else {
-		opt_copy = gen_copyf;
-		opt_mix = gen_mixf;
+		opt_mixn = gen_mixnf;
+	}
+}
+
+#elif defined(ARCH_AARCH64)
+
+void jack_port_set_funcs ()
+{
+	if (ARCH_AARCH64_HAVE_NEON (cpu_type)) {
+		opt_mixn = neon_mixnf;
+	} else {
+		opt_mixn = gen_mixnf;
 	}
 }
 
@@ -117,19 +133,20 @@ void jack_port_set_funcs ()
 
 void jack_port_set_funcs ()
 {
-	opt_copy = gen_copyf;
-	opt_mix = gen_mixf;
+	opt_mixn = gen_mixnf;
 }
 
 #endif  /* ARCH_X86 */
 
+#else   /* USE_DYNSIMD */
+
+#define opt_mixn gen_mixnf
+
 #endif  /* USE_DYNSIMD */
 
-int
-jack_port_name_equals (jack_port_shared_t* port, const char* target)
+static const char *
+jack_port_name_fixup (const char* target, char *buf, size_t size)
 {
-	char buf[JACK_PORT_NAME_SIZE + 1];
-
 	/* this nasty, nasty kludge is here because between 0.109.0 and 0.109.1,
 	   the ALSA audio backend had the name "ALSA", whereas as before and
 	   after it, it was called "alsa_pcm". this stops breakage for
@@ -138,15 +155,93 @@ jack_port_name_equals (jack_port_shared_t* port, const char* target)
 	 */
 
 	if (strncmp (target, "ALSA:capture", 12) == 0 || strncmp (target, "ALSA:playback", 13) == 0) {
-		snprintf (buf, sizeof(buf), "alsa_pcm%s", target + 4);
-		target = buf;
+		snprintf (buf, size, "alsa_pcm%s", target + 4);
+		return buf;
 	}
 
+	return target;
+}
+
+int
+jack_port_name_equals (jack_port_shared_t* port, const char* target)
+{
+	char buf[JACK_PORT_NAME_SIZE + 1];
+
+	target = jack_port_name_fixup (target, buf, sizeof(buf));
+
 	return strcmp (port->name, target) == 0 ||
 	       strcmp (port->alias1, target) == 0 ||
 	       strcmp (port->alias2, target) == 0;
 }
 
+/* FNV-1a */
+uint32_t
+jack_port_name_hash (const char *name)
+{
+	uint32_t h = 2166136261u;
+
+	while (*name) {
+		h ^= (unsigned char)*name++;
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+/* Find a port by name or alias in the engine's name index.  A hit is
+ * always checked against the port itself; a miss only counts if the
+ * engine did not touch the index meanwhile.  If the engine seems to
+ * be stuck half way through an update, scan the port array instead.
+ */
+jack_port_id_t
+jack_port_hash_lookup (jack_control_t *control, const char *name)
+{
+	char buf[JACK_PORT_NAME_SIZE + 1];
+	jack_port_hash_entry_t *table = jack_port_hash_table (control);
+	uint32_t mask = control->port_hash_size - 1;
+	uint32_t h, i, n;
+	jack_port_id_t id;
+	int seq, tries;
+
+	name = jack_port_name_fixup (name, buf, sizeof(buf));
+	h = jack_port_name_hash (name);
+
+	for (tries = 0; tries < 1000; tries++) {
+
+		seq = control->port_hash_seq;
+		if (seq & 1) {
+			continue;
+		}
+		acquire_fence ();
+
+		for (i = h & mask, n = 0; n <= mask; i = (i + 1) & mask, n++) {
+			id = table[i].id;
+			if (id == JACK_PORT_HASH_EMPTY) {
+				break;
+			}
+			if (table[i].hash == h && id < control->port_max &&
+			    control->ports[id].in_use &&
+			    jack_port_name_equals (&control->ports[id], name)) {
+				return id;
+			}
+		}
+
+		acquire_fence ();
+		if (seq == control->port_hash_seq) {
+			return JACK_PORT_HASH_EMPTY;
+		}
+	}
+
+	for (id = 0; id < control->port_max; id++) {
+		if (control->ports[id].in_use &&
+		    jack_port_name_equals (&control->ports[id], name)) {
+			return id;
+		}
+	}
+
+	return JACK_PORT_HASH_EMPTY;
+}
+
 jack_port_functions_t *
 jack_get_port_functions (jack_port_type_id_t ptid)
 {
@@ -184,7 +279,10 @@ jack_port_new (const jack_client_t *client, jack_port_id_t port_id,
 	}
 
 	port->mix_buffer = NULL;
-	port->client_segment_base = NULL;
+	port->client_segments = NULL;
+	port->zeroed = 0;
+	port->buffer_request = 0;
+	port->client = (jack_client_t*)client;
 	port->shared = shared;
 	port->type_info = &client->engine->port_types[ptid];
 	pthread_mutex_init (&port->connection_lock, NULL);
@@ -205,15 +303,23 @@ jack_port_new (const jack_client_t *client, jack_port_id_t port_id,
 		port->shared->has_mixdown = (port->fptr.mixdown ? TRUE : FALSE);
 	}
 
-	/* set up a base address so that port->offset can be used to
+	/* set up the segment table so that port->offset can be used to
 	   compute the correct location. we don't store the location
-	   directly, because port->client_segment_base and/or
-	   port->offset can change if the buffer size or port counts
-	   are changed.
+	   directly, because the segment addresses and/or port->offset
+	   can change if the buffer size is changed.
 	 */
 
-	port->client_segment_base =
-		(void**)&client->port_segment[ptid].attached_at;
+	port->client_segments = client->port_segment[ptid];
+
+	/* the buffer may live in a segment added since we last
+	   looked; input ports have none of their own.
+	 */
+	if ((shared->flags & JackPortIsOutput)
+	    && port->type_info->segment_size) {
+		jack_port_segment_attach ((jack_client_t*)client, ptid,
+					  shared->offset
+					  / port->type_info->segment_size);
+	}
 
 	return port;
 }
@@ -235,6 +341,37 @@ jack_port_type_get_buffer_size (jack_client_t *client, const char *port_type)
 	return jack_port_type_buffer_size (&(client->engine->port_types[i]), client->engine->buffer_size);
 }
 
+/* An input port gets a mix buffer once it has a second connection,
+ * which may be made on the process thread (see
+ * jack_client_handle_port_connection()).  Keep a free pool block for
+ * every input port of this type that has none yet, so that the buffer
+ * can be taken without allocating.
+ */
+static void
+jack_port_reserve_mix_buffer (jack_port_t *port)
+{
+	jack_client_t *client = port->client;
+	jack_port_t *other;
+	JSList *node;
+	unsigned int count = 0;
+
+	for (node = client->ports; node; node = jack_slist_next (node)) {
+		other = (jack_port_t*)node->data;
+		if ((other->shared->flags & JackPortIsInput)
+		    && other->type_info == port->type_info
+		    && other->mix_buffer == NULL) {
+			count++;
+		}
+	}
+
+	if (jack_pool_reserve (jack_port_type_buffer_size (port->type_info,
+							   client->engine->buffer_size),
+			       count)) {
+		jack_error ("cannot reserve a mix buffer for %s",
+			    port->shared->name);
+	}
+}
+
 jack_port_t *
 jack_port_register (jack_client_t *client,
 		    const char *port_name,
@@ -285,9 +422,37 @@ jack_port_register (jack_client_t *client,
 
 	client->ports = jack_slist_prepend (client->ports, port);
 
+	port->buffer_request = buffer_size;
+	jack_port_set_buffer_limit (port);
+
+	if (flags & JackPortIsInput) {
+		jack_port_reserve_mix_buffer (port);
+	}
+
 	return port;
 }
 
+/* The buffer size given to jack_port_register() is ignored for audio
+ * ports.  A MIDI output port may grow into the overflow arena up to
+ * that size (see jack_midi_overflow_t) when its buffer fills.
+ */
+void
+jack_port_set_buffer_limit (jack_port_t *port)
+{
+	void *buffer;
+
+	if (port->buffer_request == 0
+	    || port->shared->ptype_id != JACK_MIDI_PORT_TYPE
+	    || !(port->shared->flags & JackPortIsOutput)) {
+		return;
+	}
+
+	buffer = jack_port_get_buffer (port, port->client->engine->buffer_size);
+	if (buffer) {
+		jack_midi_buffer_set_limit (buffer, port->buffer_request);
+	}
+}
+
 int
 jack_port_unregister (jack_client_t *client, jack_port_t *port)
 {
@@ -388,11 +553,53 @@ jack_port_get_all_connections (const jack_client_t *client,
 	jack_port_t *tmp;
 	unsigned int i;
 	int need_free = FALSE;
+	char reply[JACK_CHANNEL_MAX_PAYLOAD];
+	uint32_t reply_size, nports;
+	int32_t status;
 
 	if (port == NULL) {
 		return NULL;
 	}
 
+	/* the server sends back the connected port ids in one message */
+
+	if (jack_channel_request ((jack_client_t*)client, GetPortConnections,
+				  &port->shared->id, sizeof(jack_port_id_t),
+				  &status, reply, &reply_size) == 0) {
+
+		if (status != 0 || reply_size < sizeof(nports)) {
+			return NULL;
+		}
+
+		memcpy (&nports, reply, sizeof(nports));
+
+		if (nports == 0
+		    || reply_size != sizeof(nports) + nports * sizeof(jack_port_id_t)
+		    || (ret = (const char**)malloc (sizeof(char *) * (nports + 1))) == NULL) {
+			return NULL;
+		}
+
+		for (i = 0; i < nports; ++i) {
+			jack_port_id_t port_id;
+
+			memcpy (&port_id, reply + sizeof(nports) + i * sizeof(port_id),
+				sizeof(port_id));
+			if ((tmp = jack_port_by_id_int (client, port_id, &need_free)) == NULL) {
+				free (ret);
+				return NULL;
+			}
+			ret[i] = tmp->shared->name;
+			if (need_free) {
+				free (tmp);
+				need_free = FALSE;
+			}
+		}
+
+		ret[i] = NULL;
+
+		return ret;
+	}
+
 	VALGRIND_MEMSET (&req, 0, sizeof(req));
 
 	req.type = GetPortConnections;
@@ -498,18 +705,13 @@ jack_port_by_name_int (jack_client_t *client, const char *port_name, int* free)
 		}
 	}
 
-	unsigned long i, limit;
-	jack_port_shared_t *port;
+	jack_port_id_t id;
 
-	limit = client->engine->port_max;
-	port = &client->engine->ports[0];
+	id = jack_port_hash_lookup (client->engine, port_name);
 
-	for (i = 0; i < limit; i++) {
-		if (port[i].in_use && jack_port_name_equals (&port[i], port_name)) {
-			*free = TRUE;
-			return jack_port_new (client, port[i].id,
-					      client->engine);
-		}
+	if (id != JACK_PORT_HASH_EMPTY) {
+		*free = TRUE;
+		return jack_port_new (client, id, client->engine);
 	}
 
 	return NULL;
@@ -570,10 +772,34 @@ jack_port_set_latency (jack_port_t *port, jack_nframes_t nframes)
 	}
 }
 
+/* Is the segment holding this output port's buffer mapped here? */
+static inline int
+jack_port_segment_mapped (jack_port_t *port)
+{
+	void *base;
+
+	if (port->client_segments == NULL
+	    || port->type_info->segment_size == 0) {
+		return 0;
+	}
+
+	base = jack_port_segment_base (port);
+
+	return base != MAP_FAILED && base != NULL;
+}
+
+/* Was `src', an output port, marked silent in this cycle? */
+static inline int
+jack_port_source_silent (jack_port_t *src)
+{
+	return src->shared->silent_cycle == src->client->engine->cycle_count;
+}
+
 void *
 jack_port_get_buffer (jack_port_t *port, jack_nframes_t nframes)
 {
-	JSList *node, *next;
+	JSList *node;
+	jack_port_t *audible;
 
 	/* Output port.  The buffer was assigned by the engine
 	   when the port was registered.
@@ -583,35 +809,60 @@ jack_port_get_buffer (jack_port_t *port, jack_nframes_t nframes)
 			return jack_port_get_buffer (port->tied, nframes);
 		}
 
-		if (port->client_segment_base == NULL || *port->client_segment_base == MAP_FAILED) {
+		if (!jack_port_segment_mapped (port)) {
 			return NULL;
 		}
 
+		/* the caller may be about to write into it, so it is
+		   no longer silent.  Clearing the stamp (cycle_count is
+		   never 0) also keeps an old one from matching again
+		   once cycle_count wraps.
+		 */
+		port->zeroed = 0;
+		if (port->shared->silent_cycle) {
+			port->shared->silent_cycle = 0;
+		}
+
 		return jack_output_port_buffer (port);
 	}
 
-	/* Input port.  Since this can only be called from the
-	   process() callback, and since no connections can be
-	   made/broken during this phase (enforced by the jack
-	   server), there is no need to take the connection lock here
+	/* Input port.  This is called from the process() callback,
+	   so rather than take the connection lock, read the list
+	   once: connections can be made and broken meanwhile, but
+	   the nodes stay valid until the cycle is over (see
+	   jack_client_handle_port_connection()).
+
+	   Sources marked silent this cycle add nothing, so unless two
+	   or more are audible there is nothing to mix.
 	 */
-	if ((node = port->connections) == NULL) {
+	audible = NULL;
+	for (node = port->connections; node; node = jack_slist_next (node)) {
+		if (!jack_port_source_silent ((jack_port_t*)node->data)) {
+			if (audible) {
+				break;
+			}
+			audible = (jack_port_t*)node->data;
+		}
+	}
+
+	if (audible == NULL) {
 
-		if (port->client_segment_base == NULL || *port->client_segment_base == MAP_FAILED) {
+		if (port->client_segments == NULL
+		    || port->client_segments[0].attached_at == MAP_FAILED) {
 			return NULL;
 		}
 
-		/* no connections; return a zero-filled buffer */
-		return (void*)(*(port->client_segment_base) + port->type_info->zero_buffer_offset);
+		/* no audible connections; return a zero-filled buffer */
+		return (void*)((char*)port->client_segments[0].attached_at
+			       + port->type_info->zero_buffer_offset);
 	}
 
-	if ((next = jack_slist_next (node)) == NULL) {
+	if (node == NULL) {
 
-		/* one connection: use zero-copy mode - just pass
-		   the buffer of the connected (output) port.
+		/* one audible connection: use zero-copy mode - just
+		   pass the buffer of the connected (output) port.
 		 */
-		return jack_port_get_buffer (((jack_port_t*)node->data),
-					     nframes);
+		return jack_port_get_buffer (audible, nframes);
 	}
 
 	/* Multiple connections.  Use a local buffer and mix the
@@ -619,6 +870,7 @@ jack_port_get_buffer (jack_port_t *port, jack_nframes_t nframes)
 	   established the existence of a mixdown function during the
 	   connection process.
 	 */
+	acquire_fence ();
 	if (port->mix_buffer == NULL) {
 		jack_error ( "internal jack error: mix_buffer not allocated" );
 		return NULL;
@@ -627,6 +879,51 @@ jack_port_get_buffer (jack_port_t *port, jack_nframes_t nframes)
 	return (void*)port->mix_buffer;
 }
 
+void
+jack_port_mark_silent (jack_port_t *port, jack_nframes_t nframes)
+{
+	void *buffer;
+
+	if (!(port->shared->flags & JackPortIsOutput) || port->tied
+	    || jack_uuid_compare (port->client->control->uuid,
+				  port->shared->client_id) != 0) {
+		return;
+	}
+
+	/* a buffer nobody has asked for since it was last cleared
+	   still holds silence */
+	if (!port->zeroed) {
+		if ((buffer = jack_port_get_buffer (port, nframes)) == NULL) {
+			return;
+		}
+		port->fptr.buffer_init (buffer,
+					jack_port_type_buffer_size (port->type_info,
+								    nframes),
+					nframes);
+		port->zeroed = 1;
+	}
+
+	port->shared->silent_cycle = port->client->engine->cycle_count;
+}
+
+int
+jack_port_is_silent (jack_port_t *port)
+{
+	JSList *node;
+
+	if (port->shared->flags & JackPortIsOutput) {
+		return jack_port_source_silent (port);
+	}
+
+	for (node = port->connections; node; node = jack_slist_next (node)) {
+		if (!jack_port_source_silent ((jack_port_t*)node->data)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
 size_t
 jack_port_type_buffer_size (jack_port_type_info_t* port_type_info, jack_nframes_t nframes)
 {
@@ -812,6 +1109,18 @@ jack_port_type (const jack_port_t *port)
 	return port->type_info->type_name;
 }
 
+/* tell the server to update its name index for this port */
+static void
+jack_port_reindex (jack_port_t *port)
+{
+	jack_request_t req;
+
+	req.type = ReindexPort;
+	req.x.port_info.port_id = port->shared->id;
+
+	(void)jack_client_deliver_request (port->client, &req);
+}
+
 int
 jack_port_rename (jack_client_t* client, jack_port_t *port, const char *new_name)
 {
@@ -851,6 +1160,7 @@ jack_port_set_name (jack_port_t *port, const char *new_name)
 	      ((int)(colon - port->shared->name)) - 2;
 	snprintf (colon + 1, len, "%s", new_name);
 
+	jack_port_reindex (port);
 
 	return 0;
 }
@@ -866,6 +1176,8 @@ jack_port_set_alias (jack_port_t *port, const char *alias)
 		return -1;
 	}
 
+	jack_port_reindex (port);
+
 	return 0;
 }
 
@@ -880,6 +1192,8 @@ jack_port_unset_alias (jack_port_t *port, const char *alias)
 		return -1;
 	}
 
+	jack_port_reindex (port);
+
 	return 0;
 }
 
@@ -930,16 +1244,18 @@ static inline float f_max (float x, float a)
 	return x;
 }
 
+/* Sources handed to a single mixdown pass.  Ports with more
+   connections than this are summed in several passes, each of which
+   starts from the result of the previous one. */
+#define MIXDOWN_MAX_SOURCES 64
+
 static void
 jack_audio_port_mixdown (jack_port_t *port, jack_nframes_t nframes)
 {
 	JSList *node;
 	jack_port_t *input;
-
-#ifndef ARCH_X86
-	jack_nframes_t n;
-	jack_default_audio_sample_t *dst, *src;
-#endif
+	const float *src[MIXDOWN_MAX_SOURCES];
+	int nsrc;
 	jack_default_audio_sample_t *buffer;
 
 	/* by the time we've called this, we've already established
@@ -948,37 +1264,32 @@ jack_audio_port_mixdown (jack_port_t *port, jack_nframes_t nframes)
 	 */
 
 	/* no need to take connection lock, since this is called
-	   from the process() callback, and the jack server
-	   ensures that no changes to connections happen
-	   during this time.
+	   from the process() callback, and nodes taken off the list
+	   stay valid until the cycle is over.
 	 */
 
-	node = port->connections;
-	input = (jack_port_t*)node->data;
 	buffer = port->mix_buffer;
+	nsrc = 0;
 
-#ifndef USE_DYNSIMD
-	memcpy (buffer, jack_output_port_buffer (input),
-		sizeof(jack_default_audio_sample_t) * nframes);
-#else   /* USE_DYNSIMD */
-	opt_copy (buffer, jack_output_port_buffer (input), nframes);
-#endif /* USE_DYNSIMD */
-
-	for (node = jack_slist_next (node); node;
-	     node = jack_slist_next (node)) {
+	for (node = port->connections; node; node = jack_slist_next (node)) {
 
 		input = (jack_port_t*)node->data;
+		if (jack_port_source_silent (input)) {
+			continue;
+		}
+		src[nsrc++] = jack_output_port_buffer (input);
 
-#ifndef USE_DYNSIMD
-		n = nframes;
-		dst = buffer;
-		src = jack_output_port_buffer (input);
-
-		while (n--)
-			*dst++ += *src++;
+		if (nsrc == MIXDOWN_MAX_SOURCES) {
+			opt_mixn (buffer, src, nsrc, nframes);
+			/* carry the running sum into the next pass */
+			src[0] = buffer;
+			nsrc = 1;
+		}
+	}
 
-#else           /* USE_DYNSIMD */
-		opt_mix (buffer, jack_output_port_buffer (input), nframes);
-#endif /* USE_DYNSIMD */
+	if (nsrc == 0) {
+		memset (buffer, 0, nframes * sizeof(jack_default_audio_sample_t));
+	} else if (nsrc > 1 || src[0] != buffer) {
+		opt_mixn (buffer, src, nsrc, nframes);
 	}
 }
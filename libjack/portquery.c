@@ -0,0 +1,392 @@
+/*
+    Port queries -- precompiled jack_get_ports() filters.
+
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public License
+    as published by the Free Software Foundation; either version 2.1
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this program; if not, write to the Free
+    Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+    02111-1307, USA.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <regex.h>
+
+#include "internal.h"
+#include "local.h"
+
+/* A port query holds everything jack_get_ports() used to work out on
+ * every call: the compiled name pattern, the set of port types that
+ * match the type pattern, and the flag filter.  It also remembers
+ * which ports matched last time, together with the engine's port
+ * generation (port_hash_seq, bumped by every registration, removal,
+ * rename and alias change), so that running it again while nothing
+ * has changed costs no scan at all.
+ *
+ * Name patterns that are really just literals are matched with string
+ * functions instead of regexec(); "^name$" is a single lookup in the
+ * engine's port name index.
+ */
+
+typedef enum {
+	QueryMatchAll,
+	QueryMatchExact,                /* ^literal$ */
+	QueryMatchPrefix,               /* ^literal */
+	QueryMatchSuffix,               /* literal$ */
+	QueryMatchSubstring,            /* literal */
+	QueryMatchRegex
+} jack_port_query_match_t;
+
+struct _jack_port_query {
+	jack_client_t *client;
+	char *port_name_pattern;
+	char *type_name_pattern;
+	unsigned long flags;
+
+	jack_port_query_match_t match;
+	char *literal;
+	size_t literal_len;
+	regex_t port_regex;
+	int have_regex;
+	uint32_t type_mask;             /* bit per matching port type */
+
+	int valid;                      /* ids[] is current for generation */
+	int generation;
+	jack_port_id_t *ids;
+	unsigned long n_ids;
+};
+
+/* number of jack_get_ports() queries each client keeps compiled */
+#define JACK_PORT_QUERY_CACHE_SIZE 16
+
+static int
+jack_port_query_is_meta (char c)
+{
+	return strchr (".[]()*+?{}|^$\\", c) != NULL;
+}
+
+/* Work out whether `pattern' is a literal, possibly anchored at either
+ * end.  Escaped metacharacters count as literal characters.
+ */
+static void
+jack_port_query_parse (jack_port_query_t *query, const char *pattern)
+{
+	const char *p = pattern;
+	char *out;
+	int head = 0, tail = 0;
+
+	query->match = QueryMatchRegex;
+
+	if ((query->literal = (char*)malloc (strlen (pattern) + 1)) == NULL) {
+		return;
+	}
+	out = query->literal;
+
+	if (*p == '^') {
+		head = 1;
+		p++;
+	}
+
+	while (*p) {
+		if (*p == '\\' && p[1] && jack_port_query_is_meta (p[1])) {
+			*out++ = p[1];
+			p += 2;
+		} else if (*p == '$' && p[1] == '\0') {
+			tail = 1;
+			p++;
+		} else if (jack_port_query_is_meta (*p)) {
+			return;
+		} else {
+			*out++ = *p++;
+		}
+	}
+
+	*out = '\0';
+	query->literal_len = out - query->literal;
+
+	if (head && tail) {
+		query->match = QueryMatchExact;
+	} else if (head) {
+		query->match = QueryMatchPrefix;
+	} else if (tail) {
+		query->match = QueryMatchSuffix;
+	} else {
+		query->match = QueryMatchSubstring;
+	}
+}
+
+jack_port_query_t *
+jack_port_query_new (jack_client_t *client,
+		     const char *port_name_pattern,
+		     const char *type_name_pattern,
+		     unsigned long flags)
+{
+	jack_port_query_t *query;
+	jack_control_t *engine = client->engine;
+	regex_t type_regex;
+	jack_port_type_id_t ptid;
+
+	if ((query = (jack_port_query_t*)calloc (1, sizeof(jack_port_query_t))) == NULL) {
+		return NULL;
+	}
+
+	query->client = client;
+	query->flags = flags;
+	query->port_name_pattern = strdup (port_name_pattern ? port_name_pattern : "");
+	query->type_name_pattern = strdup (type_name_pattern ? type_name_pattern : "");
+
+	if (query->port_name_pattern == NULL || query->type_name_pattern == NULL) {
+		goto fail;
+	}
+
+	if ((query->ids = (jack_port_id_t*)malloc (sizeof(jack_port_id_t) * engine->port_max)) == NULL) {
+		goto fail;
+	}
+
+	if (query->port_name_pattern[0] == '\0') {
+		query->match = QueryMatchAll;
+	} else {
+		jack_port_query_parse (query, query->port_name_pattern);
+
+		if (query->match == QueryMatchRegex) {
+			if (regcomp (&query->port_regex, query->port_name_pattern,
+				     REG_EXTENDED | REG_NOSUB)) {
+				jack_error ("invalid port name pattern \"%s\"",
+					    query->port_name_pattern);
+				goto fail;
+			}
+			query->have_regex = 1;
+		}
+	}
+
+	/* port types are fixed when the engine starts, so the type
+	   pattern only ever has to be evaluated once */
+	if (query->type_name_pattern[0] == '\0') {
+		query->type_mask = ~0U;
+	} else {
+		if (regcomp (&type_regex, query->type_name_pattern,
+			     REG_EXTENDED | REG_NOSUB)) {
+			jack_error ("invalid port type pattern \"%s\"",
+				    query->type_name_pattern);
+			goto fail;
+		}
+		for (ptid = 0; ptid < engine->n_port_types; ptid++) {
+			if (regexec (&type_regex, engine->port_types[ptid].type_name,
+				     0, NULL, 0) == 0) {
+				query->type_mask |= 1U << ptid;
+			}
+		}
+		regfree (&type_regex);
+	}
+
+	return query;
+
+fail:
+	jack_port_query_free (query);
+	return NULL;
+}
+
+void
+jack_port_query_free (jack_port_query_t *query)
+{
+	if (query->have_regex) {
+		regfree (&query->port_regex);
+	}
+	free (query->literal);
+	free (query->port_name_pattern);
+	free (query->type_name_pattern);
+	free (query->ids);
+	free (query);
+}
+
+static int
+jack_port_query_match_name (jack_port_query_t *query, const char *name)
+{
+	size_t len;
+
+	switch (query->match) {
+	case QueryMatchAll:
+		return 1;
+	case QueryMatchExact:
+		return strcmp (name, query->literal) == 0;
+	case QueryMatchPrefix:
+		return strncmp (name, query->literal, query->literal_len) == 0;
+	case QueryMatchSuffix:
+		len = strlen (name);
+		return len >= query->literal_len &&
+		       strcmp (name + len - query->literal_len, query->literal) == 0;
+	case QueryMatchSubstring:
+		return strstr (name, query->literal) != NULL;
+	case QueryMatchRegex:
+		return regexec (&query->port_regex, name, 0, NULL, 0) == 0;
+	}
+
+	return 0;
+}
+
+static int
+jack_port_query_match (jack_port_query_t *query, jack_port_shared_t *psp)
+{
+	return psp->in_use &&
+	       (psp->flags & query->flags) == query->flags &&
+	       (query->type_mask & (1U << psp->ptype_id)) &&
+	       jack_port_query_match_name (query, psp->name);
+}
+
+static void
+jack_port_query_scan (jack_port_query_t *query)
+{
+	jack_control_t *engine = query->client->engine;
+	jack_port_id_t id;
+
+	query->n_ids = 0;
+
+	if (query->match == QueryMatchExact) {
+		id = jack_port_hash_lookup (engine, query->literal);
+		if (id != JACK_PORT_HASH_EMPTY &&
+		    strcmp (engine->ports[id].name, query->literal) == 0) {
+			if (jack_port_query_match (query, &engine->ports[id])) {
+				query->ids[query->n_ids++] = id;
+			}
+			return;
+		}
+		/* the index found an alias (or nothing): the name
+		   may still belong to some other port */
+		if (id == JACK_PORT_HASH_EMPTY) {
+			return;
+		}
+	}
+
+	for (id = 0; id < engine->port_max; id++) {
+		if (jack_port_query_match (query, &engine->ports[id])) {
+			query->ids[query->n_ids++] = id;
+		}
+	}
+}
+
+/* Run `query' and return the names of the matching ports, in the same
+ * form as jack_get_ports().  The caller frees the array.
+ */
+const char **
+jack_port_query_run (jack_port_query_t *query)
+{
+	jack_control_t *engine = query->client->engine;
+	const char **matching_ports;
+	unsigned long i;
+	int generation;
+
+	generation = engine->port_hash_seq;
+	acquire_fence ();
+
+	if (!query->valid || query->generation != generation) {
+		jack_port_query_scan (query);
+		/* an odd generation means the engine was busy changing
+		   a port, so the result may be stale already */
+		query->valid = !(generation & 1);
+		query->generation = generation;
+	}
+
+	if (query->n_ids == 0) {
+		return NULL;
+	}
+
+	if ((matching_ports = (const char**)malloc (sizeof(char *) * (query->n_ids + 1))) == NULL) {
+		return NULL;
+	}
+
+	for (i = 0; i < query->n_ids; i++) {
+		matching_ports[i] = engine->ports[query->ids[i]].name;
+	}
+	matching_ports[i] = NULL;
+
+	return matching_ports;
+}
+
+static int
+jack_port_query_equals (jack_port_query_t *query,
+			const char *port_name_pattern,
+			const char *type_name_pattern,
+			unsigned long flags)
+{
+	return query->flags == flags &&
+	       strcmp (query->port_name_pattern, port_name_pattern ? port_name_pattern : "") == 0 &&
+	       strcmp (query->type_name_pattern, type_name_pattern ? type_name_pattern : "") == 0;
+}
+
+/* jack_get_ports() keeps the last few queries it was asked for, most
+ * recently used first.
+ */
+const char **
+jack_port_query_cached (jack_client_t *client,
+			const char *port_name_pattern,
+			const char *type_name_pattern,
+			unsigned long flags)
+{
+	JSList *node, *prev = NULL;
+	jack_port_query_t *query = NULL;
+	const char **matching_ports;
+	int n = 0;
+
+	pthread_mutex_lock (&client->port_query_lock);
+
+	for (node = client->port_queries; node; prev = node, node = jack_slist_next (node), n++) {
+		if (jack_port_query_equals ((jack_port_query_t*)node->data,
+					    port_name_pattern, type_name_pattern,
+					    flags)) {
+			query = (jack_port_query_t*)node->data;
+			if (prev) {
+				prev->next = node->next;
+				node->next = client->port_queries;
+				client->port_queries = node;
+			}
+			break;
+		}
+	}
+
+	if (query == NULL) {
+		if ((query = jack_port_query_new (client, port_name_pattern,
+						  type_name_pattern, flags)) == NULL) {
+			pthread_mutex_unlock (&client->port_query_lock);
+			return NULL;
+		}
+
+		client->port_queries = jack_slist_prepend (client->port_queries, query);
+
+		if (n >= JACK_PORT_QUERY_CACHE_SIZE) {
+			node = jack_slist_last (client->port_queries);
+			jack_port_query_free ((jack_port_query_t*)node->data);
+			client->port_queries = jack_slist_remove_link (client->port_queries, node);
+			jack_slist_free_1 (node);
+		}
+	}
+
+	matching_ports = jack_port_query_run (query);
+
+	pthread_mutex_unlock (&client->port_query_lock);
+
+	return matching_ports;
+}
+
+void
+jack_port_query_cache_free (jack_client_t *client)
+{
+	JSList *node;
+
+	for (node = client->port_queries; node; node = jack_slist_next (node)) {
+		jack_port_query_free ((jack_port_query_t*)node->data);
+	}
+	jack_slist_free (client->port_queries);
+	client->port_queries = NULL;
+}
@@ -0,0 +1,142 @@
+/*
+    Cycle profile readers.
+
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public License
+    as published by the Free Software Foundation; either version 2.1
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this program; if not, write to the Free
+    Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+    02111-1307, USA.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "internal.h"
+#include "local.h"
+
+/* The server updates the profile once per cycle, so a copy that
+ * overlaps an update is simply taken again, a few times at most.
+ */
+#define JACK_PROFILE_READ_TRIES 8
+
+/* Copy the profile at `shared' to `profile'.  Returns -1 if no
+ * consistent copy could be taken.
+ */
+int
+jack_profile_copy (const jack_cycle_profile_t *shared,
+		   jack_cycle_profile_t *profile)
+{
+	uint32_t guard;
+	int tries;
+
+	for (tries = 0; tries < JACK_PROFILE_READ_TRIES; tries++) {
+		guard = shared->guard2;
+		acquire_fence ();
+		memcpy (profile, (const void*)shared,
+			sizeof(jack_cycle_profile_t));
+		acquire_fence ();
+		if (shared->guard1 == guard) {
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+int
+jack_profile_read (jack_client_t *client, jack_cycle_profile_t *profile)
+{
+	return jack_profile_copy (&client->engine->profile, profile);
+}
+
+/* Turn `now' into the profile of the cycles since `then' was read.
+ * The longest times are kept from `now', as the server only keeps the
+ * longest ever.
+ */
+void
+jack_profile_since (jack_cycle_profile_t *now,
+		    const jack_cycle_profile_t *then)
+{
+	jack_profile_histogram_t *hist;
+	int phase, i;
+
+	for (phase = 0; phase < JackProfilePhases; phase++) {
+		hist = &now->phase[phase];
+		hist->count -= then->phase[phase].count;
+		hist->total_usecs -= then->phase[phase].total_usecs;
+		for (i = 0; i < JACK_PROFILE_BUCKETS; i++) {
+			hist->buckets[i] -= then->phase[phase].buckets[i];
+		}
+	}
+}
+
+/* Return the given percentile (0 to 100) of a phase's times, to the
+ * precision of the histogram: the result is the shortest time counted
+ * in the bucket it falls in.
+ */
+uint32_t
+jack_profile_percentile (const jack_profile_histogram_t *hist,
+			 float percentile)
+{
+	uint64_t rank, seen = 0;
+	int i;
+
+	if (hist->count == 0) {
+		return 0;
+	}
+
+	if (percentile <= 0.0f) {
+		rank = 1;
+	} else if (percentile >= 100.0f) {
+		rank = hist->count;
+	} else {
+		rank = (uint64_t)(percentile / 100.0f * hist->count + 0.5f);
+		if (rank == 0) {
+			rank = 1;
+		}
+	}
+
+	for (i = 0; i < JACK_PROFILE_BUCKETS; i++) {
+		seen += hist->buckets[i];
+		if (seen >= rank) {
+			break;
+		}
+	}
+
+	if (i == JACK_PROFILE_BUCKETS) {
+		i = JACK_PROFILE_BUCKETS - 1;
+	}
+
+	return jack_profile_bucket_usecs (i);
+}
+
+const char *
+jack_profile_phase_name (jack_profile_phase_t phase)
+{
+	switch (phase) {
+	case JackProfileWakeup:
+		return "wakeup jitter";
+	case JackProfileRead:
+		return "driver read";
+	case JackProfileProcess:
+		return "client graph";
+	case JackProfileWrite:
+		return "driver write";
+	case JackProfilePostProcess:
+		return "post-process";
+	default:
+		break;
+	}
+	return "unknown";
+}
@@ -46,6 +46,11 @@
 #include <sys/shm.h>
 #include <sys/sem.h>
 #include <sysdeps/ipc.h>
+#include <inttypes.h>
+#include <sys/syscall.h>
+#ifdef HAVE_LINUX_MEMPOLICY
+#include <linux/mempolicy.h>
+#endif
 
 #include "shm.h"
 #include "internal.h"
@@ -556,6 +561,102 @@ jack_resize_shm (jack_shm_info_t* si, jack_shmsize_t size)
 	return jack_attach_shm (si);
 }
 
+/* Huge page backed segments.
+ *
+ * Large segments (the port buffers) can be put on huge pages to spare
+ * every process that touches them a TLB miss per 4 KB page.  With POSIX
+ * shm the segment is a file on a hugetlbfs mount, whose full path is
+ * kept as the segment id; with System V shm it is created with
+ * SHM_HUGETLB.  Either way the size is rounded up to a whole number of
+ * huge pages, and the pages are reserved up front, so that running out
+ * shows up here as an error rather than later as a SIGBUS.  Callers
+ * fall back to ordinary segments when that happens.
+ */
+
+static jack_shmsize_t
+jack_huge_page_size (void)
+{
+	static jack_shmsize_t huge_page_size = 0;
+	FILE *meminfo;
+	char line[128];
+	unsigned long kb;
+
+	if (huge_page_size) {
+		return huge_page_size;
+	}
+
+	huge_page_size = 2 * 1024 * 1024;
+
+	if ((meminfo = fopen ("/proc/meminfo", "r")) != NULL) {
+		while (fgets (line, sizeof(line), meminfo)) {
+			if (sscanf (line, "Hugepagesize: %lu kB", &kb) == 1) {
+				huge_page_size = kb * 1024;
+				break;
+			}
+		}
+		fclose (meminfo);
+	}
+
+	return huge_page_size;
+}
+
+static inline jack_shmsize_t
+jack_huge_page_round (jack_shmsize_t size)
+{
+	jack_shmsize_t page = jack_huge_page_size ();
+
+	return ((size + page - 1) / page) * page;
+}
+
+static int jack_shmalloc_huge(jack_shmsize_t size, jack_shm_info_t* si);
+
+/* allocate a segment that may be put on huge pages */
+int
+jack_shmalloc_large (jack_shmsize_t size, jack_shm_info_t* si, int hugepages)
+{
+	if (hugepages) {
+		if (jack_shmalloc_huge (size, si) == 0) {
+			return 0;
+		}
+		jack_info ("JACK: no huge pages for a %" PRIu32 " byte"
+			   " segment, using normal pages", size);
+	}
+
+	return jack_shmalloc (size, si);
+}
+
+/* Prefer NUMA node `node' for the pages of an attached segment that
+ * have not been touched yet, and move those that have.
+ */
+int
+jack_shm_bind_node (jack_shm_info_t* si, int node)
+{
+#ifdef HAVE_LINUX_MEMPOLICY
+	unsigned long mask[4];
+	unsigned long bits = sizeof(unsigned long) * 8;
+
+	if (node < 0 || node >= (int)(sizeof(mask) * 8)) {
+		return -1;
+	}
+
+	memset (mask, 0, sizeof(mask));
+	mask[node / bits] = 1UL << (node % bits);
+
+	if (syscall (SYS_mbind, si->attached_at,
+		     (unsigned long)jack_shm_registry[si->index].size,
+		     MPOL_PREFERRED, mask, sizeof(mask) * 8 + 1,
+		     MPOL_MF_MOVE) < 0) {
+		jack_error ("cannot bind shm segment to NUMA node %d (%s)",
+			    node, strerror (errno));
+		return -1;
+	}
+
+	return 0;
+#else
+	return -1;
+#endif  /* HAVE_LINUX_MEMPOLICY */
+}
+
 #ifdef USE_POSIX_SHM
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
@@ -669,7 +770,11 @@ jack_remove_shm (jack_shm_id_t *id)
 	   XXX it would be good to differentiate between these
 	   two conditions.
 	 */
-	shm_unlink ((char*)id);
+	if (strchr ((char*)id + 1, '/')) {
+		unlink ((char*)id);     /* on hugetlbfs */
+	} else {
+		shm_unlink ((char*)id);
+	}
 }
 
 void
@@ -738,14 +843,112 @@ unlock:
 	return rc;
 }
 
+/* Find a hugetlbfs mount we can create files on.  Returns NULL if
+ * there is none.
+ */
+static const char *
+jack_hugetlbfs_dir (void)
+{
+	static char dir[PATH_MAX + 1];
+	static int searched = 0;
+	char mnt[PATH_MAX + 1], type[64];
+	char line[PATH_MAX + 128];
+	FILE *mounts;
+
+	if (searched) {
+		return dir[0] ? dir : NULL;
+	}
+
+	searched = 1;
+	dir[0] = '\0';
+
+	if ((mounts = fopen ("/proc/mounts", "r")) == NULL) {
+		return NULL;
+	}
+
+	while (fgets (line, sizeof(line), mounts)) {
+		if (sscanf (line, "%*s %4095s %63s", mnt, type) == 2
+		    && strcmp (type, "hugetlbfs") == 0
+		    && access (mnt, W_OK) == 0) {
+			snprintf (dir, sizeof(dir), "%s", mnt);
+			break;
+		}
+	}
+
+	fclose (mounts);
+
+	return dir[0] ? dir : NULL;
+}
+
+/* allocate a POSIX segment as a file on hugetlbfs */
+static int
+jack_shmalloc_huge (jack_shmsize_t size, jack_shm_info_t* si)
+{
+	jack_shm_registry_t* registry;
+	const char *dir;
+	int fd;
+	int rc = -1;
+	char name[SHM_NAME_MAX + 1];
+
+	if ((dir = jack_hugetlbfs_dir ()) == NULL) {
+		return -1;
+	}
+
+	size = jack_huge_page_round (size);
+
+	jack_shm_lock_registry ();
+
+	if ((registry = jack_get_free_shm_info ()) == NULL) {
+		jack_error ("shm registry full");
+		goto unlock;
+	}
+
+	snprintf (name, sizeof(name), "%s/jack-%d", dir, registry->index);
+
+	if (strlen (name) >= sizeof(registry->id)) {
+		goto unlock;
+	}
+
+	if ((fd = open (name, O_RDWR | O_CREAT | O_EXCL, 0666)) < 0) {
+		goto unlock;
+	}
+
+	/* reserve the pages now */
+	if (ftruncate (fd, size) < 0
+	    || posix_fallocate (fd, 0, size) != 0) {
+		close (fd);
+		unlink (name);
+		goto unlock;
+	}
+
+	fchmod (fd, 0666);
+	close (fd);
+	registry->size = size;
+	strncpy (registry->id, name, sizeof(registry->id));
+	registry->allocator = getpid ();
+	si->index = registry->index;
+	si->attached_at = MAP_FAILED;   /* not attached */
+	rc = 0;                         /* success */
+
+unlock:
+	jack_shm_unlock_registry ();
+	return rc;
+}
+
 int
 jack_attach_shm (jack_shm_info_t* si)
 {
 	int shm_fd;
 	jack_shm_registry_t *registry = &jack_shm_registry[si->index];
 
-	if ((shm_fd = shm_open (registry->id,
-				O_RDWR, 0666)) < 0) {
+	if (strchr (registry->id + 1, '/')) {
+		/* on hugetlbfs */
+		shm_fd = open (registry->id, O_RDWR);
+	} else {
+		shm_fd = shm_open (registry->id, O_RDWR, 0666);
+	}
+
+	if (shm_fd < 0) {
 		jack_error ("cannot open shm segment %s (%s)", registry->id,
 			    strerror (errno));
 		return -1;
@@ -911,6 +1114,40 @@ jack_shmalloc (jack_shmsize_t size, jack_shm_info_t* si)
 	return rc;
 }
 
+/* allocate a System V segment on huge pages */
+static int
+jack_shmalloc_huge (jack_shmsize_t size, jack_shm_info_t* si)
+{
+#ifdef SHM_HUGETLB
+	int shmid;
+	int rc = -1;
+	jack_shm_registry_t* registry;
+
+	size = jack_huge_page_round (size);
+
+	jack_shm_lock_registry ();
+
+	if ((registry = jack_get_free_shm_info ())) {
+
+		if ((shmid = shmget (IPC_PRIVATE, size,
+				     0666 | IPC_CREAT | IPC_EXCL | SHM_HUGETLB)) >= 0) {
+			registry->size = size;
+			registry->id = shmid;
+			registry->allocator = getpid ();
+			si->index = registry->index;
+			si->attached_at = MAP_FAILED; /* not attached */
+			rc = 0;
+		}
+	}
+
+	jack_shm_unlock_registry ();
+
+	return rc;
+#else
+	return -1;
+#endif  /* SHM_HUGETLB */
+}
+
 int
 jack_attach_shm (jack_shm_info_t* si)
 {
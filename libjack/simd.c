@@ -24,8 +24,24 @@
 
 #ifdef USE_DYNSIMD
 
+static inline void
+mixnf_tail (float *dest, const float * const *src, int nsrc, int i, int length)
+{
+	int k;
+	float a;
+
+	for (; i < length; i++) {
+		a = src[0][i];
+		for (k = 1; k < nsrc; k++)
+			a += src[k][i];
+		dest[i] = a;
+	}
+}
+
 #ifdef ARCH_X86
 
+#include <cpuid.h>
+
 int
 have_3dnow ()
 {
@@ -119,205 +135,6 @@ have_sse ()
 	return res;
 }
 
-void
-x86_3dnow_copyf (float *dest, const float *src, int length)
-{
-	int i, n1, n2;
-	pv2sf m64p_src = (pv2sf)src;
-	pv2sf m64p_dest = (pv2sf)dest;
-
-	n1 = (length >> 4);
-	n2 = ((length & 0xf) >> 1);
-	for (i = 0; i < n1; i++) {
-		asm volatile ("movq %0, %%mm0\n\t"
-			      : : "m" (*m64p_src++) : "mm0", "memory");
-		asm volatile ("movq %0, %%mm1\n\t"
-			      : : "m" (*m64p_src++) : "mm1", "memory");
-		asm volatile ("movq %0, %%mm2\n\t"
-			      : : "m" (*m64p_src++) : "mm2", "memory");
-		asm volatile ("movq %0, %%mm3\n\t"
-			      : : "m" (*m64p_src++) : "mm3", "memory");
-		asm volatile ("movq %0, %%mm4\n\t"
-			      : : "m" (*m64p_src++) : "mm4", "memory");
-		asm volatile ("movq %0, %%mm5\n\t"
-			      : : "m" (*m64p_src++) : "mm5", "memory");
-		asm volatile ("movq %0, %%mm6\n\t"
-			      : : "m" (*m64p_src++) : "mm6", "memory");
-		asm volatile ("movq %0, %%mm7\n\t"
-			      : : "m" (*m64p_src++) : "mm7", "memory");
-
-		asm volatile ("movq %%mm0, %0\n\t"
-			      : "=m" (*m64p_dest++) : : "mm0", "memory");
-		asm volatile ("movq %%mm1, %0\n\t"
-			      : "=m" (*m64p_dest++) : : "mm1", "memory");
-		asm volatile ("movq %%mm2, %0\n\t"
-			      : "=m" (*m64p_dest++) : : "mm2", "memory");
-		asm volatile ("movq %%mm3, %0\n\t"
-			      : "=m" (*m64p_dest++) : : "mm3", "memory");
-		asm volatile ("movq %%mm4, %0\n\t"
-			      : "=m" (*m64p_dest++) : : "mm4", "memory");
-		asm volatile ("movq %%mm5, %0\n\t"
-			      : "=m" (*m64p_dest++) : : "mm5", "memory");
-		asm volatile ("movq %%mm6, %0\n\t"
-			      : "=m" (*m64p_dest++) : : "mm6", "memory");
-		asm volatile ("movq %%mm7, %0\n\t"
-			      : "=m" (*m64p_dest++) : : "mm7", "memory");
-	}
-	for (i = 0; i < n2; i++) {
-		asm volatile (
-			"movq %1, %%mm0\n\t" \
-			"movq %%mm0, %0\n\t"
-			: "=m" (*m64p_dest++)
-			: "m" (*m64p_src++)
-			: "mm0", "memory");
-	}
-	if (length & 0x1) {
-		asm volatile (
-			"movd %1, %%mm0\n\t" \
-			"movd %%mm0, %0\n\t"
-			: "=m" (dest[length - 1])
-			: "m" (src[length - 1])
-			: "mm0", "memory");
-	}
-	asm volatile (
-		"femms\n\t" \
-		"sfence\n\t");
-}
-
-void
-x86_3dnow_add2f (float *dest, const float *src, int length)
-{
-	int i, n;
-	pv2sf m64p_dest = (pv2sf)dest;
-	pv2sf m64p_src = (pv2sf)src;
-
-	n = (length >> 1);
-	for (i = 0; i < n; i++) {
-		asm volatile (
-			"movq %1, %%mm0\n\t" \
-			"pfadd %2, %%mm0\n\t" \
-			"movq %%mm0, %0\n\t"
-			: "=m" (m64p_dest[i])
-			: "m0" (m64p_dest[i]),
-			"m" (m64p_src[i])
-			: "mm0", "memory");
-	}
-	if (n & 0x1) {
-		asm volatile (
-			"movd %1, %%mm0\n\t" \
-			"movd %2, %%mm1\n\t" \
-			"pfadd %%mm1, %%mm0\n\t" \
-			"movd %%mm0, %0\n\t"
-			: "=m" (dest[length - 1])
-			: "m0" (dest[length - 1]),
-			"m" (src[length - 1])
-			: "mm0", "mm1", "memory");
-	}
-	asm volatile (
-		"femms\n\t" \
-		"sfence\n\t");
-}
-
-void
-x86_sse_copyf (float *dest, const float *src, int length)
-{
-	int i, n1, n2, si3;
-	pv4sf m128p_src = (pv4sf)src;
-	pv4sf m128p_dest = (pv4sf)dest;
-
-	n1 = (length >> 5);
-	n2 = ((length & 0x1f) >> 2);
-	si3 = (length & ~0x3);
-	for (i = 0; i < n1; i++) {
-		asm volatile ("movaps %0, %%xmm0\n\t"
-			      : : "m" (*m128p_src++) : "xmm0", "memory");
-		asm volatile ("movaps %0, %%xmm1\n\t"
-			      : : "m" (*m128p_src++) : "xmm1", "memory");
-		asm volatile ("movaps %0, %%xmm2\n\t"
-			      : : "m" (*m128p_src++) : "xmm2", "memory");
-		asm volatile ("movaps %0, %%xmm3\n\t"
-			      : : "m" (*m128p_src++) : "xmm3", "memory");
-		asm volatile ("movaps %0, %%xmm4\n\t"
-			      : : "m" (*m128p_src++) : "xmm4", "memory");
-		asm volatile ("movaps %0, %%xmm5\n\t"
-			      : : "m" (*m128p_src++) : "xmm5", "memory");
-		asm volatile ("movaps %0, %%xmm6\n\t"
-			      : : "m" (*m128p_src++) : "xmm6", "memory");
-		asm volatile ("movaps %0, %%xmm7\n\t"
-			      : : "m" (*m128p_src++) : "xmm7", "memory");
-
-		asm volatile ("movaps %%xmm0, %0\n\t"
-			      : "=m" (*m128p_dest++) : : "xmm0", "memory");
-		asm volatile ("movaps %%xmm1, %0\n\t"
-			      : "=m" (*m128p_dest++) : : "xmm1", "memory");
-		asm volatile ("movaps %%xmm2, %0\n\t"
-			      : "=m" (*m128p_dest++) : : "xmm2", "memory");
-		asm volatile ("movaps %%xmm3, %0\n\t"
-			      : "=m" (*m128p_dest++) : : "xmm3", "memory");
-		asm volatile ("movaps %%xmm4, %0\n\t"
-			      : "=m" (*m128p_dest++) : : "xmm4", "memory");
-		asm volatile ("movaps %%xmm5, %0\n\t"
-			      : "=m" (*m128p_dest++) : : "xmm5", "memory");
-		asm volatile ("movaps %%xmm6, %0\n\t"
-			      : "=m" (*m128p_dest++) : : "xmm6", "memory");
-		asm volatile ("movaps %%xmm7, %0\n\t"
-			      : "=m" (*m128p_dest++) : : "xmm7", "memory");
-	}
-	for (i = 0; i < n2; i++) {
-		asm volatile (
-			"movaps %1, %%xmm0\n\t"	\
-			"movaps %%xmm0, %0\n\t"
-			: "=m" (*m128p_dest++)
-			: "m" (*m128p_src++)
-			: "xmm0", "memory");
-	}
-	for (i = si3; i < length; i++) {
-		asm volatile (
-			"movss %1, %%xmm0\n\t" \
-			"movss %%xmm0, %0\n\t"
-			: "=m" (dest[i])
-			: "m" (src[i])
-			: "xmm0", "memory");
-	}
-}
-
-void
-x86_sse_add2f (float *dest, const float *src, int length)
-{
-	int i, n, si2;
-	pv4sf m128p_src = (pv4sf)src;
-	pv4sf m128p_dest = (pv4sf)dest;
-
-	if (__builtin_expect (((long)src & 0xf) || ((long)dest & 0xf), 0)) {
-		/*jack_error("x86_sse_add2f(): non aligned pointers!");*/
-		si2 = 0;
-		goto sse_nonalign;
-	}
-	si2 = (length & ~0x3);
-	n = (length >> 2);
-	for (i = 0; i < n; i++) {
-		asm volatile (
-			"movaps %1, %%xmm0\n\t"	\
-			"addps %2, %%xmm0\n\t" \
-			"movaps %%xmm0, %0\n\t"
-			: "=m" (m128p_dest[i])
-			: "m0" (m128p_dest[i]),
-			"m" (m128p_src[i])
-			: "xmm0", "memory");
-	}
-sse_nonalign:
-	for (i = si2; i < length; i++) {
-		asm volatile (
-			"movss %1, %%xmm0\n\t" \
-			"addss %2, %%xmm0\n\t" \
-			"movss %%xmm0, %0\n\t"
-			: "=m" (dest[i])
-			: "m0" (dest[i]),
-			"m" (src[i])
-			: "xmm0", "memory");
-	}
-}
-
 void x86_sse_f2i (int *dest, const float *src, int length, float scale)
 {
 	int i;
@@ -410,7 +227,184 @@ sse_nonalign:
 	}
 }
 
+/* AVX2 and AVX-512 detection also has to ask the OS (XCR0) whether it
+ * saves the wide register state on context switch; the CPUID feature
+ * bits alone are not enough.
+ */
+int
+have_avx ()
+{
+	unsigned int eax, ebx, ecx, edx;
+	unsigned int xcr0_lo, xcr0_hi;
+
+	if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx)) {
+		return 0;
+	}
+	/* OSXSAVE and AVX */
+	if ((ecx & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28))) {
+		return 0;
+	}
+	asm volatile ("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+	/* XMM and YMM state */
+	if ((xcr0_lo & 0x06) != 0x06) {
+		return 0;
+	}
+	if (__get_cpuid_max (0, 0) < 7) {
+		return 0;
+	}
+	__cpuid_count (7, 0, eax, ebx, ecx, edx);
+	if (!(ebx & (1 << 5))) {
+		return 0;
+	}
+	/* AVX-512F, plus opmask and ZMM state */
+	if ((ebx & (1 << 16)) && (xcr0_lo & 0xe0) == 0xe0) {
+		return 2;
+	}
+	return 1;
+}
+
+/* The fused mixdown kernels write the sum of all `nsrc' source buffers
+ * to `dest' in a single pass.  `dest' may also be src[0], which is how
+ * port.c carries a running sum across batches of sources.  Samples are
+ * added in source order, so the result is bit-identical to repeated
+ * two-way adds.
+ */
+
+void
+x86_sse_mixnf (float *dest, const float * const *src, int nsrc, int length)
+{
+	int i, k;
+	v4sf a0, a1, a2, a3;
+
+	for (i = 0; i + 16 <= length; i += 16) {
+		a0 = *(const v4sf_u*)(src[0] + i);
+		a1 = *(const v4sf_u*)(src[0] + i + 4);
+		a2 = *(const v4sf_u*)(src[0] + i + 8);
+		a3 = *(const v4sf_u*)(src[0] + i + 12);
+		for (k = 1; k < nsrc; k++) {
+			a0 += *(const v4sf_u*)(src[k] + i);
+			a1 += *(const v4sf_u*)(src[k] + i + 4);
+			a2 += *(const v4sf_u*)(src[k] + i + 8);
+			a3 += *(const v4sf_u*)(src[k] + i + 12);
+		}
+		*(v4sf_u*)(dest + i) = a0;
+		*(v4sf_u*)(dest + i + 4) = a1;
+		*(v4sf_u*)(dest + i + 8) = a2;
+		*(v4sf_u*)(dest + i + 12) = a3;
+	}
+	mixnf_tail (dest, src, nsrc, i, length);
+}
+
+__attribute__((target ("avx2"))) void
+x86_avx2_mixnf (float *dest, const float * const *src, int nsrc, int length)
+{
+	int i, k;
+	v8sf a0, a1, a2, a3;
+
+	for (i = 0; i + 32 <= length; i += 32) {
+		a0 = *(const v8sf_u*)(src[0] + i);
+		a1 = *(const v8sf_u*)(src[0] + i + 8);
+		a2 = *(const v8sf_u*)(src[0] + i + 16);
+		a3 = *(const v8sf_u*)(src[0] + i + 24);
+		for (k = 1; k < nsrc; k++) {
+			a0 += *(const v8sf_u*)(src[k] + i);
+			a1 += *(const v8sf_u*)(src[k] + i + 8);
+			a2 += *(const v8sf_u*)(src[k] + i + 16);
+			a3 += *(const v8sf_u*)(src[k] + i + 24);
+		}
+		*(v8sf_u*)(dest + i) = a0;
+		*(v8sf_u*)(dest + i + 8) = a1;
+		*(v8sf_u*)(dest + i + 16) = a2;
+		*(v8sf_u*)(dest + i + 24) = a3;
+	}
+	for (; i + 8 <= length; i += 8) {
+		a0 = *(const v8sf_u*)(src[0] + i);
+		for (k = 1; k < nsrc; k++)
+			a0 += *(const v8sf_u*)(src[k] + i);
+		*(v8sf_u*)(dest + i) = a0;
+	}
+	mixnf_tail (dest, src, nsrc, i, length);
+}
+
+__attribute__((target ("avx512f"))) void
+x86_avx512_mixnf (float *dest, const float * const *src, int nsrc, int length)
+{
+	int i, k;
+	v16sf a0, a1, a2, a3;
+
+	for (i = 0; i + 64 <= length; i += 64) {
+		a0 = *(const v16sf_u*)(src[0] + i);
+		a1 = *(const v16sf_u*)(src[0] + i + 16);
+		a2 = *(const v16sf_u*)(src[0] + i + 32);
+		a3 = *(const v16sf_u*)(src[0] + i + 48);
+		for (k = 1; k < nsrc; k++) {
+			a0 += *(const v16sf_u*)(src[k] + i);
+			a1 += *(const v16sf_u*)(src[k] + i + 16);
+			a2 += *(const v16sf_u*)(src[k] + i + 32);
+			a3 += *(const v16sf_u*)(src[k] + i + 48);
+		}
+		*(v16sf_u*)(dest + i) = a0;
+		*(v16sf_u*)(dest + i + 16) = a1;
+		*(v16sf_u*)(dest + i + 32) = a2;
+		*(v16sf_u*)(dest + i + 48) = a3;
+	}
+	for (; i + 16 <= length; i += 16) {
+		a0 = *(const v16sf_u*)(src[0] + i);
+		for (k = 1; k < nsrc; k++)
+			a0 += *(const v16sf_u*)(src[k] + i);
+		*(v16sf_u*)(dest + i) = a0;
+	}
+	mixnf_tail (dest, src, nsrc, i, length);
+}
+
 #endif  /* ARCH_X86 */
 
+#ifdef ARCH_AARCH64
+
+#ifdef __linux__
+#include <sys/auxv.h>
+#endif
+
+/* Advanced SIMD is architecturally mandatory on AArch64, but ask the
+ * kernel anyway so that a strange configuration falls back to C.
+ */
+int
+have_neon ()
+{
+#if defined(__linux__) && defined(HWCAP_ASIMD)
+	return (getauxval (AT_HWCAP) & HWCAP_ASIMD) != 0;
+#else
+	return 1;
+#endif
+}
+
+/* See the x86 mixdown kernels above. */
+void
+neon_mixnf (float *dest, const float * const *src, int nsrc, int length)
+{
+	int i, k;
+	v4sf a0, a1, a2, a3;
+
+	for (i = 0; i + 16 <= length; i += 16) {
+		a0 = *(const v4sf_u*)(src[0] + i);
+		a1 = *(const v4sf_u*)(src[0] + i + 4);
+		a2 = *(const v4sf_u*)(src[0] + i + 8);
+		a3 = *(const v4sf_u*)(src[0] + i + 12);
+		for (k = 1; k < nsrc; k++) {
+			a0 += *(const v4sf_u*)(src[k] + i);
+			a1 += *(const v4sf_u*)(src[k] + i + 4);
+			a2 += *(const v4sf_u*)(src[k] + i + 8);
+			a3 += *(const v4sf_u*)(src[k] + i + 12);
+		}
+		*(v4sf_u*)(dest + i) = a0;
+		*(v4sf_u*)(dest + i + 4) = a1;
+		*(v4sf_u*)(dest + i + 8) = a2;
+		*(v4sf_u*)(dest + i + 12) = a3;
+	}
+	mixnf_tail (dest, src, nsrc, i, length);
+}
+
+#endif  /* ARCH_AARCH64 */
+
 #endif  /* USE_DYNSIMD */
 
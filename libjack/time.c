@@ -46,6 +46,8 @@ jack_clock_source_name (jack_timer_type_t src)
 	switch (src) {
 	case JACK_TIMER_HPET:
 		return "hpet";
+	case JACK_TIMER_TSC:
+		return "tsc";
 	case JACK_TIMER_SYSTEM_CLOCK:
 #if HAVE_CLOCK_GETTIME
 		return "system clock via clock_gettime";
@@ -88,6 +90,10 @@ jack_get_microseconds_from_system (void)
 
 #endif /* HAVE_CLOCK_GETTIME */
 
+/* set up by the system-dependent code below in the server, and
+   copied from the engine control segment by clients */
+jack_tsc_calibration_t jack_tsc_calibration;
+
 /* everything below here should be system-dependent */
 
 #include <sysdeps/time.c>
@@ -0,0 +1,235 @@
+/*
+    Cycle timing trace readers.
+
+    Copyright (C) 2026 The JACK developers
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public License
+    as published by the Free Software Foundation; either version 2.1
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this program; if not, write to the Free
+    Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+    02111-1307, USA.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal.h"
+#include "local.h"
+
+/* None of these touch anything the server's real-time thread waits
+ * for: they only copy out of the trace rings in the engine control
+ * segment (see jack_trace_slot_t).
+ */
+
+int
+jack_trace_slot_by_name (jack_client_t *client, const char *client_name)
+{
+	jack_trace_slot_t *slots = jack_trace_slots (client->engine);
+	int i;
+
+	for (i = 0; i < JACK_TRACE_SLOTS; i++) {
+		if (slots[i].in_use &&
+		    strcmp (slots[i].client_name, client_name) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/* Copy the name of the client traced in `slot' to `client_name', which
+ * must hold JACK_CLIENT_NAME_SIZE characters.  Returns -1 if the slot
+ * is not in use.
+ */
+int
+jack_trace_slot_name (jack_client_t *client, int slot, char *client_name)
+{
+	jack_trace_slot_t *tslot;
+
+	if (slot < 0 || slot >= JACK_TRACE_SLOTS) {
+		return -1;
+	}
+
+	tslot = &jack_trace_slots (client->engine)[slot];
+
+	if (!tslot->in_use) {
+		return -1;
+	}
+
+	acquire_fence ();
+	memcpy (client_name, tslot->client_name, JACK_CLIENT_NAME_SIZE);
+	client_name[JACK_CLIENT_NAME_SIZE - 1] = '\0';
+
+	return 0;
+}
+
+/* Copy up to `max' of the entries written to `slot' since `*cursor',
+ * oldest first, and advance `*cursor' past them.  Start with a cursor
+ * of zero.  Entries that were overwritten before they could be copied
+ * are skipped.  Returns the number of entries copied, or -1 if the slot
+ * is not in use.
+ */
+int
+jack_trace_read (jack_client_t *client, int slot, uint32_t *cursor,
+		 jack_trace_entry_t *entries, int max)
+{
+	jack_trace_slot_t *tslot;
+	uint32_t head, first, n, i;
+
+	if (slot < 0 || slot >= JACK_TRACE_SLOTS) {
+		return -1;
+	}
+
+	tslot = &jack_trace_slots (client->engine)[slot];
+
+	if (!tslot->in_use) {
+		return -1;
+	}
+
+	head = tslot->head;
+	acquire_fence ();
+
+	/* the slot has been handed to a new client since the last read */
+	if (*cursor > head) {
+		*cursor = 0;
+	}
+
+	first = *cursor;
+	if (head - first > JACK_TRACE_RING) {
+		first = head - JACK_TRACE_RING;
+	}
+
+	n = head - first;
+	if (n > (uint32_t)max) {
+		n = max;
+	}
+
+	for (i = 0; i < n; i++) {
+		entries[i] = tslot->ring[(first + i) & (JACK_TRACE_RING - 1)];
+	}
+
+	/* anything the server wrapped over while we were copying is
+	   not to be trusted */
+	acquire_fence ();
+	head = tslot->head;
+
+	if (head - first > JACK_TRACE_RING) {
+		uint32_t lost = head - first - JACK_TRACE_RING;
+
+		if (lost >= n) {
+			*cursor = head - JACK_TRACE_RING;
+			return 0;
+		}
+		memmove (entries, entries + lost, (n - lost) * sizeof(*entries));
+		first += lost;
+		n -= lost;
+	}
+
+	*cursor = first + n;
+
+	return n;
+}
+
+static uint32_t
+jack_trace_value (const jack_trace_entry_t *entry, jack_trace_field_t field)
+{
+	switch (field) {
+	case JackTraceWakeup:
+		return entry->wakeup_usecs;
+	case JackTraceProcess:
+		return entry->process_usecs;
+	case JackTraceFinish:
+		return entry->finish_usecs;
+	}
+	return 0;
+}
+
+static int
+jack_trace_compare (const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t*)a;
+	uint32_t y = *(const uint32_t*)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Return the given percentile (0 to 100) of one timing over `n'
+ * entries, ignoring entries for cycles the client did not finish.
+ */
+uint32_t
+jack_trace_percentile (const jack_trace_entry_t *entries, int n,
+		       jack_trace_field_t field, float percentile)
+{
+	uint32_t *values;
+	uint32_t result;
+	int i, count = 0;
+
+	if (n <= 0 || (values = (uint32_t*)malloc (n * sizeof(uint32_t))) == NULL) {
+		return 0;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (!(entries[i].flags & JackTraceUnfinished)) {
+			values[count++] = jack_trace_value (&entries[i], field);
+		}
+	}
+
+	if (count == 0) {
+		free (values);
+		return 0;
+	}
+
+	qsort (values, count, sizeof(uint32_t), jack_trace_compare);
+
+	if (percentile <= 0.0f) {
+		i = 0;
+	} else if (percentile >= 100.0f) {
+		i = count - 1;
+	} else {
+		i = (int)(percentile / 100.0f * (count - 1) + 0.5f);
+	}
+
+	result = values[i];
+	free (values);
+
+	return result;
+}
+
+/* Count one timing over `n' entries into `nbuckets' buckets of
+ * `bucket_usecs' each.  The last bucket also counts everything longer.
+ */
+void
+jack_trace_histogram (const jack_trace_entry_t *entries, int n,
+		      jack_trace_field_t field, uint32_t bucket_usecs,
+		      uint32_t *buckets, int nbuckets)
+{
+	uint32_t b;
+	int i;
+
+	memset (buckets, 0, nbuckets * sizeof(uint32_t));
+
+	if (bucket_usecs == 0 || nbuckets <= 0) {
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (entries[i].flags & JackTraceUnfinished) {
+			continue;
+		}
+		b = jack_trace_value (&entries[i], field) / bucket_usecs;
+		if (b >= (uint32_t)nbuckets) {
+			b = nbuckets - 1;
+		}
+		buckets[b]++;
+	}
+}
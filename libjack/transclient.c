@@ -42,40 +42,42 @@ jack_generate_unique_id (jack_control_t *ectl)
 	return exchange_and_add (&ectl->seq_number, 1);
 }
 
-static inline void
+/* Copy the frame timer, which the server updates once per cycle as a
+ * seqlock: guard1 is bumped before the update and guard2 after it, so
+ * a copy taken after reading guard2 and before reading guard1 is
+ * consistent if the two match.  This is called from process threads,
+ * so it never sleeps: if the server keeps getting in the way (it has
+ * been preempted in the middle of an update, say), it gives up and
+ * returns -1.
+ */
+#define JACK_FRAME_TIME_TRIES 64
+
+static inline int
 jack_read_frame_time (const jack_client_t *client, jack_frame_timer_t *copy)
 {
-	int tries = 0;
-	long timeout = 1000;
+	const jack_frame_timer_t *timer = &client->engine->frame_timer;
+	uint32_t guard;
+	int tries;
 
-	do {
-		/* throttle the busy wait if we don't get
-		   the answer very quickly.
-
-		   XXX This is disgusting. on a UP
-		   system, it needs to sleep
-		   if the first try didn't work. on an SMP
-		   system, it should wait for half of
-		   the context switch time before
-		   sleeping.
-		 */
+	for (tries = 0; tries < JACK_FRAME_TIME_TRIES; tries++) {
 
-		if (tries > 10) {
-			usleep (20);
-			tries = 0;
+		guard = timer->guard2;
+		acquire_fence ();
 
-			/* debug code to avoid system hangs... */
-			if (--timeout == 0) {
-				jack_error ("hung in loop copying position A");
-				abort ();
-			}
-		}
+		copy->frames = timer->frames;
+		copy->current_wakeup = timer->current_wakeup;
+		copy->next_wakeup = timer->next_wakeup;
+		copy->period_usecs = timer->period_usecs;
+		copy->initialized = timer->initialized;
 
-		*copy = client->engine->frame_timer;
-
-		tries++;
+		acquire_fence ();
+		if (timer->guard1 == guard) {
+			copy->guard1 = copy->guard2 = guard;
+			return 0;
+		}
+	}
 
-	} while (copy->guard1 != copy->guard2);
+	return -1;
 }
 
 /* copy a JACK transport position structure (thread-safe) */
@@ -227,12 +229,18 @@ jack_get_current_transport_frame (const jack_client_t *client)
 jack_nframes_t
 jack_frames_since_cycle_start (const jack_client_t *client)
 {
-	float usecs;
 	jack_control_t *ectl = client->engine;
+	int64_t usecs;
+
+	/* the cycle start only changes between cycles, so this needs
+	   neither the frame timer nor floating point */
+	usecs = (int64_t)(jack_get_microseconds () - ectl->current_time.usecs);
+	if (usecs <= 0) {
+		return 0;
+	}
 
-	usecs = jack_get_microseconds () - ectl->current_time.usecs;
-	return (jack_nframes_t)floor ((((float)ectl->current_time.frame_rate)
-				       / 1000000.0f) * usecs);
+	return (jack_nframes_t)(((uint64_t)usecs
+				 * ectl->current_time.frame_rate) / 1000000);
 }
 
 int
@@ -244,8 +252,7 @@ jack_get_cycle_times (const jack_client_t *client,
 {
 	jack_frame_timer_t time;
 
-	jack_read_frame_time (client, &time);
-	if (time.initialized) {
+	if (jack_read_frame_time (client, &time) == 0 && time.initialized) {
 		*current_frames  = time.frames;
 		*current_usecs   = time.current_wakeup;
 		*next_usecs      = time.next_wakeup;
@@ -267,8 +274,7 @@ jack_time_to_frames (const jack_client_t *client, jack_time_t usecs)
 	jack_frame_timer_t time;
 	jack_control_t *ectl = client->engine;
 
-	jack_read_frame_time (client, &time);
-	if (time.initialized) {
+	if (jack_read_frame_time (client, &time) == 0 && time.initialized) {
 		/*
 		   Make sure we have signed differences. It would make a lot  of sense
 		   to use the standard signed intNN_t types everywhere  instead of e.g.
@@ -307,8 +313,7 @@ jack_frames_to_time (const jack_client_t *client, jack_nframes_t frames)
 	jack_frame_timer_t time;
 	jack_control_t *ectl = client->engine;
 
-	jack_read_frame_time (client, &time);
-	if (time.initialized) {
+	if (jack_read_frame_time (client, &time) == 0 && time.initialized) {
 		/*
 		   Make sure we have signed differences. It would make a lot  of sense
 		   to use the standard signed intNN_t types everywhere  instead of e.g.